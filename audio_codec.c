@@ -0,0 +1,149 @@
+#include "audio_codec.h"
+#include <string.h>
+
+static const char *const codec_names[AUDIO_CODEC_COUNT] = {
+    [AUDIO_CODEC_FLOAT32] = "float32",
+    [AUDIO_CODEC_PCM16] = "pcm16",
+    [AUDIO_CODEC_IMA_ADPCM] = "adpcm",
+};
+
+static const int8_t ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static const int16_t ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+    19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+    130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+    876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+    5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const char *audio_codec_name(audio_codec_t codec) {
+    if (codec < 0 || codec >= AUDIO_CODEC_COUNT) {
+        return "unknown";
+    }
+    return codec_names[codec];
+}
+
+int audio_codec_from_name(const char *name) {
+    if (!name) {
+        return -1;
+    }
+    for (int i = 0; i < AUDIO_CODEC_COUNT; i++) {
+        if (strcmp(name, codec_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint32_t audio_codec_encoded_size(audio_codec_t codec, uint32_t num_samples) {
+    switch (codec) {
+        case AUDIO_CODEC_PCM16:
+            return num_samples * 2;
+        case AUDIO_CODEC_IMA_ADPCM:
+            return IMA_ADPCM_HEADER_SIZE + (num_samples + 1) / 2;
+        case AUDIO_CODEC_FLOAT32:
+        default:
+            return num_samples * 4;
+    }
+}
+
+uint32_t ima_adpcm_write_header(const ima_adpcm_state_t *state, uint8_t *out) {
+    out[0] = (uint16_t)state->predictor & 0xFF;
+    out[1] = ((uint16_t)state->predictor >> 8) & 0xFF;
+    out[2] = state->step_index;
+    out[3] = 0;
+    return IMA_ADPCM_HEADER_SIZE;
+}
+
+// Advance the decoder model by one nibble (shared by encoder and decoder)
+static inline int16_t ima_adpcm_step(ima_adpcm_state_t *state, uint8_t nibble) {
+    int32_t step = ima_step_table[state->step_index];
+    int32_t diff = step >> 3;
+
+    if (nibble & 4) diff += step;
+    if (nibble & 2) diff += step >> 1;
+    if (nibble & 1) diff += step >> 2;
+
+    int32_t predictor = state->predictor + ((nibble & 8) ? -diff : diff);
+    if (predictor > 32767) predictor = 32767;
+    if (predictor < -32768) predictor = -32768;
+    state->predictor = (int16_t)predictor;
+
+    int32_t index = state->step_index + ima_index_table[nibble];
+    if (index < 0) index = 0;
+    if (index > 88) index = 88;
+    state->step_index = (uint8_t)index;
+
+    return state->predictor;
+}
+
+static inline uint8_t ima_adpcm_encode_sample(ima_adpcm_state_t *state, int16_t sample) {
+    int32_t step = ima_step_table[state->step_index];
+    int32_t diff = sample - state->predictor;
+    uint8_t nibble = 0;
+
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 1;
+    }
+
+    // Track exactly what the decoder will reconstruct
+    ima_adpcm_step(state, nibble);
+    return nibble;
+}
+
+uint32_t ima_adpcm_encode(ima_adpcm_state_t *state, const int16_t *samples, uint32_t num_samples,
+                          uint32_t stride, uint8_t *out) {
+    uint32_t bytes = 0;
+
+    for (uint32_t i = 0; i < num_samples; i += 2) {
+        uint8_t lo = ima_adpcm_encode_sample(state, samples[i * stride]);
+        uint8_t hi = 0;
+        if (i + 1 < num_samples) {
+            hi = ima_adpcm_encode_sample(state, samples[(i + 1) * stride]);
+        }
+        out[bytes++] = lo | (hi << 4);
+    }
+
+    return bytes;
+}
+
+uint32_t ima_adpcm_decode_frame(const uint8_t *frame, uint32_t frame_len, int16_t *out) {
+    ima_adpcm_state_t state;
+    uint32_t count = 0;
+
+    if (frame_len < IMA_ADPCM_HEADER_SIZE) {
+        return 0;
+    }
+
+    state.predictor = (int16_t)(frame[0] | (frame[1] << 8));
+    state.step_index = (frame[2] > 88) ? 88 : frame[2];
+
+    for (uint32_t i = IMA_ADPCM_HEADER_SIZE; i < frame_len; i++) {
+        out[count++] = ima_adpcm_step(&state, frame[i] & 0x0F);
+        out[count++] = ima_adpcm_step(&state, frame[i] >> 4);
+    }
+
+    return count;
+}
@@ -0,0 +1,72 @@
+#ifndef __AUDIO_CODEC_H__
+#define __AUDIO_CODEC_H__
+
+#include <stdint.h>
+
+// Uplink audio encodings the STT client can negotiate per session.
+// Stock WhisperLive only understands FLOAT32; the others need the codec
+// gateway (tools/whisper_codec_gateway.py) in front of the server.
+typedef enum {
+    AUDIO_CODEC_FLOAT32 = 0,   // mono float32 [-1, 1], 4 bytes/sample
+    AUDIO_CODEC_PCM16,         // mono int16 little-endian, 2 bytes/sample
+    AUDIO_CODEC_IMA_ADPCM,     // mono 4-bit IMA ADPCM, 0.5 bytes/sample
+    AUDIO_CODEC_COUNT
+} audio_codec_t;
+
+// Every IMA ADPCM frame is self-contained: a 4-byte header
+// (predictor int16 LE, step index, reserved) followed by packed nibbles,
+// low nibble first.
+#define IMA_ADPCM_HEADER_SIZE 4
+
+typedef struct {
+    int16_t predictor;
+    uint8_t step_index;
+} ima_adpcm_state_t;
+
+/**
+ * @brief Get the wire name of a codec ("float32", "pcm16", "adpcm")
+ */
+const char *audio_codec_name(audio_codec_t codec);
+
+/**
+ * @brief Look up a codec by wire name
+ * @return codec, or -1 if unknown
+ */
+int audio_codec_from_name(const char *name);
+
+/**
+ * @brief Encoded payload size of one frame
+ * @param codec Codec
+ * @param num_samples Number of mono samples
+ * @return Size in bytes
+ */
+uint32_t audio_codec_encoded_size(audio_codec_t codec, uint32_t num_samples);
+
+/**
+ * @brief Write the IMA ADPCM frame header for the current state
+ * @return IMA_ADPCM_HEADER_SIZE
+ */
+uint32_t ima_adpcm_write_header(const ima_adpcm_state_t *state, uint8_t *out);
+
+/**
+ * @brief Encode int16 samples to packed IMA ADPCM nibbles
+ * @param state Encoder state (carried across calls within one frame)
+ * @param samples Input samples
+ * @param num_samples Number of samples to encode (even, except at the end of a frame)
+ * @param stride Distance between samples (2 to take one channel of stereo input)
+ * @param out Output, (num_samples + 1) / 2 bytes
+ * @return Number of bytes written
+ */
+uint32_t ima_adpcm_encode(ima_adpcm_state_t *state, const int16_t *samples, uint32_t num_samples,
+                          uint32_t stride, uint8_t *out);
+
+/**
+ * @brief Decode one IMA ADPCM frame (header + nibbles)
+ * @param frame Encoded frame
+ * @param frame_len Frame length in bytes
+ * @param out Output samples, 2 * (frame_len - IMA_ADPCM_HEADER_SIZE) entries
+ * @return Number of samples decoded
+ */
+uint32_t ima_adpcm_decode_frame(const uint8_t *frame, uint32_t frame_len, int16_t *out);
+
+#endif // __AUDIO_CODEC_H__
@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+#include "bflb_mtd.h"
+#include "easyflash.h"
+#include "boot_cache.h"
+
+#define DBG_TAG "BOOTCACHE"
+
+#define BOOT_CACHE_MAGIC 0x43544F42   // "BOTC"
+#define BOOT_CACHE_VERSION 1
+
+// Every record is stored as header + payload under its own easyflash key
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t len;          // Payload bytes
+    uint32_t crc;          // CRC-32 of the payload
+} boot_cache_header_t;
+
+typedef struct {
+    char host[BOOT_CACHE_HOST_MAX];
+    uint16_t port;
+    uint16_t len;
+    uint8_t data[BOOT_CACHE_TLS_SESSION_MAX];
+} boot_cache_tls_t;
+
+typedef struct {
+    char host[BOOT_CACHE_HOST_MAX];
+    uint32_t addr;
+    uint32_t ttl_s;
+} boot_cache_dns_entry_t;
+
+typedef struct {
+    boot_cache_dns_entry_t entries[BOOT_CACHE_DNS_MAX];
+} boot_cache_dns_t;
+
+typedef struct {
+    char url[BOOT_CACHE_URL_MAX];
+    uint32_t score_ms;
+    uint32_t fail_streak;
+} boot_cache_endpoint_t;
+
+typedef struct {
+    boot_cache_endpoint_t entries[BOOT_CACHE_ENDPOINT_MAX];
+} boot_cache_endpoints_t;
+
+typedef enum {
+    RECORD_TLS = 0,
+    RECORD_DNS,
+    RECORD_ENDPOINTS,
+    RECORD_COUNT
+} boot_cache_record_t;
+
+// Write state of one record
+typedef struct {
+    const char *key;
+    void *payload;
+    uint32_t size;
+    bool dirty;            // RAM differs from flash
+    bool urgent;           // Dirty with a change that matters at the next boot
+    uint32_t written_ms;
+} boot_cache_slot_t;
+
+// RAM copies, guarded by cache_lock
+static boot_cache_tls_t cache_tls;
+static boot_cache_dns_t cache_dns;
+static boot_cache_endpoints_t cache_endpoints;
+static uint32_t dns_confirmed_ms[BOOT_CACHE_DNS_MAX];   // Start of each address's TTL
+static bool dns_from_flash[BOOT_CACHE_DNS_MAX];         // Loaded at boot, not resolved since
+static SemaphoreHandle_t cache_lock;
+static bool flash_ok;
+
+static boot_cache_slot_t slots[RECORD_COUNT] = {
+    [RECORD_TLS] = {"bc_tls", &cache_tls, sizeof(cache_tls)},
+    [RECORD_DNS] = {"bc_dns", &cache_dns, sizeof(cache_dns)},
+    [RECORD_ENDPOINTS] = {"bc_ep", &cache_endpoints, sizeof(cache_endpoints)},
+};
+
+static uint32_t cache_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static uint32_t crc32(const uint8_t *data, uint32_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+// Bytes of the payload worth storing; the TLS record is mostly unused buffer
+static uint32_t payload_len(boot_cache_record_t record) {
+    if (record == RECORD_TLS) {
+        return offsetof(boot_cache_tls_t, data) + cache_tls.len;
+    }
+    return slots[record].size;
+}
+
+static void load_record(boot_cache_record_t record, uint8_t *buf, uint32_t buf_size) {
+    boot_cache_slot_t *slot = &slots[record];
+    boot_cache_header_t header;
+    size_t saved_len = 0;
+
+    size_t read = ef_get_env_blob(slot->key, buf, buf_size, &saved_len);
+    if (read == 0) {
+        return;  // Never written
+    }
+    if (read < sizeof(header) || read != saved_len) {
+        LOG_W("%s: bad length %d, ignored", slot->key, (int)saved_len);
+        return;
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (header.magic != BOOT_CACHE_MAGIC || header.version != BOOT_CACHE_VERSION ||
+        header.len > slot->size || sizeof(header) + header.len != read ||
+        crc32(buf + sizeof(header), header.len) != header.crc) {
+        LOG_W("%s: invalid record, ignored", slot->key);
+        return;
+    }
+    memcpy(slot->payload, buf + sizeof(header), header.len);
+}
+
+static void write_record(boot_cache_record_t record, uint8_t *buf) {
+    boot_cache_slot_t *slot = &slots[record];
+    boot_cache_header_t header;
+    uint32_t len = payload_len(record);
+
+    header.magic = BOOT_CACHE_MAGIC;
+    header.version = BOOT_CACHE_VERSION;
+    header.len = len;
+    header.crc = crc32(slot->payload, len);
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), slot->payload, len);
+
+    if (ef_set_env_blob(slot->key, buf, sizeof(header) + len) != EF_NO_ERR) {
+        LOG_W("%s: flash write failed", slot->key);
+        return;
+    }
+    slot->dirty = false;
+    slot->urgent = false;
+    slot->written_ms = cache_now_ms();
+}
+
+int boot_cache_init(void) {
+    if (cache_lock) {
+        return flash_ok ? 0 : -1;
+    }
+    cache_lock = xSemaphoreCreateMutex();
+    if (!cache_lock) {
+        return -1;
+    }
+
+    bflb_mtd_init();
+    if (easyflash_init() != EF_NO_ERR) {
+        LOG_E("easyflash init failed, cache is RAM only");
+        return -1;
+    }
+    flash_ok = true;
+
+    uint8_t *buf = pvPortMalloc(sizeof(boot_cache_header_t) + sizeof(boot_cache_tls_t));
+    if (!buf) {
+        LOG_E("Failed to allocate load buffer");
+        return -1;
+    }
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        load_record(i, buf, sizeof(boot_cache_header_t) + sizeof(boot_cache_tls_t));
+    }
+    vPortFree(buf);
+
+    // Terminate strings that came from flash
+    cache_tls.host[BOOT_CACHE_HOST_MAX - 1] = '\0';
+    if (cache_tls.len > BOOT_CACHE_TLS_SESSION_MAX) {
+        cache_tls.len = 0;
+    }
+    // The flash record has no clock to age against, so a saved address may
+    // be any age: count it as already expired rather than restart its TTL
+    uint32_t dns_count = 0, endpoint_count = 0;
+    for (int i = 0; i < BOOT_CACHE_DNS_MAX; i++) {
+        cache_dns.entries[i].host[BOOT_CACHE_HOST_MAX - 1] = '\0';
+        dns_confirmed_ms[i] = cache_now_ms() - cache_dns.entries[i].ttl_s * 1000;
+        dns_from_flash[i] = (cache_dns.entries[i].host[0] != '\0');
+        dns_count += (cache_dns.entries[i].host[0] != '\0');
+    }
+    for (int i = 0; i < BOOT_CACHE_ENDPOINT_MAX; i++) {
+        cache_endpoints.entries[i].url[BOOT_CACHE_URL_MAX - 1] = '\0';
+        endpoint_count += (cache_endpoints.entries[i].url[0] != '\0');
+    }
+
+    LOG_I("Loaded TLS session %s, %d address(es), %d endpoint(s)",
+          cache_tls.len ? cache_tls.host : "(none)", dns_count, endpoint_count);
+    return 0;
+}
+
+void boot_cache_flush(void) {
+    if (!flash_ok) {
+        return;
+    }
+
+    uint32_t now = cache_now_ms();
+    uint8_t *buf = NULL;
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        boot_cache_slot_t *slot = &slots[i];
+        if (!slot->dirty || (!slot->urgent && now - slot->written_ms < BOOT_CACHE_SAVE_INTERVAL_MS)) {
+            continue;
+        }
+        if (!buf) {
+            buf = pvPortMalloc(sizeof(boot_cache_header_t) + sizeof(boot_cache_tls_t));
+            if (!buf) {
+                break;
+            }
+        }
+        write_record(i, buf);
+    }
+    xSemaphoreGive(cache_lock);
+
+    if (buf) {
+        vPortFree(buf);
+    }
+}
+
+static void mark_dirty(boot_cache_record_t record, bool urgent) {
+    slots[record].dirty = true;
+    slots[record].urgent |= urgent;
+}
+
+int boot_cache_get_tls_session(char *host, uint32_t host_size, int *port,
+                               uint8_t *buf, uint32_t buf_size) {
+    int len = -1;
+
+    if (!cache_lock) {
+        return -1;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    if (cache_tls.len > 0 && cache_tls.len <= buf_size) {
+        strncpy(host, cache_tls.host, host_size - 1);
+        host[host_size - 1] = '\0';
+        *port = cache_tls.port;
+        memcpy(buf, cache_tls.data, cache_tls.len);
+        len = cache_tls.len;
+    }
+    xSemaphoreGive(cache_lock);
+    return len;
+}
+
+void boot_cache_put_tls_session(const char *host, int port, const uint8_t *data,
+                                uint32_t len, bool fresh) {
+    if (!cache_lock || len > BOOT_CACHE_TLS_SESSION_MAX) {
+        return;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    if (cache_tls.len != len || memcmp(cache_tls.data, data, len) != 0) {
+        strncpy(cache_tls.host, host, BOOT_CACHE_HOST_MAX - 1);
+        cache_tls.port = port;
+        cache_tls.len = len;
+        memcpy(cache_tls.data, data, len);
+        mark_dirty(RECORD_TLS, fresh);
+    }
+    xSemaphoreGive(cache_lock);
+}
+
+static int find_dns(const char *host) {
+    for (int i = 0; i < BOOT_CACHE_DNS_MAX; i++) {
+        if (cache_dns.entries[i].host[0] && strcmp(cache_dns.entries[i].host, host) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool boot_cache_get_addr(const char *host, uint32_t *addr, bool *stale) {
+    bool found = false;
+
+    if (!cache_lock) {
+        return false;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int i = find_dns(host);
+    if (i >= 0 && (dns_from_flash[i] ||
+                   cache_now_ms() - dns_confirmed_ms[i] < cache_dns.entries[i].ttl_s * 1000)) {
+        *addr = cache_dns.entries[i].addr;
+        *stale = dns_from_flash[i];
+        found = true;
+    }
+    xSemaphoreGive(cache_lock);
+    return found;
+}
+
+void boot_cache_put_addr(const char *host, uint32_t addr, uint32_t ttl_s) {
+    if (!cache_lock || strlen(host) >= BOOT_CACHE_HOST_MAX) {
+        return;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int i = find_dns(host);
+    if (i < 0) {
+        // Take a free entry, else the one closest to expiry
+        uint32_t now = cache_now_ms();
+        int32_t least_left = 0;
+        for (int j = 0; j < BOOT_CACHE_DNS_MAX; j++) {
+            int32_t left = (int32_t)(dns_confirmed_ms[j] + cache_dns.entries[j].ttl_s * 1000 - now);
+            if (!cache_dns.entries[j].host[0]) {
+                i = j;
+                break;
+            }
+            if (i < 0 || left < least_left) {
+                i = j;
+                least_left = left;
+            }
+        }
+        memset(&cache_dns.entries[i], 0, sizeof(cache_dns.entries[i]));
+        strcpy(cache_dns.entries[i].host, host);
+    }
+    dns_from_flash[i] = false;
+    boot_cache_dns_entry_t *entry = &cache_dns.entries[i];
+    if (entry->addr != addr || entry->ttl_s != ttl_s) {
+        mark_dirty(RECORD_DNS, entry->addr != addr);
+    }
+    entry->addr = addr;
+    entry->ttl_s = ttl_s;
+    dns_confirmed_ms[i] = cache_now_ms();
+    xSemaphoreGive(cache_lock);
+}
+
+void boot_cache_drop_addr(const char *host) {
+    if (!cache_lock) {
+        return;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int i = find_dns(host);
+    if (i >= 0) {
+        memset(&cache_dns.entries[i], 0, sizeof(cache_dns.entries[i]));
+        dns_from_flash[i] = false;
+        mark_dirty(RECORD_DNS, true);
+    }
+    xSemaphoreGive(cache_lock);
+}
+
+static int find_endpoint(const char *url) {
+    for (int i = 0; i < BOOT_CACHE_ENDPOINT_MAX; i++) {
+        if (cache_endpoints.entries[i].url[0] && strcmp(cache_endpoints.entries[i].url, url) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool boot_cache_get_endpoint(const char *url, uint32_t *score_ms, uint32_t *fail_streak) {
+    bool found = false;
+
+    if (!cache_lock) {
+        return false;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int i = find_endpoint(url);
+    if (i >= 0) {
+        *score_ms = cache_endpoints.entries[i].score_ms;
+        *fail_streak = cache_endpoints.entries[i].fail_streak;
+        found = true;
+    }
+    xSemaphoreGive(cache_lock);
+    return found;
+}
+
+void boot_cache_put_endpoint(const char *url, uint32_t score_ms, uint32_t fail_streak) {
+    if (!cache_lock || strlen(url) >= BOOT_CACHE_URL_MAX) {
+        return;
+    }
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int i = find_endpoint(url);
+    bool urgent = false;
+    if (i < 0) {
+        // Endpoints come from config.h, so a full table only follows a config
+        // change; recycle the last entry
+        for (i = 0; i < BOOT_CACHE_ENDPOINT_MAX - 1 && cache_endpoints.entries[i].url[0]; i++) {
+        }
+        memset(&cache_endpoints.entries[i], 0, sizeof(cache_endpoints.entries[i]));
+        strcpy(cache_endpoints.entries[i].url, url);
+        urgent = true;
+    }
+    boot_cache_endpoint_t *entry = &cache_endpoints.entries[i];
+    // Going down or coming back changes the first pick after boot
+    urgent |= ((entry->fail_streak == 0) != (fail_streak == 0));
+    if (urgent || entry->score_ms != score_ms || entry->fail_streak != fail_streak) {
+        mark_dirty(RECORD_ENDPOINTS, urgent);
+    }
+    entry->score_ms = score_ms;
+    entry->fail_streak = fail_streak;
+    xSemaphoreGive(cache_lock);
+}
@@ -0,0 +1,94 @@
+#ifndef __BOOT_CACHE_H__
+#define __BOOT_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Flash-backed cache of network state that makes the first turn after boot warm
+#define BOOT_CACHE_HOST_MAX 64
+#define BOOT_CACHE_URL_MAX 96
+#define BOOT_CACHE_TLS_SESSION_MAX 2048      // Serialized mbedTLS session (ticket + peer cert)
+#define BOOT_CACHE_DNS_MAX 4
+#define BOOT_CACHE_ENDPOINT_MAX 6
+#define BOOT_CACHE_SAVE_INTERVAL_MS (10 * 60 * 1000)  // Routine updates hit flash at most this often
+
+/**
+ * @brief Initialize easyflash and load the cached records
+ *
+ * Records that fail validation (magic, version, length, CRC) are ignored.
+ * Call before https_client_init() and stt_init().
+ *
+ * @return 0 on success, -1 if flash is unavailable (the cache then only lives in RAM)
+ */
+int boot_cache_init(void);
+
+/**
+ * @brief Write changed records to flash
+ *
+ * Changes that matter at the next boot (a new TLS session, a new address,
+ * a server going up or down) are written right away; score drift only every
+ * BOOT_CACHE_SAVE_INTERVAL_MS. Call from an idle point, not during a turn.
+ */
+void boot_cache_flush(void);
+
+/**
+ * @brief Get the cached TLS session
+ * @param host Buffer for the host the session belongs to
+ * @param host_size Size of host
+ * @param port Port the session belongs to
+ * @param buf Buffer for the serialized session
+ * @param buf_size Size of buf
+ * @return Session length, -1 if there is none
+ */
+int boot_cache_get_tls_session(char *host, uint32_t host_size, int *port,
+                               uint8_t *buf, uint32_t buf_size);
+
+/**
+ * @brief Store the latest TLS session
+ * @param fresh New session from a full handshake (written at the next flush);
+ *              false for a resumed one whose ticket may have been renewed
+ */
+void boot_cache_put_tls_session(const char *host, int port, const uint8_t *data,
+                                uint32_t len, bool fresh);
+
+/**
+ * @brief Look up a cached IPv4 address
+ *
+ * Addresses loaded from flash are of unknown age, so they are returned as
+ * stale until the name is resolved again: usable for the first connections,
+ * but due for re-resolution at once.
+ *
+ * @param host Host name
+ * @param addr Address in network byte order
+ * @param stale Set if the address came from flash and has not been confirmed
+ * @return true if an unexpired or flash-loaded address is cached
+ */
+bool boot_cache_get_addr(const char *host, uint32_t *addr, bool *stale);
+
+/**
+ * @brief Record the address a host name resolved to
+ * @param addr Address in network byte order
+ * @param ttl_s Validity in seconds from now
+ */
+void boot_cache_put_addr(const char *host, uint32_t addr, uint32_t ttl_s);
+
+/**
+ * @brief Forget a host's address, e.g. after connecting to it failed
+ */
+void boot_cache_drop_addr(const char *host);
+
+/**
+ * @brief Get the last known health of an endpoint
+ * @param url Endpoint URL
+ * @param score_ms Latency score
+ * @param fail_streak Consecutive failures when last saved
+ * @return true if the endpoint is cached
+ */
+bool boot_cache_get_endpoint(const char *url, uint32_t *score_ms, uint32_t *fail_streak);
+
+/**
+ * @brief Record the health of an endpoint
+ */
+void boot_cache_put_endpoint(const char *url, uint32_t score_ms, uint32_t fail_streak);
+
+#endif // __BOOT_CACHE_H__
@@ -22,7 +22,9 @@
  */
 
 #include "bflb_i2c.h"
+#include "bflb_mtimer.h"
 #include "bsp_es8388.h"
+#include <string.h>
 
 /** @addtogroup  BL702_STD_PERIPH_DRIVER
  *  @{
@@ -37,6 +39,9 @@
  */
 
 #define ES8388_I2C_SLAVE_ADDR 0x10
+#define ES8388_REG_CONTROL1   0x00
+#define ES8388_REG_LOUT1_VOL  0x2E
+#define ES8388_CTRL1_SCP_RESET 0x80 /* resets all control port registers to default */
 
 /*@} end of group ES8388_Private_Macros */
 
@@ -50,6 +55,13 @@
  *  @{
  */
 
+/* Shadow of the last value written to (or read from) each register.
+ * A register is only trusted once its bit is set in es8388_shadow_valid.
+ */
+static uint8_t es8388_shadow[ES8388_REG_NUM];
+static uint64_t es8388_shadow_valid;
+static ES8388_I2C_Stats_Type es8388_stats;
+
 /*@} end of group ES8388_Private_Variables */
 
 /** @defgroup  ES8388_Global_Variables
@@ -98,6 +110,90 @@ void ES8388_I2C_Init(void)
     bflb_i2c_init(i2c0, 200000);
 }
 
+/****************************************************************************/ /**
+ * @brief  ES8388 raw I2C transfer of a register address followed by data
+ *
+ * @param  addr: First register address
+ * @param  data: data buffer
+ * @param  len: data length
+ * @param  flags: flags of the data message (0 for write, I2C_M_READ for read)
+ *
+ * @return 0 on success
+ *
+*******************************************************************************/
+static int ES8388_Transfer(uint8_t addr, uint8_t *data, uint8_t len, uint16_t flags)
+{
+    uint64_t start_us;
+    int ret;
+
+    msgs[0].addr = ES8388_I2C_SLAVE_ADDR;
+    msgs[0].flags = I2C_M_NOSTOP;
+    msgs[0].buffer = &addr;
+    msgs[0].length = 1;
+
+    msgs[1].flags = flags;
+    msgs[1].buffer = data;
+    msgs[1].length = len;
+
+    start_us = bflb_mtimer_get_time_us();
+    ret = bflb_i2c_transfer(i2c0, msgs, 2);
+    es8388_stats.busy_us += (uint32_t)(bflb_mtimer_get_time_us() - start_us);
+    es8388_stats.transfers++;
+    es8388_stats.bytes += len;
+
+    if (ret != 0) {
+        es8388_stats.errors++;
+    }
+
+    return ret;
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 update register shadow after a transfer
+ *
+ * @param  addr: First register address
+ * @param  data: data
+ * @param  len: data length
+ * @param  ok: transfer succeeded
+ *
+ * @return None
+ *
+*******************************************************************************/
+static void ES8388_Shadow_Update(uint8_t addr, const uint8_t *data, uint8_t len, int ok)
+{
+    for (uint8_t i = 0; i < len && (addr + i) < ES8388_REG_NUM; i++) {
+        if (ok) {
+            es8388_shadow[addr + i] = data[i];
+            es8388_shadow_valid |= (1ULL << (addr + i));
+        } else {
+            es8388_shadow_valid &= ~(1ULL << (addr + i));
+        }
+    }
+
+    /* A control port reset puts every other register back to its default */
+    if (ok && addr == ES8388_REG_CONTROL1 && (data[0] & ES8388_CTRL1_SCP_RESET)) {
+        es8388_shadow_valid = (1ULL << ES8388_REG_CONTROL1);
+    }
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 check whether the shadow already holds a value
+ *
+ * @param  addr: Register address
+ * @param  data: data
+ *
+ * @return 1 if the write can be skipped
+ *
+*******************************************************************************/
+static int ES8388_Shadow_Match(uint8_t addr, uint8_t data)
+{
+    if (addr >= ES8388_REG_NUM || !(es8388_shadow_valid & (1ULL << addr))) {
+        return 0;
+    }
+
+    return es8388_shadow[addr] == data;
+}
+
 /****************************************************************************/ /**
  * @brief  ES8388 write register
  *
@@ -109,16 +205,80 @@ void ES8388_I2C_Init(void)
 *******************************************************************************/
 int ES8388_Write_Reg(uint8_t addr, uint8_t data)
 {
-    msgs[0].addr = ES8388_I2C_SLAVE_ADDR;
-    msgs[0].flags = I2C_M_NOSTOP;
-    msgs[0].buffer = &addr;
-    msgs[0].length = 1;
+    int ret;
+
+    es8388_stats.writes++;
+
+    if (ES8388_Shadow_Match(addr, data)) {
+        es8388_stats.elided++;
+        return 0;
+    }
+
+    ret = ES8388_Transfer(addr, &data, 1, 0);
+    ES8388_Shadow_Update(addr, &data, 1, ret == 0);
+
+    return ret;
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 write a range of contiguous registers
+ *
+ * Registers at either end of the range that already hold the requested value
+ * are trimmed; what remains goes out as a single burst transaction.
+ *
+ * @param  addr: First register address
+ * @param  data: data
+ * @param  len: Number of registers
+ *
+ * @return 0 on success, -1 if the range runs past register ES8388_REG_NUM - 1
+ *
+*******************************************************************************/
+int ES8388_Write_Regs(uint8_t addr, const uint8_t *data, uint8_t len)
+{
+    uint8_t first = 0;
+    uint8_t last = len;
+    int ret;
+
+    /* The burst buffer and the shadow only cover the register map */
+    if (addr >= ES8388_REG_NUM || len > ES8388_REG_NUM - addr) {
+        return -1;
+    }
+
+    es8388_stats.writes += len;
+
+    while (first < last && ES8388_Shadow_Match(addr + first, data[first])) {
+        first++;
+    }
+
+    while (last > first && ES8388_Shadow_Match(addr + last - 1, data[last - 1])) {
+        last--;
+    }
+
+    es8388_stats.elided += len - (last - first);
+
+    if (first == last) {
+        return 0;
+    }
+
+#if ES8388_I2C_BURST_WRITE
+    uint8_t burst[ES8388_REG_NUM];
+
+    memcpy(burst, data + first, last - first);
+    ret = ES8388_Transfer(addr + first, burst, last - first, 0);
+    ES8388_Shadow_Update(addr + first, data + first, last - first, ret == 0);
+#else
+    ret = 0;
 
-    msgs[1].flags = 0;
-    msgs[1].buffer = &data;
-    msgs[1].length = 1;
+    for (uint8_t i = first; i < last; i++) {
+        uint8_t value = data[i];
+        int res = ES8388_Transfer(addr + i, &value, 1, 0);
 
-    return bflb_i2c_transfer(i2c0, msgs, 2);
+        ES8388_Shadow_Update(addr + i, &value, 1, res == 0);
+        ret |= res;
+    }
+#endif
+
+    return ret;
 }
 
 /****************************************************************************/ /**
@@ -132,16 +292,70 @@ int ES8388_Write_Reg(uint8_t addr, uint8_t data)
 *******************************************************************************/
 int ES8388_Read_Reg(uint8_t addr, uint8_t *rdata)
 {
-    msgs[0].addr = ES8388_I2C_SLAVE_ADDR;
-    msgs[0].flags = I2C_M_NOSTOP;
-    msgs[0].buffer = &addr;
-    msgs[0].length = 1;
+    int ret;
 
-    msgs[1].flags = I2C_M_READ;
-    msgs[1].buffer = rdata;
-    msgs[1].length = 1;
+    es8388_stats.reads++;
+    ret = ES8388_Transfer(addr, rdata, 1, I2C_M_READ);
+    ES8388_Shadow_Update(addr, rdata, 1, ret == 0);
 
-    return bflb_i2c_transfer(i2c0, msgs, 2);
+    return ret;
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 forget the register shadow (e.g. after a codec power cycle)
+ *
+ * @param  None
+ *
+ * @return None
+ *
+*******************************************************************************/
+void ES8388_Shadow_Invalidate(void)
+{
+    es8388_shadow_valid = 0;
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 get I2C traffic statistics
+ *
+ * @param  stats: output
+ *
+ * @return None
+ *
+*******************************************************************************/
+void ES8388_I2C_Stats_Get(ES8388_I2C_Stats_Type *stats)
+{
+    *stats = es8388_stats;
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 reset I2C traffic statistics
+ *
+ * @param  None
+ *
+ * @return None
+ *
+*******************************************************************************/
+void ES8388_I2C_Stats_Reset(void)
+{
+    memset(&es8388_stats, 0, sizeof(es8388_stats));
+}
+
+/****************************************************************************/ /**
+ * @brief  ES8388 print I2C traffic statistics
+ *
+ * @param  session: label printed with the report
+ *
+ * @return None
+ *
+*******************************************************************************/
+void ES8388_I2C_Stats_Dump(const char *session)
+{
+    printf("[ES8388] %s: writes=%lu elided=%lu reads=%lu xfers=%lu bytes=%lu err=%lu i2c=%lu us\r\n",
+           session ? session : "i2c",
+           (unsigned long)es8388_stats.writes, (unsigned long)es8388_stats.elided,
+           (unsigned long)es8388_stats.reads, (unsigned long)es8388_stats.transfers,
+           (unsigned long)es8388_stats.bytes, (unsigned long)es8388_stats.errors,
+           (unsigned long)es8388_stats.busy_us);
 }
 
 /****************************************************************************/ /**
@@ -424,10 +638,10 @@ int ES8388_Set_Voice_Volume(int volume)
     }
 
     volume /= 3;
-    res = ES8388_Write_Reg(0x2e, volume);
-    res |= ES8388_Write_Reg(0x2f, volume);
-    res |= ES8388_Write_Reg(0x30, volume);
-    res |= ES8388_Write_Reg(0x31, volume);
+
+    /* LOUT1/ROUT1/LOUT2/ROUT2 are contiguous (0x2E..0x31) */
+    uint8_t vol_regs[4] = { volume, volume, volume, volume };
+    res = ES8388_Write_Regs(ES8388_REG_LOUT1_VOL, vol_regs, sizeof(vol_regs));
     return res;
 }
 
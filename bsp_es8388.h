@@ -24,6 +24,8 @@
 #ifndef __ES8388_H__
 #define __ES8388_H__
 
+#include <stdint.h>
+
 /** @addtogroup  BL702_STD_PERIPH_DRIVER
  *  @{
  */
@@ -111,6 +113,20 @@ typedef struct
     ES8388_I2S_Data_Width data_width;     /*!< ES8388 I2S dataWitdh */
 } ES8388_Cfg_Type;
 
+/**
+ *  @brief ES8388 I2C traffic statistics
+ */
+typedef struct
+{
+    uint32_t writes;    /*!< Register writes requested by the driver */
+    uint32_t elided;    /*!< Writes skipped because the shadow already held the value */
+    uint32_t reads;     /*!< Register reads issued */
+    uint32_t transfers; /*!< I2C transactions put on the bus */
+    uint32_t bytes;     /*!< Register data bytes transferred */
+    uint32_t errors;    /*!< Failed I2C transactions */
+    uint32_t busy_us;   /*!< Time spent blocked in bflb_i2c_transfer */
+} ES8388_I2C_Stats_Type;
+
 /*@} end of group ES8388_Public_Types */
 
 /** @defgroup  ES8388_Public_Constants
@@ -173,6 +189,16 @@ typedef struct
  *  @{
  */
 
+#define ES8388_REG_NUM 0x40 /*!< Size of the register shadow (covers 0x00..0x3F) */
+
+/* ES8388 auto-increments the register address, so contiguous registers
+ * can be written in one I2C transaction. Set to 0 to fall back to one
+ * transaction per register.
+ */
+#ifndef ES8388_I2C_BURST_WRITE
+#define ES8388_I2C_BURST_WRITE 1
+#endif
+
 /*@} end of group ES8388_Public_Macros */
 
 /** @defgroup  ES8388_Public_Functions
@@ -181,6 +207,13 @@ typedef struct
 void ES8388_Init(ES8388_Cfg_Type *cfg);
 void ES8388_Reg_Dump(void);
 int ES8388_Set_Voice_Volume(int volume);
+int ES8388_Write_Reg(uint8_t addr, uint8_t data);
+int ES8388_Write_Regs(uint8_t addr, const uint8_t *data, uint8_t len);
+int ES8388_Read_Reg(uint8_t addr, uint8_t *rdata);
+void ES8388_Shadow_Invalidate(void);
+void ES8388_I2C_Stats_Get(ES8388_I2C_Stats_Type *stats);
+void ES8388_I2C_Stats_Reset(void);
+void ES8388_I2C_Stats_Dump(const char *session);
 
 /*@} end of group ES8388_Public_Functions */
 
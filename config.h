@@ -8,10 +8,54 @@
 // API Configuration
 // WhisperLive STT (Real-time Speech-to-Text via WebSocket)
 #define WHISPERLIVE_WS_URL "ws://192.168.1.151:9090/"
+// Backup WhisperLive servers, e.g. "ws://192.168.1.152:9090/", "ws://192.168.1.153:9090/"
+// Each session goes to the server with the best connect+handshake latency
+#define WHISPERLIVE_WS_BACKUP_URLS ""
+// Uplink audio codec offered to the server: "float32" (stock WhisperLive),
+// "pcm16" or "adpcm" (require tools/whisper_codec_gateway.py in front of WhisperLive)
+#define WHISPERLIVE_AUDIO_CODEC "float32"
 
 // DeepSeek API
 #define DEEPSEEK_API_URL "https://api.deepseek.com/v1/chat/completions"
 #define DEEPSEEK_API_KEY "sk-9725ac0faa5947fd98a4c54649f1e2c6"
+// Speculative dispatch: ask DeepSeek before recording ends once the partial
+// transcript has been unchanged this long while the VAD trends to silence
+#define LLM_SPECULATIVE_ENABLE 1
+#define LLM_SPECULATIVE_STABLE_MS 500
+// Open the DeepSeek and TTS connections on speech onset so each stage of the
+// turn finds a ready socket (see conn_prewarm.h)
+#define CONN_PREWARM_ENABLE 1
+// Backup OpenAI-compatible chat endpoints, { url, model, api_key } each, e.g.
+// { "http://192.168.1.151:11434/v1/chat/completions", "qwen2.5:3b", "" }
+// A backup is asked as well when DeepSeek's first token is later than this
+// percentile of its recent first-token latencies, or when DeepSeek fails
+#define LLM_BACKUP_ENDPOINTS
+#define LLM_HEDGE_PERCENTILE 90
+// Send earlier turns of the conversation with each request (see conv_memory.h);
+// forget them after this long without a turn
+#define CONV_MEMORY_ENABLE 1
+#define CONV_MEMORY_IDLE_RESET_S 300
+// Answer device commands (stop, volume) and time/date questions on the device
+// instead of asking the LLM (see local_intent.h)
+#define LOCAL_INTENT_ENABLE 1
+#define LOCAL_INTENT_NTP_SERVER "ntp.aliyun.com"
+#define LOCAL_TIMEZONE_HOURS 8             // UTC+8
+
+// Semantic endpointing: shorten the trailing silence that ends a turn when the
+// live transcript already reads as a complete request (see endpoint.h)
+#define ENDPOINT_SILENCE_DEFAULT_MS 1250   // Plain acoustic endpoint
+#define ENDPOINT_SILENCE_SENTENCE_MS 600   // Transcript ends with 。/./!/！
+#define ENDPOINT_SILENCE_COMPLETE_MS 300   // Question mark/particle or a listed phrase
+// Endings that make a request complete (matched at the end of the transcript)
+#define ENDPOINT_COMPLETE_PHRASES "谢谢", "再见", "几点了", "怎么样", "是什么", "为什么", \
+                                  "多少", "停止", "暂停", "继续", "关机"
+
+// Network impairment for latency testing (see net_impair.h); keep 0 in production
+#define NET_IMPAIR_ENABLE 0
+// { latency_ms, jitter_ms, bandwidth_bps, stall_every_ms, stall_ms, reset_every_ms }
+#define NET_IMPAIR_STT_PROFILE { 0, 0, 0, 0, 0, 0 }
+#define NET_IMPAIR_LLM_PROFILE { 0, 0, 0, 0, 0, 0 }
+#define NET_IMPAIR_TTS_PROFILE { 0, 0, 0, 0, 0, 0 }
 
 // Fish Speech TTS API
 #define TTS_API_URL "http://192.168.1.151:8080/v1/tts"
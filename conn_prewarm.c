@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+#include "https_client.h"
+#include "conn_prewarm.h"
+#include "config.h"
+
+#define DBG_TAG "PREWARM"
+
+#define CONN_PREWARM_TASK_STACK 4096   // TLS handshake runs on this stack
+#define CONN_PREWARM_TASK_PRIO 10
+
+static TaskHandle_t prewarm_task;
+static SemaphoreHandle_t prewarm_lock;
+static uint32_t prewarm_pending;          // CONN_PREWARM_* bits not yet handled
+
+static void prewarm_task_fn(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(prewarm_lock, portMAX_DELAY);
+        uint32_t which = prewarm_pending;
+        prewarm_pending = 0;
+        xSemaphoreGive(prewarm_lock);
+
+        // LLM first: the TLS handshake is the longer setup and is needed sooner
+        if (which & CONN_PREWARM_LLM) {
+            https_prewarm(DEEPSEEK_API_URL);
+        }
+        if (which & CONN_PREWARM_TTS) {
+            https_prewarm(TTS_API_URL);
+        }
+
+        https_tls_stats_t stats;
+        https_get_tls_stats(&stats);
+        LOG_I("Pre-warm: opened %d, already open %d, used %d, wasted %d\r\n",
+              stats.prewarms, stats.prewarm_ready, stats.prewarm_hits, stats.prewarm_wasted);
+    }
+}
+
+int conn_prewarm_init(void) {
+    if (prewarm_task) {
+        return 0;
+    }
+
+    prewarm_lock = xSemaphoreCreateMutex();
+    if (!prewarm_lock) {
+        return -1;
+    }
+
+    if (xTaskCreate(prewarm_task_fn, "conn_prewarm", CONN_PREWARM_TASK_STACK, NULL,
+                    CONN_PREWARM_TASK_PRIO, &prewarm_task) != pdPASS) {
+        LOG_E("Failed to create pre-warm task\r\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+void conn_prewarm_trigger(uint32_t which) {
+    if (!prewarm_task) {
+        return;
+    }
+
+    xSemaphoreTake(prewarm_lock, portMAX_DELAY);
+    prewarm_pending |= which;
+    xSemaphoreGive(prewarm_lock);
+    xTaskNotifyGive(prewarm_task);
+}
@@ -0,0 +1,29 @@
+#ifndef __CONN_PREWARM_H__
+#define __CONN_PREWARM_H__
+
+#include <stdint.h>
+
+// Connections the later stages of a turn will need, opened in the
+// background while the earlier stages run
+#define CONN_PREWARM_LLM (1 << 0)        // HTTPS connection to DEEPSEEK_API_URL
+#define CONN_PREWARM_TTS (1 << 1)        // TCP connection to TTS_API_URL
+
+/**
+ * @brief Create the pre-warm task
+ * @return 0 on success, -1 on error
+ */
+int conn_prewarm_init(void);
+
+/**
+ * @brief Open or refresh connections in the background; returns at once
+ *
+ * Call on speech onset for both, and for TTS again when the LLM request
+ * starts (the TTS server closes idle connections after a few seconds).
+ * Don't ask for a host while a request to it is in flight, that would
+ * open a second connection.
+ *
+ * @param which CONN_PREWARM_* bits
+ */
+void conn_prewarm_trigger(uint32_t which);
+
+#endif // __CONN_PREWARM_H__
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+#include "conv_memory.h"
+#include "config.h"
+
+#define DBG_TAG "CONV"
+
+#define CONV_MESSAGE_TOKENS 4            // Role and framing of one chat message
+#define CONV_DIGEST_SEP "；"
+
+// One turn in the store: header, then both texts NUL-terminated
+typedef struct {
+    uint16_t user_len;
+    uint16_t reply_len;
+    uint16_t tokens;                     // Estimate for both messages
+} conv_turn_t;
+
+static uint8_t *store;                   // CONV_MEMORY_BYTES, oldest turn first
+static uint32_t store_used;
+static uint32_t turn_count;
+static uint32_t turn_tokens;             // Sum over the stored turns
+static char digest[CONV_DIGEST_MAX];
+static uint32_t digest_len;
+static uint32_t last_turn_ms;
+static SemaphoreHandle_t conv_lock;
+static conv_memory_stats_t conv_stats;
+
+static uint32_t conv_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Longest prefix of at most max bytes that doesn't split a UTF-8 character
+static uint32_t utf8_clip(const char *text, uint32_t max) {
+    uint32_t len = strlen(text);
+    if (len <= max) {
+        return len;
+    }
+    while (max > 0 && (text[max] & 0xC0) == 0x80) {
+        max--;
+    }
+    return max;
+}
+
+static uint32_t estimate_tokens(const char *text, uint32_t len) {
+    uint32_t tokens = 0;
+    uint32_t ascii = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (c < 0x80) {
+            ascii++;
+        } else if ((c & 0xC0) != 0x80) {
+            tokens++;  // Lead byte of a multi-byte character
+        }
+    }
+    return tokens + (ascii + 3) / 4;
+}
+
+uint32_t conv_memory_estimate_tokens(const char *text) {
+    return estimate_tokens(text, strlen(text));
+}
+
+static uint32_t turn_size(const conv_turn_t *t) {
+    uint32_t size = sizeof(conv_turn_t) + t->user_len + 1 + t->reply_len + 1;
+    return (size + 1) & ~1u;
+}
+
+static uint32_t digest_tokens(void) {
+    return digest_len ? estimate_tokens(digest, digest_len) + CONV_MESSAGE_TOKENS : 0;
+}
+
+// Keep the start of an evicted question; the oldest ones go first when full
+static void digest_add(const char *question) {
+    uint32_t sep_len = strlen(CONV_DIGEST_SEP);
+    uint32_t len = utf8_clip(question, CONV_DIGEST_ITEM_MAX);
+    uint32_t need = len + (digest_len ? sep_len : 0);
+
+    while (digest_len && digest_len + need >= sizeof(digest)) {
+        char *next = strstr(digest, CONV_DIGEST_SEP);
+        if (!next) {
+            digest_len = 0;
+            need = len;
+            break;
+        }
+        next += sep_len;
+        digest_len -= next - digest;
+        memmove(digest, next, digest_len + 1);
+    }
+    if (digest_len) {
+        memcpy(digest + digest_len, CONV_DIGEST_SEP, sep_len);
+        digest_len += sep_len;
+    }
+    memcpy(digest + digest_len, question, len);
+    digest_len += len;
+    digest[digest_len] = '\0';
+}
+
+// Fold the oldest turns into the digest until the history takes at most
+// target tokens and need more bytes fit
+static void evict(uint32_t target_tokens, uint32_t need_bytes) {
+    uint32_t offset = 0;
+    uint32_t evicted = 0;
+
+    while (offset < store_used &&
+           (turn_tokens + digest_tokens() > target_tokens ||
+            store_used - offset + need_bytes > CONV_MEMORY_BYTES)) {
+        conv_turn_t t;
+        memcpy(&t, store + offset, sizeof(t));
+        digest_add((const char *)store + offset + sizeof(t));
+        turn_tokens -= t.tokens;
+        offset += turn_size(&t);
+        evicted++;
+    }
+    if (evicted == 0) {
+        return;
+    }
+
+    memmove(store, store + offset, store_used - offset);
+    store_used -= offset;
+    turn_count -= evicted;
+    conv_stats.evictions++;
+    conv_stats.evicted_turns += evicted;
+    LOG_I("Evicted %d old turns, %d kept (%d tokens)\r\n", evicted, turn_count,
+          turn_tokens + digest_tokens());
+}
+
+static void forget(void) {
+    store_used = 0;
+    turn_count = 0;
+    turn_tokens = 0;
+    digest_len = 0;
+    digest[0] = '\0';
+}
+
+// A conversation left alone this long is over; don't carry it into the next
+static void expire_idle(void) {
+    if (turn_count + digest_len > 0 &&
+        conv_now_ms() - last_turn_ms >= CONV_MEMORY_IDLE_RESET_S * 1000) {
+        LOG_I("Conversation idle, forgetting %d turns\r\n", turn_count);
+        forget();
+        conv_stats.resets++;
+    }
+}
+
+void conv_memory_add_turn(const char *user_text, const char *reply) {
+    if (!store || !user_text || !reply) {
+        return;
+    }
+
+    conv_turn_t t;
+    t.user_len = utf8_clip(user_text, CONV_TEXT_MAX);
+    t.reply_len = utf8_clip(reply, CONV_TEXT_MAX);
+    t.tokens = estimate_tokens(user_text, t.user_len) + estimate_tokens(reply, t.reply_len) +
+               2 * CONV_MESSAGE_TOKENS;
+    uint32_t size = turn_size(&t);
+
+    xSemaphoreTake(conv_lock, portMAX_DELAY);
+    expire_idle();
+    if (turn_tokens + t.tokens + digest_tokens() > CONV_HISTORY_TOKENS ||
+        store_used + size > CONV_MEMORY_BYTES) {
+        evict(CONV_HISTORY_TOKENS / 2, size);
+    }
+
+    uint8_t *p = store + store_used;
+    memcpy(p, &t, sizeof(t));
+    p += sizeof(t);
+    memcpy(p, user_text, t.user_len);
+    p[t.user_len] = '\0';
+    p += t.user_len + 1;
+    memcpy(p, reply, t.reply_len);
+    p[t.reply_len] = '\0';
+
+    store_used += size;
+    turn_count++;
+    turn_tokens += t.tokens;
+    last_turn_ms = conv_now_ms();
+    xSemaphoreGive(conv_lock);
+}
+
+static void add_message(cJSON *messages, const char *role, const char *content) {
+    cJSON *msg = cJSON_CreateObject();
+    cJSON_AddItemToArray(messages, msg);
+    cJSON_AddStringToObject(msg, "role", role);
+    cJSON_AddStringToObject(msg, "content", content);
+}
+
+uint32_t conv_memory_append_messages(cJSON *messages) {
+    char line[CONV_DIGEST_MAX + 64];
+
+    if (!store) {
+        return 0;
+    }
+
+    xSemaphoreTake(conv_lock, portMAX_DELAY);
+    expire_idle();
+    if (digest_len) {
+        snprintf(line, sizeof(line), "此前对话中用户还问过：%s", digest);
+        add_message(messages, "system", line);
+    }
+    for (uint32_t offset = 0; offset < store_used;) {
+        conv_turn_t t;
+        memcpy(&t, store + offset, sizeof(t));
+        const char *user_text = (const char *)store + offset + sizeof(t);
+        add_message(messages, "user", user_text);
+        add_message(messages, "assistant", user_text + t.user_len + 1);
+        offset += turn_size(&t);
+    }
+    uint32_t tokens = turn_tokens + digest_tokens();
+    if (turn_count > 0) {
+        conv_stats.requests++;
+    }
+    xSemaphoreGive(conv_lock);
+
+    return tokens;
+}
+
+void conv_memory_reset(void) {
+    if (!store) {
+        return;
+    }
+    xSemaphoreTake(conv_lock, portMAX_DELAY);
+    forget();
+    xSemaphoreGive(conv_lock);
+}
+
+void conv_memory_get_stats(conv_memory_stats_t *stats) {
+    if (!store) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(conv_lock, portMAX_DELAY);
+    *stats = conv_stats;
+    stats->turns = turn_count;
+    stats->bytes_used = store_used;
+    stats->history_tokens = turn_tokens + digest_tokens();
+    xSemaphoreGive(conv_lock);
+}
+
+int conv_memory_init(void) {
+    if (store) {
+        return 0;
+    }
+
+    conv_lock = xSemaphoreCreateMutex();
+    if (!conv_lock) {
+        return -1;
+    }
+    // Large heap allocations land in PSRAM, keeping SRAM for DMA buffers
+    store = pvPortMalloc(CONV_MEMORY_BYTES);
+    if (!store) {
+        LOG_E("Failed to allocate conversation memory\r\n");
+        return -1;
+    }
+    forget();
+    return 0;
+}
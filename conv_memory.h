@@ -0,0 +1,73 @@
+#ifndef __CONV_MEMORY_H__
+#define __CONV_MEMORY_H__
+
+#include <stdint.h>
+#include "cJSON.h"
+
+#define CONV_MEMORY_BYTES 8192           // Turn store, allocated once from the (PSRAM) heap
+#define CONV_HISTORY_TOKENS 1000         // Estimated tokens of history sent with a request
+#define CONV_TEXT_MAX 1024               // Longest question or reply kept per turn
+#define CONV_DIGEST_MAX 512              // Questions of evicted turns, oldest dropped first
+#define CONV_DIGEST_ITEM_MAX 60          // Bytes kept of each evicted question
+
+// Conversation memory statistics
+typedef struct {
+    uint32_t turns;              // Turns held now
+    uint32_t bytes_used;         // Of CONV_MEMORY_BYTES
+    uint32_t history_tokens;     // Estimated tokens of the history (and digest) sent
+    uint32_t requests;           // Request bodies that carried history (per endpoint when hedged)
+    uint32_t evictions;          // Times old turns were folded into the digest
+    uint32_t evicted_turns;
+    uint32_t resets;             // Conversations forgotten after CONV_MEMORY_IDLE_RESET_S
+} conv_memory_stats_t;
+
+/**
+ * @brief Allocate the turn store
+ * @return 0 on success, -1 on error
+ */
+int conv_memory_init(void);
+
+/**
+ * @brief Remember a completed turn
+ *
+ * When the history grows past CONV_HISTORY_TOKENS (or the store is full),
+ * the oldest turns are evicted together until it is down to half the
+ * budget, and their questions are kept in a short digest. Evicting in
+ * batches keeps the serialised history an unchanged prefix of the next
+ * requests, so the provider's prompt cache keeps hitting in between.
+ *
+ * @param user_text What the user said
+ * @param reply The reply that was spoken
+ */
+void conv_memory_add_turn(const char *user_text, const char *reply);
+
+/**
+ * @brief Append the digest and the remembered turns to a chat messages array
+ *
+ * Goes between the system prompt and the new user message. Stored text is
+ * emitted exactly as it was added, so consecutive requests share a
+ * byte-identical prefix.
+ *
+ * @param messages cJSON array of {role, content} objects
+ * @return Estimated tokens added
+ */
+uint32_t conv_memory_append_messages(cJSON *messages);
+
+/**
+ * @brief Forget the conversation
+ */
+void conv_memory_reset(void);
+
+/**
+ * @brief Estimate the tokens of UTF-8 text
+ *
+ * One per CJK (or other non-ASCII) character, one per four ASCII characters.
+ */
+uint32_t conv_memory_estimate_tokens(const char *text);
+
+/**
+ * @brief Get conversation memory statistics
+ */
+void conv_memory_get_stats(conv_memory_stats_t *stats);
+
+#endif // __CONV_MEMORY_H__
@@ -1,26 +1,61 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "semphr.h"
 #include "log.h"
 #include "cJSON.h"
 #include "https_client.h"
+#include "deepseek_client.h"
+#include "conv_memory.h"
 #include "config.h"
 
 #define DBG_TAG "AI"
 
-char* deepseek_chat(const char* input_text) {
-    if (!input_text || strlen(input_text) == 0) {
-        return NULL;
-    }
+#define DEEPSEEK_SSE_LINE_MAX 1024   // One "data:" event (a single delta is ~300 bytes)
+#define DEEPSEEK_REPLY_MAX 2048      // Accumulated reply text
 
-    LOG_I("Asking DeepSeek: %s", input_text);
+#define LLM_HEDGE_TASK_STACK 4096    // TLS handshake runs on this stack
+#define LLM_HEDGE_TASK_PRIO 12
+#define LLM_CANCEL_POLL_MS 50        // How often a cancellable caller checks its flag
 
-    // Construct JSON body
+typedef struct {
+    const char *url;
+    const char *model;
+    const char *key;                 // "" for servers without authentication
+} llm_endpoint_t;
+
+// In order of preference; the first one is the primary. Sized for the
+// maximum so indexing past the configured ones stays in bounds; unused
+// entries have no URL.
+static const llm_endpoint_t llm_endpoints[LLM_ENDPOINTS_MAX] = {
+    { DEEPSEEK_API_URL, "deepseek-chat", DEEPSEEK_API_KEY },
+    LLM_BACKUP_ENDPOINTS
+};
+
+// SSE decoder state: lines are cut as bytes arrive, each "data:" event is
+// parsed on its own, so no full response is ever held
+typedef struct {
+    char line[DEEPSEEK_SSE_LINE_MAX];
+    uint32_t line_len;
+    bool line_overflow;
+    bool done;                       // "data: [DONE]" seen
+    char *reply;
+    uint32_t reply_len;
+    deepseek_delta_cb_t on_delta;
+    void *ctx;
+} deepseek_stream_t;
+
+static char *build_request_body(const char *input_text, const char *model) {
     cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "model", "deepseek-chat");
-    cJSON_AddFalseToObject(root, "stream"); // Use non-streaming for simplicity first
+    cJSON_AddStringToObject(root, "model", model);
+    cJSON_AddTrueToObject(root, "stream");  // Tokens arrive as SSE events
+    cJSON *stream_options = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "stream_options", stream_options);
+    cJSON_AddTrueToObject(stream_options, "include_usage");  // Prompt cache hits in the last event
 
     cJSON *messages = cJSON_CreateArray();
     cJSON_AddItemToObject(root, "messages", messages);
@@ -32,76 +67,579 @@ char* deepseek_chat(const char* input_text) {
     cJSON_AddStringToObject(sys_msg, "content",
         "你是一个语音助手。请用简短的中文回复，不超过50个字。不要使用emoji或特殊符号。");
 
+#if CONV_MEMORY_ENABLE
+    // Earlier turns go after the fixed system prompt and before the new
+    // question, so everything but the question repeats the last request
+    uint32_t history_tokens = conv_memory_append_messages(messages);
+    if (history_tokens > 0) {
+        LOG_I("With %d tokens of history", history_tokens);
+    }
+#endif
+
     cJSON *msg = cJSON_CreateObject();
     cJSON_AddItemToArray(messages, msg);
     cJSON_AddStringToObject(msg, "role", "user");
     cJSON_AddStringToObject(msg, "content", input_text);
-    
+
     char *body = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
-    
-    if (!body) {
-        LOG_E("Failed to create JSON body");
-        return NULL;
+    return body;
+}
+
+// Handle one SSE line: {"choices":[{"delta":{"content":"..."}}]}
+static void stream_handle_line(deepseek_stream_t *st, const char *line, uint32_t len) {
+    if (len < 5 || strncmp(line, "data:", 5) != 0) {
+        return;  // Blank separator, ": keep-alive" comment or other field
+    }
+    line += 5;
+    len -= 5;
+    while (len > 0 && *line == ' ') {
+        line++;
+        len--;
+    }
+
+    if (len == 6 && strncmp(line, "[DONE]", 6) == 0) {
+        st->done = true;
+        return;
+    }
+
+    cJSON *json = cJSON_ParseWithLength(line, len);
+    if (!json) {
+        LOG_W("Bad SSE event: %.*s", (int)len, line);
+        return;
+    }
+
+    cJSON *usage = cJSON_GetObjectItem(json, "usage");
+    cJSON *prompt_tokens = usage ? cJSON_GetObjectItem(usage, "prompt_tokens") : NULL;
+    cJSON *cache_hit_tokens = usage ? cJSON_GetObjectItem(usage, "prompt_cache_hit_tokens") : NULL;
+    if (cJSON_IsNumber(prompt_tokens) && cJSON_IsNumber(cache_hit_tokens)) {
+        LOG_I("Prompt %d tokens, %d from cache", prompt_tokens->valueint, cache_hit_tokens->valueint);
+    }
+
+    cJSON *choices = cJSON_GetObjectItem(json, "choices");
+    cJSON *choice = (choices && cJSON_GetArraySize(choices) > 0) ? cJSON_GetArrayItem(choices, 0) : NULL;
+    cJSON *delta = choice ? cJSON_GetObjectItem(choice, "delta") : NULL;
+    cJSON *content = delta ? cJSON_GetObjectItem(delta, "content") : NULL;
+    if (content && cJSON_IsString(content) && content->valuestring[0]) {
+        uint32_t n = strlen(content->valuestring);
+        if (st->reply_len + n >= DEEPSEEK_REPLY_MAX) {
+            n = DEEPSEEK_REPLY_MAX - 1 - st->reply_len;
+        }
+        memcpy(st->reply + st->reply_len, content->valuestring, n);
+        st->reply_len += n;
+        st->reply[st->reply_len] = '\0';
+        if (st->on_delta) {
+            st->on_delta(st->ctx, content->valuestring);
+        }
+    }
+    cJSON_Delete(json);
+}
+
+static int stream_on_data(void *ctx, const char *data, int len) {
+    deepseek_stream_t *st = (deepseek_stream_t *)ctx;
+
+    if (st->done) {
+        // Read on to the end of the body instead of aborting, so the
+        // connection is kept for the next turn
+        return 0;
+    }
+    for (int i = 0; i < len; i++) {
+        char c = data[i];
+        if (c == '\n') {
+            if (!st->line_overflow) {
+                uint32_t n = st->line_len;
+                if (n > 0 && st->line[n - 1] == '\r') {
+                    n--;
+                }
+                stream_handle_line(st, st->line, n);
+            }
+            st->line_len = 0;
+            st->line_overflow = false;
+            if (st->done) {
+                break;
+            }
+        } else if (st->line_len < sizeof(st->line)) {
+            st->line[st->line_len++] = c;
+        } else if (!st->line_overflow) {
+            LOG_W("SSE line too long, skipped");
+            st->line_overflow = true;
+        }
     }
-    
-    int body_len = strlen(body);
-    
-    // Construct Headers
+    return 0;
+}
+
+
+typedef struct llm_hedge llm_hedge_t;
+
+// One request to one endpoint
+typedef struct {
+    llm_hedge_t *hedge;
+    uint32_t index;                  // Into llm_endpoints
+    deepseek_stream_t st;
+    int status;
+    uint32_t start_ms;
+    uint32_t first_ms;               // First content delta, valid once has_first
+    bool launched;
+    bool has_first;
+    bool finished;
+    volatile bool cancel;
+} llm_attempt_t;
+
+// One chat request and its attempts; freed by whoever drops the last
+// reference, since cancelled attempts may still be connecting
+struct llm_hedge {
+    deepseek_delta_cb_t on_delta;
+    void *ctx;
+    const volatile bool *cancel;     // Caller's flag, NULL when it can't cancel
+    SemaphoreHandle_t event;         // Given on the first token and when an attempt ends
+    int winner;                      // First attempt to produce text, -1 while none has
+    uint32_t refs;
+    llm_attempt_t attempts[LLM_ENDPOINTS_MAX];
+    char input_text[];               // Own copy: a cancelled attempt may outlive the caller
+};
+
+static uint32_t llm_endpoint_count;
+static QueueHandle_t hedge_queue;        // llm_attempt_t * for the workers
+static SemaphoreHandle_t hedge_lock;     // Guards llm_hedge_t, the history and the metrics
+static uint32_t hedge_idle_workers;
+
+// Primary first-token latencies, ring buffer
+static uint32_t first_token_ms[LLM_HEDGE_HISTORY];
+static uint32_t first_token_count;
+static uint32_t first_token_next;
+static llm_hedge_metrics_t hedge_metrics;
+
+static uint32_t llm_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static void hedge_record_first_token(uint32_t ms) {
+    first_token_ms[first_token_next] = ms;
+    first_token_next = (first_token_next + 1) % LLM_HEDGE_HISTORY;
+    if (first_token_count < LLM_HEDGE_HISTORY) {
+        first_token_count++;
+    }
+}
+
+// LLM_HEDGE_PERCENTILE of the recent primary first-token latencies
+static uint32_t hedge_deadline_ms(void) {
+    uint32_t sorted[LLM_HEDGE_HISTORY];
+    uint32_t n = first_token_count;
+
+    if (n < LLM_HEDGE_MIN_SAMPLES) {
+        return LLM_HEDGE_DEFAULT_MS;
+    }
+    memcpy(sorted, first_token_ms, n * sizeof(uint32_t));
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t v = sorted[i];
+        uint32_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+    uint32_t ms = sorted[(n - 1) * LLM_HEDGE_PERCENTILE / 100];
+    return (ms < LLM_HEDGE_MIN_MS) ? LLM_HEDGE_MIN_MS : ms;
+}
+
+static void hedge_release(llm_hedge_t *h) {
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    bool last = (--h->refs == 0);
+    xSemaphoreGive(hedge_lock);
+    if (!last) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < LLM_ENDPOINTS_MAX; i++) {
+        if (h->attempts[i].st.reply) {
+            vPortFree(h->attempts[i].st.reply);
+        }
+    }
+    vSemaphoreDelete(h->event);
+    vPortFree(h);
+}
+
+// Only the winner's deltas reach the caller; a loser stops at its first token
+static void attempt_on_delta(void *ctx, const char *delta) {
+    llm_attempt_t *a = (llm_attempt_t *)ctx;
+    llm_hedge_t *h = a->hedge;
+    bool forward = false;
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    if (!a->has_first) {
+        a->has_first = true;
+        a->first_ms = llm_now_ms();
+        if (h->winner < 0) {
+            h->winner = a->index;
+        }
+        xSemaphoreGive(h->event);
+    }
+    if (h->winner == (int)a->index && !a->cancel) {
+        forward = true;
+    } else {
+        a->cancel = true;
+    }
+    xSemaphoreGive(hedge_lock);
+
+    if (forward && h->on_delta) {
+        h->on_delta(h->ctx, delta);
+    }
+}
+
+static void attempt_run(llm_attempt_t *a, const volatile bool *cancel) {
+    const llm_endpoint_t *ep = &llm_endpoints[a->index];
     char headers[256];
-    sprintf(headers, 
-        "Content-Type: application/json\r\n"
-        "Authorization: Bearer %s\r\n", 
-        DEEPSEEK_API_KEY);
-        
-    // Send Request
-    char *response = https_request(DEEPSEEK_API_URL, "POST", headers, body, body_len);
-    
-    vPortFree(body);
-    
-    if (!response) {
-        LOG_E("DeepSeek request failed");
+    int status = -1;
+
+    char *body = *cancel ? NULL : build_request_body(a->hedge->input_text, ep->model);
+    if (body) {
+        int n = sprintf(headers,
+            "Content-Type: application/json\r\n"
+            "Accept: text/event-stream\r\n");
+        if (ep->key[0]) {
+            sprintf(headers + n, "Authorization: Bearer %s\r\n", ep->key);
+        }
+        status = https_request_stream_cancellable(ep->url, "POST", headers, body, strlen(body),
+                                                  stream_on_data, &a->st, cancel);
+        vPortFree(body);
+    }
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    a->status = status;
+    a->finished = true;
+    xSemaphoreGive(a->hedge->event);
+    xSemaphoreGive(hedge_lock);
+}
+
+static void hedge_task_fn(void *arg) {
+    llm_attempt_t *a;
+
+    while (1) {
+        if (xQueueReceive(hedge_queue, &a, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        attempt_run(a, &a->cancel);
+        hedge_release(a->hedge);
+
+        xSemaphoreTake(hedge_lock, portMAX_DELAY);
+        hedge_idle_workers++;
+        xSemaphoreGive(hedge_lock);
+    }
+}
+
+// Start the next attempt on a worker; false if none is idle
+static bool attempt_launch(llm_hedge_t *h, uint32_t index) {
+    llm_attempt_t *a = &h->attempts[index];
+    bool claimed = false;
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    if (hedge_idle_workers > 0) {
+        hedge_idle_workers--;
+        h->refs++;
+        claimed = true;
+    }
+    a->launched = claimed;
+    a->start_ms = llm_now_ms();
+    xSemaphoreGive(hedge_lock);
+
+    if (!claimed) {
+        return false;
+    }
+    LOG_I("Asking %s (%s)", llm_endpoints[index].url, llm_endpoints[index].model);
+    xQueueSend(hedge_queue, &a, portMAX_DELAY);
+    return true;
+}
+
+// Run an attempt on the calling task when no worker is free (or there is
+// nothing to hedge with); only the caller's flag can cancel it
+static void attempt_run_inline(llm_hedge_t *h, uint32_t index) {
+    llm_attempt_t *a = &h->attempts[index];
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    a->launched = true;
+    a->start_ms = llm_now_ms();
+    xSemaphoreGive(hedge_lock);
+
+    LOG_I("Asking %s (%s)", llm_endpoints[index].url, llm_endpoints[index].model);
+    attempt_run(a, h->cancel ? h->cancel : &a->cancel);
+}
+
+char* deepseek_chat_stream_cancellable(const char* input_text, deepseek_delta_cb_t on_delta,
+                                       void *ctx, const volatile bool *cancel) {
+    if (!input_text || strlen(input_text) == 0) {
         return NULL;
     }
-    
-    LOG_I("DeepSeek Response: %s", response);
-    
-    // Parse Response
-    char *reply_text = NULL;
-    
-    // Find start of JSON object (skip chunk headers if present)
-    char *json_start = strchr(response, '{');
-    if (!json_start) {
-        LOG_E("No JSON object found in response");
-        vPortFree(response);
+    if (!hedge_lock) {
+        // deepseek_client_init() not called: DeepSeek only, on this task
+        hedge_lock = xSemaphoreCreateMutex();
+        if (!hedge_lock) {
+            return NULL;
+        }
+    }
+
+    LOG_I("Asking DeepSeek: %s", input_text);
+
+    uint32_t text_len = strlen(input_text);
+    llm_hedge_t *h = pvPortMalloc(sizeof(llm_hedge_t) + text_len + 1);
+    if (!h) {
+        LOG_E("Failed to allocate stream state");
         return NULL;
     }
-    
-    // Find end of JSON object
-    char *json_end = strrchr(response, '}');
-    if (json_end) {
-        *(json_end + 1) = '\0'; // Null terminate after the last '}'
-    }
-    
-    LOG_I("Parsing JSON: %s", json_start);
-    cJSON *json = cJSON_Parse(json_start);
-    if (json) {
-        cJSON *choices = cJSON_GetObjectItem(json, "choices");
-        if (choices && cJSON_GetArraySize(choices) > 0) {
-            cJSON *choice = cJSON_GetArrayItem(choices, 0);
-            cJSON *message = cJSON_GetObjectItem(choice, "message");
-            if (message) {
-                cJSON *content = cJSON_GetObjectItem(message, "content");
-                if (content && cJSON_IsString(content)) {
-                    int len = strlen(content->valuestring);
-                    reply_text = pvPortMalloc(len + 1);
-                    strcpy(reply_text, content->valuestring);
+    memset(h, 0, sizeof(llm_hedge_t));
+    memcpy(h->input_text, input_text, text_len + 1);
+    h->on_delta = on_delta;
+    h->ctx = ctx;
+    h->cancel = cancel;
+    h->winner = -1;
+    h->refs = 1;
+    h->event = xSemaphoreCreateBinary();
+    uint32_t count = llm_endpoint_count ? llm_endpoint_count : 1;
+    bool alloc_ok = (h->event != NULL);
+    for (uint32_t i = 0; i < count; i++) {
+        llm_attempt_t *a = &h->attempts[i];
+        a->hedge = h;
+        a->index = i;
+        a->st.reply = pvPortMalloc(DEEPSEEK_REPLY_MAX);
+        a->st.on_delta = attempt_on_delta;
+        a->st.ctx = a;
+        if (a->st.reply) {
+            a->st.reply[0] = '\0';
+        } else {
+            alloc_ok = false;
+        }
+    }
+    if (!alloc_ok) {
+        LOG_E("Failed to allocate stream state");
+        if (h->event) {
+            hedge_release(h);
+        } else {
+            for (uint32_t i = 0; i < count; i++) {
+                if (h->attempts[i].st.reply) vPortFree(h->attempts[i].st.reply);
+            }
+            vPortFree(h);
+        }
+        return NULL;
+    }
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    uint32_t deadline_ms = hedge_deadline_ms();
+    hedge_metrics.requests++;
+    hedge_metrics.deadline_ms = deadline_ms;
+    xSemaphoreGive(hedge_lock);
+
+    uint32_t start_ms = llm_now_ms();
+    uint32_t launched = 1;
+    uint32_t last_launch_ms = start_ms;
+    bool hedged = false;
+    bool failed_over = false;
+    bool can_hedge = (count > 1 && attempt_launch(h, 0));
+    if (!can_hedge) {
+        if (count > 1) {
+            xSemaphoreTake(hedge_lock, portMAX_DELAY);
+            hedge_metrics.unavailable++;
+            xSemaphoreGive(hedge_lock);
+        }
+        attempt_run_inline(h, 0);
+    }
+
+    // Wait for a winner to finish; send the next endpoint when the current
+    // ones are late (hedge) or have all failed (failover)
+    int winner = -1;
+    bool cancelled = false;
+    while (1) {
+        if (cancel && *cancel) {
+            cancelled = true;
+            break;
+        }
+        xSemaphoreTake(hedge_lock, portMAX_DELAY);
+        winner = h->winner;
+        bool winner_done = (winner >= 0 && h->attempts[winner].finished);
+        bool all_failed = (winner < 0);
+        for (uint32_t i = 0; i < launched; i++) {
+            if (!h->attempts[i].finished) {
+                all_failed = false;
+            }
+        }
+        xSemaphoreGive(hedge_lock);
+
+        if (winner_done) {
+            break;
+        }
+        bool more = (winner < 0 && launched < count);
+        if (all_failed && !more) {
+            break;
+        }
+
+        TickType_t wait_ticks = portMAX_DELAY;
+        if (all_failed) {
+            LOG_W("%s failed, trying %s", llm_endpoints[launched - 1].url,
+                  llm_endpoints[launched].url);
+            failed_over = true;
+            if (!attempt_launch(h, launched)) {
+                attempt_run_inline(h, launched);
+            }
+            launched++;
+            last_launch_ms = llm_now_ms();
+            continue;
+        } else if (more && can_hedge) {
+            uint32_t elapsed_ms = llm_now_ms() - last_launch_ms;
+            if (elapsed_ms >= deadline_ms) {
+                if (attempt_launch(h, launched)) {
+                    LOG_W("No first token after %d ms, hedging to %s", elapsed_ms,
+                          llm_endpoints[launched].url);
+                    hedged = true;
+                    launched++;
+                    last_launch_ms = llm_now_ms();
+                } else {
+                    // Both workers busy (e.g. with a speculative request)
+                    can_hedge = false;
+                    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+                    hedge_metrics.unavailable++;
+                    xSemaphoreGive(hedge_lock);
                 }
+                continue;
             }
+            wait_ticks = pdMS_TO_TICKS(deadline_ms - elapsed_ms);
+        }
+        if (cancel && wait_ticks > pdMS_TO_TICKS(LLM_CANCEL_POLL_MS)) {
+            wait_ticks = pdMS_TO_TICKS(LLM_CANCEL_POLL_MS);
+        }
+        xSemaphoreTake(h->event, wait_ticks);
+    }
+
+    // Cancel the losers (all of them when the caller gave up); they drop
+    // their reference when they notice
+    uint32_t end_ms = llm_now_ms();
+    char *reply = NULL;
+    bool done = false;
+    int status = -1;
+
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    for (uint32_t i = 0; i < launched; i++) {
+        if ((int)i != winner || cancelled) {
+            h->attempts[i].cancel = true;
+        }
+    }
+    if (cancelled) {
+        // The winner may still be writing its reply; it is freed with h
+    } else if (winner >= 0) {
+        llm_attempt_t *w = &h->attempts[winner];
+        reply = w->st.reply;
+        w->st.reply = NULL;
+        done = w->st.done;
+        status = w->status;
+    } else {
+        status = h->attempts[launched - 1].status;
+    }
+
+    // Primary first-token latency; when it lost the race, the time it had
+    // been waiting is a lower bound and keeps the deadline from drifting down
+    llm_attempt_t *primary = &h->attempts[0];
+    if (primary->has_first) {
+        hedge_record_first_token(primary->first_ms - primary->start_ms);
+    } else if (winner > 0 && !primary->finished) {
+        hedge_record_first_token(end_ms - primary->start_ms);
+    }
+
+    if (hedged) {
+        hedge_metrics.hedged++;
+    }
+    if (failed_over) {
+        hedge_metrics.failovers++;
+    }
+    uint32_t saved_ms = 0;
+    if (hedged && winner == 0) {
+        hedge_metrics.primary_wins++;
+    } else if (hedged && winner > 0) {
+        // Saved until the primary's first token, or at least until now if
+        // it is still waiting for one (nothing if it failed outright)
+        hedge_metrics.hedge_wins++;
+        if (primary->has_first || !primary->finished) {
+            uint32_t primary_first_ms = primary->has_first ? primary->first_ms : end_ms;
+            saved_ms = primary_first_ms - h->attempts[winner].first_ms;
+            hedge_metrics.saved_ms_total += saved_ms;
         }
-        cJSON_Delete(json);
     }
-    
-    vPortFree(response);
-    return reply_text;
+    llm_hedge_metrics_t m = hedge_metrics;
+    xSemaphoreGive(hedge_lock);
+    hedge_release(h);
+
+    if (hedged) {
+        LOG_I("Hedged: %s won, saved %d ms (hedged %d/%d, wins %d, saved %d ms total)",
+              winner >= 0 ? llm_endpoints[winner].model : "none", saved_ms,
+              m.hedged, m.requests, m.hedge_wins, m.saved_ms_total);
+    }
+
+    if (cancelled) {
+        LOG_I("DeepSeek request cancelled");
+        return NULL;
+    }
+    // A dropped connection after some text still leaves a usable reply
+    if (!reply || reply[0] == '\0' || (status != 200 && !done)) {
+        LOG_E("DeepSeek request failed (status %d)", status);
+        if (reply) vPortFree(reply);
+        return NULL;
+    }
+    if (!done) {
+        LOG_W("DeepSeek stream ended without [DONE]");
+    }
+
+    LOG_I("DeepSeek reply: %s", reply);
+    return reply;
+}
+
+char* deepseek_chat_stream(const char* input_text, deepseek_delta_cb_t on_delta, void *ctx) {
+    return deepseek_chat_stream_cancellable(input_text, on_delta, ctx, NULL);
+}
+
+char* deepseek_chat(const char* input_text) {
+    return deepseek_chat_stream(input_text, NULL, NULL);
+}
+
+void deepseek_get_hedge_metrics(llm_hedge_metrics_t *metrics) {
+    if (!hedge_lock) {
+        memset(metrics, 0, sizeof(*metrics));
+        return;
+    }
+    xSemaphoreTake(hedge_lock, portMAX_DELAY);
+    *metrics = hedge_metrics;
+    metrics->deadline_ms = hedge_deadline_ms();
+    xSemaphoreGive(hedge_lock);
+}
+
+int deepseek_client_init(void) {
+    if (hedge_queue) {
+        return 0;
+    }
+
+    llm_endpoint_count = 0;
+    while (llm_endpoint_count < LLM_ENDPOINTS_MAX && llm_endpoints[llm_endpoint_count].url) {
+        llm_endpoint_count++;
+    }
+    if (!hedge_lock) {
+        hedge_lock = xSemaphoreCreateMutex();
+    }
+    if (!hedge_lock) {
+        return -1;
+    }
+    if (llm_endpoint_count < 2) {
+        return 0;  // Nothing to hedge with
+    }
+
+    hedge_queue = xQueueCreate(LLM_HEDGE_WORKERS, sizeof(llm_attempt_t *));
+    if (!hedge_queue) {
+        LOG_E("Failed to create hedge queue");
+        return -1;
+    }
+    for (int i = 0; i < LLM_HEDGE_WORKERS; i++) {
+        if (xTaskCreate(hedge_task_fn, "llm_hedge", LLM_HEDGE_TASK_STACK, NULL,
+                        LLM_HEDGE_TASK_PRIO, NULL) != pdPASS) {
+            LOG_E("Failed to create hedge task");
+            break;
+        }
+        hedge_idle_workers++;
+    }
+
+    LOG_I("%d chat endpoints, %d hedge workers", llm_endpoint_count, hedge_idle_workers);
+    return 0;
 }
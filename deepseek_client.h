@@ -1,12 +1,91 @@
 #ifndef DEEPSEEK_CLIENT_H
 #define DEEPSEEK_CLIENT_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+// Hedged requests across OpenAI-compatible chat endpoints (see config.h)
+#define LLM_ENDPOINTS_MAX 3              // DeepSeek plus up to two backups
+#define LLM_HEDGE_WORKERS 2              // Requests in flight at once
+#define LLM_HEDGE_HISTORY 32             // Primary first-token latencies kept for the deadline
+#define LLM_HEDGE_MIN_SAMPLES 8          // Use LLM_HEDGE_DEFAULT_MS until this many
+#define LLM_HEDGE_DEFAULT_MS 2500
+#define LLM_HEDGE_MIN_MS 400             // Never hedge sooner than this
+
+// Hedging metrics
+typedef struct {
+    uint32_t requests;               // Chat requests
+    uint32_t hedged;                 // ...that sent a hedge because the first token was late
+    uint32_t failovers;              // ...that moved on because an endpoint failed
+    uint32_t hedge_wins;             // A backup answered first
+    uint32_t primary_wins;           // Hedged, but the primary still answered first
+    uint32_t saved_ms_total;         // First-token time saved by hedge wins (lower bound
+                                     // when the primary never answered)
+    uint32_t deadline_ms;            // Current hedge deadline
+    uint32_t unavailable;            // No free worker, request ran without hedging
+} llm_hedge_metrics_t;
+
+/**
+ * @brief Called for every content delta of a streamed reply
+ * @param ctx Caller context
+ * @param delta New text (UTF-8, NUL-terminated, only valid during the call)
+ */
+typedef void (*deepseek_delta_cb_t)(void *ctx, const char *delta);
+
+/**
+ * @brief Load the endpoint list and start the request workers
+ *
+ * Without it (or with a single endpoint) requests run on the calling task
+ * against DeepSeek only.
+ *
+ * @return 0 on success, -1 on error
+ */
+int deepseek_client_init(void);
+
 /**
  * @brief Send text to DeepSeek API and get response
- * 
+ *
  * @param input_text User input text
  * @return char* AI response text (caller must free) or NULL on failure
  */
 char* deepseek_chat(const char* input_text);
 
+/**
+ * @brief Send text to DeepSeek with a streamed (SSE) reply
+ *
+ * Events are parsed as TLS records arrive and every content delta is passed
+ * to on_delta right away, so speech can start before generation ends.
+ *
+ * With backup endpoints configured, the next endpoint is asked as well when
+ * no first token has arrived by the hedge deadline (a high percentile of
+ * recent primary first-token latencies) or the current one fails. The first
+ * endpoint to produce text is used and the others are cancelled.
+ *
+ * @param input_text User input text
+ * @param on_delta Delta callback (NULL to only collect the reply)
+ * @param ctx Callback context
+ * @return char* Complete reply text (caller must free) or NULL on failure
+ */
+char* deepseek_chat_stream(const char* input_text, deepseek_delta_cb_t on_delta, void *ctx);
+
+/**
+ * @brief Streamed request that the caller can abandon
+ *
+ * Like deepseek_chat_stream(), but every attempt is cancelled once *cancel
+ * becomes true, releasing its connection; no delta is passed on after that.
+ *
+ * @param input_text User input text
+ * @param on_delta Delta callback (NULL to only collect the reply)
+ * @param ctx Callback context
+ * @param cancel Set (from any task) to cancel
+ * @return char* Complete reply text (caller must free) or NULL on failure or cancel
+ */
+char* deepseek_chat_stream_cancellable(const char* input_text, deepseek_delta_cb_t on_delta,
+                                       void *ctx, const volatile bool *cancel);
+
+/**
+ * @brief Get hedging metrics
+ */
+void deepseek_get_hedge_metrics(llm_hedge_metrics_t *metrics);
+
 #endif // DEEPSEEK_CLIENT_H
@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+
+#include "dns_cache.h"
+#include "boot_cache.h"
+
+#define DBG_TAG "DNS"
+
+#define DNS_TASK_STACK 1024   // getaddrinfo() and the lwIP DNS query
+#define DNS_TASK_PRIO 5
+
+typedef struct {
+    char host[DNS_CACHE_HOST_MAX];
+    uint32_t addr;
+    bool valid;                // addr has been resolved at resolved_ms
+    bool negative;             // The last resolution failed at failed_ms
+    bool pending;              // Queued for the resolver task
+    uint32_t resolved_ms;
+    uint32_t failed_ms;
+    uint32_t last_used_ms;
+} dns_entry_t;
+
+static dns_entry_t entries[DNS_CACHE_MAX];
+static SemaphoreHandle_t dns_lock;
+static TaskHandle_t dns_task;
+static dns_cache_stats_t dns_stats;
+static uint32_t dns_resolve_ms_total;
+
+static uint32_t dns_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static dns_entry_t *find_entry(const char *host) {
+    for (int i = 0; i < DNS_CACHE_MAX; i++) {
+        if (entries[i].host[0] && strcmp(entries[i].host, host) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Take a free entry, else the least recently used one not being resolved
+static dns_entry_t *new_entry(const char *host) {
+    dns_entry_t *victim = NULL;
+
+    for (int i = 0; i < DNS_CACHE_MAX; i++) {
+        dns_entry_t *e = &entries[i];
+        if (!e->host[0]) {
+            victim = e;
+            break;
+        }
+        if (!e->pending && (!victim || e->last_used_ms < victim->last_used_ms)) {
+            victim = e;
+        }
+    }
+    if (victim) {
+        memset(victim, 0, sizeof(*victim));
+        strcpy(victim->host, host);
+    }
+    return victim;
+}
+
+static bool entry_fresh(const dns_entry_t *e, uint32_t now) {
+    return e->valid && now - e->resolved_ms < DNS_CACHE_TTL_S * 1000;
+}
+
+static bool entry_usable(const dns_entry_t *e, uint32_t now) {
+    return e->valid && now - e->resolved_ms < (DNS_CACHE_TTL_S + DNS_CACHE_STALE_S) * 1000;
+}
+
+static bool entry_failed_recently(const dns_entry_t *e, uint32_t now) {
+    return e->negative && now - e->failed_ms < DNS_CACHE_NEGATIVE_TTL_S * 1000;
+}
+
+// Due for a background re-resolution: close to expiry (or past it) and
+// still in use, so the next connection doesn't find it expired
+static bool entry_refresh_due(const dns_entry_t *e, uint32_t now) {
+    return e->valid && !e->pending && !entry_failed_recently(e, now) &&
+           now - e->resolved_ms >= DNS_CACHE_TTL_S * 10 * DNS_CACHE_REFRESH_PCT &&
+           now - e->last_used_ms < DNS_CACHE_TTL_S * 1000;
+}
+
+static void queue_entry(dns_entry_t *e) {
+    if (!e->pending) {
+        e->pending = true;
+        xTaskNotifyGive(dns_task);
+    }
+}
+
+static dns_cache_result_t lookup(const char *host, uint32_t *addr, bool count) {
+    uint32_t now = dns_now_ms();
+    dns_cache_result_t result;
+
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    dns_entry_t *e = find_entry(host);
+    bool stale = false;
+    if (!e && boot_cache_get_addr(host, addr, &stale)) {
+        // Saved in a previous boot: an address of unknown age is served as
+        // expired, which re-resolves it in the background right away
+        e = new_entry(host);
+        if (e) {
+            e->addr = *addr;
+            e->valid = true;
+            e->resolved_ms = stale ? now - DNS_CACHE_TTL_S * 1000 : now;
+        }
+    }
+
+    if (e && entry_fresh(e, now)) {
+        *addr = e->addr;
+        e->last_used_ms = now;
+        if (count) {
+            dns_stats.hits++;
+        }
+        if (entry_refresh_due(e, now)) {
+            queue_entry(e);
+        }
+        result = DNS_CACHE_HIT;
+    } else if (e && entry_usable(e, now)) {
+        // Expired: use it once more rather than wait, and renew it
+        *addr = e->addr;
+        e->last_used_ms = now;
+        if (count) {
+            dns_stats.stale_hits++;
+        }
+        if (!entry_failed_recently(e, now)) {
+            queue_entry(e);
+        }
+        result = DNS_CACHE_HIT;
+    } else if (e && entry_failed_recently(e, now)) {
+        if (count) {
+            dns_stats.negative_hits++;
+        }
+        result = DNS_CACHE_FAILED;
+    } else {
+        if (!e) {
+            e = new_entry(host);
+        }
+        if (count) {
+            dns_stats.misses++;
+        }
+        if (e) {
+            e->last_used_ms = now;
+            queue_entry(e);
+            result = DNS_CACHE_PENDING;
+        } else {
+            result = DNS_CACHE_FAILED;  // Every entry is being resolved
+        }
+    }
+    xSemaphoreGive(dns_lock);
+    return result;
+}
+
+dns_cache_result_t dns_cache_lookup(const char *host, uint32_t *addr) {
+    *addr = inet_addr(host);
+    if (*addr != INADDR_NONE) {
+        return DNS_CACHE_HIT;
+    }
+    if (!dns_task || strlen(host) >= DNS_CACHE_HOST_MAX) {
+        LOG_E("Cannot look up %s\r\n", host);
+        return DNS_CACHE_FAILED;
+    }
+    return lookup(host, addr, true);
+}
+
+int dns_cache_resolve(const char *host, uint32_t *addr, uint32_t timeout_ms) {
+    dns_cache_result_t result = dns_cache_lookup(host, addr);
+    uint32_t start_ms = dns_now_ms();
+
+    while (result == DNS_CACHE_PENDING) {
+        if (dns_now_ms() - start_ms >= timeout_ms) {
+            LOG_W("Resolving %s timed out after %d ms\r\n", host, timeout_ms);
+            return -1;
+        }
+        vTaskDelay(pdMS_TO_TICKS(DNS_CACHE_POLL_MS));
+
+        xSemaphoreTake(dns_lock, portMAX_DELAY);
+        dns_entry_t *e = find_entry(host);
+        bool pending = e && e->pending;
+        xSemaphoreGive(dns_lock);
+        if (!pending) {
+            result = lookup(host, addr, false);
+        }
+    }
+    return (result == DNS_CACHE_HIT) ? 0 : -1;
+}
+
+void dns_cache_prefetch_url(const char *url) {
+    char host[DNS_CACHE_HOST_MAX];
+    uint32_t addr;
+
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+    uint32_t len = strcspn(p, ":/");
+    if (len == 0 || len >= sizeof(host)) {
+        return;
+    }
+    memcpy(host, p, len);
+    host[len] = '\0';
+
+    dns_cache_lookup(host, &addr);
+}
+
+void dns_cache_invalidate(const char *host) {
+    if (!dns_task) {
+        return;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    dns_entry_t *e = find_entry(host);
+    if (e && !e->pending) {
+        memset(e, 0, sizeof(*e));
+    }
+    xSemaphoreGive(dns_lock);
+    boot_cache_drop_addr(host);
+}
+
+void dns_cache_get_stats(dns_cache_stats_t *stats) {
+    if (!dns_task) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    *stats = dns_stats;
+    stats->avg_resolve_ms = dns_stats.resolves ? dns_resolve_ms_total / dns_stats.resolves : 0;
+    xSemaphoreGive(dns_lock);
+}
+
+// Resolve one name outside the lock; getaddrinfo() is reentrant
+static void resolve_entry(const char *host) {
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    uint32_t addr = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    uint32_t start_ms = dns_now_ms();
+    bool ok = (getaddrinfo(host, NULL, &hints, &res) == 0 && res);
+    if (ok) {
+        addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    }
+    if (res) {
+        freeaddrinfo(res);
+    }
+    uint32_t now = dns_now_ms();
+    uint32_t elapsed_ms = now - start_ms;
+
+    xSemaphoreTake(dns_lock, portMAX_DELAY);
+    dns_stats.resolves++;
+    dns_stats.last_resolve_ms = elapsed_ms;
+    dns_resolve_ms_total += elapsed_ms;
+    dns_entry_t *e = find_entry(host);
+    if (e) {
+        if (e->valid) {
+            dns_stats.refreshes++;
+        }
+        if (ok) {
+            e->addr = addr;
+            e->valid = true;
+            e->negative = false;
+            e->resolved_ms = now;
+        } else {
+            // An expired address stays usable until DNS_CACHE_STALE_S runs out
+            dns_stats.failures++;
+            e->negative = true;
+            e->failed_ms = now;
+        }
+        e->pending = false;
+    }
+    dns_cache_stats_t stats = dns_stats;
+    xSemaphoreGive(dns_lock);
+
+    if (ok) {
+        boot_cache_put_addr(host, addr, DNS_CACHE_TTL_S);
+        struct in_addr in = { .s_addr = addr };
+        LOG_I("%s -> %s (%d ms); hits %d stale %d misses %d negative %d\r\n", host, inet_ntoa(in),
+              elapsed_ms, stats.hits, stats.stale_hits, stats.misses, stats.negative_hits);
+    } else {
+        LOG_W("Failed to resolve %s (%d ms)\r\n", host, elapsed_ms);
+    }
+}
+
+// Resolver task: works off queued lookups, and renews addresses in use
+// before they expire so connection setup never waits on DNS
+static void dns_task_fn(void *arg) {
+    char host[DNS_CACHE_HOST_MAX];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DNS_CACHE_SCAN_MS));
+
+        while (1) {
+            uint32_t now = dns_now_ms();
+            host[0] = '\0';
+
+            xSemaphoreTake(dns_lock, portMAX_DELAY);
+            for (int i = 0; i < DNS_CACHE_MAX && !host[0]; i++) {
+                dns_entry_t *e = &entries[i];
+                if (e->host[0] && (e->pending || entry_refresh_due(e, now))) {
+                    e->pending = true;
+                    strcpy(host, e->host);
+                }
+            }
+            xSemaphoreGive(dns_lock);
+
+            if (!host[0]) {
+                break;
+            }
+            resolve_entry(host);
+        }
+    }
+}
+
+int dns_cache_init(void) {
+    if (dns_task) {
+        return 0;
+    }
+
+    dns_lock = xSemaphoreCreateMutex();
+    if (!dns_lock) {
+        return -1;
+    }
+
+    if (xTaskCreate(dns_task_fn, "dns_cache", DNS_TASK_STACK, NULL,
+                    DNS_TASK_PRIO, &dns_task) != pdPASS) {
+        LOG_E("Failed to create DNS task\r\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef __DNS_CACHE_H__
+#define __DNS_CACHE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Resolver cache shared by all network clients
+#define DNS_CACHE_MAX 8
+#define DNS_CACHE_HOST_MAX 64
+#define DNS_CACHE_TTL_S 300              // lwIP does not report record TTLs
+#define DNS_CACHE_REFRESH_PCT 80         // Re-resolve in the background after this share of the TTL
+#define DNS_CACHE_STALE_S 600            // Keep serving an expired address this long while refreshing
+#define DNS_CACHE_NEGATIVE_TTL_S 15      // Don't retry a failed name before this
+#define DNS_CACHE_SCAN_MS 5000           // Background refresh check period
+#define DNS_CACHE_POLL_MS 10             // dns_cache_resolve() wait granularity
+
+typedef enum {
+    DNS_CACHE_HIT = 0,       // Address returned
+    DNS_CACHE_PENDING,       // Resolution queued, ask again later
+    DNS_CACHE_FAILED,        // Name recently failed to resolve
+} dns_cache_result_t;
+
+// Resolver statistics
+typedef struct {
+    uint32_t hits;               // Answered from a fresh entry
+    uint32_t stale_hits;         // Answered from an expired entry being refreshed
+    uint32_t misses;             // Nothing cached, resolution queued
+    uint32_t negative_hits;      // Answered from a recent failure
+    uint32_t resolves;           // Resolutions done by the background task
+    uint32_t refreshes;          // ...of which renewed an address still in use
+    uint32_t failures;
+    uint32_t last_resolve_ms;
+    uint32_t avg_resolve_ms;
+} dns_cache_stats_t;
+
+/**
+ * @brief Start the resolver task
+ *
+ * Call after boot_cache_init(); addresses saved in the previous boot seed
+ * the cache on first use.
+ *
+ * @return 0 on success, -1 on error
+ */
+int dns_cache_init(void);
+
+/**
+ * @brief Look up a host without blocking
+ *
+ * Numeric addresses are returned as is. A miss or an address close to
+ * expiry queues a background resolution.
+ *
+ * @param host Host name or dotted IPv4 address
+ * @param addr Address in network byte order (set on DNS_CACHE_HIT)
+ * @return Lookup result
+ */
+dns_cache_result_t dns_cache_lookup(const char *host, uint32_t *addr);
+
+/**
+ * @brief Look up a host, waiting for the resolver on a miss
+ * @param host Host name or dotted IPv4 address
+ * @param addr Address in network byte order
+ * @param timeout_ms Longest wait for the resolver
+ * @return 0 on success, -1 if the name did not resolve in time
+ */
+int dns_cache_resolve(const char *host, uint32_t *addr, uint32_t timeout_ms);
+
+/**
+ * @brief Resolve the host of a URL in the background, e.g. at boot
+ */
+void dns_cache_prefetch_url(const char *url);
+
+/**
+ * @brief Forget a host's address, e.g. after connecting to it failed
+ */
+void dns_cache_invalidate(const char *host);
+
+/**
+ * @brief Get the resolver statistics
+ */
+void dns_cache_get_stats(dns_cache_stats_t *stats);
+
+#endif // __DNS_CACHE_H__
@@ -0,0 +1,89 @@
+#include "endpoint.h"
+#include "config.h"
+#include <string.h>
+
+static const char *complete_phrases[] = { ENDPOINT_COMPLETE_PHRASES };
+static const char *question_endings[] = { "？", "?", "吗", "呢", "吧", "么", "嘛" };
+static const char *sentence_endings[] = { "。", ".", "！", "!" };
+static const char *continuation_endings[] = {
+    "，", ",", "、", "然后", "还有", "而且", "但是", "因为", "所以", "和", "的", "就是",
+};
+
+#define COUNT_OF(a) (sizeof(a) / sizeof((a)[0]))
+
+static bool ends_with(const char *text, uint32_t len, const char *suffix) {
+    uint32_t suffix_len = strlen(suffix);
+    return len >= suffix_len && memcmp(text + len - suffix_len, suffix, suffix_len) == 0;
+}
+
+static bool ends_with_any(const char *text, uint32_t len, const char **list, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (ends_with(text, len, list[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+endpoint_class_t endpoint_classify(const char *transcript) {
+    uint32_t len = transcript ? strlen(transcript) : 0;
+
+    // Ignore trailing whitespace
+    while (len > 0 && (transcript[len - 1] == ' ' || transcript[len - 1] == '\n')) {
+        len--;
+    }
+    if (len == 0) {
+        return ENDPOINT_UNKNOWN;
+    }
+
+    if (ends_with_any(transcript, len, continuation_endings, COUNT_OF(continuation_endings))) {
+        return ENDPOINT_INCOMPLETE;
+    }
+    if (ends_with_any(transcript, len, question_endings, COUNT_OF(question_endings))) {
+        return ENDPOINT_COMPLETE;
+    }
+
+    // Phrases may be followed by sentence punctuation ("谢谢。")
+    bool sentence = false;
+    for (uint32_t i = 0; i < COUNT_OF(sentence_endings); i++) {
+        if (ends_with(transcript, len, sentence_endings[i])) {
+            len -= strlen(sentence_endings[i]);
+            sentence = true;
+            break;
+        }
+    }
+    if (ends_with_any(transcript, len, complete_phrases, COUNT_OF(complete_phrases)) ||
+        ends_with_any(transcript, len, question_endings, COUNT_OF(question_endings))) {
+        return ENDPOINT_COMPLETE;
+    }
+    return sentence ? ENDPOINT_SENTENCE : ENDPOINT_UNKNOWN;
+}
+
+uint32_t endpoint_required_silence_ms(const char *transcript, bool transcript_fresh) {
+    // A transcript that lags the audio says nothing about the last words
+    if (!transcript_fresh) {
+        return ENDPOINT_SILENCE_DEFAULT_MS;
+    }
+
+    switch (endpoint_classify(transcript)) {
+    case ENDPOINT_COMPLETE:
+        return ENDPOINT_SILENCE_COMPLETE_MS;
+    case ENDPOINT_SENTENCE:
+        return ENDPOINT_SILENCE_SENTENCE_MS;
+    default:
+        return ENDPOINT_SILENCE_DEFAULT_MS;
+    }
+}
+
+const char *endpoint_class_name(endpoint_class_t cls) {
+    switch (cls) {
+    case ENDPOINT_INCOMPLETE:
+        return "incomplete";
+    case ENDPOINT_SENTENCE:
+        return "sentence";
+    case ENDPOINT_COMPLETE:
+        return "complete";
+    default:
+        return "unknown";
+    }
+}
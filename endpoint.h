@@ -0,0 +1,37 @@
+#ifndef __ENDPOINT_H__
+#define __ENDPOINT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Endpoint policy: required trailing silence depends on how complete the
+// live transcript looks. Durations and the phrase list live in config.h.
+
+typedef enum {
+    ENDPOINT_INCOMPLETE = 0,   // Ends with a comma or a connective ("然后", "还有", ...)
+    ENDPOINT_UNKNOWN,          // Nothing to go on: acoustic endpoint only
+    ENDPOINT_SENTENCE,         // Ends with sentence punctuation
+    ENDPOINT_COMPLETE,         // Question (？/吗/呢/吧/么) or a configured phrase
+} endpoint_class_t;
+
+/**
+ * @brief Classify how complete a transcript looks
+ * @param transcript Live transcript (UTF-8)
+ * @return Completeness class
+ */
+endpoint_class_t endpoint_classify(const char *transcript);
+
+/**
+ * @brief Trailing silence needed before ending the turn
+ * @param transcript Live transcript (UTF-8), may be empty
+ * @param transcript_fresh Transcript was received after the last speech, i.e. covers it
+ * @return Required silence in milliseconds
+ */
+uint32_t endpoint_required_silence_ms(const char *transcript, bool transcript_fresh);
+
+/**
+ * @brief Short name of a class for logs
+ */
+const char *endpoint_class_name(endpoint_class_t cls);
+
+#endif // __ENDPOINT_H__
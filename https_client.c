@@ -1,8 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <errno.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "log.h"
 
 #include <lwip/sockets.h>
@@ -10,14 +14,19 @@
 #include <lwip/tcp.h>
 #include <lwip/err.h>
 
+#include "net_impair.h"
+
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
+#include "mbedtls/version.h"
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/error.h"
 #include "mbedtls/debug.h"
 
 #include "https_client.h"
+#include "boot_cache.h"
+#include "dns_cache.h"
 
 #define DBG_TAG "HTTPS"
 #define RECV_BUF_SIZE 2048                        // Reduced from 4096
@@ -25,34 +34,41 @@
 #define MAX_RESPONSE_SIZE_TTS (32 * 1024)         // 32KB for TTS audio (reduced from 48KB)
 #define SEND_CHUNK_SIZE 1024                      // Send 1KB at a time (reduced from 2KB)
 #define PAUSE_INTERVAL (16 * 1024)                // Pause every 16KB
+#define HTTPS_HOST_MAX 64                         // Host names kept for connection reuse
+#define HTTPS_CACHED_CONNECT_TIMEOUT_MS 1500      // Give up on a remembered address after this
+#define HTTP_CONNECT_TIMEOUT_MS 10000
+#define HTTP_DNS_TIMEOUT_MS 5000
+#define HTTP_IO_TIMEOUT_S 300                     // 5 minutes, TTS synthesis can be slow
+#define HTTP_CANCEL_POLL_MS 50                    // Cancel flag check period while waiting for data
+#define HTTPS_CONN_POLL_MS 50                     // Pool rescan period while waiting for a slot
 
 // Parse URL into components
 static int parse_url(const char* url, char* protocol, char* host, int* port, char* path) {
     // Format: http://host:port/path or https://host:port/path
     const char* p = url;
-    
+
     // Extract protocol
     const char* proto_end = strstr(p, "://");
     if (!proto_end) {
         return -1;
     }
-    
+
     int proto_len = proto_end - p;
     memcpy(protocol, p, proto_len);
     protocol[proto_len] = '\0';
-    
+
     p = proto_end + 3;  // Skip "://"
-    
+
     // Extract host and port
     const char* path_start = strchr(p, '/');
     const char* port_start = strchr(p, ':');
-    
+
     if (port_start && (!path_start || port_start < path_start)) {
         // Port is specified
         int host_len = port_start - p;
         memcpy(host, p, host_len);
         host[host_len] = '\0';
-        
+
         *port = atoi(port_start + 1);
         p = path_start ? path_start : (p + strlen(p));
     } else {
@@ -60,7 +76,7 @@ static int parse_url(const char* url, char* protocol, char* host, int* port, cha
         int host_len = path_start ? (path_start - p) : strlen(p);
         memcpy(host, p, host_len);
         host[host_len] = '\0';
-        
+
         if (strcmp(protocol, "https") == 0) {
             *port = 443;
         } else {
@@ -68,745 +84,1122 @@ static int parse_url(const char* url, char* protocol, char* host, int* port, cha
         }
         p = path_start ? path_start : (p + strlen(p));
     }
-    
+
     // Extract path
     if (*p == '\0') {
         strcpy(path, "/");
     } else {
         strcpy(path, p);
     }
-    
+
     return 0;
 }
 
-// Perform HTTP request (non-SSL)
-static char* http_request_plain(const char* host, int port, const char* path,
-                                const char* method, const char* headers,
-                                const char* body, int body_len) {
-    int sockfd = -1;
+// TLS connection state
+typedef struct {
+    mbedtls_net_context server_fd;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+} https_tls_t;
+
+// One HTTP connection, over a plain socket or TLS
+typedef struct {
+    bool secure;
+    int fd;
+    https_tls_t tls;           // Used when secure
+    net_impair_endpoint_t impair;  // Server role for the impairment shim
+} http_transport_t;
+
+// Kept-alive connection slot
+typedef struct {
+    http_transport_t t;
+    char host[HTTPS_HOST_MAX];
+    int port;
+    bool open;                 // Connected (and TLS established) and reusable
+    bool busy;                 // Owned by a request
+    bool prewarmed;            // Opened by https_prewarm(), no request has used it yet
+    bool prewarming;           // Busy with https_prewarm()'s connect; no request on it
+    uint32_t idle_since_ms;
+} https_conn_t;
+
+// One piece of a request body; bodies are sent part by part without joining
+typedef struct {
+    const char *data;
+    int len;
+} http_part_t;
+
+// One DRBG seeded at init and shared by every connection
+static mbedtls_entropy_context tls_entropy;
+static mbedtls_ctr_drbg_context tls_ctr_drbg;
+static SemaphoreHandle_t tls_rng_lock;
+static bool tls_ready;
+
+// Connection pool, session cache and statistics, guarded by tls_pool_lock
+static SemaphoreHandle_t tls_pool_lock;
+static SemaphoreHandle_t conn_released;    // Given whenever a slot is released
+static https_conn_t conn_pool[HTTPS_KEEPALIVE_SLOTS];
+static mbedtls_ssl_session tls_session;    // Last negotiated session, offered for resumption
+static bool tls_session_valid;
+static char tls_session_host[HTTPS_HOST_MAX];
+static int tls_session_port;
+static https_tls_stats_t tls_stats;
+static uint32_t tls_full_ms_total;
+static uint32_t tls_resumed_ms_total;
+
+static uint32_t https_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+int https_client_init(void) {
+    if (tls_ready) {
+        return 0;
+    }
+
+    tls_rng_lock = xSemaphoreCreateMutex();
+    tls_pool_lock = xSemaphoreCreateMutex();
+    conn_released = xSemaphoreCreateBinary();
+    if (!tls_rng_lock || !tls_pool_lock || !conn_released) {
+        LOG_E("Failed to create TLS locks");
+        return -1;
+    }
+
+    mbedtls_entropy_init(&tls_entropy);
+    mbedtls_ctr_drbg_init(&tls_ctr_drbg);
+    mbedtls_ssl_session_init(&tls_session);
+
+    const char* pers = "https_client";
+    int ret = mbedtls_ctr_drbg_seed(&tls_ctr_drbg, mbedtls_entropy_func, &tls_entropy,
+                                    (const unsigned char*)pers, strlen(pers));
+    if (ret != 0) {
+        LOG_E("mbedtls_ctr_drbg_seed failed: -0x%04x", -ret);
+        return -1;
+    }
+
+    // Session from the previous boot; the server decides whether it is still good
+    uint8_t *saved = pvPortMalloc(BOOT_CACHE_TLS_SESSION_MAX);
+    if (saved) {
+        int len = boot_cache_get_tls_session(tls_session_host, sizeof(tls_session_host),
+                                             &tls_session_port, saved, BOOT_CACHE_TLS_SESSION_MAX);
+        if (len > 0 && mbedtls_ssl_session_load(&tls_session, saved, len) == 0) {
+            tls_session_valid = true;
+            LOG_I("Restored TLS session for %s", tls_session_host);
+        } else if (len > 0) {
+            // Saved by a different mbedTLS build or corrupt
+            mbedtls_ssl_session_free(&tls_session);
+            mbedtls_ssl_session_init(&tls_session);
+        }
+        vPortFree(saved);
+    }
+
+    for (int i = 0; i < HTTPS_KEEPALIVE_SLOTS; i++) {
+        conn_pool[i].t.fd = -1;
+    }
+
+    tls_ready = true;
+    return 0;
+}
+
+// Hand the cached session to the boot cache so the next boot can resume it
+static void https_tls_persist_session(bool fresh) {
+    uint8_t *buf = pvPortMalloc(BOOT_CACHE_TLS_SESSION_MAX);
+    if (!buf) {
+        return;
+    }
+
+    size_t len = 0;
+    xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+    int ret = tls_session_valid ?
+              mbedtls_ssl_session_save(&tls_session, buf, BOOT_CACHE_TLS_SESSION_MAX, &len) : -1;
+    xSemaphoreGive(tls_pool_lock);
+
+    if (ret == 0) {
+        boot_cache_put_tls_session(tls_session_host, tls_session_port, buf, len, fresh);
+    } else if (tls_session_valid) {
+        LOG_W("TLS session not persisted: -0x%04x", -ret);
+    }
+    vPortFree(buf);
+}
+
+// ctr_drbg is not thread safe; connections on different tasks share it
+static int https_rng(void *ctx, unsigned char *output, size_t len) {
+    xSemaphoreTake(tls_rng_lock, portMAX_DELAY);
+    int ret = mbedtls_ctr_drbg_random(ctx, output, len);
+    xSemaphoreGive(tls_rng_lock);
+    return ret;
+}
+
+// Socket calls go through the impairment shim under the endpoint the
+// connection serves: the TTS server is TTS, every other server (DeepSeek,
+// backup chat endpoints) is LLM. Decided by host and port rather than
+// protocol, since local chat servers speak plain HTTP too.
+#if NET_IMPAIR_ENABLE
+#define http_sock_connect(endpoint, s, name, len) net_impair_connect(endpoint, s, name, len)
+#define http_sock_send(endpoint, s, data, size) net_impair_send(endpoint, s, data, size, 0)
+#define http_sock_recv(endpoint, s, mem, len) net_impair_recv(endpoint, s, mem, len, 0)
+#else
+#define http_sock_connect(endpoint, s, name, len) connect(s, name, len)
+#define http_sock_send(endpoint, s, data, size) send(s, data, size, 0)
+#define http_sock_recv(endpoint, s, mem, len) recv(s, mem, len, 0)
+#endif
+
+static net_impair_endpoint_t http_impair_endpoint(const char *host, int port) {
+#if NET_IMPAIR_ENABLE
+    char protocol[16];
+    char tts_host[256];
+    char path[512];
+    int tts_port;
+
+    if (parse_url(TTS_API_URL, protocol, tts_host, &tts_port, path) == 0 &&
+        tts_port == port && strcmp(tts_host, host) == 0) {
+        return NET_IMPAIR_TTS;
+    }
+#endif
+    return NET_IMPAIR_LLM;
+}
+
+// Non-blocking connect with a timeout; returns the socket or -1
+static int http_connect_addr(net_impair_endpoint_t impair, uint32_t addr, int port, uint32_t timeout_ms) {
     struct sockaddr_in server_addr;
-    struct hostent* server;
-    char* response = NULL;
-    char* recv_buf = NULL;
-    int total_received = 0;
 
-    // Create socket
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0) {
         LOG_E("Failed to create socket");
-        return NULL;
+        return -1;
     }
 
-    // Set socket timeout to 5 minutes for TTS
-    struct timeval tv_timeout;
-    tv_timeout.tv_sec = 300;  // 5 minutes
-    tv_timeout.tv_usec = 0;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv_timeout, sizeof(tv_timeout));
-    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv_timeout, sizeof(tv_timeout));
-
-    // Get host by name
-    server = gethostbyname(host);
-    if (server == NULL) {
-        LOG_E("Failed to resolve host: %s", host);
-        close(sockfd);
-        return NULL;
-    }
-    
-    // Setup server address
     memset(&server_addr, 0, sizeof(server_addr));
     server_addr.sin_family = AF_INET;
-    memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
+    server_addr.sin_addr.s_addr = addr;
     server_addr.sin_port = htons(port);
-    
-    // Connect
-    LOG_I("Connecting to %s:%d...", host, port);
-    if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_E("Failed to connect");
-        close(sockfd);
-        return NULL;
+
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+
+    int ret = http_sock_connect(impair, sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr));
+    if (ret < 0 && errno == EINPROGRESS) {
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(sockfd, &wfds);
+        if (select(sockfd + 1, NULL, &wfds, NULL, &tv) > 0) {
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+            ret = (err == 0) ? 0 : -1;
+        }
     }
-    
-    LOG_I("Connected!");
-    
-    // Build HTTP request header
-    char request_header[512];
-    int header_len = sprintf(request_header,
-        "%s %s HTTP/1.1\r\n"
-        "Host: %s\r\n"
-        "%s"
-        "Content-Length: %d\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        method, path, host, headers ? headers : "", body_len);
-    
-    // Send header
-    int sent = send(sockfd, request_header, header_len, 0);
-    if (sent < 0) {
-        LOG_E("Failed to send request header");
+    fcntl(sockfd, F_SETFL, flags);
+
+    if (ret < 0) {
         close(sockfd);
-        return NULL;
+        return -1;
     }
-    
-    int total_sent = sent;
-    
-    // Send body in chunks if present
-    if (body && body_len > 0) {
-        int remaining = body_len;
-        int offset = 0;
-        int pause_counter = 0;
-        
-        LOG_I("Sending body in chunks (%d bytes total)...", body_len);
-        
-        while (remaining > 0) {
-            int chunk_size = (remaining > SEND_CHUNK_SIZE) ? SEND_CHUNK_SIZE : remaining;
-            
-            sent = send(sockfd, body + offset, chunk_size, 0);
-            if (sent < 0) {
-                LOG_E("Failed to send body chunk at offset %d", offset);
-                close(sockfd);
-                return NULL;
-            }
-            
-            offset += sent;
-            remaining -= sent;
-            total_sent += sent;
-            pause_counter += sent;
-            
-            // Pause every 16KB to let network stack process
-            if (pause_counter >= PAUSE_INTERVAL && remaining > 0) {
-                vTaskDelay(pdMS_TO_TICKS(10));
-                pause_counter = 0;
-                LOG_I("Sent %d/%d bytes (pausing)...", offset, body_len);
-            }
+
+    struct timeval tv_timeout;
+    tv_timeout.tv_sec = HTTP_IO_TIMEOUT_S;
+    tv_timeout.tv_usec = 0;
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv_timeout, sizeof(tv_timeout));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv_timeout, sizeof(tv_timeout));
+
+    // Header and body go out as separate writes; on a kept-alive connection
+    // Nagle would hold the body until the server's delayed ACK
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return sockfd;
+}
+
+// Connect by name. A cached address is tried first with a short timeout
+// (the host may have moved since it was resolved); returns the socket or -1
+static int http_connect(const char* host, int port, net_impair_endpoint_t impair) {
+    uint32_t addr = inet_addr(host);
+    bool by_name = (addr == INADDR_NONE);
+    int fd;
+
+    if (by_name && dns_cache_lookup(host, &addr) == DNS_CACHE_HIT) {
+        struct in_addr in = { .s_addr = addr };
+        LOG_I("Connecting to %s:%d (cached %s)...", host, port, inet_ntoa(in));
+        fd = http_connect_addr(impair, addr, port, HTTPS_CACHED_CONNECT_TIMEOUT_MS);
+        if (fd >= 0) {
+            return fd;
         }
-        
-        LOG_I("Body sent successfully (%d bytes)", body_len);
+        LOG_W("Cached address for %s failed, resolving", host);
+        dns_cache_invalidate(host);
     }
-    
-    LOG_I("Request sent (%d bytes total)", total_sent);
-    
-    // Allocate receive buffers
-    recv_buf = pvPortMalloc(RECV_BUF_SIZE);
-    if (!recv_buf) {
-        LOG_E("Failed to allocate recv_buf (%d bytes)", RECV_BUF_SIZE);
-        close(sockfd);
-        return NULL;
+
+    if (by_name && dns_cache_resolve(host, &addr, HTTP_DNS_TIMEOUT_MS) < 0) {
+        LOG_E("Failed to resolve host: %s", host);
+        return -1;
     }
-    
-    response = pvPortMalloc(MAX_RESPONSE_SIZE_DEFAULT);
-    if (!response) {
-        LOG_E("Failed to allocate response buffer (%d bytes)", MAX_RESPONSE_SIZE_DEFAULT);
-        vPortFree(recv_buf);
-        close(sockfd);
-        return NULL;
+
+    LOG_I("Connecting to %s:%d...", host, port);
+    fd = http_connect_addr(impair, addr, port, HTTP_CONNECT_TIMEOUT_MS);
+    if (fd < 0) {
+        LOG_E("Failed to connect to %s:%d", host, port);
+        return -1;
     }
+    return fd;
+}
 
-    while (1) {
-        int received = recv(sockfd, recv_buf, RECV_BUF_SIZE - 1, 0);
-        if (received <= 0) {
-            break;
-        }
+static void https_tls_close(https_tls_t *tls) {
+    mbedtls_ssl_close_notify(&tls->ssl);
+    mbedtls_net_free(&tls->server_fd);
+    mbedtls_ssl_free(&tls->ssl);
+    mbedtls_ssl_config_free(&tls->conf);
+}
 
-        if (total_received + received >= MAX_RESPONSE_SIZE_DEFAULT) {
-            LOG_W("Response too large, truncating");
-            received = MAX_RESPONSE_SIZE_DEFAULT - total_received - 1;
-            if (received <= 0) break;
-        }
-        
-        memcpy(response + total_received, recv_buf, received);
-        total_received += received;
-    }
-    
-    response[total_received] = '\0';
-    vPortFree(recv_buf);
-    close(sockfd);
-    
-    // Find body (after "\r\n\r\n")
-    char* body_start = strstr(response, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4;
-        int body_length = total_received - (body_start - response);
-        char* body_only = pvPortMalloc(body_length + 1);
-        if (body_only) {
-            memcpy(body_only, body_start, body_length);
-            body_only[body_length] = '\0';
-            vPortFree(response);
-            return body_only;
-        }
-    }
-    
-    return response;
-}
-
-// Perform HTTPS request (with SSL)
-static char* https_request_secure(const char* host, int port, const char* path,
-                                  const char* method, const char* headers,
-                                  const char* body, int body_len) {
-    mbedtls_net_context server_fd;
-    mbedtls_ssl_context ssl;
-    mbedtls_ssl_config conf;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
-    char* response = NULL;
-    char* recv_buf = NULL;
-    int total_received = 0;
+// Handshake; reports whether the server resumed the offered session
+static int https_tls_handshake(https_tls_t *tls, bool *resumed) {
     int ret;
-    
-    // Initialize structures
-    mbedtls_net_init(&server_fd);
-    mbedtls_ssl_init(&ssl);
-    mbedtls_ssl_config_init(&conf);
-    mbedtls_entropy_init(&entropy);
-    mbedtls_ctr_drbg_init(&ctr_drbg);
-    
-    // Seed random number generator
-    const char* pers = "https_client";
-    ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
-                                (const unsigned char*)pers, strlen(pers));
-    if (ret != 0) {
-        LOG_E("mbedtls_ctr_drbg_seed failed: -0x%04x", -ret);
-        goto cleanup;
+
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    while ((ret = mbedtls_ssl_handshake(&tls->ssl)) != 0) {
+        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return ret;
+        }
     }
-    
-    // Connect to server
-    char port_str[8];
-    sprintf(port_str, "%d", port);
-    
-    LOG_I("Connecting to %s:%d...", host, port);
-    ret = mbedtls_net_connect(&server_fd, host, port_str, MBEDTLS_NET_PROTO_TCP);
-    if (ret != 0) {
-        LOG_E("mbedtls_net_connect failed: -0x%04x", -ret);
-        goto cleanup;
+    *resumed = mbedtls_ssl_session_reused(&tls->ssl);
+#else
+    // No accessor in 2.x: an abbreviated handshake never reaches the
+    // server certificate state
+    bool saw_certificate = false;
+    while (tls->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        if (tls->ssl.state == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+            saw_certificate = true;
+        }
+        ret = mbedtls_ssl_handshake_step(&tls->ssl);
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+            return ret;
+        }
     }
-    
+    *resumed = !saw_certificate;
+#endif
+    return 0;
+}
+
+// Handshake on a connected socket, offering the cached session for
+// resumption; on failure the socket is already closed
+static int https_tls_open(https_tls_t *tls, const char* host, int port, int fd) {
+    int ret;
+
+    // Initialize structures
+    mbedtls_net_init(&tls->server_fd);
+    mbedtls_ssl_init(&tls->ssl);
+    mbedtls_ssl_config_init(&tls->conf);
+    tls->server_fd.fd = fd;
+
     // Setup SSL/TLS
-    ret = mbedtls_ssl_config_defaults(&conf,
+    ret = mbedtls_ssl_config_defaults(&tls->conf,
                                       MBEDTLS_SSL_IS_CLIENT,
                                       MBEDTLS_SSL_TRANSPORT_STREAM,
                                       MBEDTLS_SSL_PRESET_DEFAULT);
     if (ret != 0) {
         LOG_E("mbedtls_ssl_config_defaults failed: -0x%04x", -ret);
-        goto cleanup;
+        goto fail;
     }
-    
-    mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);  // Skip certificate verification for simplicity
-    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
-    
-    ret = mbedtls_ssl_setup(&ssl, &conf);
+
+    mbedtls_ssl_conf_authmode(&tls->conf, MBEDTLS_SSL_VERIFY_NONE);  // Skip certificate verification for simplicity
+    mbedtls_ssl_conf_rng(&tls->conf, https_rng, &tls_ctr_drbg);
+    mbedtls_ssl_conf_session_tickets(&tls->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+
+    ret = mbedtls_ssl_setup(&tls->ssl, &tls->conf);
     if (ret != 0) {
         LOG_E("mbedtls_ssl_setup failed: -0x%04x", -ret);
-        goto cleanup;
+        goto fail;
     }
-    
-    ret = mbedtls_ssl_set_hostname(&ssl, host);
+
+    ret = mbedtls_ssl_set_hostname(&tls->ssl, host);
     if (ret != 0) {
         LOG_E("mbedtls_ssl_set_hostname failed: -0x%04x", -ret);
-        goto cleanup;
+        goto fail;
     }
-    
-    mbedtls_ssl_set_bio(&ssl, &server_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
-    
+
+#if NET_IMPAIR_ENABLE
+    mbedtls_ssl_set_bio(&tls->ssl, &tls->server_fd, net_impair_tls_send, net_impair_tls_recv, NULL);
+#else
+    mbedtls_ssl_set_bio(&tls->ssl, &tls->server_fd, mbedtls_net_send, mbedtls_net_recv, NULL);
+#endif
+
+    // Offer the last session (ticket or session ID) to skip the key exchange
+    bool offered = false;
+    xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+    if (tls_session_valid && tls_session_port == port && strcmp(tls_session_host, host) == 0) {
+        offered = (mbedtls_ssl_set_session(&tls->ssl, &tls_session) == 0);
+    }
+    xSemaphoreGive(tls_pool_lock);
+
     // Perform SSL handshake
-    LOG_I("Performing SSL handshake...");
-    while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
-        if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-            LOG_E("mbedtls_ssl_handshake failed: -0x%04x", -ret);
-            goto cleanup;
+    LOG_I("Performing SSL handshake%s...", offered ? " (resuming)" : "");
+    uint32_t start_ms = https_now_ms();
+    bool resumed = false;
+    ret = https_tls_handshake(tls, &resumed);
+    uint32_t elapsed_ms = https_now_ms() - start_ms;
+
+    xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+    if (ret != 0) {
+        tls_stats.handshake_failures++;
+        if (offered) {
+            tls_session_valid = false;  // Don't offer a session the server chokes on again
+        }
+    } else {
+        tls_stats.last_handshake_ms = elapsed_ms;
+        if (resumed) {
+            tls_stats.handshakes_resumed++;
+            tls_resumed_ms_total += elapsed_ms;
+        } else {
+            tls_stats.handshakes_full++;
+            tls_full_ms_total += elapsed_ms;
+        }
+        // Keep the newest session; a resumed one may carry a fresh ticket
+        mbedtls_ssl_session_free(&tls_session);
+        mbedtls_ssl_session_init(&tls_session);
+        tls_session_valid = (mbedtls_ssl_get_session(&tls->ssl, &tls_session) == 0);
+        strncpy(tls_session_host, host, sizeof(tls_session_host) - 1);
+        tls_session_host[sizeof(tls_session_host) - 1] = '\0';
+        tls_session_port = port;
+    }
+    xSemaphoreGive(tls_pool_lock);
+
+    if (ret != 0) {
+        LOG_E("mbedtls_ssl_handshake failed: -0x%04x", -ret);
+        goto fail;
+    }
+    https_tls_persist_session(!resumed);
+
+    https_tls_stats_t stats;
+    https_get_tls_stats(&stats);
+    LOG_I("SSL handshake complete (%s, %u ms); full %u avg %u ms, resumed %u avg %u ms, reused %u/%u",
+          resumed ? "resumed" : "full", elapsed_ms, stats.handshakes_full, stats.avg_full_ms,
+          stats.handshakes_resumed, stats.avg_resumed_ms, stats.reused, stats.requests);
+    return 0;
+
+fail:
+    https_tls_close(tls);
+    return -1;
+}
+
+// Transport: the engine below only sees open/write/read/close
+
+static int http_transport_open(http_transport_t *t, const char* host, int port, bool secure) {
+    t->secure = secure;
+    t->impair = http_impair_endpoint(host, port);
+    t->fd = http_connect(host, port, t->impair);
+    if (t->fd < 0) {
+        return -1;
+    }
+    if (secure && https_tls_open(&t->tls, host, port, t->fd) < 0) {
+        t->fd = -1;  // Closed by https_tls_open
+        return -1;
+    }
+    return 0;
+}
+
+static void http_transport_close(http_transport_t *t) {
+    if (t->fd < 0) {
+        return;
+    }
+    if (t->secure) {
+        https_tls_close(&t->tls);
+    } else {
+        close(t->fd);
+    }
+    t->fd = -1;
+}
+
+// Write everything; 0 on success, -1 on error
+static int http_transport_write(http_transport_t *t, const char *data, int len) {
+    while (len > 0) {
+        int ret;
+        if (t->secure) {
+            ret = mbedtls_ssl_write(&t->tls.ssl, (const unsigned char*)data, len);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+                continue;
+            }
+        } else {
+            ret = http_sock_send(t->impair, t->fd, data, len);
+        }
+        if (ret <= 0) {
+            LOG_E("Send failed: %d", ret);
+            return -1;
+        }
+        data += ret;
+        len -= ret;
+    }
+    return 0;
+}
+
+// Read what is available; bytes read, 0 when the peer closed, -1 on error
+static int http_transport_read(http_transport_t *t, char *buf, int len) {
+    if (!t->secure) {
+        int ret = http_sock_recv(t->impair, t->fd, buf, len);
+        return (ret < 0) ? -1 : ret;
+    }
+
+    while (1) {
+        int ret = mbedtls_ssl_read(&t->tls.ssl, (unsigned char*)buf, len);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            continue;
+        }
+        if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+            return 0;
+        }
+        if (ret < 0) {
+            LOG_E("mbedtls_ssl_read failed: -0x%04x", -ret);
+            return -1;
         }
+        return ret;
     }
-    
-    LOG_I("SSL handshake complete!");
-    
+}
+
+// Wait until the response can be read; 0 when readable, -1 once *cancel
+// is set or after HTTP_IO_TIMEOUT_S. Only used for cancellable requests,
+// the others block in the read with the socket timeout
+static int http_transport_wait(http_transport_t *t, const volatile bool *cancel) {
+    uint32_t waited_ms = 0;
+
+    while (!*cancel) {
+        if (t->secure && mbedtls_ssl_get_bytes_avail(&t->tls.ssl) > 0) {
+            return 0;  // Already decrypted, nothing more to wait for on the socket
+        }
+
+        fd_set rfds;
+        struct timeval tv = {0, HTTP_CANCEL_POLL_MS * 1000};
+        FD_ZERO(&rfds);
+        FD_SET(t->fd, &rfds);
+        if (select(t->fd + 1, &rfds, NULL, NULL, &tv) != 0) {
+            return 0;  // Data, EOF or an error the read will report
+        }
+        waited_ms += HTTP_CANCEL_POLL_MS;
+        if (waited_ms >= HTTP_IO_TIMEOUT_S * 1000) {
+            LOG_E("Receive timed out");
+            return -1;
+        }
+    }
+    LOG_I("Request cancelled");
+    return -1;
+}
+
+// Send the request line, headers and body parts
+static int http_send_request(http_transport_t *t, const char* host, const char* path,
+                             const char* method, const char* headers,
+                             const http_part_t *parts, int part_count, bool keep_alive) {
+    int body_len = 0;
+    for (int i = 0; i < part_count; i++) {
+        body_len += parts[i].len;
+    }
+
     // Build HTTP request header
     char request_header[512];
-    int header_len = sprintf(request_header,
+    int header_len = snprintf(request_header, sizeof(request_header),
         "%s %s HTTP/1.1\r\n"
         "Host: %s\r\n"
         "%s"
         "Content-Length: %d\r\n"
-        "Connection: close\r\n"
+        "Connection: %s\r\n"
         "\r\n",
-        method, path, host, headers ? headers : "", body_len);
-    
-    // Send header
-    LOG_I("Sending HTTPS request...");
-    ret = mbedtls_ssl_write(&ssl, (unsigned char*)request_header, header_len);
-    if (ret < 0) {
-        LOG_E("mbedtls_ssl_write (header) failed: -0x%04x", -ret);
-        goto cleanup;
+        method, path, host, headers ? headers : "", body_len,
+        keep_alive ? "keep-alive" : "close");
+    if (header_len >= (int)sizeof(request_header)) {
+        LOG_E("Request header too long");
+        return -1;
     }
-    
-    int total_sent = ret;
-    
+
+    LOG_I("Sending %s request...", t->secure ? "HTTPS" : "HTTP");
+    if (http_transport_write(t, request_header, header_len) < 0) {
+        LOG_E("Failed to send request header");
+        return -1;
+    }
+
     // Send body in chunks if present
-    if (body && body_len > 0) {
-        int remaining = body_len;
-        int offset = 0;
+    if (body_len > 0) {
+        int sent = 0;
         int pause_counter = 0;
-        
+
         LOG_I("Sending body in chunks (%d bytes total)...", body_len);
-        
-        while (remaining > 0) {
-            int chunk_size = (remaining > SEND_CHUNK_SIZE) ? SEND_CHUNK_SIZE : remaining;
-            
-            ret = mbedtls_ssl_write(&ssl, (unsigned char*)(body + offset), chunk_size);
-            if (ret < 0) {
-                LOG_E("mbedtls_ssl_write (body chunk) failed at offset %d: -0x%04x", offset, -ret);
-                goto cleanup;
-            }
-            
-            offset += ret;
-            remaining -= ret;
-            total_sent += ret;
-            pause_counter += ret;
-            
-            // Pause every 16KB to let network stack process
-            if (pause_counter >= PAUSE_INTERVAL && remaining > 0) {
-                vTaskDelay(pdMS_TO_TICKS(10));
-                pause_counter = 0;
-                LOG_I("Sent %d/%d bytes (pausing)...", offset, body_len);
+
+        for (int i = 0; i < part_count; i++) {
+            for (int offset = 0; offset < parts[i].len; offset += SEND_CHUNK_SIZE) {
+                int chunk_size = parts[i].len - offset;
+                if (chunk_size > SEND_CHUNK_SIZE) {
+                    chunk_size = SEND_CHUNK_SIZE;
+                }
+                if (http_transport_write(t, parts[i].data + offset, chunk_size) < 0) {
+                    LOG_E("Failed to send body at offset %d", sent);
+                    return -1;
+                }
+                sent += chunk_size;
+                pause_counter += chunk_size;
+
+                // Pause every 16KB to let network stack process
+                if (pause_counter >= PAUSE_INTERVAL && sent < body_len) {
+                    vTaskDelay(pdMS_TO_TICKS(10));
+                    pause_counter = 0;
+                    LOG_I("Sent %d/%d bytes (pausing)...", sent, body_len);
+                }
             }
         }
-        
+
         LOG_I("Body sent successfully (%d bytes)", body_len);
     }
-    
-    LOG_I("Request sent (%d bytes total)", total_sent);
-    
-    // Allocate receive buffers
-    recv_buf = pvPortMalloc(RECV_BUF_SIZE);
-    if (!recv_buf) {
-        LOG_E("Failed to allocate recv_buf (%d bytes)", RECV_BUF_SIZE);
-        goto cleanup;
+
+    LOG_I("Request sent (%d bytes total)", header_len + body_len);
+    return 0;
+}
+
+// An idle connection is unusable once the server has sent anything
+// (close_notify or FIN) or it has sat longer than the server is likely
+// to keep it
+static bool https_conn_alive(https_conn_t *conn) {
+    if (https_now_ms() - conn->idle_since_ms > HTTPS_KEEPALIVE_IDLE_MS) {
+        return false;
     }
 
-    response = pvPortMalloc(MAX_RESPONSE_SIZE_DEFAULT);
-    if (!response) {
-        LOG_E("Failed to allocate response buffer (%d bytes)", MAX_RESPONSE_SIZE_DEFAULT);
-        vPortFree(recv_buf);
-        recv_buf = NULL;
-        goto cleanup;
+    fd_set rfds;
+    struct timeval tv = {0, 0};
+    FD_ZERO(&rfds);
+    FD_SET(conn->t.fd, &rfds);
+    return select(conn->t.fd + 1, &rfds, NULL, NULL, &tv) == 0;
+}
+
+static void https_conn_close(https_conn_t *conn) {
+    http_transport_close(&conn->t);
+    conn->open = false;
+    if (conn->prewarmed) {
+        conn->prewarmed = false;
+        xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+        tls_stats.prewarm_wasted++;
+        xSemaphoreGive(tls_pool_lock);
     }
+}
 
-    while (1) {
-        ret = mbedtls_ssl_read(&ssl, (unsigned char*)recv_buf, RECV_BUF_SIZE - 1);
+static bool https_conn_is_for(const https_conn_t *conn, const char *host, int port, bool secure) {
+    return conn->port == port && conn->t.secure == secure && strcmp(conn->host, host) == 0;
+}
 
-        if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
-            continue;
-        }
+// Take a slot for host:port, preferring an idle open connection to it.
+// Waits up to wait_ms while every slot is busy, or while https_prewarm() is
+// still connecting to the same host (so the request reuses that connection
+// instead of setting up a second one); returns NULL on timeout. A slot taken
+// for_prewarm is flagged before the lock is dropped, so no request slips past
+static https_conn_t *https_conn_acquire(const char *host, int port, bool secure, uint32_t wait_ms,
+                                        bool for_prewarm) {
+    uint32_t start_ms = https_now_ms();
+    https_conn_t *match;
+    https_conn_t *conn;
 
-        if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || ret == 0) {
-            break;
-        }
+    while (1) {
+        https_conn_t *spare = NULL;
+        bool warming = false;
 
-        if (ret < 0) {
-            LOG_E("mbedtls_ssl_read failed: -0x%04x", -ret);
-            break;
+        match = NULL;
+        xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+        for (int i = 0; i < HTTPS_KEEPALIVE_SLOTS; i++) {
+            https_conn_t *slot = &conn_pool[i];
+            if (slot->busy) {
+                warming |= slot->prewarming && slot->port == port && strcmp(slot->host, host) == 0;
+                continue;
+            }
+            if (slot->open && !match && https_conn_is_for(slot, host, port, secure)) {
+                match = slot;
+            } else if (!spare || (spare->open && (!slot->open || slot->idle_since_ms < spare->idle_since_ms))) {
+                spare = slot;  // Prefer an empty slot, else the longest idle
+            }
         }
-
-        if (total_received + ret >= MAX_RESPONSE_SIZE_DEFAULT) {
-            LOG_W("Response too large, truncating");
-            ret = MAX_RESPONSE_SIZE_DEFAULT - total_received - 1;
-            if (ret <= 0) break;
-        }
-
-        memcpy(response + total_received, recv_buf, ret);
-        total_received += ret;
-    }
-    
-    if (total_received > 0) {
-        response[total_received] = '\0';
-        
-        // Find body (after "\r\n\r\n")
-        char* body_start = strstr(response, "\r\n\r\n");
-        if (body_start) {
-            body_start += 4;
-            int body_length = total_received - (body_start - response);
-            char* body_only = pvPortMalloc(body_length + 1);
-            if (body_only) {
-                memcpy(body_only, body_start, body_length);
-                body_only[body_length] = '\0';
-                vPortFree(response);
-                vPortFree(recv_buf);
-                response = body_only;
-                recv_buf = NULL;
+        conn = match ? match : (warming ? NULL : spare);
+        if (conn) {
+            conn->busy = true;
+            conn->prewarming = for_prewarm;
+            if (conn != match) {
+                // Named now so a request can tell what a prewarm is connecting to
+                strncpy(conn->host, host, sizeof(conn->host) - 1);
+                conn->host[sizeof(conn->host) - 1] = '\0';
+                conn->port = port;
             }
         }
-    } else {
-        if (response) {
-            vPortFree(response);
-            response = NULL;
+        xSemaphoreGive(tls_pool_lock);
+
+        uint32_t waited_ms = https_now_ms() - start_ms;
+        if (conn || waited_ms >= wait_ms) {
+            break;
         }
+        // Other waiters may have been woken instead, so rescan now and then
+        uint32_t poll_ms = wait_ms - waited_ms < HTTPS_CONN_POLL_MS ? wait_ms - waited_ms : HTTPS_CONN_POLL_MS;
+        xSemaphoreTake(conn_released, pdMS_TO_TICKS(poll_ms));
     }
-    
-cleanup:
-    if (recv_buf) vPortFree(recv_buf);
-    mbedtls_ssl_close_notify(&ssl);
-    mbedtls_net_free(&server_fd);
-    mbedtls_ssl_free(&ssl);
-    mbedtls_ssl_config_free(&conf);
-    mbedtls_ctr_drbg_free(&ctr_drbg);
-    mbedtls_entropy_free(&entropy);
-    
-    return response;
-}
 
-// Main HTTPS request function
-char* https_request(const char* url, const char* method, const char* headers, 
-                   const char* body, int body_len) {
-    char protocol[16];
-    char host[256];
-    char path[512];
-    int port;
-    
-    if (parse_url(url, protocol, host, &port, path) < 0) {
-        LOG_E("Failed to parse URL: %s", url);
+    if (!conn) {
         return NULL;
     }
-    
-    LOG_I("Protocol: %s, Host: %s, Port: %d, Path: %s", protocol, host, port, path);
-    
-    if (strcmp(protocol, "https") == 0) {
-        return https_request_secure(host, port, path, method, headers, body, body_len);
-    } else if (strcmp(protocol, "http") == 0) {
-        return http_request_plain(host, port, path, method, headers, body, body_len);
-    } else {
-        LOG_E("Unsupported protocol: %s", protocol);
-        return NULL;
+    if (conn->open && (conn != match || !https_conn_alive(conn))) {
+        https_conn_close(conn);
     }
+    return conn;
 }
 
-// HTTPS request for large responses (TTS audio, etc.) - uses MAX_RESPONSE_SIZE_TTS
-char* https_request_large(const char* url, const char* method, const char* headers,
-                          const char* body, int body_len) {
-    char protocol[16];
-    char host[256];
-    char path[512];
-    int port;
+static void https_conn_release(https_conn_t *conn, bool keep) {
+    if (conn->open && !keep) {
+        https_conn_close(conn);
+    }
 
-    if (parse_url(url, protocol, host, &port, path) < 0) {
-        LOG_E("Failed to parse URL: %s", url);
-        return NULL;
+    xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+    conn->busy = false;
+    conn->prewarming = false;
+    xSemaphoreGive(tls_pool_lock);
+    xSemaphoreGive(conn_released);
+}
+
+void https_get_tls_stats(https_tls_stats_t *stats) {
+    if (!tls_ready) {
+        memset(stats, 0, sizeof(*stats));
+        return;
     }
+    xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+    *stats = tls_stats;
+    stats->avg_full_ms = tls_stats.handshakes_full ? tls_full_ms_total / tls_stats.handshakes_full : 0;
+    stats->avg_resumed_ms = tls_stats.handshakes_resumed ?
+                            tls_resumed_ms_total / tls_stats.handshakes_resumed : 0;
+    xSemaphoreGive(tls_pool_lock);
+}
 
-    LOG_I("Protocol: %s, Host: %s, Port: %d, Path: %s (LARGE buffer)", protocol, host, port, path);
+// Incremental HTTP/1.1 response decoder: headers are collected until the
+// blank line, then the body (de-chunked if needed) is handed to the
+// callback as it arrives
+#define HTTP_STREAM_HEAD_MAX 1024
 
-    // For large responses, we only support HTTP (TTS is local)
-    if (strcmp(protocol, "http") == 0) {
-        // Inline implementation with large buffer
-        int sockfd = -1;
-        struct sockaddr_in server_addr;
-        struct hostent* server;
-        char* response = NULL;
-        char* recv_buf = NULL;
-        int total_received = 0;
+typedef enum {
+    CHUNK_SIZE_LINE = 0,
+    CHUNK_DATA,
+    CHUNK_DATA_CRLF,
+    CHUNK_TRAILER,             // After the last chunk: trailer lines up to the blank one
+    CHUNK_END,
+} http_chunk_state_t;
 
-        sockfd = socket(AF_INET, SOCK_STREAM, 0);
-        if (sockfd < 0) {
-            LOG_E("Failed to create socket");
-            return NULL;
-        }
+typedef struct {
+    char head[HTTP_STREAM_HEAD_MAX];
+    uint32_t head_len;
+    bool head_done;
+    int status;
+    bool chunked;
+    bool has_length;           // Content-Length framed body
+    uint32_t body_left;
+    bool keep_alive;           // Server allows another request on this connection
+    http_chunk_state_t chunk_state;
+    uint32_t chunk_left;
+    char size_line[16];
+    uint32_t size_len;
+    https_data_cb_t on_data;
+    void *ctx;
+} http_stream_t;
 
-        struct timeval tv_timeout;
-        tv_timeout.tv_sec = 300;
-        tv_timeout.tv_usec = 0;
-        setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv_timeout, sizeof(tv_timeout));
-        setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv_timeout, sizeof(tv_timeout));
+// Value of a response header (leading spaces skipped), or NULL
+static const char *http_header_find(const char *head, const char *name) {
+    const char *p = head;
+    uint32_t name_len = strlen(name);
 
-        server = gethostbyname(host);
-        if (server == NULL) {
-            LOG_E("Failed to resolve host: %s", host);
-            close(sockfd);
-            return NULL;
+    while ((p = strchr(p, '\n')) != NULL) {
+        p++;
+        if (strncasecmp(p, name, name_len) == 0 && p[name_len] == ':') {
+            p += name_len + 1;
+            while (*p == ' ') {
+                p++;
+            }
+            return p;
         }
+    }
+    return NULL;
+}
 
-        memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-        server_addr.sin_port = htons(port);
+static bool http_header_has(const char *head, const char *name, const char *value) {
+    const char *p = http_header_find(head, name);
+    if (!p) {
+        return false;
+    }
 
-        LOG_I("Connecting to %s:%d...", host, port);
-        if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-            LOG_E("Failed to connect");
-            close(sockfd);
-            return NULL;
+    const char *eol = strchr(p, '\r');
+    uint32_t line_len = eol ? (uint32_t)(eol - p) : strlen(p);
+    uint32_t value_len = strlen(value);
+    for (uint32_t i = 0; i + value_len <= line_len; i++) {
+        if (strncasecmp(p + i, value, value_len) == 0) {
+            return true;
         }
+    }
+    return false;
+}
 
-        LOG_I("Connected!");
+// Returns 0 to continue, 1 when the body is complete, -1 on error or abort
+static int http_stream_feed(http_stream_t *st, const char *data, uint32_t len) {
+    while (len > 0 && !st->head_done) {
+        // Copy up to the end of the header block in one go
+        uint32_t n = 0;
+        while (n < len && !st->head_done) {
+            if (st->head_len >= sizeof(st->head) - 1) {
+                LOG_E("Response headers too large");
+                return -1;
+            }
+            char c = data[n++];
+            st->head[st->head_len++] = c;
+            st->head_done = (c == '\n' && st->head_len >= 4 &&
+                             memcmp(st->head + st->head_len - 4, "\r\n\r\n", 4) == 0);
+        }
+        st->head[st->head_len] = '\0';
+        data += n;
+        len -= n;
 
-        char request_header[512];
-        int header_len = sprintf(request_header,
-            "%s %s HTTP/1.1\r\n"
-            "Host: %s\r\n"
-            "%s"
-            "Content-Length: %d\r\n"
-            "Connection: close\r\n"
-            "\r\n",
-            method, path, host, headers ? headers : "", body_len);
+        if (st->head_done) {
+            sscanf(st->head, "HTTP/%*s %d", &st->status);
+            st->chunked = http_header_has(st->head, "Transfer-Encoding", "chunked");
+            const char *length = http_header_find(st->head, "Content-Length");
+            if (!st->chunked && length) {
+                st->has_length = true;
+                st->body_left = strtoul(length, NULL, 10);
+            }
+            // Only a self-delimiting body leaves the connection reusable
+            st->keep_alive = strncmp(st->head, "HTTP/1.1", 8) == 0 &&
+                             !http_header_has(st->head, "Connection", "close") &&
+                             (st->chunked || st->has_length);
+            LOG_I("Response status %d%s", st->status, st->chunked ? " (chunked)" : "");
+            if (st->has_length && st->body_left == 0) {
+                return 1;
+            }
+        }
+    }
 
-        int sent = send(sockfd, request_header, header_len, 0);
-        if (sent < 0) {
-            LOG_E("Failed to send request header");
-            close(sockfd);
-            return NULL;
+    if (!st->chunked) {
+        if (st->has_length && len > st->body_left) {
+            len = st->body_left;
         }
+        if (len > 0 && st->on_data(st->ctx, data, len) < 0) {
+            return -1;
+        }
+        if (st->has_length) {
+            st->body_left -= len;
+            return (st->body_left == 0) ? 1 : 0;
+        }
+        return 0;
+    }
 
-        int total_sent = sent;
+    while (len > 0) {
+        switch (st->chunk_state) {
+        case CHUNK_SIZE_LINE: {
+            char c = *data++;
+            len--;
+            if (c != '\n') {
+                if (st->size_len < sizeof(st->size_line) - 1) {
+                    st->size_line[st->size_len++] = c;
+                }
+                break;
+            }
+            st->size_line[st->size_len] = '\0';
+            st->size_len = 0;
+            st->chunk_left = strtoul(st->size_line, NULL, 16);  // Stops at ';' or '\r'
+            if (st->chunk_left == 0) {
+                st->chunk_state = CHUNK_TRAILER;  // size_len now counts trailer line bytes
+                break;
+            }
+            st->chunk_state = CHUNK_DATA;
+            break;
+        }
+        case CHUNK_DATA: {
+            uint32_t n = (len < st->chunk_left) ? len : st->chunk_left;
+            if (st->on_data(st->ctx, data, n) < 0) {
+                return -1;
+            }
+            data += n;
+            len -= n;
+            st->chunk_left -= n;
+            if (st->chunk_left == 0) {
+                st->chunk_state = CHUNK_DATA_CRLF;
+                st->chunk_left = 2;
+            }
+            break;
+        }
+        case CHUNK_DATA_CRLF:
+            data++;
+            len--;
+            if (--st->chunk_left == 0) {
+                st->chunk_state = CHUNK_SIZE_LINE;
+            }
+            break;
+        case CHUNK_TRAILER: {
+            // Trailers are not needed, but the final CRLF must not be left
+            // on a kept-alive connection in front of the next response
+            char c = *data++;
+            len--;
+            if (c != '\n') {
+                st->size_len += (c != '\r');
+                break;
+            }
+            if (st->size_len == 0) {
+                st->chunk_state = CHUNK_END;
+                return 1;
+            }
+            st->size_len = 0;
+            break;
+        }
+        case CHUNK_END:
+        default:
+            return 1;
+        }
+    }
+    return 0;
+}
 
-        if (body && body_len > 0) {
-            int remaining = body_len;
-            int offset = 0;
-            int pause_counter = 0;
+// The one request engine: every public request below is built on it.
+// Responses are read in RECV_BUF_SIZE blocks and decoded incrementally;
+// the connection is kept alive for the next request when the response
+// allows it
+static int http_request(const char* url, const char* method, const char* headers,
+                        const http_part_t *parts, int part_count,
+                        https_data_cb_t on_data, void *ctx, const volatile bool *cancel) {
+    char protocol[16];
+    char host[256];
+    char path[512];
+    int port;
 
-            LOG_I("Sending body in chunks (%d bytes total)...", body_len);
+    if (!on_data || parse_url(url, protocol, host, &port, path) < 0) {
+        LOG_E("Failed to parse URL: %s", url);
+        return -1;
+    }
+    bool secure = (strcmp(protocol, "https") == 0);
+    if (!secure && strcmp(protocol, "http") != 0) {
+        LOG_E("Unsupported protocol: %s", protocol);
+        return -1;
+    }
+    if (!tls_ready) {
+        LOG_E("https_client_init() has not been called");
+        return -1;
+    }
 
-            while (remaining > 0) {
-                int chunk_size = (remaining > SEND_CHUNK_SIZE) ? SEND_CHUNK_SIZE : remaining;
+    LOG_I("Protocol: %s, Host: %s, Port: %d, Path: %s", protocol, host, port, path);
 
-                sent = send(sockfd, body + offset, chunk_size, 0);
-                if (sent < 0) {
-                    LOG_E("Failed to send body chunk at offset %d", offset);
-                    close(sockfd);
-                    return NULL;
-                }
+    https_conn_t *conn = https_conn_acquire(host, port, secure, HTTPS_CONN_WAIT_MS, false);
+    if (!conn) {
+        LOG_E("No free HTTP connection slot after %d ms", HTTPS_CONN_WAIT_MS);
+        return -1;
+    }
 
-                offset += sent;
-                remaining -= sent;
-                total_sent += sent;
-                pause_counter += sent;
+    http_stream_t *st = pvPortMalloc(sizeof(http_stream_t));
+    char *recv_buf = pvPortMalloc(RECV_BUF_SIZE);
+    int result = -1;
+    bool keep = false;
+    if (!st || !recv_buf) {
+        LOG_E("Failed to allocate stream buffers");
+        goto cleanup;
+    }
 
-                if (pause_counter >= PAUSE_INTERVAL && remaining > 0) {
-                    vTaskDelay(pdMS_TO_TICKS(10));
-                    pause_counter = 0;
-                }
+    // A kept-alive connection may have been dropped by the server without
+    // us noticing; retry once on a fresh one if it fails before any response
+    for (int attempt = 0; attempt < 2; attempt++) {
+        bool reused = conn->open;
+        if (!reused) {
+            if (http_transport_open(&conn->t, host, port, secure) < 0) {
+                break;
             }
-
-            LOG_I("Body sent successfully (%d bytes)", body_len);
-        }
-
-        LOG_I("Request sent (%d bytes total)", total_sent);
-
-        recv_buf = pvPortMalloc(RECV_BUF_SIZE);
-        if (!recv_buf) {
-            LOG_E("Failed to allocate recv_buf");
-            close(sockfd);
-            return NULL;
+            conn->open = true;
+        } else {
+            LOG_I("Reusing connection to %s:%d", host, port);
         }
 
-        response = pvPortMalloc(MAX_RESPONSE_SIZE_TTS);
-        if (!response) {
-            LOG_E("Failed to allocate response buffer (%d bytes)", MAX_RESPONSE_SIZE_TTS);
-            vPortFree(recv_buf);
-            close(sockfd);
-            return NULL;
-        }
+        memset(st, 0, sizeof(http_stream_t));
+        st->on_data = on_data;
+        st->ctx = ctx;
 
-        while (1) {
-            int received = recv(sockfd, recv_buf, RECV_BUF_SIZE - 1, 0);
-            if (received <= 0) break;
+        int fed = -1;
+        if (http_send_request(&conn->t, host, path, method, headers, parts, part_count, true) == 0) {
+            while (1) {
+                if (cancel && http_transport_wait(&conn->t, cancel) < 0) {
+                    fed = -1;
+                    break;
+                }
+                int ret = http_transport_read(&conn->t, recv_buf, RECV_BUF_SIZE);
+                if (ret == 0) {
+                    fed = 0;  // Close-delimited body ends here
+                    st->keep_alive = false;
+                    break;
+                }
+                if (ret < 0) {
+                    fed = -1;
+                    break;
+                }
 
-            if (total_received + received >= MAX_RESPONSE_SIZE_TTS) {
-                LOG_W("Response too large, truncating");
-                received = MAX_RESPONSE_SIZE_TTS - total_received - 1;
-                if (received <= 0) break;
+                fed = http_stream_feed(st, recv_buf, ret);
+                if (fed != 0) {
+                    break;
+                }
             }
-
-            memcpy(response + total_received, recv_buf, received);
-            total_received += received;
         }
 
-        response[total_received] = '\0';
-        vPortFree(recv_buf);
-        close(sockfd);
+        if (reused && st->head_len == 0 && !(cancel && *cancel)) {
+            // Nothing came back: the server had closed the idle connection
+            https_conn_close(conn);
+            xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+            tls_stats.stale_retries++;
+            xSemaphoreGive(tls_pool_lock);
+            LOG_W("Kept-alive connection was closed, reconnecting");
+            continue;
+        }
 
-        LOG_I("Received %d bytes total", total_received);
-
-        char* body_start = strstr(response, "\r\n\r\n");
-        if (body_start) {
-            body_start += 4;
-            int body_length = total_received - (body_start - response);
-            char* body_only = pvPortMalloc(body_length + 1);
-            if (body_only) {
-                memcpy(body_only, body_start, body_length);
-                body_only[body_length] = '\0';
-                vPortFree(response);
-                return body_only;
-            }
+        xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+        tls_stats.requests++;
+        if (reused) {
+            tls_stats.reused++;
+        }
+        if (conn->prewarmed) {
+            tls_stats.prewarm_hits++;
+            conn->prewarmed = false;
         }
+        xSemaphoreGive(tls_pool_lock);
 
-        return response;
-    } else {
-        LOG_E("https_request_large only supports HTTP (not %s)", protocol);
-        return NULL;
+        result = (fed >= 0 && st->head_done) ? st->status : -1;
+        keep = (fed == 1 && st->keep_alive);
+        break;
     }
-}
 
-// Helper to send data in chunks
-static int send_chunked(int sockfd, const char* data, int len) {
-    int sent = 0;
-    int total_sent = 0;
-    int remaining = len;
-    int offset = 0;
-    int pause_counter = 0;
+cleanup:
+    if (recv_buf) vPortFree(recv_buf);
+    if (st) vPortFree(st);
+    conn->idle_since_ms = https_now_ms();
+    https_conn_release(conn, keep);
 
-    while (remaining > 0) {
-        int chunk_size = (remaining > SEND_CHUNK_SIZE) ? SEND_CHUNK_SIZE : remaining;
-        
-        sent = send(sockfd, data + offset, chunk_size, 0);
-        if (sent < 0) {
-            return -1;
-        }
-        
-        offset += sent;
-        remaining -= sent;
-        total_sent += sent;
-        pause_counter += sent;
-        
-        if (pause_counter >= PAUSE_INTERVAL && remaining > 0) {
-            vTaskDelay(pdMS_TO_TICKS(10));
-            pause_counter = 0;
-        }
-    }
-    return total_sent;
+    return result;
 }
 
-// Specialized function to stream audio data without allocating a huge buffer
-char* https_post_audio(const char* url, const char* headers, 
-                      const char* part1, int part1_len,
-                      const char* part2, int part2_len,
-                      const char* part3, int part3_len,
-                      const char* part4, int part4_len) {
-    
+int https_prewarm(const char* url) {
     char protocol[16];
     char host[256];
     char path[512];
     int port;
-    
+
     if (parse_url(url, protocol, host, &port, path) < 0) {
         LOG_E("Failed to parse URL: %s", url);
-        return NULL;
+        return -1;
     }
-    
-    if (strcmp(protocol, "http") != 0) {
-        LOG_E("Only HTTP supported for audio streaming currently");
-        return NULL;
+    bool secure = (strcmp(protocol, "https") == 0);
+    if (!tls_ready || (!secure && strcmp(protocol, "http") != 0)) {
+        return -1;
     }
 
-    int sockfd = -1;
-    struct sockaddr_in server_addr;
-    struct hostent* server;
-    char* response = NULL;
-    char* recv_buf = NULL;
-    int total_received = 0;
-    
-    // Create socket
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        LOG_E("Failed to create socket");
-        return NULL;
+    // Finds the idle connection to this host if there is one and drops it
+    // if the server has closed it in the meantime
+    https_conn_t *conn = https_conn_acquire(host, port, secure, 0, true);
+    if (!conn) {
+        return -1;  // Every slot is in use, or another prewarm is connecting
     }
-    
-    // Get host by name
-    server = gethostbyname(host);
-    if (server == NULL) {
-        LOG_E("Failed to resolve host: %s", host);
-        close(sockfd);
-        return NULL;
+
+    int ret = 0;
+    if (conn->open) {
+        xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+        tls_stats.prewarm_ready++;
+        xSemaphoreGive(tls_pool_lock);
+    } else if (http_transport_open(&conn->t, host, port, secure) == 0) {
+        conn->open = true;
+        conn->prewarmed = true;
+        conn->idle_since_ms = https_now_ms();
+        xSemaphoreTake(tls_pool_lock, portMAX_DELAY);
+        tls_stats.prewarms++;
+        xSemaphoreGive(tls_pool_lock);
+        LOG_I("Pre-warmed connection to %s:%d", host, port);
+    } else {
+        ret = -1;
     }
-    
-    // Setup server address
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-    server_addr.sin_port = htons(port);
-    
-    // Connect
-    LOG_I("Connecting to %s:%d...", host, port);
-    if (connect(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_E("Failed to connect");
-        close(sockfd);
-        return NULL;
+    https_conn_release(conn, true);
+
+    return ret;
+}
+
+// Buffered requests: collect the body into one allocation
+typedef struct {
+    char *buf;
+    int len;
+    int max;
+    bool truncated;
+} http_collect_t;
+
+static int http_collect_on_data(void *ctx, const char *data, int len) {
+    http_collect_t *col = ctx;
+
+    if (col->len + len > col->max - 1) {
+        if (!col->truncated) {
+            LOG_W("Response too large, truncating");
+            col->truncated = true;
+        }
+        len = col->max - 1 - col->len;
     }
-    
-    LOG_I("Connected!");
-    
-    int total_len = part1_len + part2_len + part3_len + part4_len;
-    
-    // Build HTTP request header
-    char request_header[512];
-    int header_len = sprintf(request_header,
-        "POST %s HTTP/1.1\r\n"
-        "Host: %s\r\n"
-        "%s"
-        "Content-Length: %d\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        path, host, headers ? headers : "", total_len);
-    
-    // Send header
-    if (send(sockfd, request_header, header_len, 0) < 0) {
-        LOG_E("Failed to send request header");
-        close(sockfd);
+    memcpy(col->buf + col->len, data, len);
+    col->len += len;
+    return 0;
+}
+
+static char* http_request_collect(const char* url, const char* method, const char* headers,
+                                  const http_part_t *parts, int part_count, int max_size) {
+    http_collect_t col = {0};
+
+    col.buf = pvPortMalloc(max_size);
+    if (!col.buf) {
+        LOG_E("Failed to allocate response buffer (%d bytes)", max_size);
         return NULL;
     }
-    
-    LOG_I("Streaming audio parts (%d bytes total)...", total_len);
-    
-    // Send parts sequentially
-    if (send_chunked(sockfd, part1, part1_len) < 0) goto send_error;
-    if (send_chunked(sockfd, part2, part2_len) < 0) goto send_error;
-    if (send_chunked(sockfd, part3, part3_len) < 0) goto send_error;
-    if (send_chunked(sockfd, part4, part4_len) < 0) goto send_error;
-    
-    LOG_I("Audio sent successfully!");
+    col.max = max_size;
 
-    // Receive response (same as plain http)
-    recv_buf = pvPortMalloc(RECV_BUF_SIZE);
-    if (!recv_buf) goto send_error;
+    int status = http_request(url, method, headers, parts, part_count, http_collect_on_data, &col, NULL);
+    if (status < 0) {
+        vPortFree(col.buf);
+        return NULL;
+    }
+    LOG_I("Received %d bytes total", col.len);
 
-    response = pvPortMalloc(MAX_RESPONSE_SIZE_TTS);
-    if (!response) {
-        vPortFree(recv_buf);
-        goto send_error;
+    // Hand back an allocation sized to the body
+    char *body = pvPortMalloc(col.len + 1);
+    if (!body) {
+        col.buf[col.len] = '\0';
+        return col.buf;
     }
+    memcpy(body, col.buf, col.len);
+    body[col.len] = '\0';
+    vPortFree(col.buf);
+    return body;
+}
 
-    while (1) {
-        int received = recv(sockfd, recv_buf, RECV_BUF_SIZE - 1, 0);
-        if (received <= 0) break;
-
-        if (total_received + received >= MAX_RESPONSE_SIZE_TTS) {
-            received = MAX_RESPONSE_SIZE_TTS - total_received - 1;
-            if (received <= 0) break;
-        }
-
-        memcpy(response + total_received, recv_buf, received);
-        total_received += received;
-    }
-    
-    response[total_received] = '\0';
-    vPortFree(recv_buf);
-    close(sockfd);
-    
-    // Find body
-    char* body_start = strstr(response, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4;
-        int body_length = total_received - (body_start - response);
-        char* body_only = pvPortMalloc(body_length + 1);
-        if (body_only) {
-            memcpy(body_only, body_start, body_length);
-            body_only[body_length] = '\0';
-            vPortFree(response);
-            return body_only;
-        }
-    }
-    return response;
-
-send_error:
-    LOG_E("Failed to send audio data");
-    if (recv_buf) vPortFree(recv_buf);
-    if (response) vPortFree(response);
-    close(sockfd);
-    return NULL;
+// Main HTTPS request function
+char* https_request(const char* url, const char* method, const char* headers,
+                   const char* body, int body_len) {
+    http_part_t part = {body, body ? body_len : 0};
+    return http_request_collect(url, method, headers, &part, 1, MAX_RESPONSE_SIZE_DEFAULT);
 }
 
+// Streaming request: the body is delivered as it arrives
+int https_request_stream(const char* url, const char* method, const char* headers,
+                         const char* body, int body_len, https_data_cb_t on_data, void *ctx) {
+    http_part_t part = {body, body ? body_len : 0};
+    return http_request(url, method, headers, &part, 1, on_data, ctx, NULL);
+}
+
+int https_request_stream_cancellable(const char* url, const char* method, const char* headers,
+                                     const char* body, int body_len, https_data_cb_t on_data,
+                                     void *ctx, const volatile bool *cancel) {
+    http_part_t part = {body, body ? body_len : 0};
+    return http_request(url, method, headers, &part, 1, on_data, ctx, cancel);
+}
+
+// Request for large responses (TTS audio, etc.) - uses MAX_RESPONSE_SIZE_TTS
+char* https_request_large(const char* url, const char* method, const char* headers,
+                          const char* body, int body_len) {
+    http_part_t part = {body, body ? body_len : 0};
+    return http_request_collect(url, method, headers, &part, 1, MAX_RESPONSE_SIZE_TTS);
+}
+
+// Specialized function to stream audio data without allocating a huge buffer
+char* https_post_audio(const char* url, const char* headers,
+                      const char* part1, int part1_len,
+                      const char* part2, int part2_len,
+                      const char* part3, int part3_len,
+                      const char* part4, int part4_len) {
+    http_part_t parts[] = {
+        {part1, part1_len},
+        {part2, part2_len},
+        {part3, part3_len},
+        {part4, part4_len},
+    };
+    return http_request_collect(url, "POST", headers, parts, 4, MAX_RESPONSE_SIZE_TTS);
+}
@@ -1,12 +1,65 @@
 #ifndef HTTPS_CLIENT_H
 #define HTTPS_CLIENT_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Persistent HTTP/HTTPS connections
+#define HTTPS_KEEPALIVE_SLOTS 3          // Connections kept open between requests (LLM, TTS, spare)
+#define HTTPS_KEEPALIVE_IDLE_MS 50000    // Reconnect (resuming the session) after this idle time
+#define HTTPS_CONN_WAIT_MS 15000         // A request waits this long for a slot when all are busy
+
+// Connection statistics
+typedef struct {
+    uint32_t requests;               // Requests completed (http and https)
+    uint32_t reused;                 // Requests sent on a kept-alive connection
+    uint32_t stale_retries;          // Kept-alive connections found closed by the server
+    uint32_t handshakes_full;
+    uint32_t handshakes_resumed;     // Session ticket / session ID resumptions
+    uint32_t handshake_failures;
+    uint32_t last_handshake_ms;
+    uint32_t avg_full_ms;
+    uint32_t avg_resumed_ms;
+    uint32_t prewarms;               // Connections opened by https_prewarm()
+    uint32_t prewarm_ready;          // https_prewarm() found a live connection already
+    uint32_t prewarm_hits;           // Pre-warmed connections a request then used
+    uint32_t prewarm_wasted;         // Pre-warmed connections closed unused (idle timeout, server close, evicted)
+} https_tls_stats_t;
+
 /**
- * @brief Perform an HTTPS request (for normal API responses, max 16KB)
+ * @brief Seed the shared DRBG and set up the connection pool
+ *
+ * Must be called once at boot, before any task issues an https request.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int https_client_init(void);
+
+/**
+ * @brief Get TLS handshake and connection reuse statistics
+ */
+void https_get_tls_stats(https_tls_stats_t *stats);
+
+/**
+ * @brief Make sure a connection to the host of url is open and idle in the pool
+ *
+ * Connects (and completes the TLS handshake) without sending a request, so
+ * the next request to that host skips connection setup. Does nothing if a
+ * live connection is already there. Blocks for the connection setup; a
+ * request to the same host made meanwhile waits for this connection
+ * instead of opening another one.
+ *
+ * @param url Full http or https URL (only scheme, host and port are used)
+ * @return 0 if a connection is ready, -1 on failure or if no slot is free
+ */
+int https_prewarm(const char* url);
+
+/**
+ * @brief Perform an HTTP or HTTPS request (for normal API responses, max 8KB)
  *
  * @param url Full URL (e.g., "https://api.openai.com/v1/chat/completions")
  * @param method HTTP Method (GET, POST)
@@ -19,7 +72,46 @@ char* https_request(const char* url, const char* method, const char* headers,
                    const char* body, int body_len);
 
 /**
- * @brief Perform an HTTPS request for large responses (for TTS, max 256KB)
+ * @brief Body data callback for streamed requests
+ * @return 0 to continue, negative to abort the request
+ */
+typedef int (*https_data_cb_t)(void *ctx, const char *data, int len);
+
+/**
+ * @brief Perform an HTTP or HTTPS request and stream the response body
+ *
+ * The body is handed to on_data as it arrives (chunked encoding removed);
+ * nothing is buffered beyond one receive block. All other requests are
+ * built on this one.
+ *
+ * @param url Full http or https URL
+ * @param method HTTP Method (GET, POST)
+ * @param headers Additional headers (must end with \r\n)
+ * @param body Request body (NULL if none)
+ * @param body_len Length of request body
+ * @param on_data Body callback
+ * @param ctx Callback context
+ * @return HTTP status code, or -1 on connection/TLS error or abort
+ */
+int https_request_stream(const char* url, const char* method, const char* headers,
+                         const char* body, int body_len, https_data_cb_t on_data, void *ctx);
+
+/**
+ * @brief https_request_stream() that another task can cancel
+ *
+ * While waiting for response data the flag is checked every few tens of
+ * milliseconds; once it is set the request ends and its connection is
+ * closed. Connection setup itself is not interrupted.
+ *
+ * @param cancel Flag set by the cancelling task
+ * @return HTTP status code, or -1 on error, abort or cancellation
+ */
+int https_request_stream_cancellable(const char* url, const char* method, const char* headers,
+                                     const char* body, int body_len, https_data_cb_t on_data,
+                                     void *ctx, const volatile bool *cancel);
+
+/**
+ * @brief Perform an HTTP or HTTPS request for large responses (for TTS, max 32KB)
  *
  * @param url Full URL
  * @param method HTTP Method (GET, POST)
@@ -33,6 +125,8 @@ char* https_request_large(const char* url, const char* method, const char* heade
 
 /**
  * @brief Specialized function to stream audio data without allocating a huge buffer
+ *
+ * The four parts are sent back to back as one body (max 32KB response).
  */
 char* https_post_audio(const char* url, const char* headers,
                       const char* part1, int part1_len,
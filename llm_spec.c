@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+#include "deepseek_client.h"
+#include "llm_spec.h"
+#include "local_intent.h"
+#include "config.h"
+
+#define DBG_TAG "SPEC"
+
+#define LLM_SPEC_TASK_STACK 4096   // TLS handshake runs on this stack
+#define LLM_SPEC_TASK_PRIO 12
+
+static TaskHandle_t spec_task;
+static SemaphoreHandle_t spec_lock;
+static SemaphoreHandle_t spec_progress;   // Given on every delta and when the worker finishes
+
+// Speculation state, guarded by spec_lock
+static char spec_text[LLM_SPEC_TEXT_MAX]; // Transcript the request was made on
+static bool spec_busy;                    // Worker is running a request
+static bool spec_valid;                   // Request still matches the current turn
+static volatile bool spec_cancel;         // Abandon the running request
+static char spec_stream[LLM_SPEC_REPLY_MAX];  // Text streamed so far, only appended to
+static uint32_t spec_stream_len;
+static bool spec_truncated;               // Stream buffer filled up, later deltas dropped
+static uint32_t spec_start_ms;
+static uint32_t spec_end_ms;
+
+static char offer_text[LLM_SPEC_TEXT_MAX];  // Latest offered transcript
+static uint32_t offer_changed_ms;
+static llm_spec_metrics_t spec_metrics;
+
+static uint32_t spec_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Skip spaces and punctuation; WhisperLive often only adds a final "。" or "？"
+static const char *skip_ignorable(const char *p) {
+    static const char *cjk_punct[] = {"，", "。", "？", "！", "、", "：", "；", "…"};
+
+    while (*p) {
+        if (*p == ' ' || *p == ',' || *p == '.' || *p == '?' || *p == '!') {
+            p++;
+            continue;
+        }
+        bool skipped = false;
+        for (uint32_t i = 0; i < sizeof(cjk_punct) / sizeof(cjk_punct[0]); i++) {
+            uint32_t len = strlen(cjk_punct[i]);
+            if (strncmp(p, cjk_punct[i], len) == 0) {
+                p += len;
+                skipped = true;
+                break;
+            }
+        }
+        if (!skipped) {
+            break;
+        }
+    }
+    return p;
+}
+
+static bool text_equivalent(const char *a, const char *b) {
+    while (1) {
+        a = skip_ignorable(a);
+        b = skip_ignorable(b);
+        if (*a != *b) {
+            return false;
+        }
+        if (*a == '\0') {
+            return true;
+        }
+        a++;
+        b++;
+    }
+}
+
+// Device commands are answered without the LLM, nothing to ask ahead
+static bool answered_locally(const char *text) {
+#if LOCAL_INTENT_ENABLE
+    return local_intent_match(text) != LOCAL_INTENT_NONE;
+#else
+    return false;
+#endif
+}
+
+// Drop the current speculation; a request still running is cancelled,
+// freeing its connection slot for the real one
+static void spec_invalidate(void) {
+    spec_valid = false;
+    spec_cancel = true;
+}
+
+// Buffer the reply as it streams in, so a hit can start speaking it before
+// generation ends
+static void spec_on_delta(void *ctx, const char *delta) {
+    (void)ctx;
+
+    xSemaphoreTake(spec_lock, portMAX_DELAY);
+    uint32_t n = strlen(delta);
+    if (spec_stream_len + n >= sizeof(spec_stream)) {
+        // Whole deltas only, so the taker never sees half a character, and
+        // none after the first one dropped, so it never skips text
+        spec_truncated = true;
+    }
+    if (!spec_truncated) {
+        memcpy(spec_stream + spec_stream_len, delta, n);
+        spec_stream_len += n;
+    }
+    xSemaphoreGive(spec_lock);
+    xSemaphoreGive(spec_progress);
+}
+
+static void spec_task_fn(void *arg) {
+    char text[LLM_SPEC_TEXT_MAX];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        xSemaphoreTake(spec_lock, portMAX_DELAY);
+        strcpy(text, spec_text);
+        xSemaphoreGive(spec_lock);
+
+        char *reply = deepseek_chat_stream_cancellable(text, spec_on_delta, NULL, &spec_cancel);
+
+        xSemaphoreTake(spec_lock, portMAX_DELAY);
+        spec_busy = false;
+        spec_end_ms = spec_now_ms();
+        if (!reply && !spec_cancel) {
+            spec_metrics.failures++;
+        }
+        xSemaphoreGive(spec_lock);
+        if (reply) {
+            vPortFree(reply);  // The taker hands on the streamed text instead
+        }
+        xSemaphoreGive(spec_progress);
+    }
+}
+
+int llm_spec_init(void) {
+    if (spec_task) {
+        return 0;
+    }
+
+    spec_lock = xSemaphoreCreateMutex();
+    spec_progress = xSemaphoreCreateBinary();
+    if (!spec_lock || !spec_progress) {
+        LOG_E("Failed to create speculation primitives\r\n");
+        return -1;
+    }
+
+    if (xTaskCreate(spec_task_fn, "llm_spec", LLM_SPEC_TASK_STACK, NULL,
+                    LLM_SPEC_TASK_PRIO, &spec_task) != pdPASS) {
+        LOG_E("Failed to create speculation task\r\n");
+        return -1;
+    }
+    return 0;
+}
+
+void llm_spec_reset(void) {
+    if (!spec_task) {
+        return;
+    }
+
+    xSemaphoreTake(spec_lock, portMAX_DELAY);
+    if (spec_valid) {
+        spec_metrics.stale++;  // Never claimed (e.g. turn failed)
+    }
+    spec_invalidate();
+    offer_text[0] = '\0';
+    offer_changed_ms = spec_now_ms();
+    xSemaphoreGive(spec_lock);
+}
+
+void llm_spec_offer(const char *transcript, bool trailing_silence) {
+    uint32_t now = spec_now_ms();
+
+    if (!spec_task || !transcript) {
+        return;
+    }
+
+    xSemaphoreTake(spec_lock, portMAX_DELAY);
+
+    if (strncmp(transcript, offer_text, sizeof(offer_text) - 1) != 0) {
+        strncpy(offer_text, transcript, sizeof(offer_text) - 1);
+        offer_text[sizeof(offer_text) - 1] = '\0';
+        offer_changed_ms = now;
+
+        if (spec_valid && !text_equivalent(spec_text, offer_text)) {
+            LOG_I("Transcript moved on, dropping speculation\r\n");
+            spec_metrics.stale++;
+            spec_invalidate();
+        }
+    }
+
+    if (!spec_busy && !spec_valid && offer_text[0] != '\0' && trailing_silence &&
+        now - offer_changed_ms >= LLM_SPECULATIVE_STABLE_MS && !answered_locally(offer_text)) {
+        strcpy(spec_text, offer_text);
+        spec_valid = true;
+        spec_busy = true;
+        spec_cancel = false;
+        spec_stream_len = 0;
+        spec_truncated = false;
+        spec_start_ms = now;
+        spec_metrics.issued++;
+        xSemaphoreTake(spec_progress, 0);  // Clear a signal left from a discarded request
+        LOG_I("Speculative request on: %s\r\n", spec_text);
+        xTaskNotifyGive(spec_task);
+    }
+
+    xSemaphoreGive(spec_lock);
+}
+
+char *llm_spec_take(const char *final_text, deepseek_delta_cb_t on_text, void *ctx,
+                    uint32_t timeout_ms) {
+    static char chunk[LLM_SPEC_REPLY_MAX];  // Only the voice task takes
+    char *reply = NULL;
+    uint32_t take_ms = spec_now_ms();
+    uint32_t fed = 0;
+
+    if (!spec_task || !final_text) {
+        return NULL;
+    }
+
+    xSemaphoreTake(spec_lock, portMAX_DELAY);
+    if (!spec_valid) {
+        xSemaphoreGive(spec_lock);
+        return NULL;
+    }
+    if (!text_equivalent(spec_text, final_text)) {
+        LOG_I("Speculation miss: \"%s\" vs final \"%s\"\r\n", spec_text, final_text);
+        spec_metrics.misses++;
+        spec_invalidate();
+        xSemaphoreGive(spec_lock);
+        return NULL;
+    }
+    bool was_busy = spec_busy;
+    xSemaphoreGive(spec_lock);
+
+    // Replay what has streamed in so far, then pass the rest on as it comes
+    bool stalled = false;
+    while (1) {
+        xSemaphoreTake(spec_lock, portMAX_DELAY);
+        uint32_t n = spec_stream_len - fed;
+        memcpy(chunk, spec_stream + fed, n);
+        chunk[n] = '\0';
+        bool busy = spec_busy;
+        xSemaphoreGive(spec_lock);
+
+        if (n > 0) {
+            if (on_text) {
+                on_text(ctx, chunk);
+            }
+            fed += n;
+        }
+        if (!busy) {
+            break;
+        }
+        if (xSemaphoreTake(spec_progress, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+            stalled = true;
+            break;
+        }
+    }
+
+    // Return what was spoken, not the full reply: they differ when the
+    // request stalled or failed, or when the stream buffer filled up
+    xSemaphoreTake(spec_lock, portMAX_DELAY);
+    if (fed > 0) {
+        reply = pvPortMalloc(fed + 1);
+        if (reply) {
+            memcpy(reply, spec_stream, fed);
+            reply[fed] = '\0';
+        }
+    }
+    if (spec_truncated && fed > 0) {
+        spec_metrics.truncated++;
+        LOG_W("Speculative reply longer than %d bytes, cut short\r\n", LLM_SPEC_REPLY_MAX - 1);
+    }
+    if (fed > 0) {
+        // Without speculation the request would have started at take_ms
+        uint32_t saved = was_busy ? take_ms - spec_start_ms : spec_end_ms - spec_start_ms;
+        spec_metrics.hits++;
+        spec_metrics.last_saved_ms = saved;
+        spec_metrics.saved_ms_total += saved;
+        LOG_I("Speculation hit, saved %d ms (hits %d/%d)\r\n",
+              saved, spec_metrics.hits, spec_metrics.issued);
+    }
+    if (stalled) {
+        LOG_W("Speculative request silent for %d ms, %s\r\n", timeout_ms,
+              fed > 0 ? "cutting the reply short" : "asking directly");
+    }
+    spec_invalidate();  // Cancels whatever is still running
+    xSemaphoreGive(spec_lock);
+
+    return reply;
+}
+
+void llm_spec_get_metrics(llm_spec_metrics_t *metrics) {
+    *metrics = spec_metrics;
+}
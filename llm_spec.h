@@ -0,0 +1,68 @@
+#ifndef __LLM_SPEC_H__
+#define __LLM_SPEC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "deepseek_client.h"
+
+#define LLM_SPEC_TEXT_MAX 512
+#define LLM_SPEC_REPLY_MAX 2048   // Streamed reply buffered for the taker
+
+// Speculative dispatch metrics
+typedef struct {
+    uint32_t issued;          // Speculative requests started
+    uint32_t hits;            // Final transcript matched, speculative reply used
+    uint32_t misses;          // Final transcript differed, reply discarded
+    uint32_t stale;           // Transcript moved on before the final; reply discarded
+    uint32_t failures;        // Speculative request itself failed
+    uint32_t truncated;       // Used reply cut short at LLM_SPEC_REPLY_MAX
+    uint32_t saved_ms_total;  // Latency saved across all hits
+    uint32_t last_saved_ms;   // Latency saved by the latest hit
+} llm_spec_metrics_t;
+
+/**
+ * @brief Create the speculative request worker
+ * @return 0 on success, -1 on failure
+ */
+int llm_spec_init(void);
+
+/**
+ * @brief Start a new turn; any speculation still running is discarded
+ */
+void llm_spec_reset(void);
+
+/**
+ * @brief Offer the current partial transcript
+ *
+ * Call once per recorded chunk. A DeepSeek request is started in the
+ * background when the text has not changed for LLM_SPECULATIVE_STABLE_MS
+ * and the VAD reports trailing silence.
+ *
+ * @param transcript Current partial transcript
+ * @param trailing_silence VAD is trending to silence
+ */
+void llm_spec_offer(const char *transcript, bool trailing_silence);
+
+/**
+ * @brief Claim the speculative reply for the final transcript
+ *
+ * If the speculation was made on the same text (ignoring spaces and
+ * punctuation), the text streamed so far is passed to on_text at once and
+ * the rest as it arrives, until the reply is complete or fills
+ * LLM_SPEC_REPLY_MAX. Otherwise the speculative request is cancelled.
+ *
+ * @param final_text Final transcript
+ * @param on_text Called with each piece of the reply, in order
+ * @param ctx Callback context
+ * @param timeout_ms Maximum wait for more text from the request in flight
+ * @return Text passed to on_text (caller must free) or NULL if the caller must ask itself
+ */
+char *llm_spec_take(const char *final_text, deepseek_delta_cb_t on_text, void *ctx,
+                    uint32_t timeout_ms);
+
+/**
+ * @brief Get speculative dispatch metrics
+ */
+void llm_spec_get_metrics(llm_spec_metrics_t *metrics);
+
+#endif // __LLM_SPEC_H__
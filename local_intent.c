@@ -0,0 +1,591 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+#include "bflb_mtimer.h"
+
+#include <lwip/tcpip.h>
+#include <lwip/apps/sntp.h>
+
+#include "local_intent.h"
+#include "tts_client.h"
+#include "conv_memory.h"
+#include "config.h"
+
+#define DBG_TAG "INTENT"
+
+#define NTP_UNIX_OFFSET 2208988800u      // 1900-01-01 to 1970-01-01
+
+typedef struct {
+    const char *phrase;
+    local_intent_t intent;
+} intent_phrase_t;
+
+// Phrases are normalised like transcripts, so fillers and homophones
+// don't need listing
+static const intent_phrase_t phrases[] = {
+    { "停", LOCAL_INTENT_STOP },
+    { "停止", LOCAL_INTENT_STOP },
+    { "停下", LOCAL_INTENT_STOP },
+    { "暂停", LOCAL_INTENT_STOP },
+    { "别说了", LOCAL_INTENT_STOP },
+    { "不要说了", LOCAL_INTENT_STOP },
+    { "闭嘴", LOCAL_INTENT_STOP },
+    { "安静", LOCAL_INTENT_STOP },
+    { "取消", LOCAL_INTENT_STOP },
+    { "算了", LOCAL_INTENT_STOP },
+    { "stop", LOCAL_INTENT_STOP },
+
+    { "大声", LOCAL_INTENT_VOLUME_UP },
+    { "大声点", LOCAL_INTENT_VOLUME_UP },
+    { "声音大", LOCAL_INTENT_VOLUME_UP },
+    { "声音调大", LOCAL_INTENT_VOLUME_UP },
+    { "声音调高", LOCAL_INTENT_VOLUME_UP },
+    { "音量大", LOCAL_INTENT_VOLUME_UP },
+    { "音量调大", LOCAL_INTENT_VOLUME_UP },
+    { "音量调高", LOCAL_INTENT_VOLUME_UP },
+    { "调大音量", LOCAL_INTENT_VOLUME_UP },
+    { "调高音量", LOCAL_INTENT_VOLUME_UP },
+    { "加大音量", LOCAL_INTENT_VOLUME_UP },
+    { "增大音量", LOCAL_INTENT_VOLUME_UP },
+    { "音量加", LOCAL_INTENT_VOLUME_UP },
+    { "太小声", LOCAL_INTENT_VOLUME_UP },
+    { "声音太小", LOCAL_INTENT_VOLUME_UP },
+    { "听不清", LOCAL_INTENT_VOLUME_UP },
+
+    { "小声", LOCAL_INTENT_VOLUME_DOWN },
+    { "小声点", LOCAL_INTENT_VOLUME_DOWN },
+    { "声音小", LOCAL_INTENT_VOLUME_DOWN },
+    { "声音调小", LOCAL_INTENT_VOLUME_DOWN },
+    { "声音调低", LOCAL_INTENT_VOLUME_DOWN },
+    { "音量小", LOCAL_INTENT_VOLUME_DOWN },
+    { "音量调小", LOCAL_INTENT_VOLUME_DOWN },
+    { "音量调低", LOCAL_INTENT_VOLUME_DOWN },
+    { "调小音量", LOCAL_INTENT_VOLUME_DOWN },
+    { "调低音量", LOCAL_INTENT_VOLUME_DOWN },
+    { "减小音量", LOCAL_INTENT_VOLUME_DOWN },
+    { "降低音量", LOCAL_INTENT_VOLUME_DOWN },
+    { "音量减", LOCAL_INTENT_VOLUME_DOWN },
+    { "太大声", LOCAL_INTENT_VOLUME_DOWN },
+    { "声音太大", LOCAL_INTENT_VOLUME_DOWN },
+    { "太吵", LOCAL_INTENT_VOLUME_DOWN },
+
+    { "最大音量", LOCAL_INTENT_VOLUME_MAX },
+    { "音量最大", LOCAL_INTENT_VOLUME_MAX },
+    { "音量调到最大", LOCAL_INTENT_VOLUME_MAX },
+    { "声音调到最大", LOCAL_INTENT_VOLUME_MAX },
+
+    { "最小音量", LOCAL_INTENT_VOLUME_MIN },
+    { "音量最小", LOCAL_INTENT_VOLUME_MIN },
+    { "音量调到最小", LOCAL_INTENT_VOLUME_MIN },
+    { "声音调到最小", LOCAL_INTENT_VOLUME_MIN },
+    { "静音", LOCAL_INTENT_VOLUME_MIN },
+
+    { "几点", LOCAL_INTENT_TIME },
+    { "几点钟", LOCAL_INTENT_TIME },
+    { "现在几点", LOCAL_INTENT_TIME },
+    { "现在是几点", LOCAL_INTENT_TIME },
+    { "现在几点钟", LOCAL_INTENT_TIME },
+    { "现在时间", LOCAL_INTENT_TIME },
+    { "现在什么时间", LOCAL_INTENT_TIME },
+    { "现在是什么时间", LOCAL_INTENT_TIME },
+    { "what time is it", LOCAL_INTENT_TIME },
+
+    { "今天几号", LOCAL_INTENT_DATE },
+    { "今天是几号", LOCAL_INTENT_DATE },
+    { "今天星期几", LOCAL_INTENT_DATE },
+    { "今天是星期几", LOCAL_INTENT_DATE },
+    { "今天礼拜几", LOCAL_INTENT_DATE },
+    { "今天几月几号", LOCAL_INTENT_DATE },
+    { "今天日期", LOCAL_INTENT_DATE },
+    { "今天的日期", LOCAL_INTENT_DATE },
+    { "星期几", LOCAL_INTENT_DATE },
+
+    { "换个话题", LOCAL_INTENT_FORGET },
+    { "重新开始", LOCAL_INTENT_FORGET },
+    { "忘掉刚才的对话", LOCAL_INTENT_FORGET },
+    { "忘记刚才的对话", LOCAL_INTENT_FORGET },
+    { "清除记忆", LOCAL_INTENT_FORGET },
+};
+
+// Dropped before matching (from the transcript as recognised)
+static const char *fillers[] = {
+    "请问", "请", "帮我", "麻烦", "给我", "把", "一下", "一点", "一些",
+    "吧", "啊", "呀", "呢", "嘛", "哦", "了", "的",
+};
+
+// Characters a recognizer confuses, one group per toneless pinyin
+// syllable; each folds to the first character of its group
+static const char *homophones[] = {
+    "停听厅亭庭婷挺",
+    "止只指之知直纸制至治智支值",
+    "下夏吓虾侠",
+    "暂赞咱攒",
+    "别憋",
+    "说硕",
+    "闭必比笔币毕避逼鼻",
+    "嘴最醉罪",
+    "安按暗岸案",
+    "静京经精镜境井敬竟净景警",
+    "取去区曲趣",
+    "消小笑校晓效孝",
+    "算酸蒜",
+    "大达打答搭",
+    "声生升胜省圣剩盛绳",
+    "音因银引印阴隐饮尹",
+    "量亮两辆凉梁粮良谅晾俩",
+    "调条跳挑",
+    "加家佳假价架嘉夹甲",
+    "增曾赠憎",
+    "高搞告稿糕",
+    "太台抬态泰",
+    "清轻青情晴庆倾",
+    "不部步布补",
+    "减件见间建剪简检键健渐",
+    "降将讲奖江酱",
+    "低底地第弟帝滴敌递",
+    "吵超朝潮炒抄",
+    "到道倒导刀岛",
+    "几机记级及急即集极既计寄技鸡积基济挤",
+    "点电店典垫殿",
+    "现先线县限鲜显险献闲",
+    "在再载灾",
+    "什神身深伸申审",
+    "时是事十市式师使世始视试室石实食识史示",
+    "钟中种重众终忠",
+    "今进金近尽紧仅津",
+    "天添田甜填",
+    "号好豪毫耗浩",
+    "星行性姓兴醒型形幸",
+    "期七起气其器汽奇齐骑旗启企",
+    "月越约阅跃",
+    "礼里理力利李立历例离丽",
+    "拜百白败摆",
+    "换还环欢缓幻",
+    "个各歌哥格隔",
+    "话画化花华划滑",
+    "题提体替梯",
+    "忘往王网望旺",
+    "掉吊钓",
+    "刚钢港岗",
+    "才菜财彩采猜",
+    "对队堆",
+    "新心信辛欣薪",
+    "开凯慨",
+    "除出初处础厨",
+    "忆一以已意义议易衣医依亿艺",
+    "要药咬耀",
+};
+
+typedef struct {
+    uint16_t ch;
+    uint16_t canon;
+} homophone_t;
+
+typedef struct {
+    uint16_t sym;
+    uint8_t intent;                  // Phrase ending here, LOCAL_INTENT_NONE if none
+    uint8_t phrase;                  // Index of that phrase in phrases[]
+    uint16_t child;                  // First child, 0 if none (the root is never a child)
+    uint16_t next;                   // Next sibling
+} trie_node_t;
+
+#define FILLER_SYMBOLS_MAX 4
+#define PHRASE_COUNT (sizeof(phrases) / sizeof(phrases[0]))
+
+static homophone_t *homophone_map;
+static uint32_t homophone_count;
+static uint16_t filler_syms[sizeof(fillers) / sizeof(fillers[0])][FILLER_SYMBOLS_MAX];
+static uint8_t filler_lens[sizeof(fillers) / sizeof(fillers[0])];
+static uint16_t exact_syms[PHRASE_COUNT][LOCAL_INTENT_EXACT_SYMBOLS];  // Short phrases, unfolded
+static trie_node_t trie[LOCAL_INTENT_TRIE_NODES];
+static uint32_t trie_count;
+static local_intent_stats_t intent_stats;
+
+// Wall clock, set by SNTP
+static bool clock_valid;
+static uint32_t clock_unix_s;            // UTC at clock_tick_ms
+static uint32_t clock_tick_ms;
+
+static uint32_t intent_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Called by the lwIP SNTP client (SNTP_SET_SYSTEM_TIME_NTP in lwipopts_user.h)
+void sntp_set_time(uint32_t sntp_time, uint32_t fac) {
+    (void)fac;
+    clock_unix_s = sntp_time - NTP_UNIX_OFFSET;
+    clock_tick_ms = intent_now_ms();
+    if (!clock_valid) {
+        LOG_I("Clock set by SNTP\r\n");
+    }
+    clock_valid = true;
+}
+
+// Decode UTF-8 into BMP code points; anything outside the BMP is skipped
+static uint32_t utf8_decode(const char *text, uint16_t *out, uint32_t max) {
+    const uint8_t *p = (const uint8_t *)text;
+    uint32_t n = 0;
+
+    while (*p && n < max) {
+        uint32_t cp;
+        if (p[0] < 0x80) {
+            cp = *p++;
+        } else if ((p[0] & 0xE0) == 0xC0 && p[1]) {
+            cp = ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+            p += 2;
+        } else if ((p[0] & 0xF0) == 0xE0 && p[1] && p[2]) {
+            cp = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+            p += 3;
+        } else {
+            // 4-byte sequence (emoji) or broken input
+            p++;
+            while ((*p & 0xC0) == 0x80) {
+                p++;
+            }
+            continue;
+        }
+        out[n++] = cp;
+    }
+    return n;
+}
+
+static int homophone_cmp(const void *a, const void *b) {
+    return (int)((const homophone_t *)a)->ch - (int)((const homophone_t *)b)->ch;
+}
+
+static uint16_t fold(uint16_t ch) {
+    uint32_t lo = 0;
+    uint32_t hi = homophone_count;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (homophone_map[mid].ch == ch) {
+            return homophone_map[mid].canon;
+        }
+        if (homophone_map[mid].ch < ch) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return ch;
+}
+
+// Keep letters, digits and CJK; fold full-width ASCII and upper case
+static bool keep_symbol(uint16_t *ch) {
+    uint16_t c = *ch;
+
+    if (c >= 0xFF01 && c <= 0xFF5E) {
+        c -= 0xFEE0;  // Full-width form of an ASCII character
+    }
+    if (c >= 'A' && c <= 'Z') {
+        c += 'a' - 'A';
+    }
+    *ch = c;
+    if (c < 0x80) {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9');
+    }
+    // General punctuation, CJK symbols and punctuation, full-width forms
+    return !((c >= 0x2000 && c <= 0x206F) || (c >= 0x3000 && c <= 0x303F) ||
+             (c >= 0xFE30 && c <= 0xFE4F) || (c >= 0xFF00 && c <= 0xFFEF));
+}
+
+// Transcript or phrase to matchable symbols; unfolded (if not NULL) gets
+// the same symbols before homophone folding
+static uint32_t normalize(const char *text, uint16_t *out, uint16_t *unfolded, uint32_t max) {
+    uint16_t raw[LOCAL_INTENT_SYMBOLS_MAX];
+    uint32_t raw_len = utf8_decode(text, raw, LOCAL_INTENT_SYMBOLS_MAX);
+    uint32_t kept = 0;
+
+    for (uint32_t i = 0; i < raw_len; i++) {
+        if (keep_symbol(&raw[i])) {
+            raw[kept++] = raw[i];
+        }
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < kept && n < max;) {
+        bool filler = false;
+        for (uint32_t f = 0; f < sizeof(fillers) / sizeof(fillers[0]); f++) {
+            uint32_t len = filler_lens[f];
+            if (i + len <= kept && memcmp(&raw[i], filler_syms[f], len * sizeof(uint16_t)) == 0) {
+                i += len;
+                filler = true;
+                break;
+            }
+        }
+        if (!filler) {
+            if (unfolded) {
+                unfolded[n] = raw[i];
+            }
+            out[n++] = fold(raw[i++]);
+        }
+    }
+    return n;
+}
+
+static int trie_insert(const uint16_t *syms, uint32_t len, uint32_t phrase) {
+    local_intent_t intent = phrases[phrase].intent;
+    uint32_t node = 0;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t child = trie[node].child;
+        while (child && trie[child].sym != syms[i]) {
+            child = trie[child].next;
+        }
+        if (!child) {
+            if (trie_count >= LOCAL_INTENT_TRIE_NODES) {
+                return -1;
+            }
+            child = trie_count++;
+            trie[child].sym = syms[i];
+            trie[child].intent = LOCAL_INTENT_NONE;
+            trie[child].child = 0;
+            trie[child].next = trie[node].child;
+            trie[node].child = child;
+        }
+        node = child;
+    }
+    if (trie[node].intent != LOCAL_INTENT_NONE && trie[node].intent != intent) {
+        LOG_W("Phrases for intents %d and %d normalise the same\r\n", trie[node].intent, intent);
+    }
+    trie[node].intent = intent;
+    trie[node].phrase = phrase;
+    return 0;
+}
+
+// A phrase of one or two characters is too weak as evidence once folded
+// ("听" is not "停", "太潮" is not "太吵"), so those must match as spoken
+static bool phrase_exact(uint32_t phrase, const uint16_t *unfolded, uint32_t len) {
+    return len > LOCAL_INTENT_EXACT_SYMBOLS ||
+           memcmp(unfolded, exact_syms[phrase], len * sizeof(uint16_t)) == 0;
+}
+
+// Longest phrase anywhere in syms; its length goes to *match_len
+static local_intent_t trie_search(const uint16_t *syms, const uint16_t *unfolded, uint32_t len,
+                                  uint32_t *match_len) {
+    local_intent_t best = LOCAL_INTENT_NONE;
+    uint32_t best_len = 0;
+
+    for (uint32_t start = 0; start < len; start++) {
+        uint32_t node = 0;
+        for (uint32_t i = start; i < len; i++) {
+            uint32_t child = trie[node].child;
+            while (child && trie[child].sym != syms[i]) {
+                child = trie[child].next;
+            }
+            if (!child) {
+                break;
+            }
+            node = child;
+            if (trie[node].intent != LOCAL_INTENT_NONE && i - start + 1 > best_len &&
+                phrase_exact(trie[node].phrase, unfolded + start, i - start + 1)) {
+                best = trie[node].intent;
+                best_len = i - start + 1;
+            }
+        }
+    }
+    *match_len = best_len;
+    return best;
+}
+
+local_intent_t local_intent_match(const char *text) {
+    uint16_t syms[LOCAL_INTENT_SYMBOLS_MAX];
+    uint16_t unfolded[LOCAL_INTENT_SYMBOLS_MAX];
+    uint32_t match_len;
+
+    if (!trie_count || !text) {
+        return LOCAL_INTENT_NONE;
+    }
+    uint32_t len = normalize(text, syms, unfolded, LOCAL_INTENT_SYMBOLS_MAX);
+    if (len == 0) {
+        return LOCAL_INTENT_NONE;
+    }
+    local_intent_t intent = trie_search(syms, unfolded, len, &match_len);
+    if (intent == LOCAL_INTENT_NONE || match_len * 100 < len * LOCAL_INTENT_COVERAGE_PCT) {
+        return LOCAL_INTENT_NONE;
+    }
+    return intent;
+}
+
+// Local time from the SNTP clock; false until it has been set
+static bool local_time(uint32_t *year, uint32_t *month, uint32_t *day, uint32_t *wday,
+                       uint32_t *hour, uint32_t *min) {
+    if (!clock_valid) {
+        return false;
+    }
+    uint32_t t = clock_unix_s + (intent_now_ms() - clock_tick_ms) / 1000 +
+                 LOCAL_TIMEZONE_HOURS * 3600;
+    uint32_t days = t / 86400;
+    uint32_t secs = t % 86400;
+
+    *hour = secs / 3600;
+    *min = secs / 60 % 60;
+    *wday = (days + 4) % 7;  // 1970-01-01 was a Thursday; 0 is Sunday
+
+    // Civil date from days since 1970-01-01 (proleptic Gregorian)
+    uint32_t z = days + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    *day = doy - (153 * mp + 2) / 5 + 1;
+    *month = (mp < 10) ? mp + 3 : mp - 9;
+    *year = yoe + era * 400 + (*month <= 2);
+    return true;
+}
+
+static int set_volume(int volume, char *reply) {
+    if (volume > 100) {
+        volume = 100;
+    } else if (volume < 0) {
+        volume = 0;
+    }
+    tts_set_volume(volume);
+    if (volume > 0) {
+        sprintf(reply, "音量%d", volume);  // Spoken at the new volume
+    }
+    return 0;
+}
+
+// Carry out an intent; -1 when it can't be answered here
+static int intent_execute(local_intent_t intent, char *reply) {
+    static const char *weekdays[] = {"日", "一", "二", "三", "四", "五", "六"};
+    uint32_t year, month, day, wday, hour, min;
+
+    reply[0] = '\0';
+    switch (intent) {
+    case LOCAL_INTENT_STOP:
+        return 0;
+    case LOCAL_INTENT_VOLUME_UP:
+        return set_volume(tts_get_volume() + LOCAL_INTENT_VOLUME_STEP, reply);
+    case LOCAL_INTENT_VOLUME_DOWN:
+        return set_volume(tts_get_volume() - LOCAL_INTENT_VOLUME_STEP, reply);
+    case LOCAL_INTENT_VOLUME_MAX:
+        return set_volume(100, reply);
+    case LOCAL_INTENT_VOLUME_MIN:
+        return set_volume(0, reply);
+    case LOCAL_INTENT_TIME:
+        if (!local_time(&year, &month, &day, &wday, &hour, &min)) {
+            return -1;
+        }
+        sprintf(reply, "现在是%d点%d分", hour, min);
+        return 0;
+    case LOCAL_INTENT_DATE:
+        if (!local_time(&year, &month, &day, &wday, &hour, &min)) {
+            return -1;
+        }
+        sprintf(reply, "今天是%d月%d日，星期%s", month, day, weekdays[wday]);
+        return 0;
+    case LOCAL_INTENT_FORGET:
+#if CONV_MEMORY_ENABLE
+        conv_memory_reset();
+#endif
+        strcpy(reply, "好的，我们换个话题");
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+char *local_intent_handle(const char *text) {
+    uint64_t start_us = bflb_mtimer_get_time_us();
+    local_intent_t intent = local_intent_match(text);
+    uint32_t elapsed_us = bflb_mtimer_get_time_us() - start_us;
+
+    intent_stats.checks++;
+    intent_stats.last_us = elapsed_us;
+    intent_stats.total_us += elapsed_us;
+    if (elapsed_us > intent_stats.max_us) {
+        intent_stats.max_us = elapsed_us;
+    }
+    if (intent == LOCAL_INTENT_NONE) {
+        return NULL;
+    }
+
+    char *reply = pvPortMalloc(LOCAL_INTENT_REPLY_MAX);
+    if (!reply) {
+        return NULL;
+    }
+    if (intent_execute(intent, reply) < 0) {
+        intent_stats.unanswerable++;
+        LOG_I("Intent %d needs the clock, asking the LLM\r\n", intent);
+        vPortFree(reply);
+        return NULL;
+    }
+
+    intent_stats.hits++;
+    LOG_I("Local intent %d in %d us: \"%s\" (hits %d/%d)\r\n", intent, elapsed_us, reply,
+          intent_stats.hits, intent_stats.checks);
+    return reply;
+}
+
+void local_intent_get_stats(local_intent_stats_t *stats) {
+    *stats = intent_stats;
+}
+
+int local_intent_init(void) {
+    uint16_t syms[LOCAL_INTENT_SYMBOLS_MAX];
+    uint16_t unfolded[LOCAL_INTENT_SYMBOLS_MAX];
+
+    if (trie_count) {
+        return 0;
+    }
+
+    // Homophone map, sorted for binary search
+    uint32_t total = 0;
+    for (uint32_t g = 0; g < sizeof(homophones) / sizeof(homophones[0]); g++) {
+        total += utf8_decode(homophones[g], syms, LOCAL_INTENT_SYMBOLS_MAX);
+    }
+    homophone_map = pvPortMalloc(total * sizeof(homophone_t));
+    if (!homophone_map) {
+        LOG_E("Failed to allocate homophone map\r\n");
+        return -1;
+    }
+    for (uint32_t g = 0; g < sizeof(homophones) / sizeof(homophones[0]); g++) {
+        uint32_t n = utf8_decode(homophones[g], syms, LOCAL_INTENT_SYMBOLS_MAX);
+        for (uint32_t i = 0; i < n; i++) {
+            homophone_map[homophone_count].ch = syms[i];
+            homophone_map[homophone_count].canon = syms[0];
+            homophone_count++;
+        }
+    }
+    qsort(homophone_map, homophone_count, sizeof(homophone_t), homophone_cmp);
+    for (uint32_t i = 1; i < homophone_count; i++) {
+        if (homophone_map[i].ch == homophone_map[i - 1].ch) {
+            LOG_W("U+%04X is in two homophone groups\r\n", homophone_map[i].ch);
+        }
+    }
+
+    for (uint32_t f = 0; f < sizeof(fillers) / sizeof(fillers[0]); f++) {
+        filler_lens[f] = utf8_decode(fillers[f], filler_syms[f], FILLER_SYMBOLS_MAX);
+    }
+
+    trie_count = 1;  // Root
+    memset(&trie[0], 0, sizeof(trie[0]));
+    for (uint32_t p = 0; p < PHRASE_COUNT; p++) {
+        uint32_t n = normalize(phrases[p].phrase, syms, unfolded, LOCAL_INTENT_SYMBOLS_MAX);
+        if (n == 0 || trie_insert(syms, n, p) < 0) {
+            LOG_E("Cannot add intent phrase \"%s\"\r\n", phrases[p].phrase);
+            continue;
+        }
+        if (n <= LOCAL_INTENT_EXACT_SYMBOLS) {
+            memcpy(exact_syms[p], unfolded, n * sizeof(uint16_t));
+        }
+    }
+    LOG_I("%d intent phrases, %d trie nodes, %d homophones\r\n",
+          (int)PHRASE_COUNT, trie_count, homophone_count);
+
+    // The clock for time and date questions
+    LOCK_TCPIP_CORE();
+    sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    sntp_setservername(0, LOCAL_INTENT_NTP_SERVER);
+    sntp_init();
+    UNLOCK_TCPIP_CORE();
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef __LOCAL_INTENT_H__
+#define __LOCAL_INTENT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LOCAL_INTENT_SYMBOLS_MAX 96      // Characters of a transcript looked at
+#define LOCAL_INTENT_TRIE_NODES 512
+#define LOCAL_INTENT_COVERAGE_PCT 60     // Share of the utterance a phrase must cover
+#define LOCAL_INTENT_EXACT_SYMBOLS 2     // Phrases this short must match without homophone folding
+#define LOCAL_INTENT_VOLUME_STEP 15      // Percent per "louder"/"quieter"
+#define LOCAL_INTENT_REPLY_MAX 96
+
+// Requests answered on the device
+typedef enum {
+    LOCAL_INTENT_NONE = 0,
+    LOCAL_INTENT_STOP,               // Stop/cancel: end the turn without a reply
+    LOCAL_INTENT_VOLUME_UP,
+    LOCAL_INTENT_VOLUME_DOWN,
+    LOCAL_INTENT_VOLUME_MAX,
+    LOCAL_INTENT_VOLUME_MIN,
+    LOCAL_INTENT_TIME,
+    LOCAL_INTENT_DATE,
+    LOCAL_INTENT_FORGET,             // Start a new conversation
+    LOCAL_INTENT_COUNT
+} local_intent_t;
+
+// Matcher statistics (final transcripts only)
+typedef struct {
+    uint32_t checks;
+    uint32_t hits;                   // Answered on the device
+    uint32_t unanswerable;           // Matched, but needs data we don't have (clock not set)
+    uint32_t last_us;                // Cost of the latest match
+    uint32_t max_us;
+    uint32_t total_us;
+} local_intent_stats_t;
+
+/**
+ * @brief Build the phrase trie and start SNTP for the clock
+ *
+ * Call once the network is up.
+ *
+ * @return 0 on success, -1 on error
+ */
+int local_intent_init(void);
+
+/**
+ * @brief Match a transcript against the phrase table
+ *
+ * Spaces, punctuation and filler words (请, 一下, 吧 ...) are dropped and
+ * characters are folded to one per toneless pinyin syllable, so a
+ * recognizer homophone (音亮 for 音量) still matches. Phrases of up to
+ * LOCAL_INTENT_EXACT_SYMBOLS characters must match unfolded: a single
+ * folded character (听 for 停) is too weak a match. The longest phrase
+ * found must cover LOCAL_INTENT_COVERAGE_PCT of what is left, so a long
+ * question that merely contains a command word goes to the LLM.
+ *
+ * @param text UTF-8 transcript
+ * @return Matched intent or LOCAL_INTENT_NONE
+ */
+local_intent_t local_intent_match(const char *text);
+
+/**
+ * @brief Match a final transcript and carry out the intent
+ *
+ * @param text UTF-8 transcript
+ * @return Reply to speak ("" for none; caller must free) or NULL to ask
+ *         the LLM instead
+ */
+char *local_intent_handle(const char *text);
+
+/**
+ * @brief Get matcher statistics
+ */
+void local_intent_get_stats(local_intent_stats_t *stats);
+
+#endif // __LOCAL_INTENT_H__
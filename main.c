@@ -21,11 +21,22 @@
 #include "log.h"
 #include "bsp_es8388.h"
 #include "https_client.h"
+#include "boot_cache.h"
+#include "dns_cache.h"
+#include "conn_prewarm.h"
 #include "stt_client.h"
 #include "deepseek_client.h"
+#include "conv_memory.h"
+#include "local_intent.h"
 #include "tts_client.h"
 #include "config.h"
 #include "vad.h"
+#include "stt_batch.h"
+#include "llm_spec.h"
+#include "endpoint.h"
+#include "turn_metrics.h"
+#include "utt_queue.h"
+#include "tts_queue.h"
 
 #include <math.h>
 #include <stdint.h>
@@ -55,6 +66,7 @@ static volatile uint32_t audio_recorded_size = 0;
 static volatile bool recording_complete = false;
 static volatile bool playback_complete = false;
 static vad_state_t vad_state;
+static stt_batch_state_t batch_state;  // Uplink batch controller, learns across turns
 
 // Current ES8388 mode
 static ES8388_Work_Mode current_es8388_mode = ES8388_RECORDING_MODE;
@@ -63,6 +75,13 @@ static ES8388_Work_Mode current_es8388_mode = ES8388_RECORDING_MODE;
 // 2 second buffer (stereo 16-bit) = 128KB - dynamically allocated in PSRAM
 #define TRIGGER_BUFFER_MS 2000
 #define TRIGGER_BUFFER_SIZE (AUDIO_SAMPLE_RATE * 2 * 2 * TRIGGER_BUFFER_MS / 1000)
+// Max wait for a pre-warmed STT session when a (re)connect is still in flight.
+// Speech keeps being captured into audio_buffer meanwhile, so the wait ends
+// before that fills up (less a margin for stopping the DMA); after that the
+// command is queued (see utt_queue.h)
+#define STT_SESSION_ACQUIRE_TIMEOUT_MS (AUDIO_BUFFER_SIZE / (AUDIO_SAMPLE_RATE * 2 * 2 / 1000) - 100)
+// Max gap in a matching speculative DeepSeek reply that is still streaming
+#define LLM_SPEC_TAKE_TIMEOUT_MS 15000
 // VAD Threshold: Restored to 2000 as per user request to avoid false triggers
 #define VOICE_ENERGY_THRESHOLD 2000
 static uint8_t *trigger_audio_buffer = NULL;
@@ -306,16 +325,35 @@ int play_audio(uint8_t *pcm_data, uint32_t pcm_len)
 
 // Real-time recording with streaming to WhisperLive
 // Returns transcribed text (caller must free) or NULL on failure
+// Arm DMA to capture one realtime chunk into buffer
+static void start_chunk_capture(struct bflb_dma_channel_lli_pool_s *llipool, uint8_t *buffer, uint32_t len)
+{
+    struct bflb_dma_channel_lli_transfer_s transfer;
+
+    memset(buffer, 0, len);
+    transfer.src_addr = (uint32_t)DMA_ADDR_I2S_RDR;
+    transfer.dst_addr = (uint32_t)buffer;
+    transfer.nbytes = len;
+
+    uint32_t num = bflb_dma_channel_lli_reload(dma0_ch0, llipool, 20, &transfer, 1);
+    bflb_dma_channel_lli_link_head(dma0_ch0, llipool, num);
+    bflb_dma_channel_start(dma0_ch0);
+}
+
 char* record_and_transcribe_realtime(uint32_t max_duration_ms)
 {
     LOG_I("Starting real-time recording...\r\n");
 
-    // Buffer for streaming chunks (250ms chunks to save memory)
-    #define CHUNK_DURATION_MS 250
-    #define CHUNK_SIZE (AUDIO_SAMPLE_RATE * 2 * 2 * CHUNK_DURATION_MS / 1000)  // 16-bit stereo = 16KB
+#if LLM_SPECULATIVE_ENABLE
+    llm_spec_reset();
+#endif
+
+    // Buffer for streaming chunks: one WhisperLive chunk (4096 samples, 256 ms),
+    // so a one-unit batch goes out as soon as its chunk is captured
+    #define CHUNK_DURATION_MS STT_BATCH_UNIT_MS
+    #define CHUNK_SIZE STT_BATCH_UNIT_BYTES  // 16-bit stereo = 16KB
     #define SILENCE_THRESHOLD 150  // Energy threshold for silence detection (lowered)
     #define SPEECH_THRESHOLD 180   // Energy threshold for speech detection
-    #define SILENCE_CHUNKS_TO_STOP 5  // Stop after 5 consecutive silent chunks (1.25 seconds at 250ms)
     #define MAX_SILENCE_BEFORE_SPEECH 12  // Stop if no speech detected after 3 seconds
 
     // Use static buffer to avoid malloc
@@ -342,10 +380,31 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
     uint32_t chunk_count = 0;
     bool speech_started = true;  // Assume speech already started from trigger detection
     uint32_t silence_count = 0;
+    // Freshness is judged on the audio timeline the server reports segments on
+    // (seconds since the stream start), not on when messages happened to arrive
+    uint32_t stream_ms = 0;           // Audio captured for this stream so far
+    uint32_t last_speech_at_ms = 0;   // Stream position of the last speech chunk
+    float partial_end_s = -1.0f;      // Stream position the latest partial reaches
+    bool session_lost = false;
 
     static struct bflb_dma_channel_lli_pool_s rx_llipool[20];
-    struct bflb_dma_channel_lli_transfer_s transfer;
+
+    // Batch buffer: chunks are whole batch units, so it never holds more than the largest batch
+    static uint8_t *batch_buffer = NULL;
+    uint32_t batch_len = 0;
+    if (batch_buffer == NULL) {
+        batch_buffer = pvPortMalloc(STT_BATCH_MAX_UNITS * STT_BATCH_UNIT_BYTES);
+    }
     
+    // Start capturing the first live chunk before the backlog goes out, so speech
+    // keeps being recorded while pre-roll audio drains at line rate (sends are
+    // paced by TCP send-buffer space, not by fixed delays)
+    bflb_i2s_feature_control(i2s0, I2S_CMD_CLEAR_RX_FIFO, 0);
+    bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, I2S_CMD_DATA_ENABLE_RX);
+    start_chunk_capture(rx_llipool, chunk_buffer, CHUNK_SIZE);
+    TickType_t chunk_start = xTaskGetTickCount();
+    bool chunk_armed = true;
+
     // Send the trigger audio
     // Previously we tried to trim silence, but this was too aggressive and cut off speech
     // Now we send the full trigger buffer to ensure no speech is lost
@@ -361,13 +420,13 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
                 LOG_E("Failed to send trigger audio chunk at offset %d\r\n", offset);
                 break;
             }
-            vTaskDelay(pdMS_TO_TICKS(1));
             offset += chunk_to_send;
         }
         LOG_I("Trigger audio sent (%d bytes, %.1f seconds)\r\n", 
               trigger_audio_len, 
               (float)trigger_audio_len / (AUDIO_SAMPLE_RATE * 2 * 2));
         
+        stream_ms += trigger_audio_len * 1000 / (AUDIO_SAMPLE_RATE * 2 * 2);
         has_trigger_audio = false;
     }
 
@@ -385,34 +444,32 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
                 LOG_E("Failed to send overlap audio chunk at offset %d\r\n", offset);
                 break;
             }
-            vTaskDelay(pdMS_TO_TICKS(1));  // Small delay to avoid overwhelming TCP buffer
             offset += chunk_to_send;
         }
+        stream_ms += audio_recorded_size * 1000 / (AUDIO_SAMPLE_RATE * 2 * 2);
         audio_recorded_size = 0;  // Clear
         LOG_I("Overlap audio sent\r\n");
     }
 
-    // Now start real-time recording
-    // Clear FIFO and start fresh recording
-    bflb_i2s_feature_control(i2s0, I2S_CMD_CLEAR_RX_FIFO, 0);
-    bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, I2S_CMD_DATA_ENABLE_RX);
+    // The trigger counts as speech: its last chunk must be transcribed
+    last_speech_at_ms = stream_ms > CHUNK_DURATION_MS ? stream_ms - CHUNK_DURATION_MS : 0;
 
     LOG_I("Real-time recording started\r\n");
 
     // Main recording loop
     while (total_time < max_duration_ms) {
-        // Setup DMA transfer for this chunk
-        memset(chunk_buffer, 0, CHUNK_SIZE);
-        transfer.src_addr = (uint32_t)DMA_ADDR_I2S_RDR;
-        transfer.dst_addr = (uint32_t)chunk_buffer;
-        transfer.nbytes = CHUNK_SIZE;
-
-        uint32_t num = bflb_dma_channel_lli_reload(dma0_ch0, rx_llipool, 20, &transfer, 1);
-        bflb_dma_channel_lli_link_head(dma0_ch0, rx_llipool, num);
-        bflb_dma_channel_start(dma0_ch0);
+        // Setup DMA transfer for this chunk (the first one is already running)
+        if (!chunk_armed) {
+            start_chunk_capture(rx_llipool, chunk_buffer, CHUNK_SIZE);
+            chunk_start = xTaskGetTickCount();
+        }
+        chunk_armed = false;
 
         // Wait for chunk to complete
-        vTaskDelay(pdMS_TO_TICKS(CHUNK_DURATION_MS));
+        uint32_t chunk_elapsed_ms = (xTaskGetTickCount() - chunk_start) * portTICK_PERIOD_MS;
+        if (chunk_elapsed_ms < CHUNK_DURATION_MS) {
+            vTaskDelay(pdMS_TO_TICKS(CHUNK_DURATION_MS - chunk_elapsed_ms));
+        }
 
         // Stop DMA
         bflb_dma_channel_stop(dma0_ch0);
@@ -422,6 +479,7 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
 
         chunk_count++;
         total_time += CHUNK_DURATION_MS;
+        stream_ms += CHUNK_DURATION_MS;
 
         // Calculate energy
         int16_t *samples = (int16_t*)chunk_buffer;
@@ -433,38 +491,27 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
         }
         uint32_t avg_energy = (uint32_t)(sum / num_samples);
 
-        // Batch sending logic: Accumulate 4 chunks (1 second) before sending
-        // This reduces server inference frequency and improves speed
-        #define BATCH_SIZE 4
-        static uint8_t *batch_buffer = NULL;
-        static uint32_t batch_len = 0;
-
-        // Initialize batch buffer on first use
-        if (batch_buffer == NULL) {
-            batch_buffer = pvPortMalloc(CHUNK_SIZE * BATCH_SIZE);
-            batch_len = 0;  // Ensure clean start
-        }
-
-        // Reset batch_len at start of new recording session (first chunk)
-        // Fixed by Claude (claude-opus-4-5-20251101): batch_len was not reset between sessions
-        if (chunk_count == 1) {
-            batch_len = 0;
-        }
-        
+        // Batch sending logic: accumulate chunks up to the controller's batch
+        // size (whole WhisperLive chunks); after a shrink the rest waits for the next batch
         if (batch_buffer) {
             memcpy(batch_buffer + batch_len, chunk_buffer, CHUNK_SIZE);
             batch_len += CHUNK_SIZE;
-            
-            // Send only when batch is full or recording is ending
-            if (batch_len >= CHUNK_SIZE * BATCH_SIZE) {
-                int sent = stt_send_audio_chunk(batch_buffer, batch_len);
+
+            uint32_t target = stt_batch_target_bytes(&batch_state);
+            if (batch_len >= target) {
+                TickType_t send_start = xTaskGetTickCount();
+                int sent = stt_send_audio_chunk(batch_buffer, target);
                 if (sent < 0) {
                     LOG_E("Failed to send batch audio\r\n");
                     break;
                 }
-                LOG_I("Sent batch audio (%d bytes)\r\n", batch_len);
-                batch_len = 0;
-                vTaskDelay(pdMS_TO_TICKS(5)); // Small delay after batch send
+                TickType_t send_end = xTaskGetTickCount();
+                stt_batch_on_sent(&batch_state, target, (send_end - send_start) * portTICK_PERIOD_MS,
+                                  send_end * portTICK_PERIOD_MS);
+                LOG_I("Sent batch audio (%d bytes, next batch %d ms)\r\n",
+                      target, batch_state.units * STT_BATCH_UNIT_MS);
+                batch_len -= target;
+                memmove(batch_buffer, batch_buffer + target, batch_len);
             }
         } else {
             // Fallback if malloc failed
@@ -475,10 +522,33 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
             }
         }
 
+        // Drain transcription events (received by the STT session task, never blocks)
+        stt_event_t event;
+        while (stt_event_wait(&event, 0) > 0) {
+            if (event.type == STT_EVENT_PARTIAL) {
+                stt_batch_on_transcript(&batch_state, event.timestamp_ms);
+            }
+            if (event.type == STT_EVENT_PARTIAL && event.text[0]) {
+                partial_end_s = event.end;
+                // Replace (not append) with latest transcription
+                // WhisperLive sends progressive updates, we only want the latest
+                strncpy(transcription_buffer, event.text, sizeof(transcription_buffer) - 1);
+                transcription_buffer[sizeof(transcription_buffer) - 1] = '\0';
+            } else if (event.type == STT_EVENT_CLOSE) {
+                session_lost = true;
+            }
+            stt_event_free(&event);
+        }
+        if (session_lost) {
+            LOG_E("STT session lost, stopping recording\r\n");
+            break;
+        }
+
         // Check for speech/silence
         if (avg_energy > SPEECH_THRESHOLD) {
             speech_started = true;
             silence_count = 0;
+            last_speech_at_ms = stream_ms - CHUNK_DURATION_MS;
             LOG_I("Chunk %d: energy=%d [SPEECH]\r\n", chunk_count, avg_energy);
         } else if (avg_energy > SILENCE_THRESHOLD) {
             // Medium energy - don't reset silence count, let it accumulate
@@ -490,10 +560,24 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
                   speech_started ? "" : " (pre-speech)");
         } else {
             silence_count++;
-            LOG_I("Chunk %d: energy=%d [silence %d/%d]\r\n", chunk_count, avg_energy, silence_count, SILENCE_CHUNKS_TO_STOP);
 
-            if (speech_started && silence_count >= SILENCE_CHUNKS_TO_STOP) {
-                LOG_I("Speech ended, stopping recording\r\n");
+            // Required silence follows the transcript: a finished question
+            // ends the turn sooner than a trailing "然后". The transcript is fresh
+            // once a segment reaches into the last speech chunk (Whisper ends a
+            // segment at the last word, which can fall anywhere in the chunk)
+            bool transcript_fresh = partial_end_s * 1000.0f >= (float)last_speech_at_ms;
+            uint32_t required_ms = endpoint_required_silence_ms(transcription_buffer, transcript_fresh);
+            uint32_t required_chunks = (required_ms + CHUNK_DURATION_MS / 2) / CHUNK_DURATION_MS;
+            if (required_chunks == 0) {
+                required_chunks = 1;
+            }
+            LOG_I("Chunk %d: energy=%d [silence %d/%d]\r\n", chunk_count, avg_energy, silence_count, required_chunks);
+
+            if (speech_started && silence_count >= required_chunks) {
+                LOG_I("Speech ended after %d ms silence (endpoint: %s%s)\r\n",
+                      silence_count * CHUNK_DURATION_MS,
+                      endpoint_class_name(endpoint_classify(transcription_buffer)),
+                      transcript_fresh ? "" : ", transcript stale");
                 break;
             }
 
@@ -503,24 +587,17 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
             }
         }
 
-        // Check for transcription (non-blocking)
-        char temp_text[512];
-        int received = stt_recv_transcription(temp_text, sizeof(temp_text), 50);
-        if (received > 0 && strlen(temp_text) > 0) {
-            LOG_I("Transcription: %s\r\n", temp_text);
-            // Replace (not append) with latest transcription
-            // WhisperLive sends progressive updates, we only want the latest
-            strncpy(transcription_buffer, temp_text, sizeof(transcription_buffer) - 1);
-            transcription_buffer[sizeof(transcription_buffer) - 1] = '\0';
-        }
+#if LLM_SPECULATIVE_ENABLE
+        // Start DeepSeek early once the transcript settles and speech is tailing off
+        llm_spec_offer(transcription_buffer, speech_started && silence_count > 0);
+#endif
     }
 
     bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, 0);
+    turn_metrics_mark(TURN_MARK_SPEECH_END);
 
-    // CRITICAL FIX: Send any remaining audio in batch buffer before ending
-    // Without this, the last few chunks (up to 1 second) were never sent to server
-    // causing speech to be truncated
-    // Fixed by Claude (claude-opus-4-5-20251101)
+    // Send any remaining audio in batch buffer before ending
+    // Without this, the tail of the utterance never reaches the server
     if (batch_buffer && batch_len > 0) {
         LOG_I("Sending remaining batch audio (%d bytes, %.2f seconds)...\r\n",
               batch_len, (float)batch_len / (AUDIO_SAMPLE_RATE * 2 * 2));
@@ -528,10 +605,14 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
         if (sent < 0) {
             LOG_E("Failed to send remaining batch audio\r\n");
         }
-        batch_len = 0;  // Reset for next recording session
+        batch_len = 0;
     }
 
     LOG_I("Recording done (%d chunks, %d ms)\r\n", chunk_count, total_time);
+    LOG_I("Uplink send-buffer waits so far: %d\r\n", whisper_live_tx_stalls());
+    LOG_I("Batching: %d batches, size %d ms (grow %d, shrink %d), send %d ms, turnaround %d ms\r\n",
+          batch_state.batches, batch_state.units * STT_BATCH_UNIT_MS, batch_state.grows,
+          batch_state.shrinks, batch_state.send_ms_ewma, batch_state.turnaround_ms_ewma);
 
     // Wait for final transcription
     // Adaptive timeout based on recording duration
@@ -540,22 +621,30 @@ char* record_and_transcribe_realtime(uint32_t max_duration_ms)
     if (wait_seconds < 20) wait_seconds = 20;   // Minimum 20 seconds
     if (wait_seconds > 60) wait_seconds = 60; // Maximum 60 seconds
     
-    LOG_I("Waiting for transcription (timeout: %d s)...\r\n", wait_seconds);
-    char final_text[512];
-    for (int i = 0; i < wait_seconds; i++) {
-        int final_received = stt_recv_transcription(final_text, sizeof(final_text), 1000);
-        if (final_received > 0 && strlen(final_text) > 0) {
-            LOG_I("Final: %s\r\n", final_text);
-            // Replace (not append) with final transcription
-            strncpy(transcription_buffer, final_text, sizeof(transcription_buffer) - 1);
-            transcription_buffer[sizeof(transcription_buffer) - 1] = '\0';
-            break;
-        }
-        LOG_I("Waiting... (%d/%d)\r\n", i + 1, wait_seconds);
+    // Tell the server the utterance is over so it completes the last segment
+    if (!session_lost && stt_send_end_of_audio() < 0) {
+        LOG_W("Failed to send END_OF_AUDIO\r\n");
+    }
+
+    LOG_I("Waiting for final transcription (timeout: %d s)...\r\n", wait_seconds);
+    char final_text[STT_TRANSCRIPT_MAX];
+    int final_received = session_lost ? -1 :
+        stt_wait_final(final_text, sizeof(final_text), wait_seconds * 1000);
+    turn_metrics_mark(TURN_MARK_TRANSCRIPT);
+    if (final_received < 0) {
+        LOG_E("STT session lost while waiting\r\n");
+    } else if (final_received == 0) {
+        LOG_W("No final transcription within %d s\r\n", wait_seconds);
+    }
+    if (final_received >= 0 && strlen(final_text) > 0) {
+        LOG_I("Final: %s\r\n", final_text);
+        // Replace (not append) with final transcription
+        strncpy(transcription_buffer, final_text, sizeof(transcription_buffer) - 1);
+        transcription_buffer[sizeof(transcription_buffer) - 1] = '\0';
     }
 
-    // Disconnect from STT service
-    stt_disconnect();
+    // Hand the session back; the manager pre-warms the next one
+    stt_session_release();
 
     if (strlen(transcription_buffer) > 0) {
         char *result = pvPortMalloc(strlen(transcription_buffer) + 1);
@@ -883,6 +972,11 @@ bool listen_and_record_if_voice(uint32_t listen_duration_ms, char **out_transcri
     }
 
     LOG_I("Energy: %d [VOICE DETECTED! > %d]\r\n", energy, VOICE_ENERGY_THRESHOLD);
+    turn_metrics_begin();
+#if CONN_PREWARM_ENABLE
+    // Connect to DeepSeek and TTS while the user is still talking
+    conn_prewarm_trigger(CONN_PREWARM_LLM | CONN_PREWARM_TTS);
+#endif
 
 
     // Voice detected!
@@ -903,25 +997,41 @@ bool listen_and_record_if_voice(uint32_t listen_duration_ms, char **out_transcri
     // Clear buffer to avoid sending old audio from previous session
     memset(audio_buffer, 0, AUDIO_BUFFER_SIZE);
 
-    // Setup DMA to record to audio_buffer (256KB = 4 seconds) while connecting
+    // Setup DMA to record to audio_buffer (256KB = 4 seconds) while connecting.
+    // One pass, not linked back to the head: if the session takes longer the
+    // capture stops at the end instead of overwriting the start of the command
     transfer.src_addr = (uint32_t)DMA_ADDR_I2S_RDR;
     transfer.dst_addr = (uint32_t)audio_buffer;
     transfer.nbytes = AUDIO_BUFFER_SIZE;
 
-    num = bflb_dma_channel_lli_reload(dma0_ch0, listen_llipool, 20, &transfer, 1);
-    bflb_dma_channel_lli_link_head(dma0_ch0, listen_llipool, num);
+    bflb_dma_channel_lli_reload(dma0_ch0, listen_llipool, 20, &transfer, 1);
     bflb_dma_channel_start(dma0_ch0);
+    TickType_t overlap_start = xTaskGetTickCount();
 
-    LOG_I("Recording to overlap buffer while connecting...\r\n");
+    LOG_I("Recording to overlap buffer while acquiring STT session...\r\n");
 
-    // Connect to WhisperLive (audio continues to record during this!)
-    LOG_I("Connecting to WhisperLive...\r\n");
-    stt_disconnect();  // Ensure clean state
-    if (stt_connect() < 0) {
-        LOG_E("Failed to connect to WhisperLive\r\n");
+    // Take the pre-warmed WhisperLive session (audio continues to record during this!)
+    if (stt_session_acquire(STT_SESSION_ACQUIRE_TIMEOUT_MS) < 0) {
+        LOG_E("Failed to acquire WhisperLive session\r\n");
         bflb_dma_channel_stop(dma0_ch0);
         bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, 0);
-        
+
+        // Keep the command instead of losing it: trigger + overlap go to the
+        // store-and-forward queue and are transcribed once a session is back.
+        // The overlap is in order from the start of audio_buffer, since the
+        // capture never wraps
+        uint32_t lost_ms = (xTaskGetTickCount() - overlap_start) * portTICK_PERIOD_MS;
+        uint32_t lost_size = (AUDIO_SAMPLE_RATE * 2 * 2 / 1000) * lost_ms;
+        if (lost_size > AUDIO_BUFFER_SIZE) {
+            lost_size = AUDIO_BUFFER_SIZE;
+        }
+        bflb_l1c_dcache_invalidate_range((void*)audio_buffer, AUDIO_BUFFER_SIZE);
+        if (utt_queue_begin((trigger_audio_len + lost_size) / 4) == 0) {
+            utt_queue_append((int16_t *)trigger_audio_buffer, trigger_audio_len / 4);
+            utt_queue_append((int16_t *)audio_buffer, lost_size / 4);
+            utt_queue_commit();
+        }
+
         // Critical: Ensure recording is ready for next attempt
         switch_es8388_mode(ES8388_RECORDING_MODE);
         bflb_i2s_link_rxdma(i2s0, true);
@@ -929,19 +1039,19 @@ bool listen_and_record_if_voice(uint32_t listen_duration_ms, char **out_transcri
         return false;
     }
 
-    // Stop the overlap recording (we have audio_buffer filled with 500ms of continued speech)
+    turn_metrics_mark(TURN_MARK_SESSION);
+
+    // Stop the overlap recording
     bflb_dma_channel_stop(dma0_ch0);
     bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, 0);
+    uint32_t overlap_ms = (xTaskGetTickCount() - overlap_start) * portTICK_PERIOD_MS;
 
     // Invalidate cache for overlap buffer
     bflb_l1c_dcache_invalidate_range((void*)audio_buffer, AUDIO_BUFFER_SIZE);
 
-    // Calculate actual recorded size based on connection time
-    // Stop happens right after stt_connect() returns, estimate ~1-2 seconds
-    // Each second = 16000 * 2 * 2 = 64000 bytes
-    // Conservative: use 2 seconds = 128KB
-    uint32_t estimated_connection_time_ms = 2000;  // Typical connection time
-    audio_recorded_size = (AUDIO_SAMPLE_RATE * 2 * 2 * estimated_connection_time_ms) / 1000;
+    // Overlap is exactly what the DMA captured while we waited for the session
+    // Each millisecond = 16 * 2 * 2 = 64 bytes (frame aligned)
+    audio_recorded_size = (AUDIO_SAMPLE_RATE * 2 * 2 / 1000) * overlap_ms;
     if (audio_recorded_size > AUDIO_BUFFER_SIZE) {
         audio_recorded_size = AUDIO_BUFFER_SIZE;
     }
@@ -956,6 +1066,115 @@ bool listen_and_record_if_voice(uint32_t listen_duration_ms, char **out_transcri
     return true;
 }
 
+// Sentences go to TTS as soon as DeepSeek has streamed them
+static void on_llm_delta(void *ctx, const char *delta)
+{
+    (void)ctx;
+    tts_queue_feed(delta);
+}
+
+// Get the reply and speak it: a local answer for device commands, the
+// speculative reply when it was made on the same text, else a streamed
+// request whose first sentence plays while the rest is generated. Returns
+// the reply once playback is done.
+static char *ask_llm_and_speak(const char *text)
+{
+    char *reply = NULL;
+
+#if LOCAL_INTENT_ENABLE
+    // Device commands and clock questions don't need the LLM
+    reply = local_intent_handle(text);
+    local_intent_stats_t is;
+    local_intent_get_stats(&is);
+    LOG_I("Local intents: %d/%d answered, match %d us (max %d us)\r\n",
+          is.hits, is.checks, is.last_us, is.max_us);
+    if (reply) {
+        if (reply[0]) {
+            tts_queue_begin();
+            tts_queue_feed(reply);
+            tts_queue_finish();
+        }
+        return reply;
+    }
+#endif
+#if CONN_PREWARM_ENABLE
+    // The TTS connection from speech onset may have idled out by now
+    conn_prewarm_trigger(CONN_PREWARM_TTS);
+#endif
+    tts_queue_begin();
+#if LLM_SPECULATIVE_ENABLE
+    reply = llm_spec_take(text, on_llm_delta, NULL, LLM_SPEC_TAKE_TIMEOUT_MS);
+    llm_spec_metrics_t m;
+    llm_spec_get_metrics(&m);
+    LOG_I("Speculation: issued %d, hits %d, misses %d, stale %d, truncated %d, saved %d ms total\r\n",
+          m.issued, m.hits, m.misses, m.stale, m.truncated, m.saved_ms_total);
+#endif
+    if (!reply) {
+        reply = deepseek_chat_stream(text, on_llm_delta, NULL);
+    }
+    tts_queue_finish();
+#if CONV_MEMORY_ENABLE
+    if (reply) {
+        conv_memory_add_turn(text, reply);
+        conv_memory_stats_t cm;
+        conv_memory_get_stats(&cm);
+        LOG_I("Conversation: %d turns, %d bytes, ~%d tokens, %d turns evicted\r\n",
+              cm.turns, cm.bytes_used, cm.history_tokens, cm.evicted_turns);
+    }
+#endif
+    return reply;
+}
+
+// Transcribe the oldest queued utterance once an STT session is available.
+// Uploads at line rate (no real-time pacing); returns the transcript or NULL.
+// Polled from the main loop, so it waits for the session manager's own
+// reconnect instead of kicking it out of its backoff on every pass.
+static char *forward_queued_utterance(void)
+{
+    const utt_entry_t *utt = utt_queue_oldest();
+    if (!utt || !stt_session_ready() || stt_session_acquire(0) < 0) {
+        return NULL;
+    }
+
+    uint32_t age_ms = xTaskGetTickCount() * portTICK_PERIOD_MS - utt->captured_ms;
+    LOG_I("Forwarding queued utterance (%d ms of audio, %d ms old)\r\n", utt->samples / 16, age_ms);
+    turn_metrics_begin();
+    turn_metrics_mark(TURN_MARK_SESSION);
+
+    int16_t *stereo = pvPortMalloc(UTTQ_FRAME_SAMPLES * 2 * sizeof(int16_t));
+    bool sent_ok = (stereo != NULL);
+    uint32_t frames = utt_queue_frame_count(utt);
+    for (uint32_t i = 0; sent_ok && i < frames; i++) {
+        uint32_t n = utt_queue_read_frame(utt, i, stereo);
+        sent_ok = stt_send_audio_chunk((uint8_t *)stereo, n * 4) >= 0;
+    }
+    if (stereo) {
+        vPortFree(stereo);
+    }
+    turn_metrics_mark(TURN_MARK_SPEECH_END);
+
+    char *result = NULL;
+    if (sent_ok && stt_send_end_of_audio() == 0) {
+        char final_text[STT_TRANSCRIPT_MAX];
+        int wait_ms = (20 + (utt->samples / AUDIO_SAMPLE_RATE) * 2) * 1000;
+        if (stt_wait_final(final_text, sizeof(final_text), wait_ms) > 0 && strlen(final_text) > 0) {
+            result = pvPortMalloc(strlen(final_text) + 1);
+            if (result) {
+                strcpy(result, final_text);
+            }
+        }
+    }
+    turn_metrics_mark(TURN_MARK_TRANSCRIPT);
+    stt_session_release();
+
+    utt_queue_pop(result != NULL);
+    utt_queue_metrics_t m;
+    utt_queue_get_metrics(&m);
+    LOG_I("Utterance queue: %d waiting (oldest %d ms), forwarded %d, failed %d, expired %d, dropped %d\r\n",
+          m.depth, m.oldest_age_ms, m.forwarded, m.failed, m.expired, m.dropped);
+    return result;
+}
+
 // Voice assistant task
 void voice_assistant_task(void *pvParameters)
 {
@@ -986,6 +1205,36 @@ void voice_assistant_task(void *pvParameters)
         }
     }
     
+    // Warm state from the previous boot: TLS session, addresses, STT server health
+    boot_cache_init();
+
+    // Resolve the servers in the background while the rest comes up
+    if (dns_cache_init() < 0) {
+        LOG_E("Failed to start DNS cache\r\n");
+        while(1) vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    dns_cache_prefetch_url(DEEPSEEK_API_URL);
+    dns_cache_prefetch_url(TTS_API_URL);
+    dns_cache_prefetch_url(WHISPERLIVE_WS_URL);
+
+    if (https_client_init() < 0) {
+        LOG_E("Failed to initialize HTTPS client\r\n");
+        while(1) vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    if (deepseek_client_init() < 0) {
+        LOG_W("Chat endpoint hedging unavailable\r\n");
+    }
+#if CONV_MEMORY_ENABLE
+    if (conv_memory_init() < 0) {
+        LOG_W("Conversation memory unavailable\r\n");
+    }
+#endif
+#if LOCAL_INTENT_ENABLE
+    if (local_intent_init() < 0) {
+        LOG_W("Local intents unavailable\r\n");
+    }
+#endif
+
     // Step 2: Test HTTP client
     LOG_I("\r\n=== Step 2: Testing HTTP Client ===\r\n");
     test_http_connection();
@@ -996,12 +1245,36 @@ void voice_assistant_task(void *pvParameters)
         LOG_E("Failed to initialize WhisperLive client\r\n");
         while(1) vTaskDelay(pdMS_TO_TICKS(1000));
     }
+    stt_batch_init(&batch_state);
+
+    // Connect in the background so the first trigger finds a ready session
+    if (stt_session_start() < 0) {
+        LOG_E("Failed to start WhisperLive session manager\r\n");
+        while(1) vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+    LOG_I("WhisperLive STT session manager started\r\n");
+
+    if (tts_client_init() < 0) {
+        LOG_E("Failed to start TTS playback\r\n");
+        while(1) vTaskDelay(pdMS_TO_TICKS(1000));
+    }
 
-    if (stt_connect() < 0) {
-        LOG_E("Failed to connect to WhisperLive server\r\n");
+    if (tts_queue_init() < 0) {
+        LOG_E("Failed to start TTS worker\r\n");
         while(1) vTaskDelay(pdMS_TO_TICKS(1000));
     }
-    LOG_I("WhisperLive STT connected successfully!\r\n");
+
+#if LLM_SPECULATIVE_ENABLE
+    if (llm_spec_init() < 0) {
+        LOG_W("Speculative LLM dispatch unavailable\r\n");
+    }
+#endif
+
+#if CONN_PREWARM_ENABLE
+    if (conn_prewarm_init() < 0) {
+        LOG_W("Connection pre-warming unavailable\r\n");
+    }
+#endif
 
     //Step 3: Initialize ES8388 audio codec
     LOG_I("\r\n=== Step 3: Initializing ES8388 Audio Codec ===\r\n");
@@ -1075,19 +1348,13 @@ void voice_assistant_task(void *pvParameters)
 
             // Step 7: DeepSeek Integration
             LOG_I("\r\n=== Step 7: DeepSeek API Integration ===\r\n");
-            char *ai_reply = deepseek_chat(text);
+
+            // Step 8: TTS + Playback, streamed sentence by sentence
+            char *ai_reply = ask_llm_and_speak(text);
 
             if (ai_reply) {
                 LOG_I("AI Reply: \"%s\"\r\n", ai_reply);
-
-                // Step 8: TTS + Playback (Streaming)
-                LOG_I("\r\n=== Step 8: Streaming TTS & Audio Playback ===\r\n");
-
-                if (tts_synthesize_and_play_streaming(ai_reply) == 0) {
-                    LOG_I("Streaming TTS playback complete\r\n");
-                } else {
-                    LOG_E("Streaming TTS failed\r\n");
-                }
+                turn_metrics_mark(TURN_MARK_AUDIO_END);
 
                 vPortFree(ai_reply);
             } else {
@@ -1095,6 +1362,7 @@ void voice_assistant_task(void *pvParameters)
             }
 
             vPortFree(text);
+            turn_metrics_end();
     } else {
         LOG_E("Real-time transcription failed\r\n");
     }
@@ -1102,39 +1370,42 @@ void voice_assistant_task(void *pvParameters)
     // Main loop - Voice Assistant with auto-start
     LOG_I("\r\n=== Voice Assistant Auto-Start Loop ===\r\n");
     
-    // Ensure no lingering connections from initialization
-    stt_disconnect();
-    
     LOG_I("Listening for voice activity...\r\n");
 
     while (1) {
         // Listen for voice activity
         LOG_I("Listening...\r\n");
 
-        char *text = NULL;
-        if (listen_and_record_if_voice(TRIGGER_BUFFER_MS, &text)) {  // Listen for voice, record if detected
+        // Commands captured while the STT server was unreachable go first
+        char *text = forward_queued_utterance();
+        if (text || listen_and_record_if_voice(TRIGGER_BUFFER_MS, &text)) {  // Listen for voice, record if detected
             if (text && strlen(text) > 0) {
                 LOG_I("STT: \"%s\"\r\n", text);
+                ES8388_I2C_Stats_Reset();
 
                 // AI
                 LOG_I("Sending to AI...\r\n");
-                char *ai_reply = deepseek_chat(text);
+                // Reply is spoken while it streams in
+                char *ai_reply = ask_llm_and_speak(text);
 
                 if (ai_reply) {
                     LOG_I("AI: \"%s\"\r\n", ai_reply);
-
-                    // Streaming TTS + Playback
-                    tts_synthesize_and_play_streaming(ai_reply);
+                    turn_metrics_mark(TURN_MARK_AUDIO_END);
 
                     vPortFree(ai_reply);
                 }
 
                 vPortFree(text);
+                turn_metrics_end();
+                ES8388_I2C_Stats_Dump("turn");
             }
 
             LOG_I("Ready for next command...\r\n");
         }
 
+        // Persist what this turn learned while nothing is waiting on the network
+        boot_cache_flush();
+
         // Small delay before next listen cycle
         vTaskDelay(pdMS_TO_TICKS(500));
     }
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+
+#include <lwip/sockets.h>
+
+#include "mbedtls/net_sockets.h"
+
+#include "net_impair.h"
+
+#define DBG_TAG "IMPAIR"
+
+#if NET_IMPAIR_ENABLE
+
+typedef struct {
+    net_impair_profile_t profile;
+    net_impair_stats_t stats;
+    uint64_t tx_busy_until_us;   // Bandwidth cap: link busy until then
+    uint64_t rx_busy_until_us;
+    uint32_t next_stall_ms;      // 0 = not scheduled yet
+    uint32_t next_reset_ms;
+} net_impair_state_t;
+
+// Defaults from config.h; net_impair_set() replaces them at runtime
+static net_impair_state_t impair[NET_IMPAIR_ENDPOINT_COUNT] = {
+    [NET_IMPAIR_STT] = { .profile = NET_IMPAIR_STT_PROFILE },
+    [NET_IMPAIR_LLM] = { .profile = NET_IMPAIR_LLM_PROFILE },
+    [NET_IMPAIR_TTS] = { .profile = NET_IMPAIR_TTS_PROFILE },
+};
+
+static uint32_t impair_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Next event time, uniformly spread around the mean interval
+static uint32_t impair_schedule(uint32_t now, uint32_t every_ms) {
+    return now + every_ms / 2 + (uint32_t)rand() % (every_ms + 1);
+}
+
+static void impair_sleep(net_impair_state_t *st, uint32_t ms) {
+    if (ms > 0) {
+        st->stats.delayed_ms += ms;
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+}
+
+// Stalls and resets are time based so they do not depend on how finely a
+// client splits its reads (the TTS header parser reads byte by byte)
+static int impair_events(net_impair_state_t *st, int s) {
+    const net_impair_profile_t *p = &st->profile;
+    uint32_t now = impair_now_ms();
+
+    if (p->reset_every_ms) {
+        if (st->next_reset_ms == 0) {
+            st->next_reset_ms = impair_schedule(now, p->reset_every_ms);
+        } else if ((int32_t)(now - st->next_reset_ms) >= 0) {
+            st->next_reset_ms = impair_schedule(now, p->reset_every_ms);
+            st->stats.resets++;
+            LOG_W("Injected connection reset on socket %d\r\n", s);
+            lwip_shutdown(s, SHUT_RDWR);
+            errno = ECONNRESET;
+            return -1;
+        }
+    }
+
+    if (p->stall_every_ms && p->stall_ms) {
+        if (st->next_stall_ms == 0) {
+            st->next_stall_ms = impair_schedule(now, p->stall_every_ms);
+        } else if ((int32_t)(now - st->next_stall_ms) >= 0) {
+            st->stats.stalls++;
+            LOG_W("Injected %d ms stall on socket %d\r\n", p->stall_ms, s);
+            impair_sleep(st, p->stall_ms);
+            st->next_stall_ms = impair_schedule(impair_now_ms(), p->stall_every_ms);
+        }
+    }
+
+    return 0;
+}
+
+// Serialize bytes through a link of bandwidth_bps; sleep until they are through
+static void impair_bandwidth(net_impair_state_t *st, uint64_t *busy_until_us, uint32_t bytes) {
+    uint32_t bps = st->profile.bandwidth_bps;
+    if (!bps || !bytes) {
+        return;
+    }
+
+    uint64_t now_us = (uint64_t)impair_now_ms() * 1000;
+    if (*busy_until_us < now_us) {
+        *busy_until_us = now_us;
+    }
+    *busy_until_us += (uint64_t)bytes * 1000000 / bps;
+
+    // Sub-tick remainders carry over to the next call
+    uint32_t wait_ms = (uint32_t)((*busy_until_us - now_us) / 1000);
+    if (wait_ms >= portTICK_PERIOD_MS) {
+        impair_sleep(st, wait_ms);
+    }
+}
+
+static void impair_latency(net_impair_state_t *st) {
+    const net_impair_profile_t *p = &st->profile;
+    uint32_t ms = p->latency_ms;
+
+    if (p->jitter_ms) {
+        ms += (uint32_t)rand() % (p->jitter_ms + 1);
+    }
+    impair_sleep(st, ms);
+}
+
+void net_impair_set(net_impair_endpoint_t endpoint, const net_impair_profile_t *profile) {
+    if (endpoint < NET_IMPAIR_ENDPOINT_COUNT && profile) {
+        impair[endpoint].profile = *profile;
+        impair[endpoint].next_stall_ms = 0;
+        impair[endpoint].next_reset_ms = 0;
+    }
+}
+
+void net_impair_get_stats(net_impair_endpoint_t endpoint, net_impair_stats_t *stats) {
+    if (endpoint < NET_IMPAIR_ENDPOINT_COUNT && stats) {
+        *stats = impair[endpoint].stats;
+    }
+}
+
+int net_impair_connect(net_impair_endpoint_t endpoint, int s, const struct sockaddr *name, socklen_t namelen) {
+    net_impair_state_t *st = &impair[endpoint];
+
+    // SYN out and SYN-ACK back
+    impair_latency(st);
+    impair_latency(st);
+    st->next_reset_ms = 0;  // Fresh connection, fresh reset schedule
+    return lwip_connect(s, name, namelen);
+}
+
+int net_impair_send(net_impair_endpoint_t endpoint, int s, const void *data, size_t size, int flags) {
+    net_impair_state_t *st = &impair[endpoint];
+
+    if (impair_events(st, s) < 0) {
+        return -1;
+    }
+    impair_latency(st);
+    int ret = lwip_send(s, data, size, flags);
+    if (ret > 0) {
+        impair_bandwidth(st, &st->tx_busy_until_us, ret);
+    }
+    return ret;
+}
+
+int net_impair_recv(net_impair_endpoint_t endpoint, int s, void *mem, size_t len, int flags) {
+    net_impair_state_t *st = &impair[endpoint];
+
+    if (impair_events(st, s) < 0) {
+        return -1;
+    }
+    // Latency is charged on the sending side; the downlink is rate limited
+    int ret = lwip_recv(s, mem, len, flags);
+    if (ret > 0) {
+        impair_bandwidth(st, &st->rx_busy_until_us, ret);
+    }
+    return ret;
+}
+
+int net_impair_tls_send(void *ctx, const unsigned char *buf, size_t len) {
+    net_impair_state_t *st = &impair[NET_IMPAIR_LLM];
+    int fd = ((mbedtls_net_context *)ctx)->fd;
+
+    if (impair_events(st, fd) < 0) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    impair_latency(st);
+    int ret = mbedtls_net_send(ctx, buf, len);
+    if (ret > 0) {
+        impair_bandwidth(st, &st->tx_busy_until_us, ret);
+    }
+    return ret;
+}
+
+int net_impair_tls_recv(void *ctx, unsigned char *buf, size_t len) {
+    net_impair_state_t *st = &impair[NET_IMPAIR_LLM];
+    int fd = ((mbedtls_net_context *)ctx)->fd;
+
+    if (impair_events(st, fd) < 0) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    int ret = mbedtls_net_recv(ctx, buf, len);
+    if (ret > 0) {
+        impair_bandwidth(st, &st->rx_busy_until_us, ret);
+    }
+    return ret;
+}
+
+#else
+
+// Disabled: pass-through so the API stays linkable
+
+void net_impair_set(net_impair_endpoint_t endpoint, const net_impair_profile_t *profile) {
+    (void)endpoint;
+    (void)profile;
+}
+
+void net_impair_get_stats(net_impair_endpoint_t endpoint, net_impair_stats_t *stats) {
+    (void)endpoint;
+    if (stats) {
+        memset(stats, 0, sizeof(net_impair_stats_t));
+    }
+}
+
+int net_impair_connect(net_impair_endpoint_t endpoint, int s, const struct sockaddr *name, socklen_t namelen) {
+    (void)endpoint;
+    return lwip_connect(s, name, namelen);
+}
+
+int net_impair_send(net_impair_endpoint_t endpoint, int s, const void *data, size_t size, int flags) {
+    (void)endpoint;
+    return lwip_send(s, data, size, flags);
+}
+
+int net_impair_recv(net_impair_endpoint_t endpoint, int s, void *mem, size_t len, int flags) {
+    (void)endpoint;
+    return lwip_recv(s, mem, len, flags);
+}
+
+int net_impair_tls_send(void *ctx, const unsigned char *buf, size_t len) {
+    return mbedtls_net_send(ctx, buf, len);
+}
+
+int net_impair_tls_recv(void *ctx, unsigned char *buf, size_t len) {
+    return mbedtls_net_recv(ctx, buf, len);
+}
+
+#endif // NET_IMPAIR_ENABLE
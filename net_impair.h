@@ -0,0 +1,71 @@
+#ifndef __NET_IMPAIR_H__
+#define __NET_IMPAIR_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <lwip/sockets.h>
+#include "config.h"
+
+// Network impairment shim for latency testing under bad Wi-Fi.
+//
+// With NET_IMPAIR_ENABLE set in config.h, a client source that defines
+// NET_IMPAIR_ENDPOINT and includes this header after the lwIP headers has
+// its connect()/send()/recv() routed through the shim. https_client serves
+// both LLM and TTS, so it calls the net_impair_*() functions directly with
+// the endpoint of each connection. With the flag cleared (the default) this
+// header only declares the API and the calls stay untouched.
+
+typedef enum {
+    NET_IMPAIR_STT = 0,   // WhisperLive WebSocket
+    NET_IMPAIR_LLM,       // DeepSeek (https_client, TLS connections)
+    NET_IMPAIR_TTS,       // Fish Speech (https_client, plain HTTP connections)
+    NET_IMPAIR_ENDPOINT_COUNT
+} net_impair_endpoint_t;
+
+// Impairment applied to one endpoint; all zero = pass-through
+typedef struct {
+    uint32_t latency_ms;         // Added to every connect and send (one way)
+    uint32_t jitter_ms;          // Uniform random extra on top of latency_ms
+    uint32_t bandwidth_bps;      // Cap per direction in bytes/s (0 = unlimited)
+    uint32_t stall_every_ms;     // Mean time between stalls (0 = never)
+    uint32_t stall_ms;           // Length of a stall
+    uint32_t reset_every_ms;     // Mean time between connection resets (0 = never)
+} net_impair_profile_t;
+
+// Counters per endpoint
+typedef struct {
+    uint32_t delayed_ms;         // Total time added by latency, jitter and bandwidth
+    uint32_t stalls;
+    uint32_t resets;
+} net_impair_stats_t;
+
+/**
+ * @brief Replace the impairment profile of an endpoint at runtime
+ */
+void net_impair_set(net_impair_endpoint_t endpoint, const net_impair_profile_t *profile);
+
+/**
+ * @brief Get the counters of an endpoint
+ */
+void net_impair_get_stats(net_impair_endpoint_t endpoint, net_impair_stats_t *stats);
+
+int net_impair_connect(net_impair_endpoint_t endpoint, int s, const struct sockaddr *name, socklen_t namelen);
+int net_impair_send(net_impair_endpoint_t endpoint, int s, const void *data, size_t size, int flags);
+int net_impair_recv(net_impair_endpoint_t endpoint, int s, void *mem, size_t len, int flags);
+
+/**
+ * @brief mbedTLS BIO callbacks for the LLM endpoint (wrap mbedtls_net_send/recv)
+ */
+int net_impair_tls_send(void *ctx, const unsigned char *buf, size_t len);
+int net_impair_tls_recv(void *ctx, unsigned char *buf, size_t len);
+
+#if NET_IMPAIR_ENABLE && defined(NET_IMPAIR_ENDPOINT)
+#undef connect
+#undef send
+#undef recv
+#define connect(s, name, namelen) net_impair_connect(NET_IMPAIR_ENDPOINT, s, name, namelen)
+#define send(s, data, size, flags) net_impair_send(NET_IMPAIR_ENDPOINT, s, data, size, flags)
+#define recv(s, mem, len, flags) net_impair_recv(NET_IMPAIR_ENDPOINT, s, mem, len, flags)
+#endif
+
+#endif // __NET_IMPAIR_H__
@@ -0,0 +1,57 @@
+#include "stt_batch.h"
+#include <string.h>
+
+// EWMA with 1/4 weight for the new sample; the first sample seeds it
+static uint32_t ewma(uint32_t avg, uint32_t sample) {
+    return (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+void stt_batch_init(stt_batch_state_t *state) {
+    memset(state, 0, sizeof(stt_batch_state_t));
+    state->units = STT_BATCH_INITIAL_UNITS;
+}
+
+uint32_t stt_batch_target_bytes(const stt_batch_state_t *state) {
+    return state->units * STT_BATCH_UNIT_BYTES;
+}
+
+void stt_batch_on_sent(stt_batch_state_t *state, uint32_t bytes, uint32_t send_ms, uint32_t now_ms) {
+    state->batches++;
+    state->bytes += bytes;
+    state->send_ms_ewma = ewma(state->send_ms_ewma, send_ms);
+    state->last_sent_ms = now_ms;
+    state->awaiting_transcript = true;
+
+    // Transcript lag ~ half a batch of waiting + send time + server turnaround.
+    // Small batches cut the waiting; they only hurt once the link or the
+    // server can no longer keep up with the higher frame rate.
+    uint32_t batch_ms = state->units * STT_BATCH_UNIT_MS;
+    uint32_t util_pct = state->send_ms_ewma * 100 / batch_ms;
+    bool server_behind = state->turnaround_ms_ewma > 2 * batch_ms;
+
+    if (util_pct > STT_BATCH_GROW_UTIL_PCT || server_behind) {
+        state->vote = (state->vote < 0) ? 1 : state->vote + 1;
+    } else if (util_pct < STT_BATCH_SHRINK_UTIL_PCT && state->turnaround_ms_ewma < batch_ms) {
+        state->vote = (state->vote > 0) ? -1 : state->vote - 1;
+    } else {
+        state->vote = 0;
+    }
+
+    if (state->vote >= STT_BATCH_VOTES && state->units < STT_BATCH_MAX_UNITS) {
+        state->units++;
+        state->grows++;
+        state->vote = 0;
+    } else if (state->vote <= -STT_BATCH_VOTES && state->units > STT_BATCH_MIN_UNITS) {
+        state->units--;
+        state->shrinks++;
+        state->vote = 0;
+    }
+}
+
+void stt_batch_on_transcript(stt_batch_state_t *state, uint32_t now_ms) {
+    if (!state->awaiting_transcript) {
+        return;
+    }
+    state->awaiting_transcript = false;
+    state->turnaround_ms_ewma = ewma(state->turnaround_ms_ewma, now_ms - state->last_sent_ms);
+}
@@ -0,0 +1,64 @@
+#ifndef __STT_BATCH_H__
+#define __STT_BATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "whisper_live_client.h"
+
+// Uplink batch controller configuration
+// Batches are whole WhisperLive chunks (4096 samples = 256 ms at 16 kHz)
+#define STT_BATCH_SAMPLE_RATE 16000
+#define STT_BATCH_UNIT_SAMPLES WHISPER_LIVE_CHUNK_SAMPLES
+#define STT_BATCH_UNIT_MS (STT_BATCH_UNIT_SAMPLES * 1000 / STT_BATCH_SAMPLE_RATE)
+#define STT_BATCH_UNIT_BYTES (STT_BATCH_UNIT_SAMPLES * 2 * 2)   // 16-bit stereo capture
+#define STT_BATCH_MIN_UNITS 1                   // 256 ms
+#define STT_BATCH_MAX_UNITS 4                   // 1024 ms
+#define STT_BATCH_INITIAL_UNITS 2
+#define STT_BATCH_GROW_UTIL_PCT 50              // Grow when a send takes > 50% of the batch duration
+#define STT_BATCH_SHRINK_UTIL_PCT 20            // Shrink when sends take < 20% ...
+#define STT_BATCH_VOTES 2                       // Consistent decisions needed before resizing
+
+// Controller state; also serves as the metrics record
+typedef struct {
+    uint32_t units;                // Current batch size in WhisperLive chunks
+    uint32_t send_ms_ewma;         // EWMA of time to push one batch into the socket
+    uint32_t turnaround_ms_ewma;   // EWMA of batch sent -> next transcript update
+    uint32_t last_sent_ms;         // Completion time of the newest batch
+    bool awaiting_transcript;      // A batch went out and no transcript followed yet
+    int32_t vote;                  // >0 leans to larger batches, <0 to smaller
+    // Metrics
+    uint32_t batches;              // Batches sent
+    uint32_t bytes;                // Capture bytes sent through the controller
+    uint32_t grows;                // Resize decisions towards larger batches
+    uint32_t shrinks;              // Resize decisions towards smaller batches
+} stt_batch_state_t;
+
+/**
+ * @brief Initialize batch controller state
+ */
+void stt_batch_init(stt_batch_state_t *state);
+
+/**
+ * @brief Current batch size
+ * @param state Controller state
+ * @return Capture bytes (16-bit stereo) to accumulate before sending
+ */
+uint32_t stt_batch_target_bytes(const stt_batch_state_t *state);
+
+/**
+ * @brief Record a completed batch send and re-evaluate the batch size
+ * @param state Controller state
+ * @param bytes Capture bytes in the batch
+ * @param send_ms Time the send took
+ * @param now_ms Current time
+ */
+void stt_batch_on_sent(stt_batch_state_t *state, uint32_t bytes, uint32_t send_ms, uint32_t now_ms);
+
+/**
+ * @brief Record a transcript update from the server
+ * @param state Controller state
+ * @param now_ms Time the update was received
+ */
+void stt_batch_on_transcript(stt_batch_state_t *state, uint32_t now_ms);
+
+#endif // __STT_BATCH_H__
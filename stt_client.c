@@ -4,10 +4,14 @@
 #include <stdint.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
+#include "queue.h"
 #include "log.h"
 #include "cJSON.h"
 #include "stt_client.h"
 #include "whisper_live_client.h"
+#include "stt_servers.h"
+#include "config.h"
 
 #define DBG_TAG "STT"
 
@@ -16,6 +20,10 @@ whisper_live_client_t g_whisper_client;
 
 // Initialize STT service
 int stt_init(const char *server_url) {
+    // Primary first so it wins ties, then the configured backups
+    static const char *server_urls[] = { NULL, WHISPERLIVE_WS_BACKUP_URLS };
+    server_urls[0] = server_url;
+
     LOG_I("Initializing STT service with WhisperLive: %s\r\n", server_url);
 
     if (whisper_live_init(&g_whisper_client, server_url) < 0) {
@@ -23,6 +31,18 @@ int stt_init(const char *server_url) {
         return -1;
     }
 
+    if (stt_servers_init(server_urls, sizeof(server_urls) / sizeof(server_urls[0])) < 0) {
+        LOG_E("No STT servers configured\r\n");
+        return -1;
+    }
+
+    int codec = audio_codec_from_name(WHISPERLIVE_AUDIO_CODEC);
+    if (codec < 0) {
+        LOG_W("Unknown uplink codec %s, using float32\r\n", WHISPERLIVE_AUDIO_CODEC);
+        codec = AUDIO_CODEC_FLOAT32;
+    }
+    whisper_live_set_codec(&g_whisper_client, (audio_codec_t)codec);
+
     LOG_I("STT service initialized\r\n");
     return 0;
 }
@@ -42,35 +62,16 @@ int stt_connect(void) {
 
 // Send audio chunk to STT server (real-time streaming)
 // Input: stereo int16 PCM data (L, R, L, R, ...)
-// Output: mono float32 normalized to [-1, 1]
-// Static buffer to avoid malloc - supports up to 1000ms of audio at 16kHz
-#define MAX_FLOAT_SAMPLES (16000 * 1)  // 16000 samples = 1000ms mono
-static float static_float_buffer[MAX_FLOAT_SAMPLES];
-
+// Output: mono float32 normalized to [-1, 1], converted while framing
 int stt_send_audio_chunk(uint8_t *audio_data, uint32_t len) {
     if (!audio_data || len == 0) {
         return -1;
     }
 
     // Input: stereo int16 = len bytes = len/2 samples = len/4 frames
-    int16_t *samples = (int16_t*)audio_data;
-    uint32_t num_stereo_samples = len / 2;  // Total int16 samples
-    uint32_t num_frames = num_stereo_samples / 2;  // Number of L+R pairs
+    uint32_t num_frames = len / 4;  // Number of L+R pairs
 
-    // Check buffer size
-    if (num_frames > MAX_FLOAT_SAMPLES) {
-        LOG_E("Audio chunk too large: %d frames (max %d)\r\n", num_frames, MAX_FLOAT_SAMPLES);
-        return -1;
-    }
-
-    // Convert stereo int16 to mono float32, using left channel only
-    for (uint32_t i = 0; i < num_frames; i++) {
-        static_float_buffer[i] = (float)samples[i * 2] / 32768.0f;  // Left channel only
-    }
-
-    // Send float32 audio data to WhisperLive
-    uint32_t float_len = num_frames * sizeof(float);
-    int sent = whisper_live_send_audio(&g_whisper_client, (uint8_t*)static_float_buffer, float_len);
+    int sent = whisper_live_send_audio_pcm16(&g_whisper_client, (const int16_t*)audio_data, num_frames);
 
     if (sent < 0) {
         LOG_E("Failed to send audio chunk\r\n");
@@ -81,90 +82,397 @@ int stt_send_audio_chunk(uint8_t *audio_data, uint32_t len) {
     return sent;
 }
 
-// Receive transcription from STT server
-int stt_recv_transcription(char *buffer, uint32_t buffer_size, uint32_t timeout_ms) {
-    if (!buffer) {
-        return -1;
-    }
-
-    // Receive raw WebSocket message
-    char raw_buffer[1024];
-    int received = whisper_live_recv_transcription(&g_whisper_client, raw_buffer, sizeof(raw_buffer), timeout_ms);
-
-    if (received > 0) {
-        LOG_I("Received raw message: %s\r\n", raw_buffer);
-
-        // Try to parse as JSON
-        cJSON *json = cJSON_Parse(raw_buffer);
-        if (json) {
-            // WhisperLive returns "segments" array with transcription results
-            cJSON *segments = cJSON_GetObjectItem(json, "segments");
-            if (segments && cJSON_IsArray(segments)) {
-                // Concatenate all segment texts
-                buffer[0] = '\0';
-                int total_len = 0;
-                cJSON *segment;
-                cJSON_ArrayForEach(segment, segments) {
-                    cJSON *text_item = cJSON_GetObjectItem(segment, "text");
-                    if (text_item && cJSON_IsString(text_item)) {
-                        int text_len = strlen(text_item->valuestring);
-                        if (total_len + text_len < buffer_size - 1) {
-                            strcat(buffer, text_item->valuestring);
-                            total_len += text_len;
-                        }
-                    }
-                }
-                if (total_len > 0) {
-                    cJSON_Delete(json);
-                    LOG_I("Parsed segments transcription: %s\r\n", buffer);
-                    return total_len;
-                }
+// ---------------------------------------------------------------------------
+// Transcription events: produced by the session task, consumed by the recorder
+// ---------------------------------------------------------------------------
+
+#define STT_EVENT_QUEUE_LEN 16
+
+static QueueHandle_t event_queue;
+
+// Segment tracking for the current session. Completed segments are stable
+// and kept (keyed by start time) even after the server stops repeating them;
+// the tail is the one segment still being revised. Written by the session task.
+#define STT_MAX_SEGMENTS 32
+#define STT_FINAL_STABLE_MS 1500  // After END_OF_AUDIO, accept a tail unchanged this long
+
+typedef struct {
+    float start;
+    float end;
+    char *text;
+} stt_segment_t;
+
+static stt_segment_t segments_done[STT_MAX_SEGMENTS];
+static uint32_t segments_done_count;
+static char *segment_tail;                // Live tail text, NULL if none
+static uint32_t segments_changed_ms;      // Last time the transcript changed
+static volatile bool eos_sent;            // END_OF_AUDIO sent for this session
+static volatile uint32_t eos_sent_ms;
+static bool final_reported;               // FINAL_READY already pushed
+
+static uint32_t stt_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// WhisperLive formats segment times as strings ("1.234"); accept numbers too
+static float json_seconds(cJSON *item) {
+    if (cJSON_IsNumber(item)) {
+        return (float)item->valuedouble;
+    }
+    if (cJSON_IsString(item)) {
+        return (float)atof(item->valuestring);
+    }
+    return 0.0f;
+}
+
+static void stt_event_push_n(stt_event_type_t type, const char *text, uint32_t text_len, float start, float end) {
+    stt_event_t event;
+
+    if (!event_queue) {
+        return;
+    }
+
+    event.type = type;
+    event.timestamp_ms = stt_now_ms();
+    event.start = start;
+    event.end = end;
+    event.text = NULL;
+    if (text) {
+        event.text = pvPortMalloc(text_len + 1);
+        if (!event.text) {
+            LOG_E("No memory for STT event\r\n");
+            return;
+        }
+        memcpy(event.text, text, text_len);
+        event.text[text_len] = '\0';
+    }
+
+    if (xQueueSend(event_queue, &event, 0) != pdTRUE) {
+        // Consumer is behind: drop the oldest event, transcripts supersede each other
+        stt_event_t dropped;
+        if (xQueueReceive(event_queue, &dropped, 0) == pdTRUE) {
+            stt_event_free(&dropped);
+        }
+        if (xQueueSend(event_queue, &event, 0) != pdTRUE) {
+            stt_event_free(&event);
+        }
+    }
+}
+
+static void stt_event_push(stt_event_type_t type, const char *text, float start, float end) {
+    stt_event_push_n(type, text, text ? strlen(text) : 0, start, end);
+}
+
+static void stt_event_flush(void) {
+    stt_event_t event;
+    while (event_queue && xQueueReceive(event_queue, &event, 0) == pdTRUE) {
+        stt_event_free(&event);
+    }
+}
+
+static char *stt_strndup(const char *text, uint32_t len) {
+    char *copy = pvPortMalloc(len + 1);
+    if (copy) {
+        memcpy(copy, text, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static void stt_segments_reset(void) {
+    for (uint32_t i = 0; i < segments_done_count; i++) {
+        vPortFree(segments_done[i].text);
+    }
+    segments_done_count = 0;
+    if (segment_tail) {
+        vPortFree(segment_tail);
+        segment_tail = NULL;
+    }
+    segments_changed_ms = stt_now_ms();
+    eos_sent = false;
+    final_reported = false;
+}
+
+// Record a completed segment; returns true if it was not known yet
+static bool stt_segment_complete(float start, float end, const char *text) {
+    uint32_t i;
+
+    for (i = 0; i < segments_done_count; i++) {
+        if (segments_done[i].start == start) {
+            if (strcmp(segments_done[i].text, text) == 0) {
+                return false;
+            }
+            // Server revised a completed segment: keep the newest text
+            char *copy = stt_strndup(text, strlen(text));
+            if (copy) {
+                vPortFree(segments_done[i].text);
+                segments_done[i].text = copy;
+                segments_done[i].end = end;
+            }
+            return false;
+        }
+        if (segments_done[i].start > start) {
+            break;
+        }
+    }
+
+    if (segments_done_count == STT_MAX_SEGMENTS) {
+        LOG_W("Segment table full, dropping segment at %.2f s\r\n", start);
+        return false;
+    }
+
+    char *copy = stt_strndup(text, strlen(text));
+    if (!copy) {
+        return false;
+    }
+    memmove(&segments_done[i + 1], &segments_done[i], (segments_done_count - i) * sizeof(stt_segment_t));
+    segments_done[i].start = start;
+    segments_done[i].end = end;
+    segments_done[i].text = copy;
+    segments_done_count++;
+    return true;
+}
+
+// Completed segments in order, then the live tail
+static uint32_t stt_segments_text(char *buffer, uint32_t buffer_size) {
+    uint32_t len = 0;
+
+    buffer[0] = '\0';
+    for (uint32_t i = 0; i <= segments_done_count; i++) {
+        const char *text = (i < segments_done_count) ? segments_done[i].text : segment_tail;
+        if (!text) {
+            continue;
+        }
+        uint32_t text_len = strlen(text);
+        if (len + text_len >= buffer_size) {
+            text_len = buffer_size - 1 - len;
+        }
+        memcpy(buffer + len, text, text_len);
+        len += text_len;
+        buffer[len] = '\0';
+    }
+    return len;
+}
+
+// After END_OF_AUDIO, report the final transcript once: as soon as nothing is
+// left in the tail, or when the tail has stopped changing (force: session ending)
+static void stt_check_final(bool force) {
+    char transcript[STT_TRANSCRIPT_MAX];
+    uint32_t now = stt_now_ms();
+
+    if (!eos_sent || final_reported) {
+        return;
+    }
+    if (segments_done_count == 0 && !segment_tail) {
+        return;  // Nothing heard yet; the caller's timeout decides
+    }
+    if (!force && segment_tail && (now - segments_changed_ms < STT_FINAL_STABLE_MS ||
+                                   now - eos_sent_ms < STT_FINAL_STABLE_MS)) {
+        return;
+    }
+
+    stt_segments_text(transcript, sizeof(transcript));
+    LOG_I("Final transcript (%s, %d ms after END_OF_AUDIO): %s\r\n",
+          segment_tail ? "tail stable" : "all segments completed", now - eos_sent_ms, transcript);
+    stt_event_push(STT_EVENT_FINAL_READY, transcript, 0.0f, 0.0f);
+    final_reported = true;
+}
+
+// Turn one server message into events; deliver=false only logs (idle session)
+// The message is parsed straight out of the WebSocket receive buffer.
+// Returns -1 if the server announced the end of the session
+static int stt_handle_message(const char *raw, uint32_t len, bool deliver) {
+    int ret = 0;
+    cJSON *json = cJSON_ParseWithLength(raw, len);
+
+    if (!json) {
+        // Not JSON, treat as plain text
+        if (deliver) {
+            stt_event_push_n(STT_EVENT_PARTIAL, raw, len, 0.0f, 0.0f);
+        }
+        return 0;
+    }
+
+    // WhisperLive returns "segments" array with transcription results
+    cJSON *segments = cJSON_GetObjectItem(json, "segments");
+    cJSON *text_item = cJSON_GetObjectItem(json, "text");
+    cJSON *msg_item = cJSON_GetObjectItem(json, "message");
+    cJSON *status_item = cJSON_GetObjectItem(json, "status");
+
+    if (segments && cJSON_IsArray(segments)) {
+        char transcript[STT_TRANSCRIPT_MAX];
+        const char *tail = NULL;
+        float end = 0.0f;
+        bool changed = false;
+        cJSON *segment;
+
+        cJSON_ArrayForEach(segment, segments) {
+            cJSON *seg_text = cJSON_GetObjectItem(segment, "text");
+            cJSON *completed = cJSON_GetObjectItem(segment, "completed");
+            float seg_start = json_seconds(cJSON_GetObjectItem(segment, "start"));
+            float seg_end = json_seconds(cJSON_GetObjectItem(segment, "end"));
+
+            if (!seg_text || !cJSON_IsString(seg_text)) {
+                continue;
+            }
+            end = seg_end;
+
+            if (!cJSON_IsTrue(completed)) {
+                tail = seg_text->valuestring;  // Only the last incomplete one matters
+                continue;
             }
 
-            // Look for "text" field (alternative format)
-            cJSON *text_item = cJSON_GetObjectItem(json, "text");
-            if (text_item && cJSON_IsString(text_item)) {
-                strncpy(buffer, text_item->valuestring, buffer_size - 1);
-                buffer[buffer_size - 1] = '\0';
-                cJSON_Delete(json);
-                LOG_I("Parsed transcription: %s\r\n", buffer);
-                return strlen(buffer);
+            // The server repeats completed segments; report each one once
+            tail = NULL;
+            if (deliver && stt_segment_complete(seg_start, seg_end, seg_text->valuestring)) {
+                changed = true;
+                stt_event_push(STT_EVENT_FINAL, seg_text->valuestring, seg_start, seg_end);
             }
+        }
 
-            // Look for "message" field (server status messages) - ignore these
-            cJSON *msg_item = cJSON_GetObjectItem(json, "message");
-            if (msg_item && cJSON_IsString(msg_item)) {
-                LOG_I("Server status (ignoring): %s\r\n", msg_item->valuestring);
-                cJSON_Delete(json);
-                return 0;  // Return 0 to indicate no transcription, not an error
+        if (deliver) {
+            if ((tail == NULL) != (segment_tail == NULL) ||
+                (tail && strcmp(tail, segment_tail) != 0)) {
+                if (segment_tail) {
+                    vPortFree(segment_tail);
+                }
+                segment_tail = tail ? stt_strndup(tail, strlen(tail)) : NULL;
+                changed = true;
+            }
+            if (changed) {
+                segments_changed_ms = stt_now_ms();
             }
 
-            cJSON_Delete(json);
-            LOG_W("JSON does not contain recognized fields\r\n");
-            // Return raw message if no recognized field
-            strncpy(buffer, raw_buffer, buffer_size - 1);
-            buffer[buffer_size - 1] = '\0';
-            return strlen(buffer);
-        } else {
-            // Not JSON, treat as plain text
-            LOG_I("Not JSON, treating as plain text\r\n");
-            strncpy(buffer, raw_buffer, buffer_size - 1);
-            buffer[buffer_size - 1] = '\0';
-            return strlen(buffer);
+            if (stt_segments_text(transcript, sizeof(transcript)) > 0) {
+                LOG_I("Transcript: %s\r\n", transcript);
+                stt_event_push(STT_EVENT_PARTIAL, transcript, 0.0f, end);
+            }
+            stt_check_final(false);
+        }
+    } else if (text_item && cJSON_IsString(text_item)) {
+        // Alternative format
+        if (deliver) {
+            stt_event_push(STT_EVENT_PARTIAL, text_item->valuestring, 0.0f, 0.0f);
+        }
+    } else if (msg_item && cJSON_IsString(msg_item)) {
+        // Server status: SERVER_READY, DISCONNECT, or status + message (WAIT/ERROR/WARNING)
+        LOG_I("Server status: %s%s%s\r\n",
+              (status_item && cJSON_IsString(status_item)) ? status_item->valuestring : "",
+              (status_item && cJSON_IsString(status_item)) ? " " : "",
+              msg_item->valuestring);
+        if (deliver) {
+            stt_event_push(STT_EVENT_STATUS, msg_item->valuestring, 0.0f, 0.0f);
+        }
+        if (strcmp(msg_item->valuestring, "DISCONNECT") == 0) {
+            ret = -1;
         }
-    } else if (received == 0) {
-        LOG_I("Transcription timeout\r\n");
     } else {
-        LOG_E("Failed to receive transcription\r\n");
+        LOG_W("JSON does not contain recognized fields\r\n");
+    }
+
+    cJSON_Delete(json);
+    return ret;
+}
+
+// Wait for the next transcription event
+int stt_event_wait(stt_event_t *event, uint32_t timeout_ms) {
+    if (!event || !event_queue) {
+        return -1;
+    }
+
+    if (xQueueReceive(event_queue, event, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return 0;
+    }
+    return 1;
+}
+
+// Release the text owned by an event
+void stt_event_free(stt_event_t *event) {
+    if (event && event->text) {
+        vPortFree(event->text);
+        event->text = NULL;
+    }
+}
+
+// Receive transcription from STT server
+int stt_recv_transcription(char *buffer, uint32_t buffer_size, uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    stt_event_t event;
+
+    if (!buffer || buffer_size == 0) {
+        return -1;
     }
 
-    return received;
+    // Wait for the next transcript update, skipping segment/status events
+    while (1) {
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        if (elapsed_ms >= timeout_ms) {
+            return 0;
+        }
+
+        int ret = stt_event_wait(&event, timeout_ms - elapsed_ms);
+        if (ret <= 0) {
+            return ret;
+        }
+
+        if (event.type == STT_EVENT_CLOSE) {
+            stt_event_free(&event);
+            return -1;
+        }
+        if (event.type == STT_EVENT_PARTIAL && event.text) {
+            strncpy(buffer, event.text, buffer_size - 1);
+            buffer[buffer_size - 1] = '\0';
+            stt_event_free(&event);
+            return strlen(buffer);
+        }
+        stt_event_free(&event);
+    }
 }
 
 // Send END_OF_AUDIO signal
 int stt_send_end_of_audio(void) {
     LOG_I("Sending END_OF_AUDIO signal\r\n");
-    return whisper_live_send_end_of_audio(&g_whisper_client);
+    eos_sent_ms = stt_now_ms();
+    eos_sent = true;
+    return whisper_live_send_end_of_audio(&g_whisper_client) < 0 ? -1 : 0;
+}
+
+// Wait for the final transcript of the current turn
+int stt_wait_final(char *buffer, uint32_t buffer_size, uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    stt_event_t event;
+
+    if (!buffer || buffer_size == 0) {
+        return -1;
+    }
+    buffer[0] = '\0';
+
+    while (1) {
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        if (elapsed_ms >= timeout_ms) {
+            return 0;  // buffer keeps the latest transcript seen
+        }
+
+        int ret = stt_event_wait(&event, timeout_ms - elapsed_ms);
+        if (ret <= 0) {
+            return ret;
+        }
+
+        int result = 0;
+        if (event.type == STT_EVENT_CLOSE) {
+            result = -1;
+        } else if ((event.type == STT_EVENT_PARTIAL || event.type == STT_EVENT_FINAL_READY) && event.text) {
+            strncpy(buffer, event.text, buffer_size - 1);
+            buffer[buffer_size - 1] = '\0';
+            if (event.type == STT_EVENT_FINAL_READY) {
+                result = strlen(buffer);
+            }
+        }
+        stt_event_free(&event);
+        if (result != 0) {
+            return result;
+        }
+    }
 }
 
 // Disconnect from STT service
@@ -177,3 +485,258 @@ void stt_disconnect(void) {
 bool stt_is_connected(void) {
     return g_whisper_client.connected;
 }
+
+// ---------------------------------------------------------------------------
+// Session manager: keeps a pre-warmed WhisperLive session for the next turn
+// ---------------------------------------------------------------------------
+
+#define STT_SESSION_TASK_STACK 3072
+#define STT_SESSION_TASK_PRIO 10
+#define STT_RX_POLL_MS 200
+#define STT_RETRY_MIN_MS 1000
+#define STT_RETRY_MAX_MS 10000
+
+typedef enum {
+    STT_SESSION_IDLE = 0,    // No connection
+    STT_SESSION_CONNECTING,  // Manager task is connecting
+    STT_SESSION_READY,       // Connected, waiting for a turn
+    STT_SESSION_IN_USE,      // Owned by the recorder
+} stt_session_state_t;
+
+static TaskHandle_t session_task;
+static SemaphoreHandle_t session_lock;
+static SemaphoreHandle_t session_ready;   // Given after every connect attempt
+static volatile stt_session_state_t session_state = STT_SESSION_IDLE;
+static volatile bool session_recycle = false;
+static bool session_dead = false;         // In-use session lost; closed on release
+static stt_session_metrics_t session_metrics;
+
+// Connect to one server and account for it; caller owns the client
+static int session_connect_server(int server) {
+    if (whisper_live_set_server(&g_whisper_client, stt_servers_url(server)) < 0) {
+        return -1;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    int ret = whisper_live_connect(&g_whisper_client);
+    uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+
+    stt_servers_on_session(server, ret == 0);
+    if (ret < 0) {
+        session_metrics.connect_failures++;
+        whisper_live_disconnect(&g_whisper_client);
+        return -1;
+    }
+
+    session_metrics.connects++;
+    session_metrics.server = server;
+    session_metrics.last_connect_ms = elapsed_ms;
+    if (session_metrics.avg_connect_ms == 0) {
+        session_metrics.avg_connect_ms = elapsed_ms;
+    } else {
+        session_metrics.avg_connect_ms = (session_metrics.avg_connect_ms * 7 + elapsed_ms) / 8;
+    }
+    if (elapsed_ms > session_metrics.max_connect_ms) {
+        session_metrics.max_connect_ms = elapsed_ms;
+    }
+
+    LOG_I("STT session ready on %s in %d ms (avg %d ms, max %d ms)\r\n", stt_servers_url(server),
+          elapsed_ms, session_metrics.avg_connect_ms, session_metrics.max_connect_ms);
+    return 0;
+}
+
+// Connect to the best-scoring server; if that fails, fail over to the next
+// best right away instead of waiting out the retry backoff
+static int session_connect_timed(void) {
+    int server = stt_servers_pick(-1);
+    session_metrics.server = -1;
+
+    if (server < 0) {
+        return -1;
+    }
+    if (session_connect_server(server) == 0) {
+        return 0;
+    }
+
+    int backup = stt_servers_pick(server);
+    if (backup < 0) {
+        return -1;
+    }
+    LOG_W("STT server %s failed, trying %s\r\n", stt_servers_url(server), stt_servers_url(backup));
+    if (session_connect_server(backup) < 0) {
+        return -1;
+    }
+    session_metrics.failovers++;
+    return 0;
+}
+
+// Session task: owns connect/close and is the only reader of the socket.
+// PINGs are answered inside whisper_live_recv_message; messages become events.
+static void session_task_fn(void *arg) {
+    uint32_t retry_ms = STT_RETRY_MIN_MS;
+
+    while (1) {
+        xSemaphoreTake(session_lock, portMAX_DELAY);
+
+        if (session_state == STT_SESSION_IN_USE && session_recycle) {
+            // Turn finished: WhisperLive sessions are per utterance, replace it now
+            session_recycle = false;
+            session_dead = false;
+            whisper_live_disconnect(&g_whisper_client);
+            session_state = STT_SESSION_IDLE;
+        }
+
+        if (session_state == STT_SESSION_IDLE) {
+            session_state = STT_SESSION_CONNECTING;
+            xSemaphoreGive(session_lock);
+
+            int ret = session_connect_timed();
+
+            xSemaphoreTake(session_lock, portMAX_DELAY);
+            session_state = (ret == 0) ? STT_SESSION_READY : STT_SESSION_IDLE;
+            stt_segments_reset();
+            xSemaphoreGive(session_lock);
+            xSemaphoreGive(session_ready);
+
+            if (ret == 0) {
+                retry_ms = STT_RETRY_MIN_MS;
+            } else {
+                LOG_W("STT pre-connect failed, retry in %d ms\r\n", retry_ms);
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(retry_ms));
+                retry_ms = (retry_ms * 2 > STT_RETRY_MAX_MS) ? STT_RETRY_MAX_MS : retry_ms * 2;
+            }
+            continue;
+        }
+
+        if (session_dead) {
+            // Lost while in use: wait for the recorder to release it
+            xSemaphoreGive(session_lock);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        xSemaphoreGive(session_lock);
+
+        // Block on the socket; the short timeout keeps release requests responsive
+        whisper_live_msg_t msg;
+        int ret = whisper_live_recv_message(&g_whisper_client, &msg, STT_RX_POLL_MS);
+        bool in_use = (session_state == STT_SESSION_IN_USE);
+        if (in_use) {
+            stt_check_final(false);  // Tail may have become stable without a new message
+        }
+        if (ret == 1) {
+            if (!msg.is_text || stt_handle_message((const char *)msg.data, msg.len, in_use) == 0) {
+                continue;
+            }
+        } else if (ret == WHISPER_LIVE_ERR_OVERSIZE) {
+            continue;  // Already logged and counted by the client; stream stays in sync
+        } else if (ret == 0 && g_whisper_client.connected) {
+            continue;
+        }
+
+        // Peer closed, sent CLOSE/DISCONNECT, or the socket failed
+        xSemaphoreTake(session_lock, portMAX_DELAY);
+        if (session_state == STT_SESSION_IN_USE) {
+            LOG_W("STT session lost during turn\r\n");
+            g_whisper_client.connected = false;  // Fail the recorder's sends fast
+            session_dead = true;
+            stt_check_final(true);  // Server may close right after the last segment
+            stt_event_push(STT_EVENT_CLOSE, NULL, 0.0f, 0.0f);
+        } else {
+            LOG_W("Idle STT session died, reconnecting\r\n");
+            session_metrics.dead_sessions++;
+            whisper_live_disconnect(&g_whisper_client);
+            session_state = STT_SESSION_IDLE;
+        }
+        xSemaphoreGive(session_lock);
+    }
+}
+
+int stt_session_start(void) {
+    if (session_task) {
+        return 0;
+    }
+
+    session_lock = xSemaphoreCreateMutex();
+    session_ready = xSemaphoreCreateBinary();
+    event_queue = xQueueCreate(STT_EVENT_QUEUE_LEN, sizeof(stt_event_t));
+    if (!session_lock || !session_ready || !event_queue) {
+        LOG_E("Failed to create STT session primitives\r\n");
+        return -1;
+    }
+
+    if (xTaskCreate(session_task_fn, "stt_session", STT_SESSION_TASK_STACK, NULL,
+                    STT_SESSION_TASK_PRIO, &session_task) != pdPASS) {
+        LOG_E("Failed to create STT session task\r\n");
+        return -1;
+    }
+
+    stt_servers_start_probe();
+
+    LOG_I("STT session manager started\r\n");
+    return 0;
+}
+
+int stt_session_acquire(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    bool waited = false;
+
+    if (!session_task) {
+        LOG_E("STT session manager not started\r\n");
+        return -1;
+    }
+
+    while (1) {
+        xSemaphoreTake(session_lock, portMAX_DELAY);
+        if (session_state == STT_SESSION_READY && g_whisper_client.connected) {
+            session_state = STT_SESSION_IN_USE;
+            stt_event_flush();  // Nothing from an idle session belongs to this turn
+            xSemaphoreGive(session_lock);
+            if (waited) {
+                session_metrics.acquire_waited++;
+            } else {
+                session_metrics.acquire_ready++;
+            }
+            return 0;
+        }
+        if (session_state == STT_SESSION_IDLE) {
+            // Manager is backing off after a failure; kick it now
+            xTaskNotifyGive(session_task);
+        }
+        xSemaphoreGive(session_lock);
+
+        uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+        if (elapsed_ms >= timeout_ms) {
+            LOG_E("No STT session available after %d ms\r\n", elapsed_ms);
+            return -1;
+        }
+
+        waited = true;
+        xSemaphoreTake(session_ready, pdMS_TO_TICKS(timeout_ms - elapsed_ms));
+    }
+}
+
+bool stt_session_ready(void) {
+    if (!session_task) {
+        return false;
+    }
+
+    xSemaphoreTake(session_lock, portMAX_DELAY);
+    bool ready = (session_state == STT_SESSION_READY && g_whisper_client.connected);
+    xSemaphoreGive(session_lock);
+    return ready;
+}
+
+void stt_session_release(void) {
+    if (!session_task) {
+        return;
+    }
+
+    xSemaphoreTake(session_lock, portMAX_DELAY);
+    session_recycle = true;
+    xSemaphoreGive(session_lock);
+    xTaskNotifyGive(session_task);
+}
+
+void stt_session_get_metrics(stt_session_metrics_t *metrics) {
+    *metrics = session_metrics;
+}
@@ -8,6 +8,39 @@
 // Global WhisperLive client
 extern whisper_live_client_t g_whisper_client;
 
+// Session manager metrics (connect times cover DNS + TCP + handshake + SERVER_READY)
+typedef struct {
+    uint32_t connects;            // Successful (re)connects
+    uint32_t connect_failures;    // Failed connect attempts
+    uint32_t dead_sessions;       // Ready sessions that died while idle
+    uint32_t last_connect_ms;     // Duration of the last successful connect
+    uint32_t avg_connect_ms;      // EWMA of connect duration (1/8 weight)
+    uint32_t max_connect_ms;      // Worst connect duration seen
+    uint32_t acquire_ready;       // Acquires served immediately from a ready session
+    uint32_t acquire_waited;      // Acquires that had to wait for a connect
+    uint32_t failovers;           // Sessions opened on another server after a failure
+    int32_t server;               // Server index of the current session (-1 = none)
+} stt_session_metrics_t;
+
+#define STT_TRANSCRIPT_MAX 512  // Longest running transcript carried by a PARTIAL event
+
+// Transcription events pushed by the session task's receiver
+typedef enum {
+    STT_EVENT_PARTIAL = 0,  // Completed segments plus the live tail; the tail may still change
+    STT_EVENT_FINAL,        // One segment the server marked completed (reported once)
+    STT_EVENT_STATUS,       // Server status message (SERVER_READY, WAIT, WARNING, ...)
+    STT_EVENT_CLOSE,        // Session lost during the turn
+    STT_EVENT_FINAL_READY,  // After END_OF_AUDIO: the complete final transcript
+} stt_event_type_t;
+
+typedef struct {
+    stt_event_type_t type;
+    uint32_t timestamp_ms;  // Tick time the message was received
+    float start;            // Segment start in seconds (FINAL)
+    float end;              // Segment end in seconds (PARTIAL/FINAL)
+    char *text;             // Heap text, NULL for CLOSE; release with stt_event_free()
+} stt_event_t;
+
 /**
  * @brief Initialize STT service (WhisperLive)
  * @param server_url WebSocket server URL (e.g., "ws://192.168.1.151:9090/")
@@ -30,25 +63,99 @@ int stt_connect(void);
 int stt_send_audio_chunk(uint8_t *audio_data, uint32_t len);
 
 /**
- * @brief Receive transcription from STT server (non-blocking with timeout)
+ * @brief Wait for the next transcript update of the current turn
+ *
+ * Convenience wrapper over stt_event_wait() that returns the text of the
+ * next PARTIAL event and skips the others.
+ *
  * @param buffer Buffer to store transcription text
  * @param buffer_size Size of buffer
  * @param timeout_ms Timeout in milliseconds
- * @return Number of bytes received, 0 on timeout, -1 on error
+ * @return Number of bytes received, 0 on timeout, -1 on error or session lost
  */
 int stt_recv_transcription(char *buffer, uint32_t buffer_size, uint32_t timeout_ms);
 
+/**
+ * @brief Wait for the next transcription event of the current turn
+ *
+ * Events are queued only while a session is acquired; the queue is
+ * flushed when the next session is acquired.
+ *
+ * @param event Filled on success; caller must call stt_event_free()
+ * @param timeout_ms Timeout in milliseconds (0 = poll)
+ * @return 1 if an event was returned, 0 on timeout, -1 on error
+ */
+int stt_event_wait(stt_event_t *event, uint32_t timeout_ms);
+
+/**
+ * @brief Release the text owned by an event
+ */
+void stt_event_free(stt_event_t *event);
+
 /**
  * @brief Send END_OF_AUDIO signal to server to trigger final transcription
  * @return 0 on success, -1 on failure
  */
 int stt_send_end_of_audio(void);
 
+/**
+ * @brief Wait for the final transcript after stt_send_end_of_audio()
+ *
+ * Returns as soon as the server has marked every segment completed (or the
+ * remaining tail has stopped changing), instead of polling on a timer.
+ *
+ * @param buffer Receives the final transcript; on timeout, the latest partial
+ * @param buffer_size Size of buffer
+ * @param timeout_ms Timeout in milliseconds
+ * @return Length of the final transcript, 0 on timeout, -1 if the session was lost
+ */
+int stt_wait_final(char *buffer, uint32_t buffer_size, uint32_t timeout_ms);
+
 /**
  * @brief Disconnect from STT service
  */
 void stt_disconnect(void);
 
+/**
+ * @brief Start the session manager
+ *
+ * A background task keeps one WhisperLive session connected and ready,
+ * and reconnects right after each turn so the next trigger does not pay
+ * for the connect. The same task is the only reader of the socket: it
+ * answers pings, notices dead sessions and turns server messages into
+ * transcription events.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int stt_session_start(void);
+
+/**
+ * @brief Take the ready session for a recording turn
+ * @param timeout_ms Maximum time to wait if a (re)connect is in progress
+ * @return 0 when a live session is handed over, -1 on failure
+ */
+int stt_session_acquire(uint32_t timeout_ms);
+
+/**
+ * @brief Check for a ready session without waking the manager
+ *
+ * Unlike stt_session_acquire(), this never cuts a reconnect backoff short,
+ * so it can be polled while the server is down.
+ *
+ * @return true if stt_session_acquire(0) would succeed now
+ */
+bool stt_session_ready(void);
+
+/**
+ * @brief Hand the session back after a turn; it is replaced in the background
+ */
+void stt_session_release(void);
+
+/**
+ * @brief Get session manager metrics
+ */
+void stt_session_get_metrics(stt_session_metrics_t *metrics);
+
 /**
  * @brief Check if STT service is connected
  * @return true if connected
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "log.h"
+#include "whisper_live_client.h"
+#include "stt_servers.h"
+#include "boot_cache.h"
+
+#define DBG_TAG "STT_SRV"
+
+#define STT_PROBE_TASK_STACK 2048   // Handshake buffers live on this stack
+#define STT_PROBE_TASK_PRIO 5
+
+static stt_server_t servers[STT_SERVERS_MAX];
+static uint32_t server_count;
+static SemaphoreHandle_t servers_lock;
+static TaskHandle_t probe_task;
+
+static uint32_t servers_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// EWMA with 1/4 weight for the new sample; the first sample seeds it
+static uint32_t ewma(uint32_t avg, uint32_t sample) {
+    return (avg == 0) ? sample : (avg * 3 + sample) / 4;
+}
+
+static void server_failed(stt_server_t *server) {
+    uint32_t backoff_ms = STT_SERVER_BACKOFF_MIN_MS;
+
+    for (uint32_t i = 0; i < server->fail_streak && backoff_ms < STT_SERVER_BACKOFF_MAX_MS; i++) {
+        backoff_ms *= 2;
+    }
+    if (backoff_ms > STT_SERVER_BACKOFF_MAX_MS) {
+        backoff_ms = STT_SERVER_BACKOFF_MAX_MS;
+    }
+
+    server->fail_streak++;
+    server->down_until_ms = servers_now_ms() + backoff_ms;
+    // A failure costs as much as a timed-out probe
+    server->score_ms = ewma(server->score_ms, STT_PROBE_TIMEOUT_MS);
+}
+
+static void server_ok(stt_server_t *server) {
+    server->fail_streak = 0;
+    server->down_until_ms = 0;
+}
+
+static void server_persist(const stt_server_t *server) {
+    boot_cache_put_endpoint(server->url, server->score_ms, server->fail_streak);
+}
+
+int stt_servers_init(const char *const *urls, uint32_t count) {
+    if (!servers_lock) {
+        servers_lock = xSemaphoreCreateMutex();
+        if (!servers_lock) {
+            return -1;
+        }
+    }
+
+    xSemaphoreTake(servers_lock, portMAX_DELAY);
+    memset(servers, 0, sizeof(servers));
+    server_count = 0;
+    for (uint32_t i = 0; i < count && server_count < STT_SERVERS_MAX; i++) {
+        if (urls[i] && urls[i][0]) {
+            stt_server_t *server = &servers[server_count++];
+            uint32_t score_ms, fail_streak;
+            server->url = urls[i];
+            // Start from the last boot's ranking; a server that was failing
+            // ranks like a timed-out probe until it answers again
+            if (boot_cache_get_endpoint(server->url, &score_ms, &fail_streak)) {
+                server->score_ms = fail_streak ? STT_PROBE_TIMEOUT_MS : score_ms;
+                LOG_I("%s: cached score %d ms\r\n", server->url, server->score_ms);
+            }
+        }
+    }
+    xSemaphoreGive(servers_lock);
+
+    if (count > STT_SERVERS_MAX) {
+        LOG_W("Only the first %d STT servers are used\r\n", STT_SERVERS_MAX);
+    }
+    LOG_I("%d STT server(s) configured\r\n", server_count);
+    return (server_count > 0) ? 0 : -1;
+}
+
+int stt_servers_pick(int exclude) {
+    uint32_t now = servers_now_ms();
+    int best = -1, best_down = -1;
+    uint32_t best_score = 0, best_down_until = 0;
+
+    xSemaphoreTake(servers_lock, portMAX_DELAY);
+    for (uint32_t i = 0; i < server_count; i++) {
+        if ((int)i == exclude) {
+            continue;
+        }
+        stt_server_t *server = &servers[i];
+        if (server->down_until_ms && (int32_t)(server->down_until_ms - now) > 0) {
+            // Backing off; only a candidate if everything else is down too
+            if (best_down < 0 || (int32_t)(server->down_until_ms - best_down_until) < 0) {
+                best_down = i;
+                best_down_until = server->down_until_ms;
+            }
+            continue;
+        }
+        uint32_t score = server->score_ms ? server->score_ms : STT_SERVER_UNMEASURED_MS;
+        if (best < 0 || score < best_score) {
+            best = i;
+            best_score = score;
+        }
+    }
+    xSemaphoreGive(servers_lock);
+
+    return (best >= 0) ? best : best_down;
+}
+
+const char *stt_servers_url(int index) {
+    return (index >= 0 && (uint32_t)index < server_count) ? servers[index].url : NULL;
+}
+
+void stt_servers_on_probe(int index, int latency_ms) {
+    if (index < 0 || (uint32_t)index >= server_count) {
+        return;
+    }
+
+    xSemaphoreTake(servers_lock, portMAX_DELAY);
+    stt_server_t *server = &servers[index];
+    server->probes++;
+    if (latency_ms < 0) {
+        server->probe_failures++;
+        server_failed(server);
+    } else {
+        server->score_ms = ewma(server->score_ms, latency_ms ? latency_ms : 1);
+        server_ok(server);
+    }
+    server_persist(server);
+    xSemaphoreGive(servers_lock);
+}
+
+void stt_servers_on_session(int index, bool ok) {
+    if (index < 0 || (uint32_t)index >= server_count) {
+        return;
+    }
+
+    xSemaphoreTake(servers_lock, portMAX_DELAY);
+    stt_server_t *server = &servers[index];
+    if (ok) {
+        // Session setup includes model warm-up on the server, so it is not a
+        // latency sample; it only proves the server is up
+        server->sessions++;
+        server_ok(server);
+    } else {
+        server->session_failures++;
+        server_failed(server);
+    }
+    server_persist(server);
+    xSemaphoreGive(servers_lock);
+}
+
+uint32_t stt_servers_get(stt_server_t *out) {
+    xSemaphoreTake(servers_lock, portMAX_DELAY);
+    memcpy(out, servers, sizeof(servers));
+    uint32_t count = server_count;
+    xSemaphoreGive(servers_lock);
+    return count;
+}
+
+// Probe task: refresh every server's score so the next session goes to the
+// fastest one, and notice a dead primary before a turn needs it
+static void probe_task_fn(void *arg) {
+    while (1) {
+        for (uint32_t i = 0; i < server_count; i++) {
+            int latency_ms = whisper_live_probe(servers[i].url, STT_PROBE_TIMEOUT_MS);
+            stt_servers_on_probe(i, latency_ms);
+            if (latency_ms < 0) {
+                LOG_W("STT server %s unreachable\r\n", servers[i].url);
+            } else {
+                LOG_I("STT server %s: %d ms (score %d ms)\r\n",
+                      servers[i].url, latency_ms, servers[i].score_ms);
+            }
+        }
+        vTaskDelay(pdMS_TO_TICKS(STT_PROBE_INTERVAL_MS));
+    }
+}
+
+int stt_servers_start_probe(void) {
+    if (probe_task || server_count < 2) {
+        return 0;  // Nothing to choose between with a single server
+    }
+
+    if (xTaskCreate(probe_task_fn, "stt_probe", STT_PROBE_TASK_STACK, NULL,
+                    STT_PROBE_TASK_PRIO, &probe_task) != pdPASS) {
+        LOG_E("Failed to create STT probe task\r\n");
+        return -1;
+    }
+
+    return 0;
+}
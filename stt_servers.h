@@ -0,0 +1,75 @@
+#ifndef __STT_SERVERS_H__
+#define __STT_SERVERS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// STT server selection configuration
+#define STT_SERVERS_MAX 4
+#define STT_PROBE_INTERVAL_MS 15000      // Background latency probe period
+#define STT_PROBE_TIMEOUT_MS 2000        // Connect + handshake limit for a probe
+#define STT_SERVER_UNMEASURED_MS 100     // Score assumed before the first sample
+#define STT_SERVER_BACKOFF_MIN_MS 2000   // Skip a failed server this long...
+#define STT_SERVER_BACKOFF_MAX_MS 60000  // ...doubling per consecutive failure
+
+// Per-server state; also serves as the metrics record
+typedef struct {
+    const char *url;
+    uint32_t score_ms;             // EWMA of connect + handshake latency, 0 = no sample yet
+    uint32_t fail_streak;          // Consecutive failures (probes or sessions)
+    uint32_t down_until_ms;        // Not picked before this time unless all are down
+    // Metrics
+    uint32_t probes;               // Probes attempted
+    uint32_t probe_failures;       // Probes that could not connect or upgrade
+    uint32_t sessions;             // Sessions opened on this server
+    uint32_t session_failures;     // Session connects that failed
+} stt_server_t;
+
+/**
+ * @brief Register the STT servers; the first one wins ties
+ * @param urls WebSocket server URLs
+ * @param count Number of URLs (extra entries beyond STT_SERVERS_MAX are ignored)
+ * @return 0 on success, -1 on error
+ */
+int stt_servers_init(const char *const *urls, uint32_t count);
+
+/**
+ * @brief Start the background latency probe (only with more than one server)
+ * @return 0 on success, -1 on error
+ */
+int stt_servers_start_probe(void);
+
+/**
+ * @brief Pick the server for the next session
+ * @param exclude Server index to skip (-1 for none), e.g. the one that just failed
+ * @return Server index, -1 if there is no candidate
+ */
+int stt_servers_pick(int exclude);
+
+/**
+ * @brief URL of a server
+ */
+const char *stt_servers_url(int index);
+
+/**
+ * @brief Record a probe result
+ * @param index Server index
+ * @param latency_ms Connect + handshake latency, negative on failure
+ */
+void stt_servers_on_probe(int index, int latency_ms);
+
+/**
+ * @brief Record a session connect result
+ * @param index Server index
+ * @param ok Session came up
+ */
+void stt_servers_on_session(int index, bool ok);
+
+/**
+ * @brief Copy the server table
+ * @param servers Array of STT_SERVERS_MAX entries
+ * @return Number of servers
+ */
+uint32_t stt_servers_get(stt_server_t *servers);
+
+#endif // __STT_SERVERS_H__
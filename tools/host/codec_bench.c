@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <sys/types.h>
+
+// Uplink codec check and benchmark: every codec the STT client can
+// negotiate is sent through whisper_live_send_audio_pcm16() exactly as on
+// the device (conversion, masking, send pieces), the frame is captured,
+// decoded and compared with the input, then the encode cost per capture
+// chunk is measured.
+//
+//     make -C tools/host codec_bench && tools/host/codec_bench
+//
+// The client source is built into this file so send() can be replaced by
+// an in-memory sink.
+
+static uint8_t capture[64 * 1024];
+static size_t capture_len;
+static size_t capture_piece_max;  // 0 = discard instead of capturing
+
+static ssize_t bench_send(int fd, const void *buf, size_t len, int flags) {
+    (void)fd;
+    (void)flags;
+    if (capture_piece_max == 0) {
+        return len;
+    }
+    if (len > capture_piece_max) {
+        len = capture_piece_max;  // Partial sends, like a filling TCP send buffer
+    }
+    if (capture_len + len > sizeof(capture)) {
+        return -1;
+    }
+    memcpy(capture + capture_len, buf, len);
+    capture_len += len;
+    return len;
+}
+
+#define send bench_send
+#undef NET_IMPAIR_ENABLE
+#define NET_IMPAIR_ENABLE 0  // Keep the shim from taking the socket calls back
+#include "whisper_live_client.c"
+#undef send
+
+#define BENCH_FRAMES WHISPER_LIVE_CHUNK_SAMPLES  // One capture chunk
+#define BENCH_CHUNK_MS (BENCH_FRAMES * 1000 / 16000)
+#define BENCH_ITERATIONS 2000
+#define BENCH_ADPCM_MIN_SNR_DB 25.0
+
+static int16_t stereo[BENCH_FRAMES * 2];
+
+// Speech-like test signal on the left channel; the right one must be ignored
+static void make_signal(void) {
+    srand(1);
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        double v = 7000 * sin(i * 0.05) + 3000 * sin(i * 0.31) + 600 * sin(i * 1.7) +
+                   (rand() % 401 - 200);
+        stereo[2 * i] = (int16_t)v;
+        stereo[2 * i + 1] = 12345;
+    }
+}
+
+// Unmask the captured frame in place; returns the payload or NULL
+static uint8_t *unmask_capture(uint64_t *payload_len) {
+    uint8_t *p = capture;
+    uint32_t header_len = 2;
+
+    if (capture_len < 2 || p[0] != (0x80 | WS_OPCODE_BINARY) || !(p[1] & 0x80)) {
+        return NULL;
+    }
+    *payload_len = p[1] & 0x7F;
+    if (*payload_len == 126) {
+        *payload_len = ((uint32_t)p[2] << 8) | p[3];
+        header_len = 4;
+    } else if (*payload_len == 127) {
+        *payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            *payload_len = (*payload_len << 8) | p[2 + i];
+        }
+        header_len = 10;
+    }
+    if (capture_len != header_len + 4 + *payload_len) {
+        return NULL;
+    }
+
+    uint8_t *mask = p + header_len;
+    uint8_t *payload = mask + 4;
+    for (uint64_t i = 0; i < *payload_len; i++) {
+        payload[i] ^= mask[i & 3];
+    }
+    return payload;
+}
+
+// Decode the captured frame and compare it with the left channel
+static bool check_codec(whisper_live_client_t *client, double *snr_db) {
+    static int16_t decoded[BENCH_FRAMES + 2];
+    uint64_t len = 0;
+
+    capture_len = 0;
+    capture_piece_max = 700;
+    int sent = whisper_live_send_audio_pcm16(client, stereo, BENCH_FRAMES);
+    uint8_t *payload = unmask_capture(&len);
+    if (!payload || sent != (int)len || len != audio_codec_encoded_size(client->codec, BENCH_FRAMES)) {
+        printf("%s: bad frame (sent %d, payload %d)\n", audio_codec_name(client->codec), sent, (int)len);
+        return false;
+    }
+
+    uint32_t count = BENCH_FRAMES;
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        if (client->codec == AUDIO_CODEC_FLOAT32) {
+            float f;
+            memcpy(&f, payload + 4 * i, 4);
+            decoded[i] = (int16_t)lrintf(f * 32768.0f);
+        } else if (client->codec == AUDIO_CODEC_PCM16) {
+            decoded[i] = (int16_t)(payload[2 * i] | (payload[2 * i + 1] << 8));
+        }
+    }
+    if (client->codec == AUDIO_CODEC_IMA_ADPCM) {
+        count = ima_adpcm_decode_frame(payload, len, decoded);
+    }
+    if (count != BENCH_FRAMES) {
+        printf("%s: decoded %d of %d samples\n", audio_codec_name(client->codec), count, BENCH_FRAMES);
+        return false;
+    }
+
+    double signal = 0, error = 0;
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        double d = decoded[i] - stereo[2 * i];
+        signal += (double)stereo[2 * i] * stereo[2 * i];
+        error += d * d;
+    }
+    *snr_db = error > 0 ? 10 * log10(signal / error) : INFINITY;
+    if (client->codec == AUDIO_CODEC_IMA_ADPCM) {
+        return *snr_db >= BENCH_ADPCM_MIN_SNR_DB;
+    }
+    return error == 0;  // Lossless codecs
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int main(void) {
+    static whisper_live_client_t client;
+    bool ok = true;
+
+    make_signal();
+    memset(&client, 0, sizeof(client));
+    client.connected = true;
+
+    printf("%d-sample chunk (%d ms), %d iterations\n", BENCH_FRAMES, BENCH_CHUNK_MS, BENCH_ITERATIONS);
+    printf("%-10s %8s %8s %10s %10s %s\n", "codec", "bytes", "kB/s", "us/chunk", "SNR dB", "check");
+    for (int codec = 0; codec < AUDIO_CODEC_COUNT; codec++) {
+        double snr_db = 0;
+        client.codec = codec;
+        bool codec_ok = check_codec(&client, &snr_db);
+        ok = ok && codec_ok;
+
+        capture_piece_max = 0;
+        double start = now_us();
+        for (int i = 0; i < BENCH_ITERATIONS; i++) {
+            whisper_live_send_audio_pcm16(&client, stereo, BENCH_FRAMES);
+        }
+        double per_chunk_us = (now_us() - start) / BENCH_ITERATIONS;
+
+        uint32_t bytes = audio_codec_encoded_size(codec, BENCH_FRAMES);
+        printf("%-10s %8d %8d %10.1f %10.1f %s\n", audio_codec_name(codec), bytes,
+               bytes * 1000 / BENCH_CHUNK_MS / 1024, per_chunk_us, snr_db, codec_ok ? "ok" : "FAIL");
+    }
+    return ok ? 0 : 1;
+}
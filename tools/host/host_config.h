@@ -0,0 +1,29 @@
+#ifndef __HOST_CONFIG_H__
+#define __HOST_CONFIG_H__
+
+// Host build configuration: the device's config.h with the backends moved to
+// the stand-in servers (tools/standin_servers.py). Force-included ahead of
+// every source, so later includes of config.h are no-ops.
+
+#include "config.h"
+
+#ifndef STANDIN_HOST
+#define STANDIN_HOST "127.0.0.1"
+#endif
+
+#undef WHISPERLIVE_WS_URL
+#define WHISPERLIVE_WS_URL "ws://" STANDIN_HOST ":19090/"
+#undef DEEPSEEK_API_URL
+#define DEEPSEEK_API_URL "http://" STANDIN_HOST ":18000/v1/chat/completions"
+// The second stand-in LLM port is the hedging backup
+#undef LLM_BACKUP_ENDPOINTS
+#define LLM_BACKUP_ENDPOINTS { "http://" STANDIN_HOST ":18001/v1/chat/completions", "standin-backup", "" }
+#undef TTS_API_URL
+#define TTS_API_URL "http://" STANDIN_HOST ":18080/v1/tts"
+
+// Built in so turn_harness -I can impair each endpoint; the profiles from
+// config.h stay pass-through until it does
+#undef NET_IMPAIR_ENABLE
+#define NET_IMPAIR_ENABLE 1
+
+#endif // __HOST_CONFIG_H__
@@ -0,0 +1,324 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+// Host build of the FreeRTOS subset the client modules use: every task is a
+// detached pthread, semaphores and queues are condition variables, and one
+// tick is one millisecond of CLOCK_MONOTONIC. Priorities are ignored.
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    UBaseType_t count;
+    UBaseType_t max;
+} host_sem_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t waiting;
+} host_queue_t;
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+    host_sem_t *notify;
+} host_task_t;
+
+static __thread host_task_t *current_task;
+
+void *pvPortMalloc(size_t size) {
+    return malloc(size);
+}
+
+void vPortFree(void *p) {
+    free(p);
+}
+
+size_t xPortGetFreeHeapSize(void) {
+    return 8 * 1024 * 1024;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = { ticks / 1000, (ticks % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void taskYIELD(void) {
+    sched_yield();
+}
+
+// Absolute CLOCK_MONOTONIC deadline ticks from now
+static void deadline(struct timespec *ts, TickType_t ticks) {
+    clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec += ticks / 1000;
+    ts->tv_nsec += (ticks % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+static void cond_init(pthread_cond_t *cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// Wait on cond until ready() or the timeout; lock is held on return
+static bool wait_until(pthread_mutex_t *lock, pthread_cond_t *cond, TickType_t ticks,
+                       bool (*ready)(void *), void *obj) {
+    struct timespec ts;
+    if (ticks != portMAX_DELAY) {
+        deadline(&ts, ticks);
+    }
+    while (!ready(obj)) {
+        if (ticks == 0) {
+            return false;
+        }
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(cond, lock);
+        } else if (pthread_cond_timedwait(cond, lock, &ts) == ETIMEDOUT) {
+            return ready(obj);
+        }
+    }
+    return true;
+}
+
+static host_sem_t *sem_create(UBaseType_t max, UBaseType_t initial) {
+    host_sem_t *s = calloc(1, sizeof(host_sem_t));
+    if (!s) {
+        return NULL;
+    }
+    pthread_mutex_init(&s->lock, NULL);
+    cond_init(&s->cond);
+    s->count = initial;
+    s->max = max;
+    return s;
+}
+
+static bool sem_ready(void *obj) {
+    return ((host_sem_t *)obj)->count > 0;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return sem_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return sem_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return sem_create(max_count, initial_count);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    host_sem_t *s = sem;
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->cond);
+    free(s);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    host_sem_t *s = sem;
+    pthread_mutex_lock(&s->lock);
+    bool ok = wait_until(&s->lock, &s->cond, ticks, sem_ready, s);
+    if (ok) {
+        s->count--;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    host_sem_t *s = sem;
+    BaseType_t ret = pdFALSE;
+    pthread_mutex_lock(&s->lock);
+    if (s->count < s->max) {
+        s->count++;
+        ret = pdTRUE;
+        pthread_cond_signal(&s->cond);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return ret;
+}
+
+static bool queue_not_empty(void *obj) {
+    return ((host_queue_t *)obj)->waiting > 0;
+}
+
+static bool queue_not_full(void *obj) {
+    host_queue_t *q = obj;
+    return q->waiting < q->length;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    host_queue_t *q = calloc(1, sizeof(host_queue_t));
+    if (!q) {
+        return NULL;
+    }
+    q->items = malloc(length * item_size);
+    if (!q->items) {
+        free(q);
+        return NULL;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    cond_init(&q->cond);
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+    free(q->items);
+    free(q);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    host_queue_t *q = queue;
+    pthread_mutex_lock(&q->lock);
+    bool ok = wait_until(&q->lock, &q->cond, ticks, queue_not_full, q);
+    if (ok) {
+        UBaseType_t tail = (q->head + q->waiting) % q->length;
+        memcpy(q->items + tail * q->item_size, item, q->item_size);
+        q->waiting++;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    return xQueueSend(queue, item, ticks);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    host_queue_t *q = queue;
+    pthread_mutex_lock(&q->lock);
+    bool ok = wait_until(&q->lock, &q->cond, ticks, queue_not_empty, q);
+    if (ok) {
+        memcpy(item, q->items + q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->length;
+        q->waiting--;
+        pthread_cond_broadcast(&q->cond);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return ok ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    pthread_mutex_lock(&q->lock);
+    q->head = 0;
+    q->waiting = 0;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    host_queue_t *q = queue;
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t n = q->waiting;
+    pthread_mutex_unlock(&q->lock);
+    return n;
+}
+
+static host_task_t *task_alloc(TaskFunction_t fn, void *arg) {
+    host_task_t *t = calloc(1, sizeof(host_task_t));
+    if (!t) {
+        return NULL;
+    }
+    t->fn = fn;
+    t->arg = arg;
+    t->notify = sem_create(0xffffffffUL, 0);
+    if (!t->notify) {
+        free(t);
+        return NULL;
+    }
+    return t;
+}
+
+static void *task_entry(void *arg) {
+    current_task = arg;
+    current_task->fn(current_task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    pthread_t thread;
+    pthread_attr_t attr;
+    (void)name;
+    (void)stack_depth;
+    (void)priority;
+
+    host_task_t *t = task_alloc(fn, arg);
+    if (!t) {
+        return pdFAIL;
+    }
+    if (handle) {
+        *handle = t;
+    }
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    return err ? pdFAIL : pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || task == current_task) {
+        pthread_exit(NULL);
+    }
+    // Deleting another task is not supported on the host; it keeps running
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    if (!current_task) {
+        current_task = task_alloc(NULL, NULL);  // main() or a foreign thread
+    }
+    return current_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    return xSemaphoreGive(((host_task_t *)task)->notify);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    host_sem_t *s = ((host_task_t *)xTaskGetCurrentTaskHandle())->notify;
+
+    pthread_mutex_lock(&s->lock);
+    bool ok = wait_until(&s->lock, &s->cond, ticks, sem_ready, s);
+    uint32_t value = s->count;
+    if (ok) {
+        s->count = clear_on_exit ? 0 : s->count - 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return value;
+}
@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "easyflash.h"
+#include "mbedtls/ssl.h"
+
+// Host build of the platform services below the client modules: mbedTLS as
+// a pass-through over the plain socket (the stand-in servers speak plain
+// HTTP), and EasyFlash environment blobs in memory.
+
+int host_log_verbose;
+
+void mbedtls_net_init(mbedtls_net_context *ctx) {
+    ctx->fd = -1;
+}
+
+void mbedtls_net_free(mbedtls_net_context *ctx) {
+    if (ctx->fd >= 0) {
+        close(ctx->fd);
+        ctx->fd = -1;
+    }
+}
+
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len) {
+    int ret = send(((mbedtls_net_context *)ctx)->fd, buf, len, MSG_NOSIGNAL);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_WRITE
+                                                         : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    return ret;
+}
+
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len) {
+    int ret = recv(((mbedtls_net_context *)ctx)->fd, buf, len, 0);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_WANT_READ
+                                                         : MBEDTLS_ERR_NET_CONN_RESET;
+    }
+    return ret;
+}
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx) {
+    (void)ctx;
+}
+
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx) {
+    (void)ctx;
+}
+
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len) {
+    (void)data;
+    for (size_t i = 0; i < len; i++) {
+        output[i] = (unsigned char)rand();
+    }
+    return 0;
+}
+
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx) {
+    (void)ctx;
+}
+
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx) {
+    (void)ctx;
+}
+
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len) {
+    (void)ctx;
+    (void)f_entropy;
+    (void)p_entropy;
+    (void)custom;
+    (void)len;
+    return 0;
+}
+
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t len) {
+    return mbedtls_entropy_func(p_rng, output, len);
+}
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf) {
+    (void)conf;
+}
+
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf) {
+    (void)conf;
+}
+
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset) {
+    (void)conf;
+    (void)endpoint;
+    (void)transport;
+    (void)preset;
+    return 0;
+}
+
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode) {
+    (void)conf;
+    (void)authmode;
+}
+
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng) {
+    (void)conf;
+    (void)f_rng;
+    (void)p_rng;
+}
+
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets) {
+    (void)conf;
+    (void)use_tickets;
+}
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl) {
+    memset(ssl, 0, sizeof(*ssl));
+}
+
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf) {
+    (void)conf;
+    ssl->state = 0;
+    return 0;
+}
+
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname) {
+    (void)ssl;
+    (void)hostname;
+    return 0;
+}
+
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout) {
+    (void)f_recv_timeout;
+    ssl->p_bio = p_bio;
+    ssl->f_send = f_send;
+    ssl->f_recv = f_recv;
+}
+
+// No handshake on the wire: go straight to application data
+int mbedtls_ssl_handshake_step(mbedtls_ssl_context *ssl) {
+    ssl->state = MBEDTLS_SSL_HANDSHAKE_OVER;
+    return 0;
+}
+
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl) {
+    return mbedtls_ssl_handshake_step(ssl);
+}
+
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len) {
+    return ssl->f_recv(ssl->p_bio, buf, len);
+}
+
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len) {
+    return ssl->f_send(ssl->p_bio, buf, len);
+}
+
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context *ssl) {
+    (void)ssl;
+    return 0;  // Nothing is ever buffered above the socket
+}
+
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl) {
+    (void)ssl;
+    return 0;
+}
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session) {
+    session->valid = 0;
+}
+
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session) {
+    session->valid = 0;
+}
+
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session) {
+    (void)ssl;
+    session->valid = 1;
+    return 0;
+}
+
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session) {
+    ssl->resumed = session->valid;
+    return 0;
+}
+
+int mbedtls_ssl_session_reused(const mbedtls_ssl_context *ssl) {
+    return ssl->resumed;
+}
+
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len,
+                             size_t *olen) {
+    *olen = 1;
+    if (buf_len < 1) {
+        return -1;
+    }
+    buf[0] = (unsigned char)session->valid;
+    return 0;
+}
+
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len) {
+    if (len != 1) {
+        return -1;
+    }
+    session->valid = buf[0];
+    return 0;
+}
+
+// EasyFlash environment blobs, lost at exit
+#define HOST_ENV_MAX 16
+
+typedef struct {
+    char key[32];
+    void *value;
+    size_t len;
+} host_env_t;
+
+static host_env_t env[HOST_ENV_MAX];
+static pthread_mutex_t env_lock = PTHREAD_MUTEX_INITIALIZER;
+
+EfErrCode easyflash_init(void) {
+    return EF_NO_ERR;
+}
+
+size_t ef_get_env_blob(const char *key, void *value_buf, size_t buf_len, size_t *saved_value_len) {
+    size_t n = 0;
+
+    pthread_mutex_lock(&env_lock);
+    if (saved_value_len) {
+        *saved_value_len = 0;
+    }
+    for (int i = 0; i < HOST_ENV_MAX; i++) {
+        if (env[i].value && strcmp(env[i].key, key) == 0) {
+            n = env[i].len < buf_len ? env[i].len : buf_len;
+            memcpy(value_buf, env[i].value, n);
+            if (saved_value_len) {
+                *saved_value_len = env[i].len;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&env_lock);
+    return n;
+}
+
+EfErrCode ef_set_env_blob(const char *key, const void *value_buf, size_t buf_len) {
+    host_env_t *slot = NULL;
+    EfErrCode ret = EF_ENV_FULL;
+
+    if (strlen(key) >= sizeof(env[0].key)) {
+        return EF_ENV_NAME_ERR;
+    }
+    pthread_mutex_lock(&env_lock);
+    for (int i = 0; i < HOST_ENV_MAX && !slot; i++) {
+        if (env[i].value && strcmp(env[i].key, key) == 0) {
+            slot = &env[i];
+        }
+    }
+    for (int i = 0; i < HOST_ENV_MAX && !slot; i++) {
+        if (!env[i].value) {
+            slot = &env[i];
+        }
+    }
+    void *copy = malloc(buf_len ? buf_len : 1);
+    if (slot && copy) {
+        free(slot->value);
+        strcpy(slot->key, key);
+        memcpy(copy, value_buf, buf_len);
+        slot->value = copy;
+        slot->len = buf_len;
+        ret = EF_NO_ERR;
+    } else {
+        free(copy);
+    }
+    pthread_mutex_unlock(&env_lock);
+    return ret;
+}
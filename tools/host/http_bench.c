@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "https_client.h"
+
+// HTTP receive throughput on loopback: the shared streaming engine
+// (https_request_stream) against the per-byte receive path tts_client.c
+// used before it, on a chunked WAV response with random chunk sizes like
+// the TTS server's. recv() calls are counted with the linker's --wrap.
+//
+//     make -C tools/host http_bench && tools/host/http_bench
+
+#define BENCH_BODY_BYTES (4 * 1024 * 1024)
+#define BENCH_CHUNK_MIN 256
+#define BENCH_CHUNK_MAX 4096
+#define BENCH_RUNS 10
+#define BENCH_WAV_HEADER_SIZE 44
+#define BENCH_PLAY_CHUNK_SIZE 4096      // TTS_CHUNK_SIZE
+#define BENCH_RECV_BUF_SIZE 2048        // TTS_RECV_BUF_SIZE
+
+static char *response;
+static size_t response_len;
+static long audio_bytes;                // PCM bytes in one response
+
+static long recv_calls;
+ssize_t __real_recv(int fd, void *buf, size_t len, int flags);
+
+ssize_t __wrap_recv(int fd, void *buf, size_t len, int flags) {
+    recv_calls++;
+    return __real_recv(fd, buf, len, flags);
+}
+
+// One chunked response: WAV header, then silence in random-sized chunks
+static void build_response(void) {
+    static const char head[] = "HTTP/1.1 200 OK\r\nContent-Type: audio/wav\r\n"
+                               "Transfer-Encoding: chunked\r\n\r\n";
+    size_t max = sizeof(head) + BENCH_BODY_BYTES + BENCH_BODY_BYTES / BENCH_CHUNK_MIN * 16 + 64;
+    char *p = response = malloc(max);
+    uint8_t wav[BENCH_WAV_HEADER_SIZE] = { 'R', 'I', 'F', 'F' };
+
+    memcpy(wav + 36, "data", 4);
+    p += sprintf(p, "%s%x\r\n", head, BENCH_WAV_HEADER_SIZE);
+    memcpy(p, wav, sizeof(wav));
+    p += sizeof(wav);
+    p += sprintf(p, "\r\n");
+
+    srand(1);
+    for (long total = 0; total < BENCH_BODY_BYTES;) {
+        int n = BENCH_CHUNK_MIN + rand() % (BENCH_CHUNK_MAX - BENCH_CHUNK_MIN + 1);
+        p += sprintf(p, "%x\r\n", n);
+        memset(p, 0, n);
+        p += n;
+        p += sprintf(p, "\r\n");
+        total += n;
+        audio_bytes += n;
+    }
+    p += sprintf(p, "0\r\n\r\n");
+    response_len = p - response;
+}
+
+// Answers every request on a connection with the same response
+static void *server_conn(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char buf[4096];
+    size_t have = 0;
+
+    while (1) {
+        char *end;
+        buf[have] = '\0';
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            ssize_t r = __real_recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+            if (r <= 0) {
+                close(fd);
+                return NULL;
+            }
+            have += r;
+            buf[have] = '\0';
+        }
+        size_t head_len = end + 4 - buf;
+        char *cl = strstr(buf, "Content-Length:");
+        size_t body_len = cl && cl < end ? strtoul(cl + 15, NULL, 10) : 0;
+        while (have < head_len + body_len) {
+            ssize_t r = __real_recv(fd, buf + have, sizeof(buf) - 1 - have, 0);
+            if (r <= 0) {
+                close(fd);
+                return NULL;
+            }
+            have += r;
+        }
+        memmove(buf, buf + head_len + body_len, have - head_len - body_len);
+        have -= head_len + body_len;
+
+        if (send(fd, response, response_len, MSG_NOSIGNAL) != (ssize_t)response_len) {
+            close(fd);
+            return NULL;
+        }
+    }
+}
+
+static void *server_main(void *arg) {
+    int listen_fd = (int)(intptr_t)arg;
+
+    while (1) {
+        pthread_t thread;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd >= 0 && pthread_create(&thread, NULL, server_conn, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(thread);
+        }
+    }
+    return NULL;
+}
+
+static int start_server(void) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    pthread_t thread;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) < 0 ||
+        pthread_create(&thread, NULL, server_main, (void *)(intptr_t)fd) != 0) {
+        return -1;
+    }
+    return ntohs(addr.sin_port);
+}
+
+// Emulated playback buffer both paths fill
+static char play_buf[BENCH_PLAY_CHUNK_SIZE];
+static int play_pos;
+static long played;
+
+static void play(const char *data, int len) {
+    played += len;
+    while (len > 0) {
+        int n = BENCH_PLAY_CHUNK_SIZE - play_pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(play_buf + play_pos, data, n);
+        play_pos = (play_pos + n) % BENCH_PLAY_CHUNK_SIZE;
+        data += n;
+        len -= n;
+    }
+}
+
+static int recv_line(int fd, char *line, int max) {
+    int pos = 0;
+
+    while (pos < max - 1) {
+        if (recv(fd, line + pos, 1, 0) <= 0) {
+            return -1;
+        }
+        if (line[pos] == '\n' && pos > 0 && line[pos - 1] == '\r') {
+            line[pos - 1] = '\0';
+            return pos - 1;
+        }
+        pos++;
+    }
+    return -1;
+}
+
+// tts_client.c's receive loop before the shared engine, minus I2S: headers
+// and chunk-size lines one byte per recv(), body reads capped at the chunk
+static long per_byte_request(int port) {
+    struct sockaddr_in addr;
+    char header_buf[512];
+    char line[32];
+    int total_header = 0;
+    long got = 0;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return -1;
+    }
+    const char *request = "POST /v1/tts HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                          "Content-Type: application/json\r\nContent-Length: 2\r\n\r\n{}";
+    send(fd, request, strlen(request), 0);
+
+    while (total_header < (int)sizeof(header_buf) - 1) {
+        if (recv(fd, header_buf + total_header, 1, 0) <= 0) {
+            break;
+        }
+        total_header++;
+        if (total_header >= 4 && memcmp(header_buf + total_header - 4, "\r\n\r\n", 4) == 0) {
+            break;
+        }
+    }
+    if (recv_line(fd, line, sizeof(line)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int chunk_remaining = strtol(line, NULL, 16);
+
+    uint8_t wav_header[BENCH_WAV_HEADER_SIZE];
+    int wav_header_read = 0;
+    while (wav_header_read < BENCH_WAV_HEADER_SIZE) {
+        int r = recv(fd, wav_header + wav_header_read, BENCH_WAV_HEADER_SIZE - wav_header_read, 0);
+        if (r <= 0) {
+            close(fd);
+            return -1;
+        }
+        wav_header_read += r;
+    }
+    chunk_remaining -= wav_header_read;
+
+    static char mono_buffer[BENCH_PLAY_CHUNK_SIZE];
+    int mono_pos = 0;
+    while (1) {
+        if (chunk_remaining == 0) {
+            char crlf[2];
+            recv(fd, crlf, 2, 0);
+            if (recv_line(fd, line, sizeof(line)) < 0 || (chunk_remaining = strtol(line, NULL, 16)) == 0) {
+                break;
+            }
+        }
+        int space = BENCH_PLAY_CHUNK_SIZE - mono_pos;
+        int recv_size = space > BENCH_RECV_BUF_SIZE ? BENCH_RECV_BUF_SIZE : space;
+        if (recv_size > chunk_remaining) {
+            recv_size = chunk_remaining;
+        }
+        int r = recv(fd, mono_buffer + mono_pos, recv_size, 0);
+        if (r <= 0) {
+            break;
+        }
+        chunk_remaining -= r;
+        mono_pos += r;
+        got += r;
+        if (mono_pos >= BENCH_PLAY_CHUNK_SIZE) {
+            play(mono_buffer, mono_pos);
+            mono_pos = 0;
+        }
+    }
+    close(fd);
+    return got;
+}
+
+static int on_data(void *ctx, const char *data, int len) {
+    (void)ctx;
+    play(data, len);
+    return 0;
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *name, long bytes, double seconds, long calls) {
+    printf("%-10s %10ld %9.1f %9.1f %10ld %9.1f\n", name, bytes, seconds * 1e3,
+           bytes / seconds / 1e6, calls, (double)bytes / calls);
+}
+
+int main(void) {
+    char url[64];
+    bool ok = true;
+
+    build_response();
+    int port = start_server();
+    if (port < 0 || https_client_init() < 0) {
+        printf("setup failed\n");
+        return 1;
+    }
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/v1/tts", port);
+
+    printf("%d responses of %ld audio bytes in %d-%d byte chunks\n",
+           BENCH_RUNS, audio_bytes, BENCH_CHUNK_MIN, BENCH_CHUNK_MAX);
+    printf("%-10s %10s %9s %9s %10s %9s\n", "path", "bytes", "ms", "MB/s", "recv()", "B/recv");
+
+    long calls = recv_calls;
+    long bytes = 0;
+    double start = now_s();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        long got = per_byte_request(port);
+        ok = ok && got == audio_bytes;
+        bytes += got;
+    }
+    report("per-byte", bytes, now_s() - start, recv_calls - calls);
+
+    calls = recv_calls;
+    played = 0;
+    start = now_s();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        ok = ok && https_request_stream(url, "POST", "Content-Type: application/json\r\n",
+                                        "{}", 2, on_data, NULL) == 200;
+    }
+    report("engine", played, now_s() - start, recv_calls - calls);
+    ok = ok && played == BENCH_RUNS * (audio_bytes + BENCH_WAV_HEADER_SIZE);
+
+    if (!ok) {
+        printf("FAILED: short or failed responses\n");
+    }
+    return ok ? 0 : 1;
+}
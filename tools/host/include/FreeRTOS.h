@@ -0,0 +1,31 @@
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+// Host build: the subset of the FreeRTOS API the client modules use,
+// implemented on pthreads in host_freertos.c (1 tick = 1 ms)
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void *TaskHandle_t;
+typedef void *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xffffffffUL
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define configASSERT(x) ((void)(x))
+
+void *pvPortMalloc(size_t size);
+void vPortFree(void *p);
+size_t xPortGetFreeHeapSize(void);
+
+#endif // __HOST_FREERTOS_H__
@@ -0,0 +1,7 @@
+#ifndef __HOST_BFLB_MTD_H__
+#define __HOST_BFLB_MTD_H__
+
+static inline void bflb_mtd_init(void) {
+}
+
+#endif // __HOST_BFLB_MTD_H__
@@ -0,0 +1,13 @@
+#ifndef __HOST_BFLB_MTIMER_H__
+#define __HOST_BFLB_MTIMER_H__
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t bflb_mtimer_get_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif // __HOST_BFLB_MTIMER_H__
@@ -0,0 +1,24 @@
+#ifndef __HOST_EASYFLASH_H__
+#define __HOST_EASYFLASH_H__
+
+// Host build: environment blobs kept in memory (host_platform.c), as on a
+// device booting with an erased flash
+
+#include <stddef.h>
+
+typedef enum {
+    EF_NO_ERR,
+    EF_ERASE_ERR,
+    EF_READ_ERR,
+    EF_WRITE_ERR,
+    EF_ENV_NAME_ERR,
+    EF_ENV_NAME_EXIST,
+    EF_ENV_FULL,
+    EF_ENV_INIT_FAILED,
+} EfErrCode;
+
+EfErrCode easyflash_init(void);
+size_t ef_get_env_blob(const char *key, void *value_buf, size_t buf_len, size_t *saved_value_len);
+EfErrCode ef_set_env_blob(const char *key, const void *value_buf, size_t buf_len);
+
+#endif // __HOST_EASYFLASH_H__
@@ -0,0 +1,16 @@
+#ifndef __HOST_LOG_H__
+#define __HOST_LOG_H__
+
+#include <stdio.h>
+
+// Errors always, warnings unless host_log_verbose < 0, info only when > 0
+extern int host_log_verbose;
+
+#define HOST_LOG(level, ...) \
+    do { printf("[" level "][%s] ", DBG_TAG); printf(__VA_ARGS__); printf("\n"); } while (0)
+#define LOG_E(...) HOST_LOG("E", __VA_ARGS__)
+#define LOG_W(...) do { if (host_log_verbose >= 0) HOST_LOG("W", __VA_ARGS__); } while (0)
+#define LOG_I(...) do { if (host_log_verbose > 0) HOST_LOG("I", __VA_ARGS__); } while (0)
+#define LOG_D(...) do { } while (0)
+
+#endif // __HOST_LOG_H__
@@ -0,0 +1,21 @@
+#ifndef __HOST_LWIP_SNTP_H__
+#define __HOST_LWIP_SNTP_H__
+
+#include <stdint.h>
+
+// No SNTP on the host: the clock is set by calling sntp_set_time() directly
+#define SNTP_OPMODE_POLL 0
+
+static inline void sntp_setoperatingmode(uint8_t mode) {
+    (void)mode;
+}
+
+static inline void sntp_setservername(uint8_t idx, const char *server) {
+    (void)idx;
+    (void)server;
+}
+
+static inline void sntp_init(void) {
+}
+
+#endif // __HOST_LWIP_SNTP_H__
@@ -0,0 +1,26 @@
+#ifndef __HOST_LWIP_SOCKETS_H__
+#define __HOST_LWIP_SOCKETS_H__
+
+// Host build: lwIP's BSD socket layer is the host's own
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+#define lwip_send send
+#define lwip_recv recv
+#define lwip_connect connect
+#define lwip_shutdown shutdown
+#define lwip_close close
+
+#endif // __HOST_LWIP_SOCKETS_H__
@@ -0,0 +1,12 @@
+#ifndef __HOST_LWIP_TCP_H__
+#define __HOST_LWIP_TCP_H__
+
+#include "sockets.h"
+
+// Sizes from the device's lwipopts.h, used to size send batches (the
+// host's <netinet/tcp.h> has an unrelated TCP_MSS)
+#undef TCP_MSS
+#define TCP_MSS 1360
+#define TCP_SND_BUF (4 * 32 * TCP_MSS)
+
+#endif // __HOST_LWIP_TCP_H__
@@ -0,0 +1,7 @@
+#ifndef __HOST_LWIP_TCPIP_H__
+#define __HOST_LWIP_TCPIP_H__
+
+#define LOCK_TCPIP_CORE()
+#define UNLOCK_TCPIP_CORE()
+
+#endif // __HOST_LWIP_TCPIP_H__
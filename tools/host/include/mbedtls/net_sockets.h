@@ -0,0 +1 @@
+#include "ssl.h"
@@ -0,0 +1,95 @@
+#ifndef __HOST_MBEDTLS_SSL_H__
+#define __HOST_MBEDTLS_SSL_H__
+
+// Host build: a pass-through "TLS" over plain TCP (host_platform.c), so
+// https:// URLs can point at the plain stand-in servers. Declares the
+// mbedTLS 2.x subset https_client.c uses.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MBEDTLS_VERSION_NUMBER 0x021C0000
+
+#define MBEDTLS_ERR_NET_CONN_RESET -0x0050
+#define MBEDTLS_ERR_SSL_TIMEOUT -0x6800
+#define MBEDTLS_ERR_SSL_WANT_READ -0x6900
+#define MBEDTLS_ERR_SSL_WANT_WRITE -0x6880
+#define MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY -0x7880
+
+#define MBEDTLS_NET_PROTO_TCP 0
+#define MBEDTLS_SSL_IS_CLIENT 0
+#define MBEDTLS_SSL_TRANSPORT_STREAM 0
+#define MBEDTLS_SSL_PRESET_DEFAULT 0
+#define MBEDTLS_SSL_VERIFY_NONE 0
+#define MBEDTLS_SSL_SESSION_TICKETS_ENABLED 1
+#define MBEDTLS_SSL_SERVER_CERTIFICATE 3
+#define MBEDTLS_SSL_HANDSHAKE_OVER 16
+
+typedef int mbedtls_ssl_send_t(void *ctx, const unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_t(void *ctx, unsigned char *buf, size_t len);
+typedef int mbedtls_ssl_recv_timeout_t(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+typedef struct {
+    int fd;
+} mbedtls_net_context;
+
+typedef struct {
+    int state;
+    void *p_bio;
+    mbedtls_ssl_send_t *f_send;
+    mbedtls_ssl_recv_t *f_recv;
+    int resumed;
+} mbedtls_ssl_context;
+
+typedef struct {
+    int valid;
+} mbedtls_ssl_session;
+
+typedef struct { int unused; } mbedtls_ssl_config;
+typedef struct { int unused; } mbedtls_entropy_context;
+typedef struct { int unused; } mbedtls_ctr_drbg_context;
+
+void mbedtls_net_init(mbedtls_net_context *ctx);
+void mbedtls_net_free(mbedtls_net_context *ctx);
+int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
+int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len);
+
+void mbedtls_entropy_init(mbedtls_entropy_context *ctx);
+void mbedtls_entropy_free(mbedtls_entropy_context *ctx);
+int mbedtls_entropy_func(void *data, unsigned char *output, size_t len);
+void mbedtls_ctr_drbg_init(mbedtls_ctr_drbg_context *ctx);
+void mbedtls_ctr_drbg_free(mbedtls_ctr_drbg_context *ctx);
+int mbedtls_ctr_drbg_seed(mbedtls_ctr_drbg_context *ctx, int (*f_entropy)(void *, unsigned char *, size_t),
+                          void *p_entropy, const unsigned char *custom, size_t len);
+int mbedtls_ctr_drbg_random(void *p_rng, unsigned char *output, size_t len);
+
+void mbedtls_ssl_config_init(mbedtls_ssl_config *conf);
+void mbedtls_ssl_config_free(mbedtls_ssl_config *conf);
+int mbedtls_ssl_config_defaults(mbedtls_ssl_config *conf, int endpoint, int transport, int preset);
+void mbedtls_ssl_conf_authmode(mbedtls_ssl_config *conf, int authmode);
+void mbedtls_ssl_conf_rng(mbedtls_ssl_config *conf, int (*f_rng)(void *, unsigned char *, size_t), void *p_rng);
+void mbedtls_ssl_conf_session_tickets(mbedtls_ssl_config *conf, int use_tickets);
+
+void mbedtls_ssl_init(mbedtls_ssl_context *ssl);
+void mbedtls_ssl_free(mbedtls_ssl_context *ssl);
+int mbedtls_ssl_setup(mbedtls_ssl_context *ssl, const mbedtls_ssl_config *conf);
+int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname);
+void mbedtls_ssl_set_bio(mbedtls_ssl_context *ssl, void *p_bio, mbedtls_ssl_send_t *f_send,
+                         mbedtls_ssl_recv_t *f_recv, mbedtls_ssl_recv_timeout_t *f_recv_timeout);
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+int mbedtls_ssl_handshake_step(mbedtls_ssl_context *ssl);
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
+int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
+size_t mbedtls_ssl_get_bytes_avail(const mbedtls_ssl_context *ssl);
+int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl);
+
+void mbedtls_ssl_session_init(mbedtls_ssl_session *session);
+void mbedtls_ssl_session_free(mbedtls_ssl_session *session);
+int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl, mbedtls_ssl_session *session);
+int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session);
+int mbedtls_ssl_session_reused(const mbedtls_ssl_context *ssl);
+int mbedtls_ssl_session_save(const mbedtls_ssl_session *session, unsigned char *buf, size_t buf_len,
+                             size_t *olen);
+int mbedtls_ssl_session_load(mbedtls_ssl_session *session, const unsigned char *buf, size_t len);
+
+#endif // __HOST_MBEDTLS_SSL_H__
@@ -0,0 +1,21 @@
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+void taskYIELD(void);
+
+#define taskENTER_CRITICAL() do { } while (0)
+#define taskEXIT_CRITICAL() do { } while (0)
+
+#endif // __HOST_TASK_H__
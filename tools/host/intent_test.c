@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "FreeRTOS.h"
+#include "local_intent.h"
+
+// Local intent matcher test: every utterance must give its intent (or go
+// to the LLM), including recognizer homophones that should still match
+// and near-misses that must not. Then the device actions behind a few of
+// them are checked, and the cost of matching a long utterance is measured.
+//
+//     make -C tools/host intent_test && tools/host/intent_test
+
+#define TEST_MATCH_ITERATIONS 100000
+
+typedef struct {
+    const char *text;
+    local_intent_t intent;
+} intent_case_t;
+
+static const intent_case_t cases[] = {
+    { "停止。", LOCAL_INTENT_STOP },
+    { "停一下吧", LOCAL_INTENT_STOP },
+    { "别说了！", LOCAL_INTENT_STOP },
+    { "把音量调大一点", LOCAL_INTENT_VOLUME_UP },
+    { "声音大一点", LOCAL_INTENT_VOLUME_UP },
+    { "音亮调大", LOCAL_INTENT_VOLUME_UP },              // Homophone of 音量
+    { "大声点", LOCAL_INTENT_VOLUME_UP },
+    { "小声点儿", LOCAL_INTENT_VOLUME_DOWN },
+    { "太吵了", LOCAL_INTENT_VOLUME_DOWN },
+    { "静音", LOCAL_INTENT_VOLUME_MIN },
+    { "音量调到最大", LOCAL_INTENT_VOLUME_MAX },
+    { "现在几点了？", LOCAL_INTENT_TIME },
+    { "请问现在几点钟", LOCAL_INTENT_TIME },
+    { "现在是什么时间", LOCAL_INTENT_TIME },
+    { "今天星期几？", LOCAL_INTENT_DATE },
+    { "今天几号", LOCAL_INTENT_DATE },
+    { "What time is it?", LOCAL_INTENT_TIME },
+    { "换个话题吧", LOCAL_INTENT_FORGET },
+    { "今天天气怎么样", LOCAL_INTENT_NONE },
+    { "听歌", LOCAL_INTENT_NONE },
+    { "为什么声音大一点会失真呢", LOCAL_INTENT_NONE },   // Contains a command, but is a question
+    { "帮我写一首关于停止战争的诗", LOCAL_INTENT_NONE },
+    { "给我讲个笑话", LOCAL_INTENT_NONE },
+    { "你好", LOCAL_INTENT_NONE },
+    { "几点", LOCAL_INTENT_TIME },
+    { "急点了", LOCAL_INTENT_NONE },                     // Short phrases must match as spoken
+    { "太潮了", LOCAL_INTENT_NONE },
+    { "听", LOCAL_INTENT_NONE },
+    { "酸了", LOCAL_INTENT_NONE },
+};
+
+// Device actions the matcher drives
+static int volume = 50;
+static int conv_resets;
+
+void tts_set_volume(int v) {
+    volume = v;
+}
+
+int tts_get_volume(void) {
+    return volume;
+}
+
+void conv_memory_reset(void) {
+    conv_resets++;
+}
+
+void sntp_set_time(uint32_t sntp_time, uint32_t fac);
+
+// Handle text and compare the reply (NULL = LLM, "" = silent)
+static bool check_reply(const char *text, const char *prefix) {
+    char *reply = local_intent_handle(text);
+    bool ok = prefix ? (reply && strncmp(reply, prefix, strlen(prefix)) == 0) : !reply;
+
+    if (!ok) {
+        printf("%s: reply \"%s\", expected %s%s%s\n", text, reply ? reply : "(LLM)",
+               prefix ? "\"" : "", prefix ? prefix : "(LLM)", prefix ? "...\"" : "");
+    }
+    vPortFree(reply);
+    return ok;
+}
+
+static bool check_actions(void) {
+    bool ok = true;
+
+    ok &= check_reply("大声点", "音量65") && volume == 65;
+    ok &= check_reply("音量调到最大", "音量100") && volume == 100;
+    ok &= check_reply("静音", "") && volume == 0;
+    ok &= check_reply("停止", "");
+    ok &= check_reply("换个话题", "好的") && conv_resets == 1;
+
+    // Clock questions go to the LLM until SNTP has set the clock
+    ok &= check_reply("现在几点", NULL);
+    sntp_set_time((uint32_t)time(NULL) + 2208988800u, 0);
+    ok &= check_reply("现在几点", "现在是");
+    ok &= check_reply("今天星期几", "今天是");
+    return ok;
+}
+
+int main(void) {
+    uint32_t failures = 0;
+
+    if (local_intent_init() < 0) {
+        printf("init failed\n");
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        local_intent_t got = local_intent_match(cases[i].text);
+        if (got != cases[i].intent) {
+            printf("%s: intent %d, expected %d\n", cases[i].text, got, cases[i].intent);
+            failures++;
+        }
+    }
+    printf("%d/%d utterances matched as expected\n",
+           (int)(sizeof(cases) / sizeof(cases[0]) - failures), (int)(sizeof(cases) / sizeof(cases[0])));
+
+    if (!check_actions()) {
+        failures++;
+    }
+
+    struct timespec a, b;
+    const char *long_text = "帮我写一首关于停止战争的诗，要押韵，大概八句左右就可以";
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (int i = 0; i < TEST_MATCH_ITERATIONS; i++) {
+        local_intent_match(long_text);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    printf("long utterance: %.2f us per match\n",
+           ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec)) / 1e3 / TEST_MATCH_ITERATIONS);
+
+    return failures ? 1 : 0;
+}
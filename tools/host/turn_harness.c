@@ -0,0 +1,449 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <unistd.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+#include "cJSON.h"
+#include "boot_cache.h"
+#include "dns_cache.h"
+#include "https_client.h"
+#include "stt_client.h"
+#include "deepseek_client.h"
+#include "conv_memory.h"
+#include "tts_client.h"
+#include "tts_queue.h"
+#include "turn_metrics.h"
+#include "net_impair.h"
+#include "config.h"
+
+#define DBG_TAG "HARNESS"
+
+// End-to-end turn harness: drives the client modules through full turns
+// against tools/standin_servers.py and reports per-stage latency
+// distributions over all turns (turn_metrics only keeps the last 64).
+//
+// A turn runs like voice_assistant_task: acquire the pre-warmed STT session,
+// stream an utterance in capture-sized chunks, END_OF_AUDIO, wait for the
+// final transcript, then stream the DeepSeek reply sentence by sentence
+// into tts_queue. Playback is emulated below: the WAV stream is fetched with
+// the same request, and the "speaker" consumes it in real time. The report
+// includes the silence between consecutive sentences of a reply.
+//
+//     python3 tools/standin_servers.py &
+//     make -C tools/host && tools/host/turn_harness -n 300
+//
+// The host build has the second stand-in LLM port as a backup endpoint, so
+// LLM hedging is exercised too; give the primary a slow tail with
+// --llm-tail-pct to see the hedge rate and time saved.
+//
+// The network impairment shim is built in as well: -I gives an endpoint a
+// profile in config.h's order, e.g. 80 ms +-40 ms latency and a 300 ms
+// stall about every 5 s on the TTS server:
+//
+//     tools/host/turn_harness -I tts:80,40,0,5000,300,0
+
+#define HARNESS_SAMPLE_RATE 16000
+#define HARNESS_CHUNK_SAMPLES 4096           // One capture chunk (WhisperLive's chunk size)
+#define HARNESS_WAV_HEADER_SIZE 44
+#define HARNESS_PLAY_BLOCK_BYTES (4 * 1024)  // One DMA buffer (TTS_CHUNK_SIZE)
+#define HARNESS_LOOKAHEAD_BLOCKS 8           // tts_client's block pool (TTS_PCM_BLOCKS)
+#define HARNESS_SESSION_TIMEOUT_MS 10000
+#define HARNESS_FINAL_TIMEOUT_MS 5000
+#define HARNESS_STAGES_MAX 16
+
+static uint32_t turns_wanted = 200;
+static uint32_t utterance_ms = 1500;
+static double speed = 4.0;                   // Audio in and out runs this much faster than real time
+
+static uint32_t *samples[HARNESS_STAGES_MAX];  // Every turn's value of each stage
+static uint32_t sample_count[HARNESS_STAGES_MAX];
+static uint32_t underruns;
+
+static uint32_t now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+// Emulated speaker, modelled on tts_client: each sentence's WAV stream is
+// cut into DMA-sized blocks, a block is queued once full (or at the end of
+// the sentence), and the speaker plays queued blocks back to back until
+// tts_play_end(). Fetching may run HARNESS_LOOKAHEAD_BLOCKS ahead of it.
+typedef struct {
+    uint8_t header[HARNESS_WAV_HEADER_SIZE];
+    uint32_t header_len;
+    uint32_t block_bytes;       // PCM bytes of the block being filled
+    bool queued_first;          // The sentence's first block is queued
+    bool bad_header;
+} harness_player_t;
+
+static bool reply_playing;      // The speaker has had audio this reply
+static uint32_t speaker_end_ms; // When the speaker runs out of queued audio
+
+static uint32_t *gap_samples;   // Silence before every sentence after a reply's first
+static uint32_t gap_count;
+static uint32_t gap_cap;
+
+static uint32_t audio_ms(uint32_t pcm_bytes) {
+    return (uint32_t)(pcm_bytes * 1000.0 / (HARNESS_SAMPLE_RATE * 2) / speed);
+}
+
+static void record_gap(uint32_t gap_ms) {
+    if (gap_count == gap_cap) {
+        uint32_t cap = gap_cap ? gap_cap * 2 : 256;
+        uint32_t *grown = realloc(gap_samples, cap * sizeof(uint32_t));
+        if (!grown) {
+            return;
+        }
+        gap_samples = grown;
+        gap_cap = cap;
+    }
+    gap_samples[gap_count++] = gap_ms;
+}
+
+static void queue_block(harness_player_t *p) {
+    uint32_t now = now_ms();
+    bool first = !p->queued_first;
+
+    if (!reply_playing) {
+        reply_playing = true;
+        speaker_end_ms = now;
+        turn_metrics_mark(TURN_MARK_AUDIO_START);
+    } else if (first) {
+        record_gap((int32_t)(now - speaker_end_ms) > 0 ? now - speaker_end_ms : 0);
+    } else if ((int32_t)(now - speaker_end_ms) > 0) {
+        underruns++;  // The speaker ran dry before this data arrived
+    }
+    if ((int32_t)(now - speaker_end_ms) > 0) {
+        speaker_end_ms = now;
+    }
+    speaker_end_ms += audio_ms(p->block_bytes);
+    p->block_bytes = 0;
+    p->queued_first = true;
+
+    // The block pool is full: wait for the speaker to free one
+    uint32_t ahead_ms = audio_ms(HARNESS_LOOKAHEAD_BLOCKS * HARNESS_PLAY_BLOCK_BYTES);
+    if ((int32_t)(speaker_end_ms - now - ahead_ms) > 0) {
+        vTaskDelay(pdMS_TO_TICKS(speaker_end_ms - now - ahead_ms));
+    }
+}
+
+static int player_on_data(void *ctx, const char *data, int len) {
+    harness_player_t *p = ctx;
+
+    turn_metrics_mark(TURN_MARK_TTS_FIRST_BYTE);
+    while (len > 0 && p->header_len < HARNESS_WAV_HEADER_SIZE) {
+        p->header[p->header_len++] = (uint8_t)*data++;
+        len--;
+        if (p->header_len == HARNESS_WAV_HEADER_SIZE && memcmp(p->header, "RIFF", 4) != 0) {
+            p->bad_header = true;
+            return -1;
+        }
+    }
+
+    while (len > 0) {
+        uint32_t n = HARNESS_PLAY_BLOCK_BYTES - p->block_bytes;
+        if (n > (uint32_t)len) {
+            n = len;
+        }
+        p->block_bytes += n;
+        len -= n;
+        if (p->block_bytes == HARNESS_PLAY_BLOCK_BYTES) {
+            queue_block(p);
+        }
+    }
+    return 0;
+}
+
+// Called by tts_queue's task for every sentence
+int tts_play_sentence(const char *text) {
+    harness_player_t player;
+
+    memset(&player, 0, sizeof(player));
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "text", text);
+    cJSON_AddStringToObject(root, "format", TTS_FORMAT);
+    cJSON_AddNumberToObject(root, "sample_rate", HARNESS_SAMPLE_RATE);
+    char *body = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!body) {
+        return -1;
+    }
+
+    int status = https_request_stream(TTS_API_URL, "POST", "Content-Type: application/json\r\n",
+                                      body, strlen(body), player_on_data, &player);
+    cJSON_free(body);
+
+    // The rest of the sentence, however short, is the last block
+    if (player.block_bytes > 0) {
+        queue_block(&player);
+    }
+    if (status != 200 || player.bad_header) {
+        LOG_E("TTS request failed (status %d)", status);
+        return -1;
+    }
+    return 0;
+}
+
+// Called by tts_queue's task at the end of the reply
+int tts_play_end(void) {
+    uint32_t now = now_ms();
+
+    if (reply_playing && (int32_t)(speaker_end_ms - now) > 0) {
+        vTaskDelay(pdMS_TO_TICKS(speaker_end_ms - now));
+    }
+    reply_playing = false;
+    return 0;
+}
+
+static void on_llm_delta(void *ctx, const char *delta) {
+    (void)ctx;
+    tts_queue_feed(delta);
+}
+
+// Capture-sized chunks of a tone, stereo 16-bit like the I2S buffers
+static bool send_utterance(void) {
+    static int16_t chunk[HARNESS_CHUNK_SAMPLES * 2];
+    uint32_t total = utterance_ms * HARNESS_SAMPLE_RATE / 1000;
+    uint32_t start_ms = now_ms();
+    stt_event_t event;
+
+    for (uint32_t sent = 0; sent < total;) {
+        uint32_t n = total - sent < HARNESS_CHUNK_SAMPLES ? total - sent : HARNESS_CHUNK_SAMPLES;
+        for (uint32_t i = 0; i < n; i++) {
+            int16_t v = (int16_t)(4000 * sin(2 * M_PI * 220 * (sent + i) / HARNESS_SAMPLE_RATE));
+            chunk[2 * i] = v;
+            chunk[2 * i + 1] = v;
+        }
+        if (stt_send_audio_chunk((uint8_t *)chunk, n * 4) < 0) {
+            return false;
+        }
+        sent += n;
+
+        // Partials are not used here, but must not pile up
+        while (stt_event_wait(&event, 0) > 0) {
+            stt_event_free(&event);
+        }
+
+        // Capture pace: the next chunk exists only once it has been spoken
+        uint32_t due_ms = start_ms + (uint32_t)(sent * 1000.0 / HARNESS_SAMPLE_RATE / speed);
+        uint32_t now = now_ms();
+        if ((int32_t)(due_ms - now) > 0) {
+            vTaskDelay(pdMS_TO_TICKS(due_ms - now));
+        }
+    }
+    return true;
+}
+
+static bool run_turn(void) {
+    char transcript[STT_TRANSCRIPT_MAX];
+
+    turn_metrics_begin();
+    if (stt_session_acquire(HARNESS_SESSION_TIMEOUT_MS) < 0) {
+        LOG_E("No STT session");
+        turn_metrics_end();
+        return false;
+    }
+    turn_metrics_mark(TURN_MARK_SESSION);
+
+    bool ok = send_utterance();
+    turn_metrics_mark(TURN_MARK_SPEECH_END);
+    ok = ok && stt_send_end_of_audio() == 0 &&
+         stt_wait_final(transcript, sizeof(transcript), HARNESS_FINAL_TIMEOUT_MS) > 0;
+    turn_metrics_mark(TURN_MARK_TRANSCRIPT);
+    stt_session_release();
+    if (!ok) {
+        LOG_E("No final transcript");
+        turn_metrics_end();
+        return false;
+    }
+
+    tts_queue_begin();
+    char *reply = deepseek_chat_stream(transcript, on_llm_delta, NULL);
+    ok = (tts_queue_finish() == 0) && reply;
+    turn_metrics_mark(TURN_MARK_AUDIO_END);
+    turn_metrics_end();
+    if (reply) {
+        conv_memory_add_turn(transcript, reply);
+        vPortFree(reply);
+    }
+    return ok;
+}
+
+static void record_turn(const uint32_t *counts_before) {
+    turn_stage_stats_t stats[HARNESS_STAGES_MAX];
+    uint32_t n = turn_metrics_get(stats, HARNESS_STAGES_MAX);
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (stats[i].count != counts_before[i]) {
+            samples[i][sample_count[i]++] = stats[i].last_ms;
+        }
+    }
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t n, uint32_t pct) {
+    return n ? sorted[(n - 1) * pct / 100] : 0;
+}
+
+static void report(uint32_t turns, uint32_t failures, uint32_t elapsed_ms) {
+    turn_stage_stats_t stats[HARNESS_STAGES_MAX];
+    uint32_t n = turn_metrics_get(stats, HARNESS_STAGES_MAX);
+
+    printf("\n%d turns (%d failed) in %d s, audio at %.1fx real time, %d playback underruns\n",
+           turns, failures, elapsed_ms / 1000, speed, underruns);
+    llm_hedge_metrics_t hedge;
+    deepseek_get_hedge_metrics(&hedge);
+    printf("LLM hedging: %d of %d requests hedged (%.1f%%), backup won %d, primary won %d, "
+           "%d failovers, %d unhedged (no worker)\n",
+           hedge.hedged, hedge.requests, hedge.requests ? 100.0 * hedge.hedged / hedge.requests : 0.0,
+           hedge.hedge_wins, hedge.primary_wins, hedge.failovers, hedge.unavailable);
+    printf("             saved %d ms total, %d ms per backup win, deadline now %d ms\n",
+           hedge.saved_ms_total, hedge.hedge_wins ? hedge.saved_ms_total / hedge.hedge_wins : 0,
+           hedge.deadline_ms);
+    uint32_t silent = 0;
+    qsort(gap_samples, gap_count, sizeof(uint32_t), compare_u32);
+    for (uint32_t i = 0; i < gap_count; i++) {
+        silent += gap_samples[i] > 0;
+    }
+    printf("Sentence gaps: %d of %d sentence boundaries silent, p50 %d ms, p90 %d ms, max %d ms\n",
+           silent, gap_count, percentile(gap_samples, gap_count, 50),
+           percentile(gap_samples, gap_count, 90), gap_count ? gap_samples[gap_count - 1] : 0);
+    printf("%-12s %6s %7s %7s %7s %7s %7s\n", "stage", "n", "mean", "p50", "p90", "p99", "max");
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t count = sample_count[i];
+        uint64_t sum = 0;
+        qsort(samples[i], count, sizeof(uint32_t), compare_u32);
+        for (uint32_t j = 0; j < count; j++) {
+            sum += samples[i][j];
+        }
+        printf("%-12s %6d %7d %7d %7d %7d %7d\n", stats[i].name, count,
+               count ? (uint32_t)(sum / count) : 0, percentile(samples[i], count, 50),
+               percentile(samples[i], count, 90), percentile(samples[i], count, 99),
+               count ? samples[i][count - 1] : 0);
+    }
+}
+
+static const char *impair_names[NET_IMPAIR_ENDPOINT_COUNT] = {
+    [NET_IMPAIR_STT] = "stt",
+    [NET_IMPAIR_LLM] = "llm",
+    [NET_IMPAIR_TTS] = "tts",
+};
+static bool impaired;
+
+// "endpoint:latency,jitter,bandwidth,stall_every,stall,reset_every"
+static bool parse_impair(const char *arg) {
+    net_impair_profile_t p;
+    char name[8];
+
+    memset(&p, 0, sizeof(p));
+    int n = sscanf(arg, "%7[a-z]:%u,%u,%u,%u,%u,%u", name, &p.latency_ms, &p.jitter_ms,
+                   &p.bandwidth_bps, &p.stall_every_ms, &p.stall_ms, &p.reset_every_ms);
+    if (n < 2) {
+        return false;
+    }
+    for (int i = 0; i < NET_IMPAIR_ENDPOINT_COUNT; i++) {
+        if (strcmp(name, impair_names[i]) == 0) {
+            net_impair_set(i, &p);
+            impaired = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void report_impair(void) {
+    printf("Impairment:");
+    for (int i = 0; i < NET_IMPAIR_ENDPOINT_COUNT; i++) {
+        net_impair_stats_t st;
+        net_impair_get_stats(i, &st);
+        printf("  %s %d ms added, %d stalls, %d resets", impair_names[i], st.delayed_ms,
+               st.stalls, st.resets);
+    }
+    printf("\n");
+}
+
+static void usage(const char *prog) {
+    printf("Usage: %s [-n turns] [-u utterance_ms] [-x speed] [-v]\n"
+           "       [-I stt|llm|tts:latency_ms[,jitter_ms,bandwidth_bps,stall_every_ms,stall_ms,reset_every_ms]]...\n",
+           prog);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:u:x:I:vh")) != -1) {
+        switch (opt) {
+        case 'n':
+            turns_wanted = atoi(optarg);
+            break;
+        case 'u':
+            utterance_ms = atoi(optarg);
+            break;
+        case 'x':
+            speed = atof(optarg);
+            break;
+        case 'I':
+            if (!parse_impair(optarg)) {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'v':
+            host_log_verbose = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (turns_wanted == 0 || utterance_ms == 0 || speed <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < HARNESS_STAGES_MAX; i++) {
+        samples[i] = calloc(turns_wanted, sizeof(uint32_t));
+    }
+
+    boot_cache_init();
+    if (dns_cache_init() < 0 || https_client_init() < 0 || deepseek_client_init() < 0 ||
+        conv_memory_init() < 0 || tts_queue_init() < 0 || stt_init(WHISPERLIVE_WS_URL) < 0 ||
+        stt_session_start() < 0) {
+        LOG_E("Initialization failed");
+        return 1;
+    }
+
+    uint32_t failures = 0;
+    uint32_t start_ms = now_ms();
+    for (uint32_t t = 0; t < turns_wanted; t++) {
+        turn_stage_stats_t before[HARNESS_STAGES_MAX];
+        uint32_t counts[HARNESS_STAGES_MAX];
+        uint32_t n = turn_metrics_get(before, HARNESS_STAGES_MAX);
+        for (uint32_t i = 0; i < n; i++) {
+            counts[i] = before[i].count;
+        }
+
+        if (!run_turn()) {
+            failures++;
+        }
+        record_turn(counts);
+        if ((t + 1) % 50 == 0) {
+            printf("%d/%d turns\n", t + 1, turns_wanted);
+            fflush(stdout);
+        }
+    }
+    report(turns_wanted, failures, now_ms() - start_ms);
+    if (impaired) {
+        report_impair();
+    }
+    return failures ? 2 : 0;
+}
@@ -0,0 +1,214 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+
+// WebSocket receive parser test and throughput benchmark.
+// A scripted frame stream (fragmentation, control frames between
+// fragments, 16- and 64-bit lengths, oversize messages, masked and
+// unmasked frames) is fed to whisper_live_recv_message() in random-sized
+// reads, from single bytes up to a few kB, and every trial must return the
+// same messages. Then a stream of transcript-sized text frames is parsed
+// to measure throughput.
+//
+//     make -C tools/host ws_parser_test && tools/host/ws_parser_test
+//
+// The client source is built into this file so recv()/send() can be
+// replaced by in-memory streams.
+
+#define TEST_TRIALS 200
+#define TEST_BENCH_FRAMES 3000
+#define TEST_BENCH_FRAME_LEN 300      // About one transcript update
+#define TEST_BENCH_READ_MAX 1460      // One TCP segment per recv()
+
+static uint8_t rx_stream[1024 * 1024];
+static size_t rx_stream_len;
+static size_t rx_stream_pos;
+static size_t rx_read_max;
+static size_t tx_bytes;              // PONG frames sent back
+
+static ssize_t test_recv(int fd, void *buf, size_t len, int flags) {
+    (void)fd;
+    (void)flags;
+    if (rx_stream_pos >= rx_stream_len) {
+        errno = EAGAIN;  // Receive timeout
+        return -1;
+    }
+    size_t n = 1 + rand() % rx_read_max;
+    if (n > len) {
+        n = len;
+    }
+    if (n > rx_stream_len - rx_stream_pos) {
+        n = rx_stream_len - rx_stream_pos;
+    }
+    memcpy(buf, rx_stream + rx_stream_pos, n);
+    rx_stream_pos += n;
+    return n;
+}
+
+static ssize_t test_send(int fd, const void *buf, size_t len, int flags) {
+    (void)fd;
+    (void)buf;
+    (void)flags;
+    tx_bytes += len;
+    return len;
+}
+
+#define recv test_recv
+#define send test_send
+#undef NET_IMPAIR_ENABLE
+#define NET_IMPAIR_ENABLE 0  // Keep the shim from taking the socket calls back
+#include "whisper_live_client.c"
+#undef recv
+#undef send
+
+// Append one server frame to the stream
+static void put_frame(bool fin, uint8_t opcode, bool masked, const char *payload, size_t len) {
+    uint8_t *p = rx_stream + rx_stream_len;
+    size_t header_len = 2;
+
+    p[0] = (fin ? 0x80 : 0) | opcode;
+    if (len < 126) {
+        p[1] = len;
+    } else if (len < 65536) {
+        p[1] = 126;
+        p[2] = len >> 8;
+        p[3] = len & 0xFF;
+        header_len = 4;
+    } else {
+        p[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            p[2 + i] = (uint64_t)len >> (56 - 8 * i);
+        }
+        header_len = 10;
+    }
+
+    if (masked) {
+        static const uint8_t mask[4] = { 0x11, 0x22, 0x33, 0x44 };
+        p[1] |= 0x80;
+        memcpy(p + header_len, mask, 4);
+        header_len += 4;
+        for (size_t i = 0; i < len; i++) {
+            p[header_len + i] = payload[i] ^ mask[i & 3];
+        }
+    } else {
+        memcpy(p + header_len, payload, len);
+    }
+    rx_stream_len += header_len + len;
+}
+
+static void reset_client(whisper_live_client_t *client) {
+    memset(client, 0, sizeof(*client));
+    client->socket_fd = -1;
+    client->connected = true;
+    rx_stream_len = 0;
+    rx_stream_pos = 0;
+    tx_bytes = 0;
+}
+
+static bool run_trial(whisper_live_client_t *client, int trial) {
+    static char big[70000];
+    static const char *expected[] = {
+        "T:hello", "T:frag-mented!", "B:bin", "OVERSIZE", "OVERSIZE", "OVERSIZE",
+        "T:xxxxxxxxxxxxxxxx", "T:after",
+    };
+    const int expected_count = sizeof(expected) / sizeof(expected[0]);
+    char got[16][32];
+    uint32_t lens[16];
+    int n = 0;
+    int ret;
+
+    memset(big, 'x', sizeof(big));
+    reset_client(client);
+    rx_read_max = 1 + rand() % 3000;
+
+    put_frame(true, WS_OPCODE_TEXT, false, "hello", 5);
+    put_frame(false, WS_OPCODE_TEXT, false, "frag-", 5);     // Fragmented, PING in between
+    put_frame(true, WS_OPCODE_PING, false, "pg", 2);
+    put_frame(false, WS_OPCODE_CONTINUATION, true, "ment", 4);
+    put_frame(true, WS_OPCODE_CONTINUATION, false, "ed!", 3);
+    put_frame(true, WS_OPCODE_BINARY, true, "bin", 3);
+    put_frame(true, WS_OPCODE_TEXT, false, big, 5000);       // Oversize, 16-bit length
+    put_frame(false, WS_OPCODE_TEXT, false, big, 3000);      // Oversize once reassembled
+    put_frame(true, WS_OPCODE_CONTINUATION, false, big, 3000);
+    put_frame(true, WS_OPCODE_TEXT, false, big, 70000);      // Oversize, 64-bit length
+    put_frame(true, WS_OPCODE_TEXT, false, big, 4000);       // Largest that fits
+    put_frame(true, WS_OPCODE_TEXT, true, "after", 5);
+    put_frame(true, WS_OPCODE_CLOSE, false, "", 0);
+
+    whisper_live_msg_t msg;
+    while (n < 16 && (ret = whisper_live_recv_message(client, &msg, 100)) != -1) {
+        if (ret == 0) {
+            printf("trial %d: unexpected timeout\n", trial);
+            return false;
+        }
+        lens[n] = ret == 1 ? msg.len : 0;
+        if (ret == 1) {
+            snprintf(got[n], sizeof(got[n]), "%s:%.*s", msg.is_text ? "T" : "B",
+                     (int)(msg.len < 16 ? msg.len : 16), msg.data);
+        } else {
+            snprintf(got[n], sizeof(got[n]), "OVERSIZE");
+        }
+        n++;
+    }
+
+    // The PING is answered with a masked 2-byte PONG; CLOSE ends the session
+    bool ok = n == expected_count && !client->connected && tx_bytes == 2 + 4 + 2 && lens[6] == 4000;
+    for (int i = 0; ok && i < n; i++) {
+        ok = strcmp(got[i], expected[i]) == 0;
+    }
+    if (!ok) {
+        printf("trial %d FAILED (reads up to %d bytes, %d bytes sent back):\n",
+               trial, (int)rx_read_max, (int)tx_bytes);
+        for (int i = 0; i < n; i++) {
+            printf("  %-20s %d\n", got[i], lens[i]);
+        }
+    }
+    return ok;
+}
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void benchmark(whisper_live_client_t *client) {
+    static char text[TEST_BENCH_FRAME_LEN];
+    whisper_live_msg_t msg;
+    int count = 0;
+
+    memset(text, 'a', sizeof(text));
+    reset_client(client);
+    for (int i = 0; i < TEST_BENCH_FRAMES; i++) {
+        put_frame(true, WS_OPCODE_TEXT, false, text, sizeof(text));
+    }
+    rx_read_max = TEST_BENCH_READ_MAX;
+
+    double start = now_us();
+    while (whisper_live_recv_message(client, &msg, 100) == 1) {
+        count++;
+    }
+    double elapsed_us = now_us() - start;
+    printf("%d messages of %d bytes: %.1f MB/s, %.2f us per message\n",
+           count, TEST_BENCH_FRAME_LEN, rx_stream_len / elapsed_us, elapsed_us / count);
+}
+
+int main(void) {
+    static whisper_live_client_t client;
+
+    host_log_verbose = -1;  // The oversize messages are dropped with a warning each
+    srand(1);
+    for (int trial = 0; trial < TEST_TRIALS; trial++) {
+        if (!run_trial(&client, trial)) {
+            return 1;
+        }
+    }
+    printf("parser: %d trials ok\n", TEST_TRIALS);
+    benchmark(&client);
+    return 0;
+}
@@ -0,0 +1,385 @@
+#!/usr/bin/env python3
+"""Local stand-ins for the WhisperLive, DeepSeek and Fish-Speech servers.
+
+Lets the client code be driven through full turns (tools/host/turn_harness)
+without the GPU boxes or an API key, with scripted, repeatable timing:
+
+  STT   WhisperLive WebSocket protocol. Partial segments are sent every
+        --stt-partial-ms of received audio, --stt-lag-ms after it arrived;
+        the completed segment follows END_OF_AUDIO after --stt-final-ms.
+  LLM   OpenAI-style /v1/chat/completions, SSE ("stream": true) or a plain
+        JSON reply. First token after --llm-ttft-ms, then one token every
+        --llm-token-ms. --llm-tail-pct of the requests get --llm-tail-ms
+        more before their first token, the slow tail hedging is for.
+        A second port (--llm-backup-port) is the hedging backup, with its
+        own --llm-backup-ttft-ms and no tail.
+  TTS   Fish-Speech /v1/tts: a chunked 16-bit WAV, first byte after
+        --tts-ttfb-ms, streamed at --tts-speed times real time.
+
+Every delay is multiplied by a log-normal factor (--jitter is its sigma), so
+the harness sees a distribution rather than a constant. Only the standard
+library is needed; HTTP connections are kept alive like the real servers.
+
+    python3 standin_servers.py --jitter 0.3 --llm-ttft-ms 600
+    python3 standin_servers.py --llm-tail-pct 10 --llm-tail-ms 3000   # hedging
+
+The default ports match tools/host/host_config.h.
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import math
+import random
+import struct
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+SAMPLE_RATE = 16000
+
+TRANSCRIPTS = [
+    "今天天气怎么样",
+    "给我讲一个简短的笑话",
+    "北京有什么好玩的地方",
+    "帮我想一个晚饭的菜谱",
+    "一公里等于多少米",
+]
+
+REPLIES = [
+    "今天晴转多云，气温二十度左右。出门记得带件外套。",
+    "好的。小明问妈妈为什么要上学，妈妈说因为学校不会来找你。",
+    "可以去故宫和长城看看。晚上再去南锣鼓巷逛逛。",
+    "试试番茄炒蛋配米饭吧。简单又下饭。",
+    "一公里等于一千米。",
+]
+
+
+class Timing:
+    def __init__(self, args):
+        self.args = args
+        self.rng = random.Random(args.seed)
+
+    def delay(self, ms):
+        """Scripted delay in seconds with log-normal jitter."""
+        if ms <= 0:
+            return 0.0
+        factor = math.exp(self.rng.gauss(0.0, self.args.jitter)) if self.args.jitter > 0 else 1.0
+        return ms * factor / 1000.0
+
+
+def log(args, *parts):
+    if args.verbose:
+        print(*parts, flush=True)
+
+
+# --- HTTP/1.1 with keep-alive -------------------------------------------------
+
+async def read_request(reader):
+    """One request: (method, path, headers, body), or None when the peer is gone."""
+    line = await reader.readline()
+    if not line:
+        return None
+    method, path, _ = line.decode("latin-1").split(" ", 2)
+    headers = {}
+    while True:
+        line = await reader.readline()
+        if line in (b"\r\n", b"\n", b""):
+            break
+        key, value = line.decode("latin-1").split(":", 1)
+        headers[key.strip().lower()] = value.strip()
+    body = await reader.readexactly(int(headers.get("content-length", "0")))
+    return method, path, headers, body
+
+
+def chunk(data):
+    return b"%x\r\n" % len(data) + data + b"\r\n"
+
+
+async def send_json(writer, status, obj):
+    body = json.dumps(obj, ensure_ascii=False).encode()
+    writer.write(b"HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                 b"Content-Length: %d\r\n\r\n" % (status, b"OK" if status == 200 else b"Error", len(body)))
+    writer.write(body)
+    await writer.drain()
+
+
+async def serve_http(handler, reader, writer):
+    try:
+        while True:
+            request = await read_request(reader)
+            if request is None:
+                break
+            await handler(writer, *request)
+    except (ConnectionError, asyncio.IncompleteReadError, ValueError):
+        pass
+    finally:
+        writer.close()
+
+
+# --- LLM ----------------------------------------------------------------------
+
+def pick_reply(messages):
+    question = messages[-1]["content"] if messages else ""
+    for i, text in enumerate(TRANSCRIPTS):
+        if text in question:
+            return REPLIES[i]
+    return REPLIES[sum(question.encode()) % len(REPLIES)]
+
+
+async def llm_handler(args, timing, backup, writer, method, path, headers, body):
+    request = json.loads(body)
+    reply = pick_reply(request.get("messages", []))
+    tokens = [reply[i:i + 2] for i in range(0, len(reply), 2)]
+    prompt_tokens = len(body) // 3
+    usage = {"prompt_tokens": prompt_tokens, "completion_tokens": len(tokens),
+             "prompt_cache_hit_tokens": 0}
+
+    if backup:
+        ttft_ms = args.llm_backup_ttft_ms
+    else:
+        ttft_ms = args.llm_ttft_ms
+        if timing.rng.uniform(0, 100) < args.llm_tail_pct:
+            ttft_ms += args.llm_tail_ms
+    await asyncio.sleep(timing.delay(ttft_ms))
+    if not request.get("stream"):
+        await asyncio.sleep(timing.delay(args.llm_token_ms * len(tokens)))
+        await send_json(writer, 200, {"choices": [{"index": 0, "message": {
+            "role": "assistant", "content": reply}, "finish_reason": "stop"}], "usage": usage})
+        log(args, "llm%s: replied" % (" backup" if backup else ""), reply)
+        return
+
+    writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                 b"Transfer-Encoding: chunked\r\n\r\n")
+    for i, token in enumerate(tokens):
+        if i > 0:
+            await asyncio.sleep(timing.delay(args.llm_token_ms))
+        event = {"choices": [{"index": 0, "delta": {"content": token}, "finish_reason": None}]}
+        writer.write(chunk(("data: " + json.dumps(event, ensure_ascii=False) + "\n\n").encode()))
+        await writer.drain()
+    event = {"choices": [], "usage": usage}
+    writer.write(chunk(("data: " + json.dumps(event) + "\n\n").encode()))
+    writer.write(chunk(b"data: [DONE]\n\n") + b"0\r\n\r\n")
+    await writer.drain()
+    log(args, "llm%s: streamed" % (" backup" if backup else ""), reply)
+
+
+# --- TTS ----------------------------------------------------------------------
+
+def wav_header():
+    # Streamed, so the sizes are unknown; Fish-Speech sends 0xFFFFFFFF too
+    return (b"RIFF" + struct.pack("<I", 0xFFFFFFFF) + b"WAVE" +
+            b"fmt " + struct.pack("<IHHIIHH", 16, 1, 1, SAMPLE_RATE, SAMPLE_RATE * 2, 2, 16) +
+            b"data" + struct.pack("<I", 0xFFFFFFFF))
+
+
+def tone(start, count):
+    return b"".join(struct.pack("<h", int(6000 * math.sin(2 * math.pi * 440 * (start + i) / SAMPLE_RATE)))
+                    for i in range(count))
+
+
+async def tts_handler(args, timing, writer, method, path, headers, body):
+    text = json.loads(body).get("text", "")
+    samples = len(text) * args.tts_ms_per_char * SAMPLE_RATE // 1000
+    block = SAMPLE_RATE * args.tts_block_ms // 1000
+
+    await asyncio.sleep(timing.delay(args.tts_ttfb_ms))
+    writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: audio/wav\r\n"
+                 b"Transfer-Encoding: chunked\r\n\r\n")
+    writer.write(chunk(wav_header()))
+    # Paced against a clock: jitter makes single blocks late, not the stream slow
+    loop = asyncio.get_running_loop()
+    start = loop.time()
+    block_s = args.tts_block_ms / args.tts_speed / 1000.0
+    sent = 0
+    while sent < samples:
+        n = min(block, samples - sent)
+        writer.write(chunk(tone(sent, n)))
+        await writer.drain()
+        sent += n
+        due = start + sent / SAMPLE_RATE / args.tts_speed
+        late = timing.delay(args.tts_block_ms / args.tts_speed) - block_s
+        await asyncio.sleep(max(0.0, due + late - loop.time()))
+    writer.write(b"0\r\n\r\n")
+    await writer.drain()
+    log(args, "tts: %d ms of audio for" % (samples * 1000 // SAMPLE_RATE), text)
+
+
+# --- STT (WhisperLive) ----------------------------------------------------------
+
+async def ws_read(reader):
+    """One frame: (opcode, payload). Client frames are always masked."""
+    b0, b1 = await reader.readexactly(2)
+    length = b1 & 0x7F
+    if length == 126:
+        length = struct.unpack(">H", await reader.readexactly(2))[0]
+    elif length == 127:
+        length = struct.unpack(">Q", await reader.readexactly(8))[0]
+    mask = await reader.readexactly(4) if b1 & 0x80 else b"\0\0\0\0"
+    data = await reader.readexactly(length)
+    key = (mask * (length // 4 + 1))[:length]
+    data = (int.from_bytes(data, "big") ^ int.from_bytes(key, "big")).to_bytes(length, "big")
+    return b0 & 0x0F, data
+
+
+def ws_frame(opcode, payload):
+    n = len(payload)
+    if n < 126:
+        head = struct.pack(">BB", 0x80 | opcode, n)
+    elif n < 65536:
+        head = struct.pack(">BBH", 0x80 | opcode, 126, n)
+    else:
+        head = struct.pack(">BBQ", 0x80 | opcode, 127, n)
+    return head + payload
+
+
+def audio_samples(codec, payload):
+    if codec == "pcm16":
+        return len(payload) // 2
+    if codec == "adpcm":
+        return 2 * max(0, len(payload) - 4)
+    return len(payload) // 4
+
+
+class SttSession:
+    def __init__(self, args, timing, writer, transcript):
+        self.args = args
+        self.timing = timing
+        self.writer = writer
+        self.uid = "standin"
+        self.codec = "float32"
+        self.transcript = transcript
+        self.samples = 0
+        self.next_partial = args.stt_partial_ms * SAMPLE_RATE // 1000
+        self.pending = set()
+        self.last_at = 0.0
+
+    def send(self, obj):
+        self.writer.write(ws_frame(0x1, json.dumps(obj, ensure_ascii=False).encode()))
+
+    def segment(self, completed):
+        seconds = self.samples / SAMPLE_RATE
+        chars = len(self.transcript) if completed else min(
+            len(self.transcript), int(seconds * self.args.stt_chars_per_s))
+        return {"uid": self.uid, "segments": [{
+            "start": "0.000", "end": "%.3f" % seconds,
+            "text": self.transcript[:chars], "completed": completed}]}
+
+    def later(self, seconds, message):
+        # Messages leave in order, like a server working through its queue
+        loop = asyncio.get_event_loop()
+        at = max(loop.time() + seconds, self.last_at)
+        self.last_at = at
+
+        async def run():
+            await asyncio.sleep(at - loop.time())
+            self.send(message)
+            await self.writer.drain()
+        task = asyncio.ensure_future(run())
+        self.pending.add(task)
+        task.add_done_callback(self.pending.discard)
+
+    def on_config(self, payload):
+        config = json.loads(payload)
+        self.uid = config.get("uid", self.uid)
+        ready = {"uid": self.uid, "message": "SERVER_READY", "backend": "standin"}
+        if config.get("audio_codec") in ("pcm16", "adpcm"):
+            self.codec = config["audio_codec"]
+            ready["audio_codec"] = self.codec
+        self.later(self.timing.delay(self.args.stt_ready_ms), ready)
+
+    def on_audio(self, payload):
+        if payload == b"END_OF_AUDIO":
+            self.later(self.timing.delay(self.args.stt_final_ms), self.segment(True))
+            log(self.args, "stt: final", self.transcript)
+            return
+        self.samples += audio_samples(self.codec, payload)
+        if self.samples >= self.next_partial and self.samples * 1000 // SAMPLE_RATE > 0:
+            self.next_partial += self.args.stt_partial_ms * SAMPLE_RATE // 1000
+            self.later(self.timing.delay(self.args.stt_lag_ms), self.segment(False))
+
+
+async def stt_connection(args, timing, counter, reader, writer):
+    try:
+        request = await read_request(reader)
+        if request is None:
+            return
+        key = request[2].get("sec-websocket-key", "")
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        writer.write(("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\n"
+                      "Connection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n" % accept).encode())
+        await writer.drain()
+
+        transcript = TRANSCRIPTS[counter[0] % len(TRANSCRIPTS)]
+        counter[0] += 1
+        session = SttSession(args, timing, writer, transcript)
+        configured = False
+        while True:
+            opcode, payload = await ws_read(reader)
+            if opcode == 0x8:
+                writer.write(ws_frame(0x8, payload[:2]))
+                await writer.drain()
+                break
+            if opcode == 0x9:
+                writer.write(ws_frame(0xA, payload))
+            elif opcode == 0x1 and not configured:
+                session.on_config(payload)
+                configured = True
+            elif opcode == 0x2:
+                session.on_audio(payload)
+            await writer.drain()
+    except (ConnectionError, asyncio.IncompleteReadError, ValueError):
+        pass
+    finally:
+        writer.close()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--stt-port", type=int, default=19090)
+    parser.add_argument("--llm-port", type=int, default=18000)
+    parser.add_argument("--llm-backup-port", type=int, default=18001)
+    parser.add_argument("--tts-port", type=int, default=18080)
+    parser.add_argument("--stt-ready-ms", type=float, default=50)
+    parser.add_argument("--stt-partial-ms", type=int, default=500, help="audio time between partials")
+    parser.add_argument("--stt-lag-ms", type=float, default=150, help="delay of each partial")
+    parser.add_argument("--stt-final-ms", type=float, default=250, help="END_OF_AUDIO to final")
+    parser.add_argument("--stt-chars-per-s", type=float, default=4.0)
+    parser.add_argument("--llm-ttft-ms", type=float, default=500)
+    parser.add_argument("--llm-token-ms", type=float, default=30)
+    parser.add_argument("--llm-tail-pct", type=float, default=0, help="requests with a slow first token")
+    parser.add_argument("--llm-tail-ms", type=float, default=3000, help="extra first-token delay of those")
+    parser.add_argument("--llm-backup-ttft-ms", type=float, default=700)
+    parser.add_argument("--tts-ttfb-ms", type=float, default=300)
+    parser.add_argument("--tts-speed", type=float, default=4.0, help="multiple of real time")
+    parser.add_argument("--tts-ms-per-char", type=int, default=200, help="audio per character")
+    parser.add_argument("--tts-block-ms", type=int, default=100)
+    parser.add_argument("--jitter", type=float, default=0.2, help="sigma of the log-normal delay factor")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    timing = Timing(args)
+    counter = [0]
+    servers = [
+        await asyncio.start_server(lambda r, w: stt_connection(args, timing, counter, r, w),
+                                   args.host, args.stt_port),
+        await asyncio.start_server(lambda r, w: serve_http(
+            lambda *a: llm_handler(args, timing, False, *a), r, w), args.host, args.llm_port),
+        await asyncio.start_server(lambda r, w: serve_http(
+            lambda *a: llm_handler(args, timing, True, *a), r, w), args.host, args.llm_backup_port),
+        await asyncio.start_server(lambda r, w: serve_http(
+            lambda *a: tts_handler(args, timing, *a), r, w), args.host, args.tts_port),
+    ]
+    print("Stand-ins: STT ws://%s:%d/  LLM http://%s:%d (backup :%d)  TTS http://%s:%d" % (
+        args.host, args.stt_port, args.host, args.llm_port, args.llm_backup_port,
+        args.host, args.tts_port), flush=True)
+    await asyncio.gather(*(s.serve_forever() for s in servers))
+
+
+if __name__ == "__main__":
+    try:
+        asyncio.run(main())
+    except KeyboardInterrupt:
+        pass
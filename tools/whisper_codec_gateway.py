@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""WhisperLive codec gateway.
+
+Sits between the device and a stock WhisperLive server. The device offers an
+uplink codec in its session config ("audio_codec": "pcm16" | "adpcm"); the
+gateway confirms it in SERVER_READY, decodes every binary audio frame back to
+float32 and forwards it upstream. Everything else is relayed unchanged.
+
+    pip install websockets numpy
+    python3 whisper_codec_gateway.py --listen 0.0.0.0:9091 --upstream ws://127.0.0.1:9090/
+
+Then point WHISPERLIVE_WS_URL at the gateway.
+"""
+
+import argparse
+import asyncio
+import json
+
+import numpy as np
+import websockets
+
+IMA_INDEX = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+IMA_STEP = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767,
+]
+ADPCM_HEADER_SIZE = 4
+
+
+def decode_adpcm(frame: bytes) -> np.ndarray:
+    """Decode one self-contained IMA ADPCM frame (see audio_codec.h)."""
+    predictor = int.from_bytes(frame[0:2], "little", signed=True)
+    index = min(frame[2], 88)
+    out = np.empty(2 * (len(frame) - ADPCM_HEADER_SIZE), dtype=np.int16)
+    n = 0
+    for byte in frame[ADPCM_HEADER_SIZE:]:
+        for nibble in (byte & 0x0F, byte >> 4):
+            step = IMA_STEP[index]
+            diff = step >> 3
+            if nibble & 4:
+                diff += step
+            if nibble & 2:
+                diff += step >> 1
+            if nibble & 1:
+                diff += step >> 2
+            predictor += -diff if nibble & 8 else diff
+            predictor = max(-32768, min(32767, predictor))
+            index = max(0, min(88, index + IMA_INDEX[nibble]))
+            out[n] = predictor
+            n += 1
+    return out
+
+
+def to_float32(codec: str, payload: bytes) -> bytes:
+    if codec == "pcm16":
+        samples = np.frombuffer(payload, dtype="<i2")
+    elif codec == "adpcm":
+        samples = decode_adpcm(payload)
+    else:
+        return payload
+    return (samples.astype(np.float32) / 32768.0).tobytes()
+
+
+async def relay(device, upstream_url):
+    config_msg = await device.recv()
+    config = json.loads(config_msg)
+    codec = config.pop("audio_codec", "float32")
+    if codec not in ("float32", "pcm16", "adpcm"):
+        codec = "float32"
+
+    async with websockets.connect(upstream_url, max_size=None) as server:
+        await server.send(json.dumps(config))
+
+        async def uplink():
+            async for msg in device:
+                if isinstance(msg, bytes) and msg != b"END_OF_AUDIO":
+                    msg = to_float32(codec, msg)
+                await server.send(msg)
+
+        async def downlink():
+            async for msg in server:
+                if isinstance(msg, str):
+                    try:
+                        data = json.loads(msg)
+                    except ValueError:
+                        data = None
+                    if isinstance(data, dict) and data.get("message") == "SERVER_READY":
+                        data["audio_codec"] = codec
+                        msg = json.dumps(data)
+                await device.send(msg)
+
+        tasks = [asyncio.ensure_future(uplink()), asyncio.ensure_future(downlink())]
+        await asyncio.wait(tasks, return_when=asyncio.FIRST_COMPLETED)
+        for task in tasks:
+            task.cancel()
+
+
+async def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--listen", default="0.0.0.0:9091")
+    parser.add_argument("--upstream", default="ws://127.0.0.1:9090/")
+    args = parser.parse_args()
+
+    host, port = args.listen.rsplit(":", 1)
+    async with websockets.serve(lambda ws, *_: relay(ws, args.upstream), host, int(port), max_size=None):
+        await asyncio.Future()
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
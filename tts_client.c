@@ -5,16 +5,16 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "semphr.h"
+#include "queue.h"
 #include "log.h"
 #include "cJSON.h"
 #include "config.h"
+#include "turn_metrics.h"
 #include "bsp_es8388.h"
 #include "bflb_i2s.h"
 #include "bflb_dma.h"
 #include "bflb_l1c.h"
-
-#include <lwip/sockets.h>
-#include <lwip/netdb.h>
+#include "https_client.h"
 
 #define DBG_TAG "TTS"
 
@@ -23,7 +23,20 @@
 #define TTS_CHUNK_SIZE (4 * 1024)        // 4KB per buffer (mono PCM) = 2048 samples (128ms at 16kHz)
 #define TTS_STEREO_CHUNK_SIZE (8 * 1024) // 8KB stereo buffer = 2048 stereo frames
 #define TTS_NUM_BUFFERS 2                // Double buffering
-#define TTS_RECV_BUF_SIZE 2048           // Network receive buffer
+#define TTS_WAV_HEADER_SIZE 44           // Canonical RIFF/WAVE header
+
+// Pop suppression is done on the PCM, not through the codec volume
+#define TTS_FADE_SAMPLES 256             // 16ms linear fade at 16kHz
+#define TTS_PLAYBACK_VOLUME 50           // Codec output volume during playback until changed
+
+// Fetching runs ahead of playback: the response of the next sentence is
+// received into a pool of mono blocks while the current one plays
+#define TTS_PCM_BLOCKS 8                 // 8 x 4KB = 1 s of 16kHz audio held ahead of the speaker
+#define TTS_BLOCK_WAIT_MS 5000           // Pool still full after this: playback is stuck
+#define TTS_DMA_TIMEOUT_MS 1000
+#define TTS_PLAY_END_TIMEOUT_MS 5000
+#define TTS_PLAYER_TASK_STACK 2048
+#define TTS_PLAYER_TASK_PRIO 16          // Above the voice task; it only refills the DMA
 
 // External I2S and DMA handles (defined in main.c)
 extern struct bflb_device_s *i2s0;
@@ -47,13 +60,53 @@ static int16_t *stereo_buffers[TTS_NUM_BUFFERS] = {stereo_buffer_0, stereo_buffe
 // DMA LLI pool
 static struct bflb_dma_channel_lli_pool_s tx_llipool[20];
 
-// DMA completion flag (for interrupt-based playback)
-static volatile bool dma_transfer_done = false;
+// DMA completion, given by the interrupt
+static SemaphoreHandle_t dma_done;
+static volatile TickType_t dma_done_tick;
+static int playback_volume = TTS_PLAYBACK_VOLUME;
+
+// What the fetcher hands the playback task
+typedef enum {
+    TTS_BLOCK_PCM = 0,          // Full block of the current sentence
+    TTS_BLOCK_LAST,             // Final block of a sentence, possibly empty; gets the fade-out
+    TTS_BLOCK_REPLY_END,        // No more sentences: return the codec to recording
+} tts_block_kind_t;
+
+typedef struct {
+    int16_t *pcm;               // Pool block, NULL for TTS_BLOCK_REPLY_END
+    uint16_t samples;
+    uint8_t kind;
+    bool first;                 // First block of a sentence; gets the fade-in
+    uint32_t sample_rate;
+} tts_block_t;
+
+static QueueHandle_t play_queue;        // tts_block_t, fetcher -> playback task
+static QueueHandle_t free_blocks;       // int16_t * of the pool, playback task -> fetcher
+static SemaphoreHandle_t reply_played;  // Given once the codec is back in recording mode
+static TaskHandle_t player_task;
 
 // DMA interrupt callback
 static void tts_dma_isr(void *arg)
 {
-    dma_transfer_done = true;
+    BaseType_t woken = pdFALSE;
+
+    dma_done_tick = xTaskGetTickCountFromISR();
+    xSemaphoreGiveFromISR(dma_done, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+// Apply a linear Q15 gain ramp in place
+// fade_in ramps 0 -> 1 over the first TTS_FADE_SAMPLES samples,
+// otherwise ramps 1 -> 0 over the last TTS_FADE_SAMPLES samples
+static void pcm_fade(int16_t *samples, uint32_t num_samples, bool fade_in)
+{
+    uint32_t n = (num_samples < TTS_FADE_SAMPLES) ? num_samples : TTS_FADE_SAMPLES;
+    int16_t *p = fade_in ? samples : samples + (num_samples - n);
+
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t gain = (int32_t)(((fade_in ? i : (n - 1 - i)) << 15) / n);
+        p[i] = (int16_t)((p[i] * gain) >> 15);
+    }
 }
 
 // Convert mono to stereo in place (source buffer to destination buffer)
@@ -65,13 +118,13 @@ static void mono_to_stereo(int16_t *mono, int16_t *stereo, uint32_t mono_samples
     }
 }
 
-
-
 // Non-blocking play buffer - starts DMA and returns immediately
 static void play_buffer_non_blocking(int16_t *buffer, uint32_t len)
 {
+    turn_metrics_mark(TURN_MARK_AUDIO_START);  // Only the first buffer of a turn counts
+
     // Reset completion flag
-    dma_transfer_done = false;
+    xSemaphoreTake(dma_done, 0);
 
     // Attach interrupt (must do this every time after mode switch)
     bflb_dma_channel_irq_attach(dma0_ch1, tts_dma_isr, NULL);
@@ -92,63 +145,17 @@ static void play_buffer_non_blocking(int16_t *buffer, uint32_t len)
     bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, I2S_CMD_DATA_ENABLE_TX);
 }
 
-
-// Parse URL to extract host, port, path
-static int parse_tts_url(const char *url, char *host, int *port, char *path)
+static void wait_buffer_played(void)
 {
-    // Format: http://host:port/path
-    if (strncmp(url, "http://", 7) != 0) {
-        return -1;
-    }
-
-    const char *host_start = url + 7;
-    const char *port_start = strchr(host_start, ':');
-    const char *path_start = strchr(host_start, '/');
-
-    if (!port_start || !path_start) {
-        return -1;
+    if (xSemaphoreTake(dma_done, pdMS_TO_TICKS(TTS_DMA_TIMEOUT_MS)) != pdTRUE) {
+        LOG_W("DMA wait timeout\r\n");
     }
-
-    int host_len = port_start - host_start;
-    strncpy(host, host_start, host_len);
-    host[host_len] = '\0';
-
-    *port = atoi(port_start + 1);
-    strcpy(path, path_start);
-
-    return 0;
 }
 
-// Streaming TTS synthesis and playback
-int tts_synthesize_and_play_streaming(const char *text)
+// Codec and DMA into playback mode, once per reply. The codec comes up at a
+// fixed volume; the fade-in on the first PCM buffer takes care of the pop.
+static void playback_open(void)
 {
-    if (!text || strlen(text) == 0) {
-        LOG_E("Text is empty\r\n");
-        return -1;
-    }
-
-    LOG_I("Streaming TTS: %s\r\n", text);
-
-    int sockfd = -1;
-    char *recv_buf = NULL;
-    char *mono_buffer = NULL;
-    int result = -1;
-
-    // Allocate buffers (network buffers can use PSRAM)
-    recv_buf = pvPortMalloc(TTS_RECV_BUF_SIZE);
-    mono_buffer = pvPortMalloc(TTS_CHUNK_SIZE);
-
-    if (!recv_buf || !mono_buffer) {
-        LOG_E("Failed to allocate buffers\r\n");
-        goto cleanup;
-    }
-
-    // Check DMA channel is available (initialized in main.c)
-    if (!dma0_ch1) {
-        LOG_E("DMA channel not initialized\r\n");
-        goto cleanup;
-    }
-
     // Stop any ongoing DMA transfer first
     bflb_dma_channel_stop(dma0_ch1);
 
@@ -166,164 +173,181 @@ int tts_synthesize_and_play_streaming(const char *text)
     };
     bflb_dma_channel_init(dma0_ch1, &dma_config);
 
-    LOG_I("DMA TX configured for streaming\r\n");
-
-    // Parse URL
-    char host[64];
-    char path[128];
-    int port;
-
-    if (parse_tts_url(TTS_API_URL, host, &port, path) < 0) {
-        LOG_E("Failed to parse TTS URL\r\n");
-        goto cleanup;
-    }
-
-    // Create JSON request body
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "text", text);
-    cJSON_AddStringToObject(root, "format", TTS_FORMAT);
-    cJSON_AddNumberToObject(root, "chunk_length", 200);
-    cJSON_AddBoolToObject(root, "normalize", true);
-    // Request 16kHz audio to match speaker hardware and avoid distortion
-    cJSON_AddNumberToObject(root, "sample_rate", 16000);
-    cJSON_AddNumberToObject(root, "mp3_bitrate", 192);  // Increased from 64 to 192 for better quality
-    cJSON_AddNumberToObject(root, "opus_bitrate", -1000);
-    cJSON_AddItemToObject(root, "references", cJSON_CreateArray());
-
-    // Add reference_id if configured (for voice selection)
-    #ifdef TTS_REFERENCE_ID
-    cJSON_AddStringToObject(root, "reference_id", TTS_REFERENCE_ID);
-    #endif
+    switch_es8388_mode(ES8388_PLAY_BACK_MODE);
+    ES8388_Set_Voice_Volume(playback_volume);
+    LOG_I("Playback started\r\n");
+}
 
-    char *body = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
+// Back to recording once the last buffer of the reply has played
+static void playback_close(void)
+{
+    // Stop DMA and I2S
+    bflb_dma_channel_stop(dma0_ch1);
+    bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, 0);
 
-    if (!body) {
-        LOG_E("Failed to create JSON body\r\n");
-        goto cleanup;
-    }
+    // Restore I2S sample rate to recording rate (16kHz)
+    set_i2s_sample_rate(RECORDING_SAMPLE_RATE);
 
-    int body_len = strlen(body);
+    // Switch back to recording mode
+    switch_es8388_mode(ES8388_RECORDING_MODE);
+    bflb_i2s_link_rxdma(i2s0, true);
+}
 
-    // Create socket
-    sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sockfd < 0) {
-        LOG_E("Failed to create socket\r\n");
-        vPortFree(body);
-        goto cleanup;
-    }
+// Playback task: turns fetched blocks into stereo DMA buffers, ping-ponging
+// between two so one converts while the other plays. Sentences follow each
+// other without leaving playback mode; each fades in and out on its own,
+// since the next one may arrive late.
+static void tts_player_fn(void *arg)
+{
+    tts_block_t b;
+    bool open = false;           // Codec in playback mode
+    bool dma_busy = false;       // A buffer is playing
+    int fill_idx = 0;
+    int16_t last_sample = 0;     // Last sample handed to DMA, start of a padded fade-out
+    uint32_t rate = 0;
+    uint32_t sentences = 0;
+    uint32_t gap_total_ms = 0;
+    uint32_t gap_max_ms = 0;
 
-    // Set socket timeout
-    struct timeval tv_timeout;
-    tv_timeout.tv_sec = 60;
-    tv_timeout.tv_usec = 0;
-    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv_timeout, sizeof(tv_timeout));
-
-    // Connect
-    struct hostent *server = gethostbyname(host);
-    if (!server) {
-        LOG_E("Failed to resolve host\r\n");
-        vPortFree(body);
-        goto cleanup;
-    }
+    while (1) {
+        xQueueReceive(play_queue, &b, portMAX_DELAY);
 
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-    server_addr.sin_port = htons(port);
-
-    LOG_I("Connecting to %s:%d...\r\n", host, port);
-    if (connect(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_E("Failed to connect\r\n");
-        vPortFree(body);
-        goto cleanup;
-    }
+        if (b.kind == TTS_BLOCK_REPLY_END) {
+            if (dma_busy) {
+                wait_buffer_played();
+                dma_busy = false;
+            }
+            if (open) {
+                playback_close();
+                LOG_I("Reply played: %d sentences, gaps %d ms total, %d ms max\r\n",
+                      sentences, gap_total_ms, gap_max_ms);
+            }
+            open = false;
+            rate = 0;
+            sentences = 0;
+            gap_total_ms = 0;
+            gap_max_ms = 0;
+            xSemaphoreGive(reply_played);
+            continue;
+        }
 
-    LOG_I("Connected! Sending request...\r\n");
-
-    // Send HTTP request
-    char request_header[512];
-    int header_len = sprintf(request_header,
-        "POST %s HTTP/1.1\r\n"
-        "Host: %s\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %d\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        path, host, body_len);
-
-    send(sockfd, request_header, header_len, 0);
-    send(sockfd, body, body_len, 0);
-    vPortFree(body);
+        // The speaker ran dry waiting for this block; between sentences
+        // that is the gap the look-ahead is meant to hide
+        if (dma_busy && xSemaphoreTake(dma_done, 0) == pdTRUE) {
+            dma_busy = false;
+            if (b.first && sentences > 0) {
+                uint32_t gap_ms = (xTaskGetTickCount() - dma_done_tick) * portTICK_PERIOD_MS;
+                gap_total_ms += gap_ms;
+                if (gap_ms > gap_max_ms) {
+                    gap_max_ms = gap_ms;
+                }
+            }
+        }
 
-    LOG_I("Request sent, waiting for response...\r\n");
+        if (!open) {
+            playback_open();
+            open = true;
+        }
+        if (b.first && b.sample_rate != rate) {
+            if (dma_busy) {
+                wait_buffer_played();
+                dma_busy = false;
+            }
+            // Set I2S sample rate to match TTS audio
+            set_i2s_sample_rate(b.sample_rate);
+            // Clear TX FIFO to avoid any stale data
+            bflb_i2s_feature_control(i2s0, I2S_CMD_CLEAR_TX_FIFO, 0);
+            bflb_i2s_link_txdma(i2s0, true);
+            rate = b.sample_rate;
+        }
 
-    // Read HTTP headers first
-    int header_end = 0;
-    int total_header = 0;
-    char header_buf[512];
+        // A fade needs TTS_FADE_SAMPLES to ramp over: a short final block
+        // holds its last sample for the rest of the ramp, so the fade-out
+        // brings it down to zero gradually
+        uint32_t n = b.samples;
+        if (b.kind == TTS_BLOCK_LAST && n < TTS_FADE_SAMPLES && !(b.first && n == 0)) {
+            if (n > 0) {
+                last_sample = b.pcm[n - 1];
+            }
+            for (uint32_t i = n; i < TTS_FADE_SAMPLES; i++) {
+                b.pcm[i] = last_sample;
+            }
+            n = TTS_FADE_SAMPLES;
+        }
+        if (n == 0) {
+            xQueueSend(free_blocks, &b.pcm, 0);  // A sentence without audio
+            continue;
+        }
+        if (b.first) {
+            pcm_fade(b.pcm, n, true);
+        }
+        if (b.kind == TTS_BLOCK_LAST) {
+            pcm_fade(b.pcm, n, false);
+        }
+        last_sample = b.pcm[n - 1];
 
-    while (total_header < sizeof(header_buf) - 1) {
-        int r = recv(sockfd, header_buf + total_header, 1, 0);
-        if (r <= 0) break;
-        total_header++;
+        // Convert to stereo, and the mono block is free again
+        mono_to_stereo(b.pcm, stereo_buffers[fill_idx], n);
+        xQueueSend(free_blocks, &b.pcm, 0);
 
-        // Check for end of headers
-        if (total_header >= 4 &&
-            header_buf[total_header-4] == '\r' && header_buf[total_header-3] == '\n' &&
-            header_buf[total_header-2] == '\r' && header_buf[total_header-1] == '\n') {
-            header_end = 1;
-            break;
+        if (dma_busy) {
+            wait_buffer_played();
+        }
+        play_buffer_non_blocking(stereo_buffers[fill_idx], n * 4);
+        dma_busy = true;
+        fill_idx = (fill_idx + 1) % TTS_NUM_BUFFERS;
+        if (b.first) {
+            sentences++;
         }
     }
+}
 
-    if (!header_end) {
-        LOG_E("Failed to receive HTTP headers\r\n");
-        goto cleanup;
-    }
+// Fetch state of one sentence, carried across body callbacks
+typedef struct {
+    uint8_t wav_header[TTS_WAV_HEADER_SIZE];
+    int wav_header_read;
+    bool started;              // WAV header parsed
+    int skip;                  // Header bytes past the first 44 before the PCM data
+    uint32_t sample_rate;
+    int16_t *block;            // Pool block being filled
+    int block_pos;             // Bytes in block
+    bool sent_first;           // First block of the sentence handed over
+    bool first_byte;
+} tts_stream_t;
+
+// Hand the block being filled to the playback task
+static void tts_stream_send(tts_stream_t *s, tts_block_kind_t kind)
+{
+    tts_block_t b = {
+        .pcm = s->block,
+        .samples = s->block_pos / 2,
+        .kind = kind,
+        .first = !s->sent_first,
+        .sample_rate = s->sample_rate,
+    };
 
-    header_buf[total_header] = '\0';
-    LOG_I("HTTP Headers received\r\n");
-
-    // Check if response uses chunked transfer encoding
-    bool is_chunked = (strstr(header_buf, "chunked") != NULL);
-    LOG_I("Transfer-Encoding: %s\r\n", is_chunked ? "chunked" : "identity");
-
-    // If chunked, skip the first chunk size line (e.g., "4102c\r\n")
-    int initial_chunk_size = 0;
-    // If chunked, skip the first chunk size line (e.g., "4102c\r\n")
-    if (is_chunked) {
-        char chunk_line[32];
-        int chunk_line_pos = 0;
-        while (chunk_line_pos < sizeof(chunk_line) - 1) {
-            int r = recv(sockfd, chunk_line + chunk_line_pos, 1, 0);
-            if (r <= 0) break;
-            if (chunk_line[chunk_line_pos] == '\n' && chunk_line_pos > 0 && chunk_line[chunk_line_pos-1] == '\r') {
-                chunk_line[chunk_line_pos-1] = '\0';
-                break;
-            }
-            chunk_line_pos++;
-        }
-        LOG_I("First chunk size: %s (hex)\r\n", chunk_line);
-        initial_chunk_size = strtol(chunk_line, NULL, 16);
-    } else {
-        initial_chunk_size = 0x7FFFFFFF;
-    }
+    xQueueSend(play_queue, &b, portMAX_DELAY);
+    s->block = NULL;
+    s->block_pos = 0;
+    s->sent_first = true;
+}
 
-    // Read WAV header
-    int wav_header_size = 44;
-    int wav_header_read = 0;
-    uint8_t wav_header[64];
-
-    while (wav_header_read < wav_header_size) {
-        int r = recv(sockfd, wav_header + wav_header_read, wav_header_size - wav_header_read, 0);
-        if (r <= 0) {
-            LOG_E("Failed to read WAV header, recv=%d\r\n", r);
-            break;
-        }
-        wav_header_read += r;
+// Take a pool block to fill; waits while playback is TTS_PCM_BLOCKS behind
+static int tts_stream_take_block(tts_stream_t *s)
+{
+    if (xQueueReceive(free_blocks, &s->block, pdMS_TO_TICKS(TTS_BLOCK_WAIT_MS)) != pdTRUE) {
+        LOG_E("Playback not draining, dropping the sentence\r\n");
+        s->block = NULL;
+        return -1;
     }
+    s->block_pos = 0;
+    return 0;
+}
+
+// Validate the WAV header and note its format
+static int tts_stream_start(tts_stream_t *s)
+{
+    uint8_t *wav_header = s->wav_header;
 
     // Debug: print first bytes received
     LOG_I("WAV header bytes[0..7]: %02X %02X %02X %02X %02X %02X %02X %02X\r\n",
@@ -335,7 +359,7 @@ int tts_synthesize_and_play_streaming(const char *text)
     if (wav_header[0] != 'R' || wav_header[1] != 'I' || wav_header[2] != 'F' || wav_header[3] != 'F') {
         LOG_E("Invalid WAV header (expected RIFF, got %c%c%c%c)\r\n",
               wav_header[0], wav_header[1], wav_header[2], wav_header[3]);
-        goto cleanup;
+        return -1;
     }
 
     // Parse WAV format info (standard WAV header layout)
@@ -361,7 +385,7 @@ int tts_synthesize_and_play_streaming(const char *text)
 
     // Find actual data offset
     int data_offset = 0;
-    for (int i = 12; i < wav_header_read - 4; i++) {
+    for (int i = 12; i < s->wav_header_read - 4; i++) {
         if (wav_header[i] == 'd' && wav_header[i+1] == 'a' &&
             wav_header[i+2] == 't' && wav_header[i+3] == 'a') {
             data_offset = i + 8;
@@ -371,204 +395,234 @@ int tts_synthesize_and_play_streaming(const char *text)
 
     if (data_offset == 0) {
         LOG_E("Could not find data chunk\r\n");
-        goto cleanup;
+        return -1;
     }
 
     LOG_I("WAV data starts at offset %d\r\n", data_offset);
 
-    // Set I2S sample rate to match TTS audio
-    set_i2s_sample_rate(sample_rate);
-
-    // Switch to playback mode
-    switch_es8388_mode(ES8388_PLAY_BACK_MODE);
-    
-    // Mute DAC before starting playback to avoid pop noise
-    extern int ES8388_Set_Voice_Volume(int volume);
-    ES8388_Set_Voice_Volume(0);  // Mute
-    
-    // Clear TX FIFO to avoid any stale data
-    bflb_i2s_feature_control(i2s0, I2S_CMD_CLEAR_TX_FIFO, 0);
-    
-    bflb_i2s_link_txdma(i2s0, true);
-    
-    // Give codec time to stabilize after mode switch
-    vTaskDelay(pdMS_TO_TICKS(100));  // Increased from 50ms to 100ms
-    
-    // Unmute DAC with a slower, smoother ramp to avoid pop
-    // Ramp from 0 to 50 in smaller steps (reduced from 60 to further minimize distortion)
-    for (int vol = 0; vol <= 50; vol += 5) {
-        ES8388_Set_Voice_Volume(vol);
-        vTaskDelay(pdMS_TO_TICKS(10)); // Slower ramp (10ms per step)
+    s->sample_rate = sample_rate;
+    if (tts_stream_take_block(s) < 0) {
+        return -1;
     }
-    ES8388_Set_Voice_Volume(50);  // Final volume (reduced to minimize clipping)
-
-    int mono_pos = 0;
 
     // If there's data after WAV header in our buffer, process it
-    if (wav_header_read > data_offset) {
-        int extra = wav_header_read - data_offset;
-        memcpy(mono_buffer, wav_header + data_offset, extra);
-        mono_pos = extra;
+    if (s->wav_header_read > data_offset) {
+        int extra = s->wav_header_read - data_offset;
+        memcpy(s->block, wav_header + data_offset, extra);
+        s->block_pos = extra;
+    } else {
+        s->skip = data_offset - s->wav_header_read;
     }
 
     LOG_I("Starting streaming playback...\r\n");
+    s->started = true;
+    return 0;
+}
 
-    // Simple double buffering without pre-fill
-    int fill_buffer_idx = 0;  
-    bool is_playing = false;
+// Response body callback: the HTTP engine has already removed the chunked
+// framing, so this only sees the WAV stream
+static int tts_on_data(void *ctx, const char *data, int len)
+{
+    tts_stream_t *s = ctx;
 
-    // Chunked encoding state
-    int chunk_remaining = initial_chunk_size;
-    if (is_chunked) {
-        chunk_remaining -= wav_header_read;
-        LOG_I("Initial chunk remaining: %d bytes\r\n", chunk_remaining);
+    if (!s->first_byte) {
+        turn_metrics_mark(TURN_MARK_TTS_FIRST_BYTE);
+        s->first_byte = true;
     }
 
-    while (1) {
-        // Receive data until we have a full chunk
-        int space = TTS_CHUNK_SIZE - mono_pos;
-        if (space > 0) {
-            // If chunked and current chunk is empty, read next chunk size
-            if (is_chunked && chunk_remaining == 0) {
-                // Read CRLF after chunk data
-                char temp[2];
-                recv(sockfd, temp, 2, 0); 
-                
-                // Read next chunk size line
-                char line[32];
-                int line_pos = 0;
-                while (line_pos < sizeof(line) - 1) {
-                    int r = recv(sockfd, line + line_pos, 1, 0);
-                    if (r <= 0) break;
-                    if (line[line_pos] == '\n' && line_pos > 0 && line[line_pos-1] == '\r') {
-                        line[line_pos-1] = '\0';
-                        break;
-                    }
-                    line_pos++;
-                }
-                
-                int next_size = strtol(line, NULL, 16);
-                // LOG_I("Next chunk: %d bytes\r\n", next_size);
-                
-                if (next_size == 0) {
-                    LOG_I("End of chunks\r\n");
-                    break; // End of stream
-                }
-                chunk_remaining = next_size;
-            }
+    // Read WAV header
+    if (!s->started) {
+        int n = TTS_WAV_HEADER_SIZE - s->wav_header_read;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s->wav_header + s->wav_header_read, data, n);
+        s->wav_header_read += n;
+        data += n;
+        len -= n;
 
-            int recv_size = (space > TTS_RECV_BUF_SIZE) ? TTS_RECV_BUF_SIZE : space;
-            if (is_chunked && recv_size > chunk_remaining) {
-                recv_size = chunk_remaining;
-            }
+        if (s->wav_header_read < TTS_WAV_HEADER_SIZE) {
+            return 0;
+        }
+        if (tts_stream_start(s) < 0) {
+            return -1;
+        }
+    }
 
-            int r = recv(sockfd, mono_buffer + mono_pos, recv_size, 0);
+    if (s->skip > 0) {
+        int n = (len < s->skip) ? len : s->skip;
+        data += n;
+        len -= n;
+        s->skip -= n;
+    }
 
-            if (r <= 0) {
-                // End of stream (unexpected if chunked)
-                LOG_I("Stream ended unexpectedly (received %d)\r\n", r);
-                break;
-            }
-            
-            if (is_chunked) {
-                chunk_remaining -= r;
-            }
-            mono_pos += r;
+    while (len > 0) {
+        if (!s->block && tts_stream_take_block(s) < 0) {
+            return -1;
+        }
+        int n = TTS_CHUNK_SIZE - s->block_pos;
+        if (n > len) {
+            n = len;
         }
+        memcpy((char *)s->block + s->block_pos, data, n);
+        s->block_pos += n;
+        data += n;
+        len -= n;
 
         // When we have a full chunk
-        if (mono_pos >= TTS_CHUNK_SIZE) {
-            int mono_samples = TTS_CHUNK_SIZE / 2;
-            uint32_t stereo_len = mono_samples * 4;
-
-            // Convert to stereo
-            mono_to_stereo((int16_t *)mono_buffer, stereo_buffers[fill_buffer_idx], mono_samples);
-            
-            // If nothing is playing, start immediately
-            if (!is_playing) {
-                play_buffer_non_blocking(stereo_buffers[fill_buffer_idx], stereo_len);
-                is_playing = true;
-            } else {
-                // Wait for previous buffer to complete with tight polling and timeout
-                uint32_t wait_start = xTaskGetTickCount();
-                while (!dma_transfer_done) {
-                    if (xTaskGetTickCount() - wait_start > pdMS_TO_TICKS(1000)) {
-                        LOG_W("DMA wait timeout in loop\r\n");
-                        break;
-                    }
-                    taskYIELD();
-                }
-                // Start playing immediately
-                play_buffer_non_blocking(stereo_buffers[fill_buffer_idx], stereo_len);
-            }
-
-            // Switch to other buffer
-            fill_buffer_idx = (fill_buffer_idx + 1) % TTS_NUM_BUFFERS;
-            mono_pos = 0;
+        if (s->block_pos >= TTS_CHUNK_SIZE) {
+            tts_stream_send(s, TTS_BLOCK_PCM);
         }
     }
-    
-    // Wait for final playback to finish
-    if (is_playing) {
-        uint32_t wait_start = xTaskGetTickCount();
-        while (!dma_transfer_done) {
-            if (xTaskGetTickCount() - wait_start > pdMS_TO_TICKS(1000)) {
-                LOG_W("DMA wait timeout at end\r\n");
-                break;
-            }
-            taskYIELD();
-        }
+    return 0;
+}
+
+// Streaming TTS synthesis and playback
+void tts_set_volume(int volume)
+{
+    if (volume < 0) {
+        volume = 0;
+    } else if (volume > 100) {
+        volume = 100;
     }
+    playback_volume = volume;
+}
 
-    // Play remaining partial data
-    if (mono_pos > 0) {
-        int mono_samples = mono_pos / 2;
-        uint32_t stereo_len = mono_samples * 4;
-        mono_to_stereo((int16_t *)mono_buffer, stereo_buffers[fill_buffer_idx], mono_samples);
-        play_buffer_non_blocking(stereo_buffers[fill_buffer_idx], stereo_len);
-        
-        uint32_t wait_start = xTaskGetTickCount();
-        while (!dma_transfer_done) {
-            if (xTaskGetTickCount() - wait_start > pdMS_TO_TICKS(1000)) {
-                LOG_W("DMA wait timeout for last chunk\r\n");
-                break;
-            }
-            taskYIELD();
+int tts_get_volume(void)
+{
+    return playback_volume;
+}
+
+int tts_client_init(void)
+{
+    if (player_task) {
+        return 0;
+    }
+
+    // Check DMA channel is available (initialized in main.c)
+    if (!dma0_ch1) {
+        LOG_E("DMA channel not initialized\r\n");
+        return -1;
+    }
+
+    dma_done = xSemaphoreCreateBinary();
+    reply_played = xSemaphoreCreateBinary();
+    play_queue = xQueueCreate(TTS_PCM_BLOCKS + 1, sizeof(tts_block_t));
+    free_blocks = xQueueCreate(TTS_PCM_BLOCKS, sizeof(int16_t *));
+    if (!dma_done || !reply_played || !play_queue || !free_blocks) {
+        LOG_E("Failed to create playback queues\r\n");
+        return -1;
+    }
+
+    // Network-side buffers can use PSRAM; DMA only reads the stereo ones
+    for (int i = 0; i < TTS_PCM_BLOCKS; i++) {
+        int16_t *block = pvPortMalloc(TTS_CHUNK_SIZE);
+        if (!block) {
+            LOG_E("Failed to allocate buffers\r\n");
+            return -1;
         }
+        xQueueSend(free_blocks, &block, 0);
     }
 
-    LOG_I("Streaming TTS complete!\r\n");
-    result = 0;
+    if (xTaskCreate(tts_player_fn, "tts_play", TTS_PLAYER_TASK_STACK, NULL,
+                    TTS_PLAYER_TASK_PRIO, &player_task) != pdPASS) {
+        LOG_E("Failed to create playback task\r\n");
+        return -1;
+    }
+    return 0;
+}
 
-cleanup:
-    // Mute DAC before stopping to avoid pop noise
-    ES8388_Set_Voice_Volume(0);
-    vTaskDelay(pdMS_TO_TICKS(20));
-    
+int tts_play_sentence(const char *text)
+{
+    if (!text || strlen(text) == 0) {
+        LOG_E("Text is empty\r\n");
+        return -1;
+    }
+    if (!player_task) {
+        LOG_E("tts_client_init() has not been called\r\n");
+        return -1;
+    }
+
+    LOG_I("Streaming TTS: %s\r\n", text);
+
+    tts_stream_t stream;
+    tts_stream_t *s = &stream;
+
+    memset(s, 0, sizeof(*s));
+
+    // Create JSON request body
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "text", text);
+    cJSON_AddStringToObject(root, "format", TTS_FORMAT);
+    cJSON_AddNumberToObject(root, "chunk_length", 200);
+    cJSON_AddBoolToObject(root, "normalize", true);
+    // Request 16kHz audio to match speaker hardware and avoid distortion
+    cJSON_AddNumberToObject(root, "sample_rate", 16000);
+    cJSON_AddNumberToObject(root, "mp3_bitrate", 192);  // Increased from 64 to 192 for better quality
+    cJSON_AddNumberToObject(root, "opus_bitrate", -1000);
+    cJSON_AddItemToObject(root, "references", cJSON_CreateArray());
 
+    // Add reference_id if configured (for voice selection)
+    #ifdef TTS_REFERENCE_ID
+    cJSON_AddStringToObject(root, "reference_id", TTS_REFERENCE_ID);
+    #endif
+
+    char *body = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
 
-    // Close socket
-    if (sockfd >= 0) {
-        close(sockfd);
+    if (!body) {
+        LOG_E("Failed to create JSON body\r\n");
+        return -1;
     }
 
-    // Stop DMA and I2S
-    if (dma0_ch1) {
-        bflb_dma_channel_stop(dma0_ch1);
+    // Audio goes to the playback task from the body callback as it arrives
+    int status = https_request_stream(TTS_API_URL, "POST", "Content-Type: application/json\r\n",
+                                      body, strlen(body), tts_on_data, s);
+    vPortFree(body);
+
+    // Whatever arrived ends on a faded-out block, also when the stream broke
+    // off, so an aborted sentence does not stop mid-waveform
+    if (s->sent_first || s->block_pos > 0) {
+        if (!s->block && tts_stream_take_block(s) < 0) {
+            return -1;
+        }
+        tts_stream_send(s, TTS_BLOCK_LAST);
+    } else if (s->block) {
+        xQueueSend(free_blocks, &s->block, 0);
     }
-    bflb_i2s_feature_control(i2s0, I2S_CMD_DATA_ENABLE, 0);
 
-    // Restore I2S sample rate to recording rate (16kHz)
-    set_i2s_sample_rate(RECORDING_SAMPLE_RATE);
+    if (status != 200 || !s->started) {
+        LOG_E("TTS request failed (status %d)\r\n", status);
+        return -1;
+    }
 
-    // Switch back to recording mode
-    switch_es8388_mode(ES8388_RECORDING_MODE);
-    bflb_i2s_link_rxdma(i2s0, true);
+    LOG_I("Streaming TTS received\r\n");
+    return 0;
+}
+
+int tts_play_end(void)
+{
+    tts_block_t b = { .pcm = NULL, .kind = TTS_BLOCK_REPLY_END };
+
+    if (!player_task) {
+        return -1;
+    }
+    xSemaphoreTake(reply_played, 0);
+    xQueueSend(play_queue, &b, portMAX_DELAY);
+    if (xSemaphoreTake(reply_played, pdMS_TO_TICKS(TTS_PLAY_END_TIMEOUT_MS)) != pdTRUE) {
+        LOG_W("Playback did not drain in time\r\n");
+        return -1;
+    }
+    return 0;
+}
 
-    // Free buffers (stereo_buffers are now static, no need to free)
-    if (recv_buf) vPortFree(recv_buf);
-    if (mono_buffer) vPortFree(mono_buffer);
+int tts_synthesize_and_play_streaming(const char *text)
+{
+    int result = tts_play_sentence(text);
 
+    if (tts_play_end() < 0) {
+        result = -1;
+    }
     return result;
 }
 
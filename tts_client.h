@@ -3,17 +3,58 @@
 
 #include <stdint.h>
 
+/**
+ * @brief Start the playback task and its buffer pool
+ *
+ * Call once after the I2S and DMA channels are set up.
+ *
+ * @return 0 on success, -1 on failure
+ */
+int tts_client_init(void);
+
+/**
+ * @brief Synthesize one sentence and queue its audio for playback
+ *
+ * Returns once the whole response has been received, which is up to one
+ * second (the buffer pool) ahead of the speaker, so the next sentence can be
+ * fetched while this one plays. The codec switches to playback with the first
+ * sentence of a reply and stays there until tts_play_end().
+ *
+ * @param text Text to convert to speech
+ * @return 0 on success, -1 on failure
+ */
+int tts_play_sentence(const char *text);
+
+/**
+ * @brief End the reply: wait for the queued audio to play out, then return
+ *        the codec to recording mode
+ *
+ * @return 0 on success, -1 if playback did not drain in time
+ */
+int tts_play_end(void);
+
 /**
  * @brief Streaming TTS - synthesize and play audio in real-time
  *
- * This function connects to the TTS server, receives audio data in chunks,
- * and plays them using double-buffered DMA for minimal memory usage and latency.
+ * A reply of one sentence: tts_play_sentence() followed by tts_play_end().
  *
  * @param text Text to convert to speech
  * @return 0 on success, -1 on failure
  */
 int tts_synthesize_and_play_streaming(const char *text);
 
+/**
+ * @brief Set the playback volume, applied from the next reply on
+ *
+ * @param volume 0-100
+ */
+void tts_set_volume(int volume);
+
+/**
+ * @brief Get the playback volume (0-100)
+ */
+int tts_get_volume(void);
+
 /**
  * @brief [DEPRECATED] Send text to Fish Speech TTS server and get audio data
  * Use tts_synthesize_and_play_streaming() instead.
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "queue.h"
+#include "log.h"
+#include "tts_client.h"
+#include "turn_metrics.h"
+#include "tts_queue.h"
+
+#define DBG_TAG "TTSQ"
+
+#define TTS_QUEUE_TASK_STACK 4096
+#define TTS_QUEUE_TASK_PRIO 14    // Below the voice task so LLM reads are not held up
+
+static QueueHandle_t sentence_queue;    // char * (heap), NULL = end of reply
+static SemaphoreHandle_t reply_done;    // Given when the worker reaches end of reply
+static TaskHandle_t tts_task;
+
+// Sentence being assembled (voice assistant task only)
+static char pending[TTS_QUEUE_SENTENCE_MAX];
+static uint32_t pending_len;
+static uint32_t sentences_queued;
+
+// Hard sentence ends; a comma ends the first clause once it is long enough
+static const char *sentence_ends[] = { "。", "！", "？", "；", "!", "?", ";", "\n" };
+static const char *clause_ends[] = { "，", "、", "," };
+
+static void tts_task_fn(void *arg) {
+    char *sentence;
+
+    while (1) {
+        if (xQueueReceive(sentence_queue, &sentence, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (!sentence) {
+            // Lets the last sentence play out, then the codec goes back to recording
+            tts_play_end();
+            xSemaphoreGive(reply_done);
+            continue;
+        }
+        // Returns once the audio is received, so the next sentence is fetched
+        // while this one is still playing
+        if (tts_play_sentence(sentence) != 0) {
+            LOG_E("TTS failed for: %s\r\n", sentence);
+        }
+        vPortFree(sentence);
+    }
+}
+
+int tts_queue_init(void) {
+    if (tts_task) {
+        return 0;
+    }
+
+    sentence_queue = xQueueCreate(TTS_QUEUE_LEN, sizeof(char *));
+    reply_done = xSemaphoreCreateBinary();
+    if (!sentence_queue || !reply_done) {
+        LOG_E("Failed to create TTS queue\r\n");
+        return -1;
+    }
+
+    if (xTaskCreate(tts_task_fn, "tts_queue", TTS_QUEUE_TASK_STACK, NULL,
+                    TTS_QUEUE_TASK_PRIO, &tts_task) != pdPASS) {
+        LOG_E("Failed to create TTS worker task\r\n");
+        return -1;
+    }
+    return 0;
+}
+
+static bool ends_with_any(const char *text, uint32_t len, const char **list, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t n = strlen(list[i]);
+        if (len >= n && memcmp(text + len - n, list[i], n) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Queue the pending text as one sentence (skipped if only whitespace)
+static void flush_pending(void) {
+    uint32_t start = 0;
+    while (start < pending_len && (pending[start] == ' ' || pending[start] == '\n')) {
+        start++;
+    }
+    if (start == pending_len) {
+        pending_len = 0;
+        return;
+    }
+
+    char *sentence = pvPortMalloc(pending_len - start + 1);
+    if (sentence) {
+        memcpy(sentence, pending + start, pending_len - start);
+        sentence[pending_len - start] = '\0';
+        if (sentences_queued == 0) {
+            turn_metrics_mark(TURN_MARK_REPLY);
+        }
+        LOG_I("Speak: %s\r\n", sentence);
+        // Blocks only if the worker is TTS_QUEUE_LEN sentences behind
+        xQueueSend(sentence_queue, &sentence, portMAX_DELAY);
+        sentences_queued++;
+    }
+    pending_len = 0;
+}
+
+void tts_queue_begin(void) {
+    pending_len = 0;
+    sentences_queued = 0;
+    xSemaphoreTake(reply_done, 0);
+}
+
+void tts_queue_feed(const char *text) {
+    while (*text) {
+        // Copy one UTF-8 character so sentences never split a code point
+        uint32_t n = 1;
+        while ((text[n] & 0xC0) == 0x80) {
+            n++;
+        }
+        if (pending_len + n >= sizeof(pending)) {
+            flush_pending();
+        }
+        memcpy(pending + pending_len, text, n);
+        pending_len += n;
+        text += n;
+
+        if (ends_with_any(pending, pending_len, sentence_ends, sizeof(sentence_ends) / sizeof(sentence_ends[0])) ||
+            (sentences_queued == 0 && pending_len >= TTS_QUEUE_CLAUSE_MIN &&
+             ends_with_any(pending, pending_len, clause_ends, sizeof(clause_ends) / sizeof(clause_ends[0])))) {
+            flush_pending();
+        }
+    }
+}
+
+int tts_queue_finish(void) {
+    char *end = NULL;
+
+    flush_pending();
+    xQueueSend(sentence_queue, &end, portMAX_DELAY);
+
+    if (xSemaphoreTake(reply_done, pdMS_TO_TICKS(TTS_QUEUE_FINISH_TIMEOUT_MS)) != pdTRUE) {
+        LOG_E("TTS playback did not finish in time\r\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,37 @@
+#ifndef __TTS_QUEUE_H__
+#define __TTS_QUEUE_H__
+
+#include <stdint.h>
+
+// Sentence pipeline between a streamed LLM reply and TTS playback: text is
+// cut into sentences as it arrives and a worker task speaks them in order,
+// so the first sentence plays while the rest is still being generated.
+#define TTS_QUEUE_LEN 8                  // Sentences waiting for the worker
+#define TTS_QUEUE_SENTENCE_MAX 512       // Longest sentence kept together (bytes)
+#define TTS_QUEUE_CLAUSE_MIN 36          // Cut the first sentence at a comma once this long
+#define TTS_QUEUE_FINISH_TIMEOUT_MS 120000
+
+/**
+ * @brief Create the sentence queue and the TTS worker task
+ * @return 0 on success, -1 on error
+ */
+int tts_queue_init(void);
+
+/**
+ * @brief Start a new reply (drops any unfinished sentence text)
+ */
+void tts_queue_begin(void);
+
+/**
+ * @brief Add reply text; every completed sentence is queued for speech
+ * @param text UTF-8 text (a streamed delta or a whole reply)
+ */
+void tts_queue_feed(const char *text);
+
+/**
+ * @brief Queue the remaining text and wait until everything has been spoken
+ * @return 0 when playback finished, -1 on timeout
+ */
+int tts_queue_finish(void);
+
+#endif // __TTS_QUEUE_H__
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+#include "turn_metrics.h"
+
+#define DBG_TAG "TURN"
+
+// A stage is the time between two marks
+typedef struct {
+    const char *name;
+    turn_mark_t from;
+    turn_mark_t to;
+} turn_stage_t;
+
+static const turn_stage_t stages[] = {
+    { "stt_session", TURN_MARK_VOICE,          TURN_MARK_SESSION },
+    { "stt_final",   TURN_MARK_SPEECH_END,     TURN_MARK_TRANSCRIPT },
+    { "llm",         TURN_MARK_TRANSCRIPT,     TURN_MARK_REPLY },
+    { "tts_ttfb",    TURN_MARK_REPLY,          TURN_MARK_TTS_FIRST_BYTE },
+    { "tts_start",   TURN_MARK_TTS_FIRST_BYTE, TURN_MARK_AUDIO_START },
+    { "response",    TURN_MARK_SPEECH_END,     TURN_MARK_AUDIO_START },  // What the user waits for
+    { "playback",    TURN_MARK_AUDIO_START,    TURN_MARK_AUDIO_END },
+};
+
+#define TURN_STAGE_COUNT (sizeof(stages) / sizeof(stages[0]))
+
+typedef struct {
+    uint32_t history[TURN_METRICS_HISTORY];
+    uint32_t count;
+    uint32_t last_ms;
+    uint32_t max_ms;
+} turn_stage_data_t;
+
+static uint32_t marks[TURN_MARK_COUNT];   // Tick time in ms, 0 = not reached
+static bool turn_active;
+static uint32_t turns;
+static turn_stage_data_t stage_data[TURN_STAGE_COUNT];
+
+static uint32_t turn_now_ms(void) {
+    uint32_t now = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    return now ? now : 1;  // 0 means "not reached"
+}
+
+void turn_metrics_begin(void) {
+    memset(marks, 0, sizeof(marks));
+    turn_active = true;
+    marks[TURN_MARK_VOICE] = turn_now_ms();
+}
+
+void turn_metrics_mark(turn_mark_t mark) {
+    if (turn_active && mark < TURN_MARK_COUNT && marks[mark] == 0) {
+        marks[mark] = turn_now_ms();
+    }
+}
+
+// Percentile of the recent samples (insertion sort, history is small)
+static void stage_percentiles(const turn_stage_data_t *data, uint32_t *p50, uint32_t *p90) {
+    uint32_t sorted[TURN_METRICS_HISTORY];
+    uint32_t n = (data->count < TURN_METRICS_HISTORY) ? data->count : TURN_METRICS_HISTORY;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = data->history[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+
+    *p50 = n ? sorted[n / 2] : 0;
+    *p90 = n ? sorted[(n * 9) / 10] : 0;
+}
+
+uint32_t turn_metrics_get(turn_stage_stats_t *stats, uint32_t max_stats) {
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < TURN_STAGE_COUNT && n < max_stats; i++, n++) {
+        const turn_stage_data_t *data = &stage_data[i];
+        stats[n].name = stages[i].name;
+        stats[n].count = data->count;
+        stats[n].last_ms = data->last_ms;
+        stats[n].max_ms = data->max_ms;
+        stage_percentiles(data, &stats[n].p50_ms, &stats[n].p90_ms);
+    }
+
+    return n;
+}
+
+void turn_metrics_end(void) {
+    char line[192] = "";
+    int len = 0;
+
+    if (!turn_active) {
+        return;
+    }
+    turn_active = false;
+    turns++;
+
+    // Only stages whose both ends were reached count; a turn that skipped
+    // TTS, for example, leaves the TTS distributions alone
+    for (uint32_t i = 0; i < TURN_STAGE_COUNT; i++) {
+        uint32_t from = marks[stages[i].from];
+        uint32_t to = marks[stages[i].to];
+        if (!from || !to || to < from) {
+            continue;
+        }
+
+        turn_stage_data_t *data = &stage_data[i];
+        uint32_t ms = to - from;
+        data->history[data->count % TURN_METRICS_HISTORY] = ms;
+        data->count++;
+        data->last_ms = ms;
+        if (ms > data->max_ms) {
+            data->max_ms = ms;
+        }
+
+        if (len < (int)sizeof(line)) {
+            len += snprintf(line + len, sizeof(line) - len, " %s=%d", stages[i].name, ms);
+        }
+    }
+    LOG_I("Turn %d latency (ms):%s\r\n", turns, line);
+
+    if (turns % TURN_METRICS_REPORT_EVERY == 0) {
+        turn_stage_stats_t stats[TURN_STAGE_COUNT];
+        uint32_t n = turn_metrics_get(stats, TURN_STAGE_COUNT);
+        LOG_I("Latency over the last %d turns (p50/p90/max ms):\r\n", TURN_METRICS_HISTORY);
+        for (uint32_t i = 0; i < n; i++) {
+            LOG_I("  %-12s %6d %6d %6d  (n=%d)\r\n", stats[i].name,
+                  stats[i].p50_ms, stats[i].p90_ms, stats[i].max_ms, stats[i].count);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef __TURN_METRICS_H__
+#define __TURN_METRICS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Per-turn latency instrumentation configuration
+#define TURN_METRICS_HISTORY 64        // Turns kept per stage for percentiles
+#define TURN_METRICS_REPORT_EVERY 10   // Log the distribution summary every N turns
+
+// Points in a turn; each is recorded once (the first mark wins)
+typedef enum {
+    TURN_MARK_VOICE = 0,         // Trigger detected voice
+    TURN_MARK_SESSION,           // STT session acquired
+    TURN_MARK_SPEECH_END,        // Endpointing ended the recording
+    TURN_MARK_TRANSCRIPT,        // Final transcript available
+    TURN_MARK_REPLY,             // First reply sentence ready for TTS
+    TURN_MARK_TTS_FIRST_BYTE,    // First byte of the TTS response
+    TURN_MARK_AUDIO_START,       // First reply audio handed to the DMA
+    TURN_MARK_AUDIO_END,         // Playback finished
+    TURN_MARK_COUNT
+} turn_mark_t;
+
+// Distribution of one stage over the recent turns
+typedef struct {
+    const char *name;
+    uint32_t count;      // Turns measured since boot
+    uint32_t last_ms;
+    uint32_t p50_ms;     // Over the last TURN_METRICS_HISTORY turns
+    uint32_t p90_ms;
+    uint32_t max_ms;     // Since boot
+} turn_stage_stats_t;
+
+/**
+ * @brief Start a new turn: clears all marks and records TURN_MARK_VOICE
+ */
+void turn_metrics_begin(void);
+
+/**
+ * @brief Record a point in the current turn (ignored if already recorded)
+ */
+void turn_metrics_mark(turn_mark_t mark);
+
+/**
+ * @brief Finish the turn: fold its stage durations into the distributions and log them
+ */
+void turn_metrics_end(void);
+
+/**
+ * @brief Get the distribution of every stage
+ * @param stats Array to fill
+ * @param max_stats Capacity of the array
+ * @return Number of stages filled
+ */
+uint32_t turn_metrics_get(turn_stage_stats_t *stats, uint32_t max_stats);
+
+#endif // __TURN_METRICS_H__
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "log.h"
+#include "audio_codec.h"
+#include "utt_queue.h"
+
+#define DBG_TAG "UTTQ"
+
+#define UTTQ_FRAME_BYTES (IMA_ADPCM_HEADER_SIZE + UTTQ_FRAME_SAMPLES / 2)
+
+// Ring of queued utterances, oldest at queue_head. Only the voice assistant
+// task touches the queue, so there is no locking.
+static utt_entry_t queue[UTTQ_MAX_ITEMS];
+static uint32_t queue_head;
+static uint32_t queue_count;
+static uint32_t queue_bytes;
+static utt_queue_metrics_t uttq_metrics;
+
+// Utterance being captured
+static utt_entry_t capture;
+static ima_adpcm_state_t capture_state;
+static uint32_t capture_frame_fill;  // Samples in the current frame
+
+static uint32_t uttq_now_ms(void) {
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static void free_entry(utt_entry_t *utt) {
+    queue_bytes -= utt->len;
+    vPortFree(utt->data);
+    memset(utt, 0, sizeof(utt_entry_t));
+}
+
+static void drop_head(void) {
+    free_entry(&queue[queue_head]);
+    queue_head = (queue_head + 1) % UTTQ_MAX_ITEMS;
+    queue_count--;
+}
+
+int utt_queue_begin(uint32_t max_frames) {
+    if (capture.data) {
+        vPortFree(capture.data);
+    }
+    memset(&capture, 0, sizeof(capture));
+    memset(&capture_state, 0, sizeof(capture_state));
+    capture_frame_fill = 0;
+
+    uint32_t frames = (max_frames + UTTQ_FRAME_SAMPLES - 1) / UTTQ_FRAME_SAMPLES;
+    capture.cap = frames * UTTQ_FRAME_BYTES;
+    capture.data = pvPortMalloc(capture.cap);
+    if (!capture.data) {
+        LOG_E("No memory to keep utterance (%d bytes)\r\n", capture.cap);
+        uttq_metrics.dropped++;
+        return -1;
+    }
+    capture.captured_ms = uttq_now_ms();
+    return 0;
+}
+
+void utt_queue_append(const int16_t *stereo, uint32_t frames) {
+    if (!capture.data) {
+        return;
+    }
+
+    while (frames > 0) {
+        if (capture_frame_fill == 0) {
+            // Frames are self-contained: seed the predictor like the uplink does
+            if (capture.len + UTTQ_FRAME_BYTES > capture.cap) {
+                return;
+            }
+            capture_state.predictor = stereo[0];
+            capture.len += ima_adpcm_write_header(&capture_state, capture.data + capture.len);
+        }
+
+        uint32_t n = UTTQ_FRAME_SAMPLES - capture_frame_fill;
+        if (n > frames) {
+            n = frames & ~1u;  // Nibbles are packed in pairs; drop an odd last sample
+            if (n == 0) {
+                return;
+            }
+        }
+        capture.len += ima_adpcm_encode(&capture_state, stereo, n, 2, capture.data + capture.len);
+        capture.samples += n;
+        capture_frame_fill = (capture_frame_fill + n) % UTTQ_FRAME_SAMPLES;
+        stereo += n * 2;
+        frames -= n;
+    }
+}
+
+void utt_queue_commit(void) {
+    if (!capture.data) {
+        return;
+    }
+    if (capture.samples == 0 || capture.len > UTTQ_MAX_BYTES) {
+        vPortFree(capture.data);
+        memset(&capture, 0, sizeof(capture));
+        uttq_metrics.dropped++;
+        return;
+    }
+
+    // Make room: newest speech is the most useful, evict from the head
+    while (queue_count == UTTQ_MAX_ITEMS || queue_bytes + capture.len > UTTQ_MAX_BYTES) {
+        LOG_W("Utterance queue full, dropping the oldest\r\n");
+        drop_head();
+        uttq_metrics.dropped++;
+    }
+
+    queue[(queue_head + queue_count) % UTTQ_MAX_ITEMS] = capture;
+    queue_count++;
+    queue_bytes += capture.len;
+    uttq_metrics.enqueued++;
+
+    LOG_I("Queued utterance: %d ms as %d bytes (%d waiting, %d bytes)\r\n",
+          capture.samples / 16, capture.len, queue_count, queue_bytes);
+    memset(&capture, 0, sizeof(capture));
+}
+
+const utt_entry_t *utt_queue_oldest(void) {
+    uint32_t now = uttq_now_ms();
+
+    while (queue_count > 0 && now - queue[queue_head].captured_ms > UTTQ_MAX_AGE_MS) {
+        LOG_W("Queued utterance expired after %d ms\r\n", now - queue[queue_head].captured_ms);
+        drop_head();
+        uttq_metrics.expired++;
+    }
+
+    return queue_count ? &queue[queue_head] : NULL;
+}
+
+uint32_t utt_queue_frame_count(const utt_entry_t *utt) {
+    return (utt->len + UTTQ_FRAME_BYTES - 1) / UTTQ_FRAME_BYTES;
+}
+
+uint32_t utt_queue_read_frame(const utt_entry_t *utt, uint32_t index, int16_t *stereo_out) {
+    uint32_t offset = index * UTTQ_FRAME_BYTES;
+    if (offset >= utt->len) {
+        return 0;
+    }
+
+    uint32_t frame_len = utt->len - offset;
+    if (frame_len > UTTQ_FRAME_BYTES) {
+        frame_len = UTTQ_FRAME_BYTES;
+    }
+
+    // Decode into the upper half, then spread to stereo front to back;
+    // writes never overtake the mono samples still to be read
+    int16_t *mono = stereo_out + UTTQ_FRAME_SAMPLES;
+    uint32_t n = ima_adpcm_decode_frame(utt->data + offset, frame_len, mono);
+    for (uint32_t i = 0; i < n; i++) {
+        int16_t s = mono[i];
+        stereo_out[2 * i] = s;
+        stereo_out[2 * i + 1] = s;
+    }
+    return n;
+}
+
+void utt_queue_pop(bool forwarded) {
+    if (queue_count == 0) {
+        return;
+    }
+    drop_head();
+    if (forwarded) {
+        uttq_metrics.forwarded++;
+    } else {
+        uttq_metrics.failed++;
+    }
+}
+
+void utt_queue_get_metrics(utt_queue_metrics_t *metrics) {
+    *metrics = uttq_metrics;
+    metrics->depth = queue_count;
+    metrics->bytes = queue_bytes;
+    metrics->oldest_age_ms = queue_count ? uttq_now_ms() - queue[queue_head].captured_ms : 0;
+}
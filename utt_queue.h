@@ -0,0 +1,85 @@
+#ifndef __UTT_QUEUE_H__
+#define __UTT_QUEUE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Store-and-forward queue for utterances captured while no STT session was
+// available. Audio is kept as mono IMA ADPCM (1/8 of the stereo capture).
+#define UTTQ_MAX_ITEMS 4
+#define UTTQ_MAX_BYTES (160 * 1024)       // Total encoded audio held
+#define UTTQ_MAX_AGE_MS 60000             // Older utterances are dropped, not answered
+#define UTTQ_FRAME_SAMPLES 4096           // Mono samples per ADPCM frame
+
+// One queued utterance
+typedef struct {
+    uint32_t captured_ms;    // Capture time (tick time)
+    uint32_t samples;        // Mono samples stored
+    uint32_t len;            // Encoded bytes used
+    uint32_t cap;            // Encoded bytes allocated
+    uint8_t *data;           // Self-contained ADPCM frames, back to back
+} utt_entry_t;
+
+// Queue metrics
+typedef struct {
+    uint32_t depth;          // Utterances waiting
+    uint32_t bytes;          // Encoded bytes waiting
+    uint32_t oldest_age_ms;  // Age of the oldest waiting utterance
+    uint32_t enqueued;
+    uint32_t forwarded;      // Uploaded and transcribed
+    uint32_t failed;         // Upload attempts that produced no transcript
+    uint32_t expired;        // Dropped for age
+    uint32_t dropped;        // Rejected or evicted because the queue was full
+} utt_queue_metrics_t;
+
+/**
+ * @brief Start capturing an utterance
+ * @param max_frames Upper bound of stereo frames that will be appended
+ * @return 0 on success, -1 if no memory (the utterance is counted as dropped)
+ */
+int utt_queue_begin(uint32_t max_frames);
+
+/**
+ * @brief Append stereo int16 capture (left channel is kept)
+ * @param stereo Interleaved stereo samples
+ * @param frames Number of stereo frames
+ */
+void utt_queue_append(const int16_t *stereo, uint32_t frames);
+
+/**
+ * @brief Queue the utterance being captured; evicts the oldest when full
+ */
+void utt_queue_commit(void);
+
+/**
+ * @brief Oldest utterance still worth forwarding; expires stale ones first
+ * @return Entry, or NULL if the queue is empty
+ */
+const utt_entry_t *utt_queue_oldest(void);
+
+/**
+ * @brief Number of ADPCM frames in an utterance
+ */
+uint32_t utt_queue_frame_count(const utt_entry_t *utt);
+
+/**
+ * @brief Decode one frame to stereo int16 (both channels equal)
+ * @param utt Entry from utt_queue_oldest()
+ * @param index Frame index
+ * @param stereo_out Output, room for 2 * UTTQ_FRAME_SAMPLES samples
+ * @return Number of stereo frames written
+ */
+uint32_t utt_queue_read_frame(const utt_entry_t *utt, uint32_t index, int16_t *stereo_out);
+
+/**
+ * @brief Remove the oldest utterance after an upload attempt
+ * @param forwarded A transcript came back
+ */
+void utt_queue_pop(bool forwarded);
+
+/**
+ * @brief Get queue metrics
+ */
+void utt_queue_get_metrics(utt_queue_metrics_t *metrics);
+
+#endif // __UTT_QUEUE_H__
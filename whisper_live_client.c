@@ -1,8 +1,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "log.h"
 
 #include <lwip/sockets.h>
@@ -10,11 +12,17 @@
 #include <lwip/tcp.h>
 #include <lwip/err.h>
 
+#define NET_IMPAIR_ENDPOINT NET_IMPAIR_STT
+#include "net_impair.h"
+
+#include "cJSON.h"
 #include "whisper_live_client.h"
+#include "dns_cache.h"
 
 #define DBG_TAG "WhisperLive"
 
 // WebSocket opcodes
+#define WS_OPCODE_CONTINUATION 0x00
 #define WS_OPCODE_TEXT 0x01
 #define WS_OPCODE_BINARY 0x02
 #define WS_OPCODE_CLOSE 0x08
@@ -123,9 +131,89 @@ static int websocket_handshake(int socket_fd, const char* host, const char* path
     return 0;
 }
 
-// Send WebSocket frame
-static int send_ws_frame(int socket_fd, uint8_t opcode, const uint8_t* payload, uint32_t payload_len) {
-    uint8_t header[14];
+// Resolve and connect with a bounded wait. lwIP's blocking connect() only
+// gives up after the SYN retries (tens of seconds), far too long to fail over.
+// Returns a blocking socket with send/receive timeouts of timeout_ms, or -1.
+static int ws_open_socket(const char *host, int port, uint32_t timeout_ms) {
+    struct sockaddr_in server_addr;
+    uint32_t addr;
+
+    // Usually answered from the cache; only a cold name waits for the resolver
+    if (dns_cache_resolve(host, &addr, timeout_ms) < 0) {
+        LOG_E("Failed to resolve hostname %s\r\n", host);
+        return -1;
+    }
+
+    // Create socket
+    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_fd < 0) {
+        LOG_E("Failed to create socket\r\n");
+        return -1;
+    }
+
+    struct timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    setsockopt(socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    // Setup server address
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = addr;
+    server_addr.sin_port = htons(port);
+
+    LOG_I("Connecting to %s:%d\r\n", host, port);
+
+    // Non-blocking connect, then wait for writability
+    int flags = fcntl(socket_fd, F_GETFL, 0);
+    fcntl(socket_fd, F_SETFL, flags | O_NONBLOCK);
+
+    int ret = connect(socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr));
+    if (ret < 0 && errno == EINPROGRESS) {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(socket_fd, &wfds);
+        if (select(socket_fd + 1, NULL, &wfds, NULL, &timeout) > 0) {
+            int err = 0;
+            socklen_t err_len = sizeof(err);
+            getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+            ret = (err == 0) ? 0 : -1;
+        } else {
+            LOG_E("Connect timed out after %d ms\r\n", timeout_ms);
+        }
+    }
+    fcntl(socket_fd, F_SETFL, flags);
+
+    if (ret < 0) {
+        LOG_E("Failed to connect to server\r\n");
+        close(socket_fd);
+        return -1;
+    }
+
+    return socket_fd;
+}
+
+// Outgoing frames are staged in TCP_MSS-sized pieces. Payload always starts at
+// WS_TX_PAYLOAD_OFFSET so it stays 32-bit aligned for masking; the header of
+// the first piece is placed right in front of it so both go out in one send().
+#define WS_MAX_HEADER_LEN 14
+#define WS_TX_PAYLOAD_OFFSET 16
+#define WS_SEND_CHUNK_SIZE (2 * TCP_MSS)
+#define WS_SEND_STALL_MS 10000  // Give up when the send buffer stays full this long
+static uint8_t ws_tx_buffer[WS_TX_PAYLOAD_OFFSET + WS_SEND_CHUNK_SIZE] __attribute__((aligned(4)));
+
+// Serializes frame writers (recorder audio vs. PONG/CLOSE from the receive task)
+// so frames never interleave on the socket and the staging buffer is not shared
+static SemaphoreHandle_t ws_tx_lock;
+static uint32_t ws_tx_stalls;  // Times a sender had to wait for send-buffer space
+
+// Produces up to max_len bytes of masked payload into dst (32-bit aligned).
+// Must return a multiple of 4 bytes unless it is the last piece of the frame.
+typedef uint32_t (*ws_payload_fill_t)(void *ctx, uint8_t *dst, uint32_t max_len, uint32_t mask32);
+
+// Build frame header (FIN=1, MASK=1) into header, returns header length
+static int ws_build_header(uint8_t *header, uint8_t opcode, uint32_t payload_len, const uint8_t mask[4]) {
     int header_len = 2;
 
     // First byte: FIN=1, RSV=0, Opcode
@@ -153,51 +241,217 @@ static int send_ws_frame(int socket_fd, uint8_t opcode, const uint8_t* payload,
         header_len = 10;
     }
 
-    // Generate masking key (simple random)
-    uint8_t mask[4];
+    // Add masking key to header
+    memcpy(&header[header_len], mask, 4);
+    return header_len + 4;
+}
+
+// Generate masking key (simple random)
+static void ws_make_mask(uint8_t mask[4]) {
     uint32_t random = xTaskGetTickCount();
     mask[0] = (random >> 24) & 0xFF;
     mask[1] = (random >> 16) & 0xFF;
     mask[2] = (random >> 8) & 0xFF;
     mask[3] = random & 0xFF;
+}
 
-    // Add masking key to header
-    memcpy(&header[header_len], mask, 4);
-    header_len += 4;
+// Send all bytes, paced by free space in the TCP send buffer
+static int ws_send_all(int socket_fd, const uint8_t *data, uint32_t len) {
+    uint32_t offset = 0;
 
-    // Send header
-    if (send(socket_fd, header, header_len, 0) < 0) {
-        LOG_E("Failed to send WebSocket header\r\n");
+    while (offset < len) {
+        // Non-blocking: take whatever the TCP send buffer has room for
+        int sent = send(socket_fd, data + offset, len - offset, MSG_DONTWAIT);
+        if (sent > 0) {
+            offset += sent;
+            continue;
+        }
+        if (sent < 0 && (errno == EWOULDBLOCK || errno == EAGAIN)) {
+            // Buffer full: sleep until lwIP reports room again (ACKs freed space)
+            fd_set wfds;
+            struct timeval tv;
+            FD_ZERO(&wfds);
+            FD_SET(socket_fd, &wfds);
+            tv.tv_sec = WS_SEND_STALL_MS / 1000;
+            tv.tv_usec = (WS_SEND_STALL_MS % 1000) * 1000;
+
+            ws_tx_stalls++;
+            if (select(socket_fd + 1, NULL, &wfds, NULL, &tv) > 0) {
+                continue;
+            }
+            LOG_E("Send stalled for %d ms\r\n", WS_SEND_STALL_MS);
+        }
         return -1;
     }
 
-    // Mask and send payload in chunks to avoid large memory allocation
-    #define WS_SEND_CHUNK_SIZE 1024
-    uint8_t chunk_buffer[WS_SEND_CHUNK_SIZE];
+    return len;
+}
+
+// Stream a data frame whose payload is produced piece by piece by fill()
+static int send_ws_frame_stream(int socket_fd, uint8_t opcode, uint32_t payload_len,
+                                ws_payload_fill_t fill, void *ctx) {
+    uint8_t header[WS_MAX_HEADER_LEN];
+    uint8_t mask[4];
+    uint32_t mask32;
     uint32_t offset = 0;
-    
-    while (offset < payload_len) {
-        uint32_t chunk_len = payload_len - offset;
-        if (chunk_len > WS_SEND_CHUNK_SIZE) {
-            chunk_len = WS_SEND_CHUNK_SIZE;
-        }
-        
-        // Copy and mask
-        for (uint32_t i = 0; i < chunk_len; i++) {
-            chunk_buffer[i] = payload[offset + i] ^ mask[(offset + i) % 4];
+    int ret = (int)payload_len;
+
+    ws_make_mask(mask);
+    memcpy(&mask32, mask, 4);  // Byte order matches the payload in memory
+
+    int header_len = ws_build_header(header, opcode, payload_len, mask);
+    uint8_t *payload = ws_tx_buffer + WS_TX_PAYLOAD_OFFSET;
+    uint8_t *piece = payload - header_len;
+
+    if (ws_tx_lock) {
+        xSemaphoreTake(ws_tx_lock, portMAX_DELAY);
+    }
+    memcpy(piece, header, header_len);
+
+    do {
+        uint32_t chunk_len = fill(ctx, payload, WS_SEND_CHUNK_SIZE, mask32);
+        if (chunk_len > payload_len - offset) {
+            chunk_len = payload_len - offset;
         }
-        
-        // Send chunk
-        int sent = send(socket_fd, chunk_buffer, chunk_len, 0);
-        if (sent < 0) {
+
+        if (ws_send_all(socket_fd, piece, (payload - piece) + chunk_len) < 0) {
             LOG_E("Failed to send WebSocket payload chunk at offset %d\r\n", offset);
-            return -1;
+            ret = -1;
+            break;
+        }
+
+        offset += chunk_len;
+        piece = payload;  // Header only goes out with the first piece
+        if (chunk_len == 0) {
+            break;
         }
-        
-        offset += sent;
+    } while (offset < payload_len);
+
+    if (ws_tx_lock) {
+        xSemaphoreGive(ws_tx_lock);
     }
+    return ret;
+}
+
+// Mask a payload piece in place, 32 bits at a time
+static void ws_mask_inplace(uint8_t *dst, uint32_t len, uint32_t mask32) {
+    uint32_t words = len / 4;
+    const uint8_t *mask = (const uint8_t *)&mask32;
+
+    for (uint32_t i = 0; i < words; i++) {
+        ((uint32_t *)dst)[i] ^= mask32;
+    }
+    for (uint32_t i = words * 4; i < len; i++) {
+        dst[i] ^= mask[i & 3];
+    }
+}
 
-    return payload_len;
+// Plain byte payload source for send_ws_frame()
+typedef struct {
+    const uint8_t *data;
+    uint32_t remaining;
+} ws_bytes_src_t;
+
+static uint32_t ws_fill_bytes(void *ctx, uint8_t *dst, uint32_t max_len, uint32_t mask32) {
+    ws_bytes_src_t *src = (ws_bytes_src_t *)ctx;
+    uint32_t len = (src->remaining < max_len) ? src->remaining : max_len;
+
+    memcpy(dst, src->data, len);
+    ws_mask_inplace(dst, len, mask32);
+
+    src->data += len;
+    src->remaining -= len;
+    return len;
+}
+
+// Send WebSocket frame
+static int send_ws_frame(int socket_fd, uint8_t opcode, const uint8_t* payload, uint32_t payload_len) {
+    ws_bytes_src_t src = { payload, payload_len };
+    return send_ws_frame_stream(socket_fd, opcode, payload_len, ws_fill_bytes, &src);
+}
+
+// Stereo int16 -> mono (left channel) payload sources, one per codec
+typedef struct {
+    const int16_t *samples;
+    uint32_t frames_left;
+    ima_adpcm_state_t adpcm;
+    bool header_sent;
+} ws_pcm16_src_t;
+
+static uint32_t ws_fill_pcm16_float(void *ctx, uint8_t *dst, uint32_t max_len, uint32_t mask32) {
+    ws_pcm16_src_t *src = (ws_pcm16_src_t *)ctx;
+    uint32_t frames = max_len / sizeof(float);
+    uint32_t *out = (uint32_t *)dst;
+
+    if (frames > src->frames_left) {
+        frames = src->frames_left;
+    }
+
+    // Convert, then mask the float's bit pattern as one 32-bit word
+    for (uint32_t i = 0; i < frames; i++) {
+        union { float f; uint32_t u; } v;
+        v.f = (float)src->samples[i * 2] / 32768.0f;
+        out[i] = v.u ^ mask32;
+    }
+
+    src->samples += frames * 2;
+    src->frames_left -= frames;
+    return frames * sizeof(float);
+}
+
+static uint32_t ws_fill_pcm16_int16(void *ctx, uint8_t *dst, uint32_t max_len, uint32_t mask32) {
+    ws_pcm16_src_t *src = (ws_pcm16_src_t *)ctx;
+    uint32_t frames = max_len / sizeof(int16_t);
+    uint32_t *out = (uint32_t *)dst;
+    uint32_t pairs;
+
+    if (frames > src->frames_left) {
+        frames = src->frames_left;
+    }
+    pairs = frames / 2;
+
+    // Two little-endian samples per masked word
+    for (uint32_t i = 0; i < pairs; i++) {
+        uint32_t lo = (uint16_t)src->samples[i * 4];
+        uint32_t hi = (uint16_t)src->samples[i * 4 + 2];
+        uint8_t w[4] = { lo & 0xFF, lo >> 8, hi & 0xFF, hi >> 8 };
+        uint32_t v;
+        memcpy(&v, w, 4);
+        out[i] = v ^ mask32;
+    }
+    if (frames & 1) {
+        uint16_t last = (uint16_t)src->samples[(frames - 1) * 2];
+        dst[pairs * 4] = last & 0xFF;
+        dst[pairs * 4 + 1] = last >> 8;
+        ws_mask_inplace(dst + pairs * 4, 2, mask32);
+    }
+
+    src->samples += frames * 2;
+    src->frames_left -= frames;
+    return frames * sizeof(int16_t);
+}
+
+static uint32_t ws_fill_pcm16_adpcm(void *ctx, uint8_t *dst, uint32_t max_len, uint32_t mask32) {
+    ws_pcm16_src_t *src = (ws_pcm16_src_t *)ctx;
+    uint32_t len = 0;
+
+    if (!src->header_sent) {
+        len = ima_adpcm_write_header(&src->adpcm, dst);
+        src->header_sent = true;
+    }
+
+    // Two samples per byte; keep the piece a multiple of 4 bytes
+    uint32_t frames = ((max_len - len) & ~3u) * 2;
+    if (frames > src->frames_left) {
+        frames = src->frames_left;
+    }
+
+    len += ima_adpcm_encode(&src->adpcm, src->samples, frames, 2, dst + len);
+    ws_mask_inplace(dst, len, mask32);
+
+    src->samples += frames * 2;
+    src->frames_left -= frames;
+    return len;
 }
 
 // Initialize WhisperLive client
@@ -209,87 +463,143 @@ int whisper_live_init(whisper_live_client_t *client, const char *server_url) {
     memset(client, 0, sizeof(whisper_live_client_t));
     client->socket_fd = -1;
 
+    if (!ws_tx_lock) {
+        ws_tx_lock = xSemaphoreCreateMutex();
+    }
+
     // Parse URL
     if (parse_ws_url(server_url, client->host, &client->port, client->path) < 0) {
         return -1;
     }
 
+    client->requested_codec = AUDIO_CODEC_FLOAT32;
+    client->codec = AUDIO_CODEC_FLOAT32;
+
     LOG_I("WhisperLive initialized: host=%s, port=%d, path=%s\r\n",
           client->host, client->port, client->path);
 
     return 0;
 }
 
-// Connect to WhisperLive server
-int whisper_live_connect(whisper_live_client_t *client) {
-    if (!client) {
+// Point the client at another server for the next connect
+int whisper_live_set_server(whisper_live_client_t *client, const char *server_url) {
+    if (!client || !server_url || client->socket_fd >= 0) {
         return -1;
     }
 
-    struct sockaddr_in server_addr;
-    struct hostent *server;
+    return parse_ws_url(server_url, client->host, &client->port, client->path);
+}
 
-    LOG_I("Resolving hostname: %s\r\n", client->host);
+// Time a TCP connect plus WebSocket upgrade, then hang up before the config
+// message so the server never allocates a transcription session
+int whisper_live_probe(const char *server_url, uint32_t timeout_ms) {
+    char host[WHISPER_LIVE_MAX_HOST_LEN];
+    char path[WHISPER_LIVE_MAX_PATH_LEN];
+    int port;
 
-    // Resolve hostname
-    server = gethostbyname(client->host);
-    if (server == NULL) {
-        LOG_E("Failed to resolve hostname\r\n");
+    if (!server_url || parse_ws_url(server_url, host, &port, path) < 0) {
         return -1;
     }
 
-    // Create socket
-    client->socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (client->socket_fd < 0) {
-        LOG_E("Failed to create socket\r\n");
+    TickType_t start = xTaskGetTickCount();
+    int socket_fd = ws_open_socket(host, port, timeout_ms);
+    if (socket_fd < 0) {
         return -1;
     }
 
-    // Set socket timeout
-    struct timeval timeout;
-    timeout.tv_sec = 10;
-    timeout.tv_usec = 0;
-    setsockopt(client->socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-    setsockopt(client->socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int ret = websocket_handshake(socket_fd, host, path);
+    uint32_t elapsed_ms = (xTaskGetTickCount() - start) * portTICK_PERIOD_MS;
+    close(socket_fd);
 
-    // Setup server address
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    memcpy(&server_addr.sin_addr.s_addr, server->h_addr, server->h_length);
-    server_addr.sin_port = htons(client->port);
+    return (ret < 0) ? -1 : (int)elapsed_ms;
+}
+
+// Select the codec to offer on the next connect
+void whisper_live_set_codec(whisper_live_client_t *client, audio_codec_t codec) {
+    if (client) {
+        client->requested_codec = codec;
+    }
+}
 
-    LOG_I("Connecting to %s:%d\r\n", client->host, client->port);
+// Pick the session codec from the SERVER_READY message; stock WhisperLive
+// does not echo "audio_codec", which means float32
+static audio_codec_t negotiate_codec(whisper_live_client_t *client, const char *response) {
+    audio_codec_t codec = AUDIO_CODEC_FLOAT32;
+    cJSON *json = cJSON_Parse(response);
+
+    if (json) {
+        cJSON *item = cJSON_GetObjectItem(json, "audio_codec");
+        if (item && cJSON_IsString(item)) {
+            int accepted = audio_codec_from_name(item->valuestring);
+            if (accepted == client->requested_codec) {
+                codec = (audio_codec_t)accepted;
+            }
+        }
+        cJSON_Delete(json);
+    }
 
-    // Connect
-    if (connect(client->socket_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        LOG_E("Failed to connect to server\r\n");
-        close(client->socket_fd);
-        client->socket_fd = -1;
+    return codec;
+}
+
+// Connect to WhisperLive server
+int whisper_live_connect(whisper_live_client_t *client) {
+    if (!client) {
         return -1;
     }
 
+    // Fresh receive state for the new stream
+    client->rx_len = 0;
+    client->rx_consumed = 0;
+    client->rx_msg_len = 0;
+    client->rx_msg_opcode = 0;
+    client->rx_skip_message = false;
+    client->rx_discard = 0;
+
+    client->socket_fd = ws_open_socket(client->host, client->port, WHISPER_LIVE_CONNECT_TIMEOUT_MS);
+    if (client->socket_fd < 0) {
+        return -1;
+    }
+
+    // TCP keepalive so a pre-warmed session whose peer vanished is noticed
+    int keepalive = 1, keepidle = 10, keepintvl = 5, keepcnt = 3;
+    setsockopt(client->socket_fd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive));
+    setsockopt(client->socket_fd, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(keepidle));
+    setsockopt(client->socket_fd, IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(keepintvl));
+    setsockopt(client->socket_fd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt));
+
     LOG_I("TCP connection established\r\n");
 
-    // Perform WebSocket handshake
+    // Perform WebSocket handshake (still under the connect timeout)
     if (websocket_handshake(client->socket_fd, client->host, client->path) < 0) {
         close(client->socket_fd);
         client->socket_fd = -1;
         return -1;
     }
 
+    // Session timeout from here on
+    struct timeval timeout;
+    timeout.tv_sec = 10;
+    timeout.tv_usec = 0;
+    setsockopt(client->socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client->socket_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    client->rx_timeout_ms = 10000;
+
     client->connected = true;
     client->config_sent = false;
     LOG_I("WhisperLive connected successfully\r\n");
 
     // Send configuration message (required by WhisperLive protocol)
     // Disable server-side VAD - device already does VAD before starting recording
-    const char *config_json = "{"
+    // "audio_codec" is ignored by stock WhisperLive and consumed by the codec gateway
+    char config_json[192];
+    snprintf(config_json, sizeof(config_json), "{"
         "\"uid\":\"aipi-voice-assistant\","
         "\"language\":\"zh\","
         "\"task\":\"transcribe\","
         "\"model\":\"small\","
-        "\"use_vad\":false"
-    "}";
+        "\"use_vad\":false,"
+        "\"audio_codec\":\"%s\""
+    "}", audio_codec_name(client->requested_codec));
 
     LOG_I("Sending WhisperLive config: %s\r\n", config_json);
     if (send_ws_frame(client->socket_fd, WS_OPCODE_TEXT, (const uint8_t*)config_json, strlen(config_json)) < 0) {
@@ -303,9 +613,19 @@ int whisper_live_connect(whisper_live_client_t *client) {
     // Wait for server ready response
     char response[512];
     int resp_len = whisper_live_recv_transcription(client, response, sizeof(response), 5000);
+    client->codec = AUDIO_CODEC_FLOAT32;
+    if (resp_len < 0) {
+        LOG_E("Server closed connection during setup\r\n");
+        close(client->socket_fd);
+        client->socket_fd = -1;
+        client->connected = false;
+        return -1;
+    }
     if (resp_len > 0) {
         LOG_I("Server response: %s\r\n", response);
+        client->codec = negotiate_codec(client, response);
     }
+    LOG_I("Uplink codec: %s\r\n", audio_codec_name(client->codec));
 
     client->config_sent = true;
     LOG_I("WhisperLive config sent successfully\r\n");
@@ -323,111 +643,306 @@ int whisper_live_send_audio(whisper_live_client_t *client, const uint8_t *audio_
     return send_ws_frame(client->socket_fd, WS_OPCODE_BINARY, audio_data, len);
 }
 
-// Receive transcription from WhisperLive server
-int whisper_live_recv_transcription(whisper_live_client_t *client, char *buffer, uint32_t buffer_size, uint32_t timeout_ms) {
-    struct timeval timeout;
-    uint8_t header[2];
-    int received;
-    uint8_t opcode, masked;
-    uint32_t payload_len;
-    int total_received;
-
-    if (!client || !client->connected || !buffer) {
-        LOG_E("recv_transcription: invalid params or not connected\r\n");
+// Send stereo int16 PCM as a mono float32 binary frame in one pass
+int whisper_live_send_audio_pcm16(whisper_live_client_t *client, const int16_t *stereo_samples, uint32_t num_frames) {
+    if (!client || !client->connected || !stereo_samples) {
         return -1;
     }
 
-    // Set timeout
-    timeout.tv_sec = timeout_ms / 1000;
-    timeout.tv_usec = (timeout_ms % 1000) * 1000;
-    setsockopt(client->socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ws_pcm16_src_t src;
+    ws_payload_fill_t fill;
 
-retry_recv:
-    // Receive WebSocket frame header
-    received = recv(client->socket_fd, header, 2, 0);
-    if (received <= 0) {
-        // Timeout or error - don't log for short timeouts (expected during streaming)
-        if (received == -1) {
-            // Check if it's just a timeout (EAGAIN/EWOULDBLOCK) vs real error
-            // In lwip, timeout returns -1 with errno EAGAIN
-            return 0;  // Treat as timeout, not fatal error
-        }
-        return received;  // 0 = connection closed
+    memset(&src, 0, sizeof(src));
+    src.samples = stereo_samples;
+    src.frames_left = num_frames;
+
+    switch (client->codec) {
+        case AUDIO_CODEC_PCM16:
+            fill = ws_fill_pcm16_int16;
+            break;
+        case AUDIO_CODEC_IMA_ADPCM:
+            // Frames are self-contained; seed the predictor with the first sample
+            src.adpcm.predictor = num_frames ? stereo_samples[0] : 0;
+            fill = ws_fill_pcm16_adpcm;
+            break;
+        case AUDIO_CODEC_FLOAT32:
+        default:
+            fill = ws_fill_pcm16_float;
+            break;
     }
 
-    opcode = header[0] & 0x0F;
-    masked = (header[1] >> 7) & 0x01;
-    payload_len = header[1] & 0x7F;
+    return send_ws_frame_stream(client->socket_fd, WS_OPCODE_BINARY,
+                                audio_codec_encoded_size(client->codec, num_frames), fill, &src);
+}
 
-    LOG_I("WS frame: opcode=%d, masked=%d, len=%d\r\n", opcode, masked, payload_len);
+// Incoming frames are parsed incrementally from recv_buffer, which is filled
+// with large recv() calls. The buffer is laid out as
+//   [0, rx_msg_len)       payload of a fragmented message being reassembled
+//   [rx_msg_len, rx_len)  raw bytes not parsed yet
+// Fragments are appended in place by sliding each payload down over its own
+// header; control frames are handled and cut out wherever they appear.
+// A single-frame message is returned without any copy.
+
+typedef struct {
+    bool fin;
+    uint8_t opcode;
+    bool masked;
+    uint8_t mask[4];
+    uint64_t payload_len;
+} ws_frame_header_t;
 
-    // Handle extended payload length
-    if (payload_len == 126) {
-        uint8_t len_bytes[2];
-        if (recv(client->socket_fd, len_bytes, 2, 0) != 2) {
-            return -1;
+// Decode a frame header; returns its length, or 0 if more bytes are needed
+static uint32_t ws_parse_header(const uint8_t *p, uint32_t avail, ws_frame_header_t *f) {
+    uint32_t header_len = 2;
+
+    if (avail < 2) {
+        return 0;
+    }
+
+    f->fin = (p[0] & 0x80) != 0;
+    f->opcode = p[0] & 0x0F;
+    f->masked = (p[1] & 0x80) != 0;
+    f->payload_len = p[1] & 0x7F;
+
+    if (f->payload_len == 126) {
+        if (avail < 4) {
+            return 0;
         }
-        payload_len = (len_bytes[0] << 8) | len_bytes[1];
-    } else if (payload_len == 127) {
-        uint8_t len_bytes[8];
-        if (recv(client->socket_fd, len_bytes, 8, 0) != 8) {
-            return -1;
+        f->payload_len = ((uint32_t)p[2] << 8) | p[3];
+        header_len = 4;
+    } else if (f->payload_len == 127) {
+        if (avail < 10) {
+            return 0;
         }
-        payload_len = (len_bytes[4] << 24) | (len_bytes[5] << 16) | (len_bytes[6] << 8) | len_bytes[7];
+        f->payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            f->payload_len = (f->payload_len << 8) | p[2 + i];
+        }
+        header_len = 10;
     }
 
-    // Skip masking key if present
-    if (masked) {
-        uint8_t mask[4];
-        recv(client->socket_fd, mask, 4, 0);
+    if (f->masked) {
+        if (avail < header_len + 4) {
+            return 0;
+        }
+        memcpy(f->mask, p + header_len, 4);
+        header_len += 4;
     }
 
-    // Handle PING frame - respond with PONG
-    if (opcode == WS_OPCODE_PING) {
-        uint8_t ping_data[125];
-        uint32_t ping_len = (payload_len < 125) ? payload_len : 125;
-        if (ping_len > 0) {
-            recv(client->socket_fd, ping_data, ping_len, 0);
+    return header_len;
+}
+
+// Remove len bytes at pos from the unparsed region
+static void ws_rx_cut(whisper_live_client_t *client, uint32_t pos, uint32_t len) {
+    memmove(client->recv_buffer + pos, client->recv_buffer + pos + len, client->rx_len - pos - len);
+    client->rx_len -= len;
+}
+
+// Append whatever the socket has; 1 on data, 0 on timeout, -1 on close/error
+static int ws_rx_fill(whisper_live_client_t *client) {
+    int received = recv(client->socket_fd, client->recv_buffer + client->rx_len,
+                        WHISPER_LIVE_RECV_BUF_SIZE - client->rx_len, 0);
+    if (received == 0) {
+        client->connected = false;  // Peer closed the connection
+        return -1;
+    }
+    if (received < 0) {
+        if (errno == EWOULDBLOCK || errno == EAGAIN) {
+            return 0;  // Timeout, not fatal
         }
-        send_ws_frame(client->socket_fd, WS_OPCODE_PONG, ping_data, ping_len);
-        goto retry_recv;
+        client->connected = false;
+        return -1;
     }
+    client->rx_len += received;
+    return 1;
+}
 
-    // Handle CLOSE frame
-    if (opcode == WS_OPCODE_CLOSE) {
-        client->connected = false;
+// Receive the next complete data message
+int whisper_live_recv_message(whisper_live_client_t *client, whisper_live_msg_t *msg, uint32_t timeout_ms) {
+    struct timeval timeout;
+    uint8_t *buf;
+    int ret;
+
+    if (!client || !client->connected || !msg) {
         return -1;
     }
+    buf = client->recv_buffer;
 
-    // Skip non-text frames
-    if (opcode != WS_OPCODE_TEXT) {
-        uint8_t drain[256];
-        while (payload_len > 0) {
-            uint32_t chunk = (payload_len < 256) ? payload_len : 256;
-            int r = recv(client->socket_fd, drain, chunk, 0);
-            if (r <= 0) break;
-            payload_len -= r;
+    // The span handed out last time is no longer needed
+    if (client->rx_consumed > 0) {
+        memmove(buf, buf + client->rx_consumed, client->rx_len - client->rx_consumed);
+        client->rx_len -= client->rx_consumed;
+        client->rx_consumed = 0;
+    }
+
+    // Set timeout only when it changes; the receive task polls with a fixed value
+    if (timeout_ms != client->rx_timeout_ms) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+        setsockopt(client->socket_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        client->rx_timeout_ms = timeout_ms;
+    }
+
+    while (1) {
+        uint32_t pos = client->rx_msg_len;
+        uint32_t avail = client->rx_len - pos;
+        ws_frame_header_t f;
+
+        // Skip the remainder of an oversize frame
+        if (client->rx_discard > 0) {
+            uint32_t n = (client->rx_discard < avail) ? (uint32_t)client->rx_discard : avail;
+            ws_rx_cut(client, pos, n);
+            client->rx_discard -= n;
+            if (client->rx_discard > 0 && (ret = ws_rx_fill(client)) <= 0) {
+                return ret;
+            }
+            continue;
+        }
+
+        uint32_t header_len = ws_parse_header(buf + pos, avail, &f);
+        if (header_len == 0 && client->rx_len == WHISPER_LIVE_RECV_BUF_SIZE) {
+            // No room left for the next fragment header behind the reassembled payload
+            LOG_W("WS message too large (%d bytes so far), dropped\r\n", client->rx_msg_len);
+            memmove(buf, buf + pos, avail);
+            client->rx_len = avail;
+            client->rx_msg_len = 0;
+            client->rx_msg_opcode = 0;
+            client->rx_skip_message = true;
+            client->rx_oversize++;
+            return WHISPER_LIVE_ERR_OVERSIZE;
+        }
+        if (header_len == 0) {
+            if ((ret = ws_rx_fill(client)) <= 0) {
+                return ret;
+            }
+            continue;
+        }
+
+        bool control = (f.opcode & 0x08) != 0;
+        uint64_t frame_len = header_len + f.payload_len;
+
+        if (control && f.payload_len > 125) {
+            LOG_E("Invalid control frame (opcode=%d, len=%d)\r\n", f.opcode, (uint32_t)f.payload_len);
+            client->connected = false;
+            return -1;
+        }
+
+        if (pos + frame_len > WHISPER_LIVE_RECV_BUF_SIZE) {
+            // Message cannot be held: drop it whole and tell the caller
+            LOG_W("WS message too large (%d + %d bytes), dropped\r\n",
+                  client->rx_msg_len, (uint32_t)f.payload_len);
+            memmove(buf, buf + pos, avail);
+            client->rx_len = avail;
+            client->rx_msg_len = 0;
+            client->rx_msg_opcode = 0;
+            client->rx_skip_message = !f.fin;
+            client->rx_discard = frame_len;
+            client->rx_oversize++;
+            return WHISPER_LIVE_ERR_OVERSIZE;
+        }
+
+        if (avail < frame_len) {
+            if ((ret = ws_rx_fill(client)) <= 0) {
+                return ret;
+            }
+            continue;
+        }
+
+        uint8_t *payload = buf + pos + header_len;
+        uint32_t payload_len = (uint32_t)f.payload_len;
+        if (f.masked) {
+            for (uint32_t i = 0; i < payload_len; i++) {
+                payload[i] ^= f.mask[i & 3];
+            }
+        }
+
+        if (control) {
+            if (f.opcode == WS_OPCODE_PING) {
+                // Respond with PONG carrying the same data
+                send_ws_frame(client->socket_fd, WS_OPCODE_PONG, payload, payload_len);
+            } else if (f.opcode == WS_OPCODE_CLOSE) {
+                client->connected = false;
+                return -1;
+            }
+            ws_rx_cut(client, pos, (uint32_t)frame_len);
+            continue;
+        }
+
+        if (client->rx_skip_message) {
+            // Continuation of a message already dropped as oversize
+            if (f.fin) {
+                client->rx_skip_message = false;
+            }
+            ws_rx_cut(client, pos, (uint32_t)frame_len);
+            continue;
+        }
+
+        if ((f.opcode == WS_OPCODE_CONTINUATION) != (client->rx_msg_opcode != 0)) {
+            LOG_W("Unexpected WS frame (opcode=%d), dropped\r\n", f.opcode);
+            ws_rx_cut(client, pos, (uint32_t)frame_len);
+            continue;
+        }
+
+        if (f.fin && pos == 0) {
+            // Single-frame message: hand out the payload in place
+            msg->data = payload;
+            msg->len = payload_len;
+            msg->is_text = (f.opcode == WS_OPCODE_TEXT);
+            client->rx_consumed = (uint32_t)frame_len;
+            return 1;
+        }
+
+        // Append this fragment to the message in progress
+        if (f.opcode != WS_OPCODE_CONTINUATION) {
+            client->rx_msg_opcode = f.opcode;
+        }
+        ws_rx_cut(client, pos, header_len);
+        client->rx_msg_len += payload_len;
+
+        if (f.fin) {
+            msg->data = buf;
+            msg->len = client->rx_msg_len;
+            msg->is_text = (client->rx_msg_opcode == WS_OPCODE_TEXT);
+            client->rx_consumed = client->rx_msg_len;
+            client->rx_msg_len = 0;
+            client->rx_msg_opcode = 0;
+            return 1;
         }
-        goto retry_recv;
     }
+}
 
-    // Receive text payload
-    if (payload_len >= buffer_size) {
-        payload_len = buffer_size - 1;
+// Receive transcription from WhisperLive server
+int whisper_live_recv_transcription(whisper_live_client_t *client, char *buffer, uint32_t buffer_size, uint32_t timeout_ms) {
+    whisper_live_msg_t msg;
+    int ret;
+
+    if (!client || !client->connected || !buffer || buffer_size == 0) {
+        LOG_E("recv_transcription: invalid params or not connected\r\n");
+        return -1;
     }
 
-    total_received = 0;
-    while (total_received < payload_len) {
-        received = recv(client->socket_fd, buffer + total_received, payload_len - total_received, 0);
-        if (received <= 0) break;
-        total_received += received;
+    // Skip non-text messages
+    do {
+        ret = whisper_live_recv_message(client, &msg, timeout_ms);
+    } while (ret == 1 && !msg.is_text);
+
+    if (ret != 1) {
+        return ret;
     }
 
-    if (total_received > 0) {
-        buffer[total_received] = '\0';
+    if (msg.len >= buffer_size) {
+        LOG_W("WS message of %d bytes does not fit %d byte buffer\r\n", msg.len, buffer_size);
+        return WHISPER_LIVE_ERR_OVERSIZE;
     }
 
-    return total_received;
+    memcpy(buffer, msg.data, msg.len);
+    buffer[msg.len] = '\0';
+    return msg.len;
+}
+
+// Number of times a sender waited for TCP send-buffer space
+uint32_t whisper_live_tx_stalls(void) {
+    return ws_tx_stalls;
 }
 
 // Send END_OF_AUDIO signal to server
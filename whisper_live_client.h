@@ -3,12 +3,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "audio_codec.h"
 
 // WhisperLive configuration
 #define WHISPER_LIVE_MAX_HOST_LEN 64
 #define WHISPER_LIVE_MAX_PATH_LEN 128
-#define WHISPER_LIVE_RECV_BUF_SIZE 2048
+#define WHISPER_LIVE_RECV_BUF_SIZE 4096  // Largest WebSocket message accepted (minus frame header)
 #define WHISPER_LIVE_CHUNK_SAMPLES 4096  // WhisperLive expects 4096 samples per chunk
+#define WHISPER_LIVE_CONNECT_TIMEOUT_MS 3000  // TCP connect plus WebSocket upgrade
+
+#define WHISPER_LIVE_ERR_OVERSIZE (-2)  // Message larger than the receive buffer, dropped
 
 // WhisperLive client handle
 typedef struct whisper_live_client_s {
@@ -18,9 +22,27 @@ typedef struct whisper_live_client_s {
     char path[WHISPER_LIVE_MAX_PATH_LEN];
     bool connected;
     bool config_sent;
+    audio_codec_t requested_codec;  // Codec offered in the session config
+    audio_codec_t codec;            // Codec accepted by the server for this session
+    uint32_t rx_timeout_ms;         // SO_RCVTIMEO currently applied to the socket
     uint8_t recv_buffer[WHISPER_LIVE_RECV_BUF_SIZE];
+    uint32_t rx_len;                // Bytes held in recv_buffer
+    uint32_t rx_consumed;           // Bytes of the last returned message, dropped on next receive
+    uint32_t rx_msg_len;            // Reassembled payload of a fragmented message in progress
+    uint8_t rx_msg_opcode;          // Opcode of the fragmented message in progress (0 = none)
+    bool rx_skip_message;           // Dropping the remaining fragments of an oversize message
+    uint64_t rx_discard;            // Bytes of an oversize frame still to skip
+    uint32_t rx_oversize;           // Messages dropped because they did not fit
 } whisper_live_client_t;
 
+// A received WebSocket data message. data points into the client's receive
+// buffer and stays valid until the next receive call on that client.
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+    bool is_text;
+} whisper_live_msg_t;
+
 /**
  * @brief Initialize WhisperLive client
  * @param client Client handle
@@ -29,6 +51,36 @@ typedef struct whisper_live_client_s {
  */
 int whisper_live_init(whisper_live_client_t *client, const char *server_url);
 
+/**
+ * @brief Select the uplink codec to offer on the next connect
+ *
+ * The server (or codec gateway) confirms the codec in its SERVER_READY
+ * message; if it does not, the session falls back to float32.
+ *
+ * @param client Client handle
+ * @param codec Codec to request
+ */
+void whisper_live_set_codec(whisper_live_client_t *client, audio_codec_t codec);
+
+/**
+ * @brief Point the client at another server for the next connect
+ * @param client Client handle (must be disconnected)
+ * @param server_url WebSocket server URL
+ * @return 0 on success, -1 on error
+ */
+int whisper_live_set_server(whisper_live_client_t *client, const char *server_url);
+
+/**
+ * @brief Measure connect plus WebSocket handshake latency of a server
+ *
+ * Closes right after the upgrade, before any session config is sent.
+ *
+ * @param server_url WebSocket server URL
+ * @param timeout_ms Limit for connect and for the handshake response
+ * @return Latency in milliseconds, -1 if unreachable
+ */
+int whisper_live_probe(const char *server_url, uint32_t timeout_ms);
+
 /**
  * @brief Connect to WhisperLive server
  * @param client Client handle
@@ -45,16 +97,53 @@ int whisper_live_connect(whisper_live_client_t *client);
  */
 int whisper_live_send_audio(whisper_live_client_t *client, const uint8_t *audio_data, uint32_t len);
 
+/**
+ * @brief Send stereo int16 PCM as mono audio (left channel) in the session codec
+ *
+ * Encoding, WebSocket masking and sending happen in a single pass over the
+ * input through a small staging buffer; no intermediate buffer is used.
+ *
+ * @param client Client handle
+ * @param stereo_samples Interleaved stereo int16 samples (L, R, L, R, ...)
+ * @param num_frames Number of stereo frames
+ * @return Number of payload bytes sent, -1 on error
+ */
+int whisper_live_send_audio_pcm16(whisper_live_client_t *client, const int16_t *stereo_samples, uint32_t num_frames);
+
+/**
+ * @brief Receive the next complete WebSocket data message
+ *
+ * Reads the socket in large blocks and decodes frames incrementally:
+ * fragmented messages are reassembled, PING is answered and CLOSE ends
+ * the session, also between fragments. The payload is returned in place.
+ *
+ * @param client Client handle
+ * @param msg Filled with a span into the receive buffer
+ * @param timeout_ms Timeout in milliseconds
+ * @return 1 on message, 0 on timeout, -1 on error or connection closed,
+ *         WHISPER_LIVE_ERR_OVERSIZE if a message was dropped for size
+ */
+int whisper_live_recv_message(whisper_live_client_t *client, whisper_live_msg_t *msg, uint32_t timeout_ms);
+
 /**
  * @brief Receive transcription from WhisperLive server
  * @param client Client handle
  * @param buffer Buffer to store transcription
  * @param buffer_size Size of buffer
  * @param timeout_ms Timeout in milliseconds
- * @return Number of bytes received, 0 on timeout, -1 on error
+ * @return Number of bytes received, 0 on timeout, -1 on error or connection closed,
+ *         WHISPER_LIVE_ERR_OVERSIZE if the message does not fit the buffer
  */
 int whisper_live_recv_transcription(whisper_live_client_t *client, char *buffer, uint32_t buffer_size, uint32_t timeout_ms);
 
+/**
+ * @brief Number of times a sender had to wait for TCP send-buffer space
+ *
+ * Sends are non-blocking and paced by lwIP's writability; this counts the
+ * waits, i.e. how often the uplink was limited by the network.
+ */
+uint32_t whisper_live_tx_stalls(void);
+
 /**
  * @brief Send END_OF_AUDIO signal to server
  * @param client Client handle